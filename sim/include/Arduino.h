@@ -0,0 +1,106 @@
+#pragma once
+
+// Arduino-ESP32 core subset for the host simulator (pio run -e sim).
+// Time comes from the simulator's virtual clock (Sim.h), heap numbers from
+// its arena, so the firmware's own bookkeeping works unchanged.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#include "pgmspace.h"
+#include "WString.h"
+#include "Printable.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+#include "Sim.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+using std::min;
+using std::max;
+using std::abs;
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+inline unsigned long millis() { return (unsigned long)(uint32_t)(sim::nowUs() / 1000); }
+inline unsigned long micros() { return (unsigned long)(uint32_t)sim::nowUs(); }
+void delay(uint32_t ms);
+inline void delayMicroseconds(uint32_t us) { sim::skipUs(us); }
+inline void yield() {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+#if !defined(__GLIBC__) || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+  const size_t n = strlen(src);
+  if (size) {
+    const size_t k = n < size - 1 ? n : size - 1;
+    memcpy(dst, src, k);
+    dst[k] = 0;
+  }
+  return n;
+}
+#endif
+
+class EspClass {
+public:
+  uint32_t getHeapSize() { return (uint32_t)sim::heapStats().size; }
+  uint32_t getFreeHeap() { return (uint32_t)sim::heapStats().freeBytes; }
+  uint32_t getMinFreeHeap() { return (uint32_t)sim::heapStats().minFree; }
+  uint32_t getMaxAllocHeap() { return (uint32_t)sim::heapStats().largestFree; }
+  uint32_t getPsramSize() { return 0; }
+  uint32_t getFreePsram() { return 0; }
+  uint64_t getEfuseMac();
+  uint32_t getCpuFreqMHz() { return 240; }
+  const char* getChipModel() { return "host"; }
+  uint8_t getChipRevision() { return 0; }
+  const char* getSdkVersion() { return "sim"; }
+  uint32_t getSketchSize();
+  uint32_t getFreeSketchSpace();
+  uint32_t getFlashChipSize() { return 4UL * 1024UL * 1024UL; }
+  void restart();
+};
+extern EspClass ESP;
+
+// stdout; nothing is ever received
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void flush() override { fflush(stdout); }
+  size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+  size_t write(const uint8_t* buf, size_t n) override { return fwrite(buf, 1, n, stdout); }
+  using Print::write;
+  operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+// The sketch
+void setup();
+void loop();
+inline size_t getArduinoLoopTaskStackSize() { return 8192; }
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Captive portal DNS: nothing to answer on the host
+class DNSServer {
+public:
+  bool start(uint16_t port, const String& domain, const IPAddress& ip) {
+    (void)port; (void)domain; (void)ip;
+    return true;
+  }
+  void stop() {}
+  void processNextRequest() {}
+};
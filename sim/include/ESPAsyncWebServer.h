@@ -0,0 +1,299 @@
+#pragma once
+
+// ESPAsyncWebServer subset. Requests come from the simulator's HTTP listener
+// (--http-port) or from sim::httpRequest() and are dispatched on the loop
+// thread between two loop() calls, so handlers never race the firmware here
+// the way they can against the AsyncTCP task on target. Request and response
+// objects live in the simulated heap. WebSockets accept no clients.
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+
+typedef enum {
+  HTTP_GET = 0b00000001,
+  HTTP_POST = 0b00000010,
+  HTTP_DELETE = 0b00000100,
+  HTTP_PUT = 0b00001000,
+  HTTP_PATCH = 0b00010000,
+  HTTP_HEAD = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, const String& filename, size_t index, uint8_t* data, size_t len,
+                           bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t* data, size_t len, size_t index, size_t total)>
+    ArBodyHandlerFunction;
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<void()> ArDisconnectHandler;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String& name, const String& value, bool form, bool file = false)
+      : _name(name), _value(value), _isForm(form), _isFile(file) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+  bool isPost() const { return _isForm; }
+  bool isFile() const { return _isFile; }
+
+private:
+  String _name;
+  String _value;
+  bool _isForm;
+  bool _isFile;
+};
+
+class AsyncWebHeader {
+public:
+  AsyncWebHeader(const String& name, const String& value) : _name(name), _value(value) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+
+private:
+  String _name;
+  String _value;
+};
+
+class AsyncWebServerResponse {
+public:
+  virtual ~AsyncWebServerResponse() {}
+  void setCode(int code) { _code = code; }
+  int code() const { return _code; }
+  void setContentType(const char* type) { _contentType = type; }
+  const String& contentType() const { return _contentType; }
+  void addHeader(const char* name, const char* value) { _headers.emplace_back(String(name), String(value)); }
+  void addHeader(const char* name, const String& value) { _headers.emplace_back(String(name), value); }
+  void addHeader(const String& name, const String& value) { _headers.emplace_back(name, value); }
+  const std::vector<AsyncWebHeader>& headers() const { return _headers; }
+
+  // Next body bytes into buf: 0 = done, RESPONSE_TRY_AGAIN = not yet
+  virtual size_t fill(uint8_t* buf, size_t maxLen) = 0;
+  virtual int64_t contentLength() const { return -1; }   // -1 = chunked
+
+protected:
+  int _code = 200;
+  String _contentType;
+  std::vector<AsyncWebHeader> _headers;
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse {
+public:
+  AsyncBasicResponse(int code, const char* type, const uint8_t* data, size_t len) {
+    _code = code;
+    _contentType = type ? type : "";
+    _body.concat(reinterpret_cast<const char*>(data), len);
+  }
+  size_t fill(uint8_t* buf, size_t maxLen) override {
+    const size_t n = min(maxLen, (size_t)_body.length() - _sent);
+    memcpy(buf, _body.c_str() + _sent, n);
+    _sent += n;
+    return n;
+  }
+  int64_t contentLength() const override { return _body.length(); }
+
+private:
+  String _body;
+  size_t _sent = 0;
+};
+
+class AsyncCallbackResponse : public AsyncWebServerResponse {
+public:
+  AsyncCallbackResponse(const char* type, int64_t len, AwsResponseFiller filler)
+      : _filler(filler), _len(len) {
+    _contentType = type ? type : "";
+  }
+  size_t fill(uint8_t* buf, size_t maxLen) override {
+    if (_len >= 0) {
+      if (_index >= (size_t)_len) return 0;
+      maxLen = min(maxLen, (size_t)_len - _index);
+    }
+    const size_t n = _filler(buf, maxLen, _index);
+    if (n != RESPONSE_TRY_AGAIN) _index += n;
+    return n;
+  }
+  int64_t contentLength() const override { return _len; }
+
+private:
+  AwsResponseFiller _filler;
+  int64_t _len;
+  size_t _index = 0;
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print {
+public:
+  AsyncResponseStream(const char* type, size_t bufferSize) {
+    _contentType = type ? type : "";
+    _body.reserve(bufferSize);
+  }
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* data, size_t len) override {
+    _body.concat(reinterpret_cast<const char*>(data), len);
+    return len;
+  }
+  using Print::write;
+  size_t fill(uint8_t* buf, size_t maxLen) override {
+    const size_t n = min(maxLen, (size_t)_body.length() - _sent);
+    memcpy(buf, _body.c_str() + _sent, n);
+    _sent += n;
+    return n;
+  }
+  int64_t contentLength() const override { return _body.length(); }
+
+private:
+  String _body;
+  size_t _sent = 0;
+};
+
+class AsyncWebServerRequest {
+public:
+  AsyncWebServerRequest(WebRequestMethodComposite method, const String& url) : _method(method), _url(url) {}
+  ~AsyncWebServerRequest();
+
+  WebRequestMethodComposite method() const { return _method; }
+  const String& url() const { return _url; }
+  size_t contentLength() const { return _contentLength; }
+  const String& contentType() const { return _contentType; }
+
+  bool hasParam(const char* name, bool post = false, bool file = false) const { return getParam(name, post, file) != nullptr; }
+  bool hasParam(const String& name, bool post = false, bool file = false) const { return hasParam(name.c_str(), post, file); }
+  const AsyncWebParameter* getParam(const char* name, bool post = false, bool file = false) const;
+  const AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const { return getParam(name.c_str(), post, file); }
+  size_t params() const { return _params.size(); }
+  const AsyncWebParameter* getParam(size_t i) const { return i < _params.size() ? &_params[i] : nullptr; }
+
+  bool hasHeader(const char* name) const { return getHeader(name) != nullptr; }
+  const AsyncWebHeader* getHeader(const char* name) const;
+
+  bool authenticate(const char* user, const char* pass) const;
+  void requestAuthentication(const char* realm = nullptr, bool digest = true);
+  void onDisconnect(ArDisconnectHandler fn) { _onDisconnect.push_back(fn); }
+
+  void send(AsyncWebServerResponse* response);
+  void send(int code, const char* type = "", const char* content = "") {
+    send(beginResponse(code, type, reinterpret_cast<const uint8_t*>(content), content ? strlen(content) : 0));
+  }
+  void send(int code, const char* type, const String& content) {
+    send(beginResponse(code, type, reinterpret_cast<const uint8_t*>(content.c_str()), content.length()));
+  }
+  void redirect(const char* url, int code = 302);
+  void redirect(const String& url, int code = 302) { redirect(url.c_str(), code); }
+
+  AsyncWebServerResponse* beginResponse(int code, const char* type = "", const char* content = "") {
+    return beginResponse(code, type, reinterpret_cast<const uint8_t*>(content), content ? strlen(content) : 0);
+  }
+  AsyncWebServerResponse* beginResponse(int code, const char* type, const String& content) {
+    return beginResponse(code, type, reinterpret_cast<const uint8_t*>(content.c_str()), content.length());
+  }
+  AsyncWebServerResponse* beginResponse(int code, const char* type, const uint8_t* data, size_t len) {
+    return new AsyncBasicResponse(code, type, data, len);
+  }
+  AsyncWebServerResponse* beginResponse(const char* type, size_t len, AwsResponseFiller filler) {
+    return new AsyncCallbackResponse(type, (int64_t)len, filler);
+  }
+  AsyncWebServerResponse* beginChunkedResponse(const char* type, AwsResponseFiller filler) {
+    return new AsyncCallbackResponse(type, -1, filler);
+  }
+  AsyncResponseStream* beginResponseStream(const char* type, size_t bufferSize = 1460) {
+    return new AsyncResponseStream(type, bufferSize);
+  }
+
+  void* _tempObject = nullptr;
+
+private:
+  friend struct SimWebAccess;
+
+  WebRequestMethodComposite _method;
+  String _url;
+  String _contentType;
+  size_t _contentLength = 0;
+  std::vector<AsyncWebParameter> _params;
+  std::vector<AsyncWebHeader> _headers;
+  std::vector<ArDisconnectHandler> _onDisconnect;
+  AsyncWebServerResponse* _response = nullptr;
+  bool _trusted = false;           // in-process request: authenticate() passes
+};
+
+class AsyncWebHandler {
+public:
+  virtual ~AsyncWebHandler() {}
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {
+public:
+  String uri;
+  WebRequestMethodComposite method = HTTP_ANY;
+  ArRequestHandlerFunction onRequest;
+  ArUploadHandlerFunction onUpload;
+  ArBodyHandlerFunction onBody;
+};
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t port) : _port(port) {}
+  ~AsyncWebServer();
+
+  void begin();
+  void end() {}
+  AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                              ArUploadHandlerFunction onUpload = nullptr, ArBodyHandlerFunction onBody = nullptr);
+  AsyncCallbackWebHandler& on(const char* uri, ArRequestHandlerFunction onRequest) { return on(uri, HTTP_ANY, onRequest); }
+  void onNotFound(ArRequestHandlerFunction fn) { _notFound = fn; }
+  AsyncWebHandler& addHandler(AsyncWebHandler* handler) { _others.push_back(handler); return *handler; }
+
+private:
+  friend struct SimWebAccess;
+
+  uint16_t _port;
+  std::vector<AsyncCallbackWebHandler*> _handlers;
+  std::vector<AsyncWebHandler*> _others;
+  ArRequestHandlerFunction _notFound;
+};
+
+// -------------------- WebSocket (no clients in the simulator) --------------------
+
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PING, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+typedef enum { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING } AwsClientStatus;
+typedef std::shared_ptr<std::vector<uint8_t>> AsyncWebSocketSharedBuffer;
+
+class AsyncWebSocket;
+
+class AsyncWebSocketClient {
+public:
+  uint32_t id() const { return _id; }
+  AwsClientStatus status() const { return WS_DISCONNECTED; }
+  size_t queueLen() const { return 0; }
+  void text(AsyncWebSocketSharedBuffer buffer) { (void)buffer; }
+  void text(const char* message) { (void)message; }
+  void close(uint16_t code = 0, const char* message = nullptr) { (void)code; (void)message; }
+
+private:
+  uint32_t _id = 0;
+};
+
+typedef std::function<void(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type, void* arg,
+                           uint8_t* data, size_t len)> AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+  explicit AsyncWebSocket(const char* url) : _url(url) {}
+  void setAuthentication(const char* user, const char* pass) { (void)user; (void)pass; }
+  void onEvent(AwsEventHandler handler) { _handler = handler; }
+  void cleanupClients(uint16_t maxClients = 8) { (void)maxClients; }
+  AsyncWebSocketClient* client(uint32_t id) { (void)id; return nullptr; }
+  size_t count() const { return 0; }
+  void textAll(const char* message) { (void)message; }
+
+private:
+  String _url;
+  AwsEventHandler _handler;
+};
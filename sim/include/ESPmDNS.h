@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+#include "mdns.h"
+
+// No multicast DNS on the host: services are accepted, browsing finds nothing
+class MDNSResponder {
+public:
+  bool begin(const char* hostName) { (void)hostName; return true; }
+  void end() {}
+  bool addService(const char* service, const char* proto, uint16_t port) {
+    (void)service; (void)proto; (void)port;
+    return true;
+  }
+  int queryService(const char* service, const char* proto) { (void)service; (void)proto; return 0; }
+  String hostname(int) { return String(); }
+  IPAddress address(int) { return IPAddress(); }
+  uint16_t port(int) { return 0; }
+  String txt(int, const char*) { return String(); }
+};
+extern MDNSResponder MDNS;
@@ -0,0 +1,100 @@
+#pragma once
+
+// FastLED subset: show() copies the pixels, with brightness and the power
+// limit applied, into a framebuffer (sim::frame()) instead of driving a pin.
+
+#include <Arduino.h>
+
+inline uint8_t scale8(uint8_t i, uint8_t scale) { return (uint8_t)(((uint16_t)i * (1 + (uint16_t)scale)) >> 8); }
+inline uint8_t scale8_video(uint8_t i, uint8_t scale) { return (uint8_t)((((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0)); }
+inline uint8_t qadd8(uint8_t a, uint8_t b) { const unsigned s = (unsigned)a + b; return s > 255 ? 255 : (uint8_t)s; }
+inline uint8_t qsub8(uint8_t a, uint8_t b) { return a > b ? (uint8_t)(a - b) : 0; }
+inline uint8_t sin8(uint8_t theta) { return (uint8_t)lround(127.5 + 127.5 * sin(theta * (2.0 * M_PI / 256.0))); }
+inline uint8_t cos8(uint8_t theta) { return sin8((uint8_t)(theta + 64)); }
+
+struct CRGB {
+  union {
+    struct {
+      uint8_t r;
+      uint8_t g;
+      uint8_t b;
+    };
+    uint8_t raw[3];
+  };
+
+  enum HTMLColorCode : uint32_t {
+    Black = 0x000000,
+    White = 0xFFFFFF,
+    Red = 0xFF0000,
+    Green = 0x008000,
+    Lime = 0x00FF00,
+    Blue = 0x0000FF,
+    Yellow = 0xFFFF00,
+    Orange = 0xFFA500,
+    Purple = 0x800080,
+    Cyan = 0x00FFFF,
+    Magenta = 0xFF00FF,
+  };
+
+  CRGB() : r(0), g(0), b(0) {}
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  CRGB(uint32_t code) : r((uint8_t)(code >> 16)), g((uint8_t)(code >> 8)), b((uint8_t)code) {}
+  CRGB(HTMLColorCode code) : CRGB((uint32_t)code) {}
+
+  CRGB& nscale8_video(uint8_t s) {
+    r = scale8_video(r, s);
+    g = scale8_video(g, s);
+    b = scale8_video(b, s);
+    return *this;
+  }
+  CRGB& nscale8(uint8_t s) {
+    r = scale8(r, s);
+    g = scale8(g, s);
+    b = scale8(b, s);
+    return *this;
+  }
+  CRGB& fadeToBlackBy(uint8_t amount) { return nscale8((uint8_t)(255 - amount)); }
+  CRGB& operator+=(const CRGB& o) { r = qadd8(r, o.r); g = qadd8(g, o.g); b = qadd8(b, o.b); return *this; }
+  bool operator==(const CRGB& o) const { return r == o.r && g == o.g && b == o.b; }
+  bool operator!=(const CRGB& o) const { return !(*this == o); }
+  uint8_t& operator[](uint8_t i) { return raw[i]; }
+};
+
+inline void fill_solid(CRGB* leds, int count, const CRGB& c) {
+  for (int i = 0; i < count; i++) leds[i] = c;
+}
+
+enum EOrder { RGB = 0012, RBG = 0021, GRB = 0102, GBR = 0120, BRG = 0201, BGR = 0210 };
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2812B {};
+template <uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2812 {};
+template <uint8_t DATA_PIN, EOrder RGB_ORDER> class SK6812 {};
+
+class CLEDController {};
+
+class CFastLED {
+public:
+  template <template <uint8_t, EOrder> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+  CLEDController& addLeds(CRGB* leds, int count) {
+    _leds = leds;
+    _count = count;
+    return _controller;
+  }
+  void setBrightness(uint8_t b) { _brightness = b; }
+  uint8_t getBrightness() const { return _brightness; }
+  void setMaxPowerInVoltsAndMilliamps(uint8_t volts, uint32_t milliamps) { _volts = volts; _maxMa = milliamps; }
+  void clear(bool writeData = false) {
+    if (_leds) fill_solid(_leds, _count, CRGB());
+    if (writeData) show();
+  }
+  void show();
+
+private:
+  CLEDController _controller;
+  CRGB*    _leds = nullptr;
+  int      _count = 0;
+  uint8_t  _brightness = 255;
+  uint8_t  _volts = 5;
+  uint32_t _maxMa = 0;
+};
+extern CFastLED FastLED;
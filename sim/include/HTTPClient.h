@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_PARTIAL_CONTENT 206
+
+// http:// only, one request per begin(), Content-Length bodies
+class HTTPClient {
+public:
+  bool begin(WiFiClient& client, const String& url);
+  void end();
+  void setReuse(bool reuse) { (void)reuse; }
+  void setTimeout(uint16_t ms) { _timeoutMs = ms; }
+  void setConnectTimeout(int32_t ms) { _connectTimeoutMs = ms; }
+  void addHeader(const String& name, const String& value);
+  void collectHeaders(const char* keys[], size_t count);
+  int GET();
+  String header(const char* name);
+  int getSize() const { return _size; }
+  WiFiClient* getStreamPtr() { return _client; }
+  WiFiClient& getStream() { return *_client; }
+  String getString();
+
+private:
+  bool readLine(String& line);
+
+  WiFiClient* _client = nullptr;
+  String   _host;
+  uint16_t _port = 80;
+  String   _path;
+  String   _extra;
+  String   _keys[8];
+  String   _values[8];
+  size_t   _keyCount = 0;
+  int      _size = -1;
+  uint16_t _timeoutMs = 5000;
+  int32_t  _connectTimeoutMs = 5000;
+};
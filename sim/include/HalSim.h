@@ -0,0 +1,107 @@
+#pragma once
+
+// Simulator implementations of the hal ports (Hal.h), selected by
+// -D BAMBUBEACON_HAL_IMPL in env:sim. Wi-Fi is the simulated station (link
+// up/down, join delay), UDP and the MQTT client are host sockets, NVS is a
+// text file per namespace under --data-dir and the LED output lands in the
+// framebuffer behind sim::frame(). No pin, no power limiter hardware.
+
+#include <Preferences.h>
+#include <WiFiClientSecure.h>
+#include <WiFiUdp.h>
+
+namespace hal {
+
+class SimWifi : public WifiPort<SimWifi> {
+public:
+  wl_status_t statusImpl() { return WiFi.status(); }
+  IPAddress localIPImpl() { return WiFi.localIP(); }
+  String macAddressImpl() { return WiFi.macAddress(); }
+
+  void modeImpl(wifi_mode_t m) { WiFi.mode(m); }
+  void setHostnameImpl(const char* name) { WiFi.setHostname(name); }
+  void setSleepImpl(bool on) { WiFi.setSleep(on); }
+  void configImpl(IPAddress ip, IPAddress gw, IPAddress sn, IPAddress dns) { WiFi.config(ip, gw, sn, dns); }
+  void beginImpl(const char* ssid, const char* pass) { WiFi.begin(ssid, pass); }
+  void disconnectImpl(bool wifiOff, bool eraseAp) { WiFi.disconnect(wifiOff, eraseAp); }
+
+  void softAPConfigImpl(IPAddress ip, IPAddress gw, IPAddress sn) { WiFi.softAPConfig(ip, gw, sn); }
+  void softAPImpl(const char* ssid) { WiFi.softAP(ssid); }
+  void softAPdisconnectImpl(bool wifiOff) { WiFi.softAPdisconnect(wifiOff); }
+  uint8_t softAPgetStationNumImpl() { return WiFi.softAPgetStationNum(); }
+
+  void scanDeleteImpl() { WiFi.scanDelete(); }
+  int16_t scanNetworksImpl(bool async, bool showHidden) { return WiFi.scanNetworks(async, showHidden); }
+  int16_t scanCompleteImpl() { return WiFi.scanComplete(); }
+};
+
+class SimUdp : public UdpPort<SimUdp> {
+public:
+  bool beginMulticastImpl(IPAddress group, uint16_t port) { return _udp.beginMulticast(group, port); }
+  void stopImpl() { _udp.stop(); }
+
+  bool beginPacketImpl(IPAddress ip, uint16_t port) { return _udp.beginPacket(ip, port); }
+  bool beginMulticastPacketImpl() { return _udp.beginMulticastPacket(); }
+  size_t writeImpl(const uint8_t* data, size_t len) { return _udp.write(data, len); }
+  bool endPacketImpl() { return _udp.endPacket(); }
+
+  int parsePacketImpl() { return _udp.parsePacket(); }
+  IPAddress remoteIPImpl() { return _udp.remoteIP(); }
+  int readImpl() { return _udp.read(); }
+  int readImpl(uint8_t* buf, size_t len) { return _udp.read(buf, len); }
+  void flushImpl() { _udp.flush(); }
+
+private:
+  WiFiUDP _udp;
+};
+
+// Plain TCP underneath (WiFiClientSecure.h): tools/printer_sim.py without --tls
+class SimTlsClient : public TlsClientPort<SimTlsClient> {
+public:
+  void setInsecureImpl() {}
+  void setHandshakeTimeoutImpl(unsigned long seconds) { (void)seconds; }
+  void setTimeoutImpl(uint32_t ms) { _net.setTimeout(ms); }
+  Client& clientImpl() { return _net; }
+
+private:
+  WiFiClientSecure _net;
+};
+
+class SimNvs : public NvsPort<SimNvs> {
+public:
+  bool beginImpl(const char* ns, bool readOnly) { return _prefs.begin(ns, readOnly); }
+  void endImpl() { _prefs.end(); }
+
+  bool getBoolImpl(const char* key, bool def) { return _prefs.getBool(key, def); }
+  int32_t getIntImpl(const char* key, int32_t def) { return _prefs.getInt(key, def); }
+  uint16_t getUShortImpl(const char* key, uint16_t def) { return _prefs.getUShort(key, def); }
+  uint32_t getUIntImpl(const char* key, uint32_t def) { return _prefs.getUInt(key, def); }
+  float getFloatImpl(const char* key, float def) { return _prefs.getFloat(key, def); }
+  String getStringImpl(const char* key, const String& def) { return _prefs.getString(key, def); }
+
+  void putBoolImpl(const char* key, bool v) { _prefs.putBool(key, v); }
+  void putIntImpl(const char* key, int32_t v) { _prefs.putInt(key, v); }
+  void putUShortImpl(const char* key, uint16_t v) { _prefs.putUShort(key, v); }
+  void putUIntImpl(const char* key, uint32_t v) { _prefs.putUInt(key, v); }
+  void putFloatImpl(const char* key, float v) { _prefs.putFloat(key, v); }
+  void putStringImpl(const char* key, const String& v) { _prefs.putString(key, v); }
+
+private:
+  Preferences _prefs;
+};
+
+class SimLedOut : public LedOutPort<SimLedOut> {
+public:
+  void attachImpl(CRGB* leds, uint16_t count) { FastLED.addLeds<WS2812B, 0, GRB>(leds, count); }
+  void setBrightnessImpl(uint8_t b) { FastLED.setBrightness(b); }
+  void setMaxCurrentImpl(uint32_t mA) { FastLED.setMaxPowerInVoltsAndMilliamps(5, mA); }
+  void showImpl() { FastLED.show(); }
+};
+
+using Wifi = SimWifi;
+using Udp = SimUdp;
+using TlsClient = SimTlsClient;
+using Nvs = SimNvs;
+using LedOut = SimLedOut;
+
+}  // namespace hal
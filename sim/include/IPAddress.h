@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "WString.h"
+#include "Printable.h"
+#include "Print.h"
+
+// IPv4 only, stored in network order like the ESP32 core
+class IPAddress : public Printable {
+public:
+  IPAddress() : _addr(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    _bytes[0] = a; _bytes[1] = b; _bytes[2] = c; _bytes[3] = d;
+  }
+  IPAddress(uint32_t addr) : _addr(addr) {}
+  IPAddress(const uint8_t* b) { for (int i = 0; i < 4; i++) _bytes[i] = b[i]; }
+
+  operator uint32_t() const { return _addr; }
+  bool operator==(const IPAddress& o) const { return _addr == o._addr; }
+  bool operator!=(const IPAddress& o) const { return _addr != o._addr; }
+  bool operator==(const uint8_t* b) const { return IPAddress(b) == *this; }
+  uint8_t operator[](int i) const { return _bytes[i]; }
+  uint8_t& operator[](int i) { return _bytes[i]; }
+  IPAddress& operator=(uint32_t a) { _addr = a; return *this; }
+
+  bool fromString(const char* s) {
+    unsigned v[4];
+    char tail;
+    if (!s || sscanf(s, "%u.%u.%u.%u%c", &v[0], &v[1], &v[2], &v[3], &tail) != 4) return false;
+    for (int i = 0; i < 4; i++) {
+      if (v[i] > 255) return false;
+      _bytes[i] = (uint8_t)v[i];
+    }
+    return true;
+  }
+  bool fromString(const String& s) { return fromString(s.c_str()); }
+
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+    return String(buf);
+  }
+  size_t printTo(Print& p) const override { return p.print(toString()); }
+
+private:
+  union {
+    uint8_t  _bytes[4];
+    uint32_t _addr;
+  };
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <functional>
+#include <string>
+
+
+// No WebSocket transport in the simulator: frames are counted and dropped
+// (Serial already carries every line to stdout)
+class WebSerial {
+public:
+  void begin(AsyncWebServer* server, const char* url = "/webserial") { (void)server; (void)url; }
+  void onMessage(std::function<void(const std::string&)> cb) { _cb = cb; }
+  void setAuthentication(const String& user, const String& pass) { (void)user; (void)pass; }
+  bool setCustomHtmlPage(const uint8_t* ptr, size_t size, const char* encoding = nullptr) {
+    (void)ptr; (void)size; (void)encoding;
+    return true;
+  }
+  bool setCustomHtmlPage(const char* ptr, const char* encoding = nullptr) { (void)ptr; (void)encoding; return true; }
+  size_t write(const uint8_t* data, size_t len) { (void)data; return len; }
+  size_t getConnectionCount() const { return 0; }
+
+private:
+  std::function<void(const std::string&)> _cb;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+// NVS stand-in: one text file per namespace under <data-dir>/nvs/, rewritten
+// on every put (NVS commits each write too)
+class Preferences {
+public:
+  ~Preferences() { end(); }
+
+  bool begin(const char* name, bool readOnly = false, const char* partition = nullptr);
+  void end();
+
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putBool(const char* key, bool v) { return putValue(key, v ? "1" : "0") ? 1 : 0; }
+  size_t putInt(const char* key, int32_t v) { return putNumber(key, (long long)v, 4); }
+  size_t putUInt(const char* key, uint32_t v) { return putNumber(key, (long long)v, 4); }
+  size_t putShort(const char* key, int16_t v) { return putNumber(key, (long long)v, 2); }
+  size_t putUShort(const char* key, uint16_t v) { return putNumber(key, (long long)v, 2); }
+  size_t putFloat(const char* key, float v);
+  size_t putString(const char* key, const char* v) { return putValue(key, v ? v : "") ? strlen(v ? v : "") : 0; }
+  size_t putString(const char* key, const String& v) { return putString(key, v.c_str()); }
+
+  bool getBool(const char* key, bool def = false) { const char* v = find(key); return v ? atoi(v) != 0 : def; }
+  int32_t getInt(const char* key, int32_t def = 0) { const char* v = find(key); return v ? (int32_t)strtoll(v, nullptr, 10) : def; }
+  uint32_t getUInt(const char* key, uint32_t def = 0) { const char* v = find(key); return v ? (uint32_t)strtoll(v, nullptr, 10) : def; }
+  int16_t getShort(const char* key, int16_t def = 0) { const char* v = find(key); return v ? (int16_t)strtol(v, nullptr, 10) : def; }
+  uint16_t getUShort(const char* key, uint16_t def = 0) { const char* v = find(key); return v ? (uint16_t)strtol(v, nullptr, 10) : def; }
+  float getFloat(const char* key, float def = NAN) { const char* v = find(key); return v ? strtof(v, nullptr) : def; }
+  String getString(const char* key, const String& def = String()) { const char* v = find(key); return v ? String(v) : def; }
+
+private:
+  bool putValue(const char* key, const char* value);
+  size_t putNumber(const char* key, long long v, size_t width) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%lld", v);
+    return putValue(key, buf) ? width : 0;
+  }
+  const char* find(const char* key);
+
+  struct Store* _store = nullptr;
+  bool _readOnly = true;
+};
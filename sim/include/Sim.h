@@ -0,0 +1,109 @@
+#pragma once
+
+// Host simulator control surface (sim/src). Not part of the Arduino API: the
+// firmware never includes this, only the shims and the simulator driver do.
+//
+// Virtual time: now = real monotonic time + skipped idle time. Code runs at
+// its real speed (so perf/valgrind profiles are meaningful), but idle time
+// (delay(), the gap to the next loop() quantum) is skipped instead of slept.
+// --speed caps virtual time at N x real time; 0 runs unpaced.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+
+namespace sim {
+
+struct Options {
+  std::string dataDir = "sim-data";
+  std::string printerIp = "127.0.0.1";
+  std::string usn = "SIM00000000001";
+  std::string accessCode = "12345678";
+  uint16_t httpPort = 8080;        // 0 = no listener
+  double   speed = 0.0;            // virtual/real cap, 0 = unpaced
+  uint32_t loopUs = 1000;          // minimum virtual time per loop()
+  uint64_t durationMs = 0;         // virtual run time, 0 = forever
+  uint32_t heapKb = 256;
+  uint32_t wifiJoinMs = 1500;
+  uint32_t seed = 1;
+  double   soakDays = 0.0;         // --soak: virtual days, 0 = no soak
+  uint32_t soakWindowMin = 60;     // virtual minutes per stats window
+  std::string soakCsv;             // one row per window, empty = none
+};
+
+const Options& options();
+
+// Clock
+int64_t  nowUs();                  // virtual
+void     skipUs(int64_t us);       // advance virtual time without running code
+void     sleepUntilUs(int64_t t);  // background tasks: block until virtual time t
+void     markLoopThread();
+bool     isLoopThread();
+
+// Heap arena behind malloc/new (--wrap) with ESP-like accounting
+struct HeapStats {
+  size_t   size = 0;
+  size_t   freeBytes = 0;
+  size_t   minFree = 0;
+  size_t   largestFree = 0;
+  uint64_t allocs = 0;             // successful allocations, cumulative
+  uint64_t frees = 0;
+  uint32_t blocks = 0;             // live allocations
+  uint32_t freeChunks = 0;         // fragments in the free list
+  uint64_t failed = 0;
+};
+void      heapInit(size_t bytes);
+HeapStats heapStats();
+
+// Allocations on this thread bypass the arena while alive (simulator plumbing)
+class HeapBypass {
+public:
+  HeapBypass();
+  ~HeapBypass();
+  HeapBypass(const HeapBypass&) = delete;
+  HeapBypass& operator=(const HeapBypass&) = delete;
+};
+
+// Wi-Fi link: the station associates wifiJoinMs after WiFi.begin()
+void setLinkUp(bool up);
+bool linkUp();
+uint32_t localAddr();              // network order
+
+// HTTP: dispatch a request through the registered AsyncWebServer handlers
+struct HttpResult {
+  int status = 0;
+  std::string contentType;
+  std::string body;
+};
+HttpResult httpRequest(const char* method, const std::string& pathAndQuery,
+                       const std::string& body = std::string(),
+                       const char* contentType = "application/x-www-form-urlencoded",
+                       bool withAuth = true);
+void startHttpListener(uint16_t port);
+void pollWeb();                    // loop thread: listener requests, chunked responses
+
+// esp_timer callbacks due by now (ESP_TIMER_TASK dispatch), on the loop thread
+void runTimers();
+
+// LED framebuffer after the last FastLED.show()
+struct Frame {
+  const uint8_t* rgb = nullptr;    // 3 bytes per LED, brightness applied
+  uint16_t count = 0;
+  uint32_t shows = 0;
+};
+Frame frame();
+
+// Accelerated soak (--soak): printer broker, scenario and per-window stats.
+// soakStart() runs before setup() and returns the broker's address.
+std::string soakStart();
+void soakTick();                   // loop thread, once per pass
+int  soakVerdict();                // exit code: 0 = no drift, 1 = degraded
+
+// ESP.restart(): thrown on the loop thread and caught by the driver, which
+// re-execs the binary with the same data directory
+struct RestartSignal {};
+void requestRestart();
+bool restartRequested();
+
+}  // namespace sim
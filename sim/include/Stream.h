@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Print.h"
+#include "Sim.h"
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long ms) { _timeout = ms; }
+  unsigned long getTimeout() const { return _timeout; }
+
+  virtual size_t readBytes(char* buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+      const int c = timedRead();
+      if (c < 0) break;
+      buffer[n++] = (char)c;
+    }
+    return n;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes(reinterpret_cast<char*>(buffer), length); }
+
+  String readString() {
+    String s;
+    for (int c; (c = timedRead()) >= 0;) s.concat((char)c);
+    return s;
+  }
+
+protected:
+  int timedRead() {
+    const int64_t until = sim::nowUs() + (int64_t)_timeout * 1000;
+    do {
+      const int c = read();
+      if (c >= 0) return c;
+      sim::skipUs(1000);
+    } while (sim::nowUs() < until);
+    return -1;
+  }
+
+  unsigned long _timeout = 1000;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+
+#define UPDATE_ERROR_OK 0
+#define UPDATE_ERROR_WRITE 1
+#define UPDATE_ERROR_SPACE 4
+#define UPDATE_ERROR_SIZE 5
+#define UPDATE_ERROR_ABORT 8
+#define UPDATE_ERROR_MAGIC_BYTE 10
+
+// Writes <data-dir>/ota.bin; end(true) turns it into app.bin, the "running
+// partition" after the next restart
+class UpdateClass {
+public:
+  bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH);
+  size_t write(uint8_t* data, size_t len);
+  bool end(bool evenIfRemaining = false);
+  void abort();
+  bool isRunning() const { return _fp != nullptr; }
+  bool hasError() const { return _error != UPDATE_ERROR_OK; }
+  uint8_t getError() const { return _error; }
+  const char* errorString() const;
+  void printError(Print& out) { out.printf("ERROR[%u]: %s\n", _error, errorString()); }
+  size_t progress() const { return _written; }
+
+private:
+  FILE*   _fp = nullptr;
+  size_t  _size = 0;
+  size_t  _written = 0;
+  uint8_t _error = UPDATE_ERROR_OK;
+};
+extern UpdateClass Update;
@@ -0,0 +1,228 @@
+#pragma once
+
+// Arduino String on malloc/realloc, so it lands in the simulated heap like
+// the target's does.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper*>(p))
+
+#ifndef DEC
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+#endif
+
+class String {
+public:
+  String(const char* s = "") { assign(s, s ? strlen(s) : 0); }
+  String(const char* s, size_t n) { assign(s, n); }
+  String(const __FlashStringHelper* s) : String(reinterpret_cast<const char*>(s)) {}
+  String(const String& o) { assign(o.c_str(), o._len); }
+  String(String&& o) noexcept : _buf(o._buf), _len(o._len), _cap(o._cap) { o._buf = nullptr; o._len = o._cap = 0; }
+  explicit String(char c) { assign(&c, 1); }
+  String(unsigned char v, unsigned char base = DEC) { fromUnsigned(v, base); }
+  String(int v, unsigned char base = DEC) { fromSigned(v, base); }
+  String(unsigned int v, unsigned char base = DEC) { fromUnsigned(v, base); }
+  String(long v, unsigned char base = DEC) { fromSigned(v, base); }
+  String(unsigned long v, unsigned char base = DEC) { fromUnsigned(v, base); }
+  String(long long v, unsigned char base = DEC) { fromSigned(v, base); }
+  String(unsigned long long v, unsigned char base = DEC) { fromUnsigned(v, base); }
+  String(float v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+  String(double v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+  ~String() { free(_buf); }
+
+  String& operator=(const String& o) { if (this != &o) assign(o.c_str(), o._len); return *this; }
+  String& operator=(String&& o) noexcept {
+    if (this != &o) {
+      free(_buf);
+      _buf = o._buf; _len = o._len; _cap = o._cap;
+      o._buf = nullptr; o._len = o._cap = 0;
+    }
+    return *this;
+  }
+  String& operator=(const char* s) { assign(s, s ? strlen(s) : 0); return *this; }
+  String& operator=(const __FlashStringHelper* s) { return *this = reinterpret_cast<const char*>(s); }
+
+  bool reserve(size_t n) { return grow(n); }
+  unsigned int length() const { return (unsigned int)_len; }
+  bool isEmpty() const { return _len == 0; }
+  const char* c_str() const { return _buf ? _buf : ""; }
+  char* begin() { return _buf; }
+  char* end() { return _buf ? _buf + _len : nullptr; }
+  const char* begin() const { return c_str(); }
+  const char* end() const { return c_str() + _len; }
+  void clear() { _len = 0; if (_buf) _buf[0] = 0; }
+  explicit operator bool() const { return true; }
+
+  bool concat(const char* s, size_t n) {
+    if (!s || !n) return true;
+    if (!grow(_len + n)) return false;
+    memmove(_buf + _len, s, n);
+    _len += n;
+    _buf[_len] = 0;
+    return true;
+  }
+  bool concat(const String& s) { return concat(s.c_str(), s._len); }
+  bool concat(const char* s) { return s ? concat(s, strlen(s)) : true; }
+  bool concat(const __FlashStringHelper* s) { return concat(reinterpret_cast<const char*>(s)); }
+  bool concat(char c) { return concat(&c, 1); }
+  bool concat(unsigned char v) { return concat(String(v)); }
+  bool concat(int v) { return concat(String(v)); }
+  bool concat(unsigned int v) { return concat(String(v)); }
+  bool concat(long v) { return concat(String(v)); }
+  bool concat(unsigned long v) { return concat(String(v)); }
+  bool concat(long long v) { return concat(String(v)); }
+  bool concat(unsigned long long v) { return concat(String(v)); }
+  bool concat(float v) { return concat(String(v)); }
+  bool concat(double v) { return concat(String(v)); }
+
+  template <typename T> String& operator+=(const T& v) { concat(v); return *this; }
+
+  // Arduino's StringSumHelper chain, collapsed to copies
+  template <typename T> friend String operator+(const String& a, const T& b) { String r(a); r.concat(b); return r; }
+  friend String operator+(const char* a, const String& b) { String r(a); r.concat(b); return r; }
+
+  int compareTo(const String& o) const { return strcmp(c_str(), o.c_str()); }
+  bool equals(const String& o) const { return _len == o._len && compareTo(o) == 0; }
+  bool equals(const char* s) const { return strcmp(c_str(), s ? s : "") == 0; }
+  bool equalsIgnoreCase(const String& o) const { return _len == o._len && strcasecmp(c_str(), o.c_str()) == 0; }
+  bool operator==(const String& o) const { return equals(o); }
+  bool operator==(const char* s) const { return equals(s); }
+  bool operator!=(const String& o) const { return !equals(o); }
+  bool operator!=(const char* s) const { return !equals(s); }
+  bool operator<(const String& o) const { return compareTo(o) < 0; }
+  friend bool operator==(const char* s, const String& o) { return o.equals(s); }
+  friend bool operator!=(const char* s, const String& o) { return !o.equals(s); }
+
+  bool startsWith(const String& p) const { return p._len <= _len && strncmp(c_str(), p.c_str(), p._len) == 0; }
+  bool startsWith(const String& p, unsigned int off) const { return off + p._len <= _len && strncmp(c_str() + off, p.c_str(), p._len) == 0; }
+  bool endsWith(const String& s) const { return s._len <= _len && strcmp(c_str() + _len - s._len, s.c_str()) == 0; }
+
+  char charAt(unsigned int i) const { return i < _len ? _buf[i] : 0; }
+  void setCharAt(unsigned int i, char c) { if (i < _len) _buf[i] = c; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  char& operator[](unsigned int i) { static char dummy; return i < _len ? _buf[i] : (dummy = 0); }
+  void getBytes(unsigned char* out, unsigned int n, unsigned int off = 0) const {
+    if (!n || !out) return;
+    size_t k = off < _len ? _len - off : 0;
+    if (k > n - 1) k = n - 1;
+    memcpy(out, c_str() + (off < _len ? off : 0), k);
+    out[k] = 0;
+  }
+  void toCharArray(char* out, unsigned int n, unsigned int off = 0) const { getBytes((unsigned char*)out, n, off); }
+
+  int indexOf(char c, unsigned int from = 0) const {
+    if (from >= _len) return -1;
+    const char* p = strchr(c_str() + from, c);
+    return p ? (int)(p - c_str()) : -1;
+  }
+  int indexOf(const String& s, unsigned int from = 0) const {
+    if (from > _len) return -1;
+    const char* p = strstr(c_str() + from, s.c_str());
+    return p ? (int)(p - c_str()) : -1;
+  }
+  int indexOf(const char* s, unsigned int from = 0) const { return indexOf(String(s), from); }
+  int lastIndexOf(char c) const {
+    const char* p = strrchr(c_str(), c);
+    return p ? (int)(p - c_str()) : -1;
+  }
+
+  String substring(unsigned int from) const { return substring(from, (unsigned int)_len); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) { unsigned int t = from; from = to; to = t; }
+    if (from >= _len) return String();
+    if (to > _len) to = (unsigned int)_len;
+    return String(c_str() + from, to - from);
+  }
+
+  void remove(unsigned int index) { if (index < _len) { _len = index; _buf[_len] = 0; } }
+  void remove(unsigned int index, unsigned int count) {
+    if (index >= _len || !count) return;
+    if (count > _len - index) count = (unsigned int)(_len - index);
+    memmove(_buf + index, _buf + index + count, _len - index - count + 1);
+    _len -= count;
+  }
+  void replace(char a, char b) { for (size_t i = 0; i < _len; i++) if (_buf[i] == a) _buf[i] = b; }
+  void replace(const String& a, const String& b) {
+    if (!a._len) return;
+    String out;
+    const char* p = c_str();
+    for (const char* q; (q = strstr(p, a.c_str())); p = q + a._len) {
+      out.concat(p, q - p);
+      out.concat(b);
+    }
+    out.concat(p);
+    *this = static_cast<String&&>(out);
+  }
+  void toLowerCase() { for (size_t i = 0; i < _len; i++) if (_buf[i] >= 'A' && _buf[i] <= 'Z') _buf[i] += 32; }
+  void toUpperCase() { for (size_t i = 0; i < _len; i++) if (_buf[i] >= 'a' && _buf[i] <= 'z') _buf[i] -= 32; }
+  void trim() {
+    if (!_len) return;
+    size_t a = 0, b = _len;
+    while (a < b && (unsigned char)_buf[a] <= ' ') a++;
+    while (b > a && (unsigned char)_buf[b - 1] <= ' ') b--;
+    memmove(_buf, _buf + a, b - a);
+    _len = b - a;
+    _buf[_len] = 0;
+  }
+
+  long toInt() const { return strtol(c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(c_str(), nullptr); }
+  double toDouble() const { return strtod(c_str(), nullptr); }
+
+private:
+  bool grow(size_t n) {
+    if (_buf && n <= _cap) return true;
+    char* p = (char*)realloc(_buf, n + 1);
+    if (!p) return false;
+    if (!_buf) p[0] = 0;
+    _buf = p;
+    _cap = n;
+    return true;
+  }
+  void assign(const char* s, size_t n) {
+    if (!s) n = 0;
+    if (!grow(n)) { clear(); return; }
+    if (n) memmove(_buf, s, n);
+    _len = n;
+    _buf[n] = 0;
+  }
+  void fromUnsigned(unsigned long long v, unsigned char base) {
+    char tmp[66];
+    char* p = tmp + sizeof(tmp) - 1;
+    *p = 0;
+    if (base < 2) base = 10;
+    do {
+      const unsigned d = (unsigned)(v % base);
+      *--p = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+      v /= base;
+    } while (v);
+    assign(p, strlen(p));
+  }
+  void fromSigned(long long v, unsigned char base) {
+    if (v < 0 && base == DEC) {
+      fromUnsigned((unsigned long long)(-(v + 1)) + 1, base);
+      String r("-");
+      r.concat(*this);
+      *this = static_cast<String&&>(r);
+    } else {
+      fromUnsigned((unsigned long long)v, base);
+    }
+  }
+  void fromDouble(double v, unsigned int decimals) {
+    char tmp[48];
+    snprintf(tmp, sizeof(tmp), "%.*f", (int)decimals, v);
+    assign(tmp, strlen(tmp));
+  }
+
+  char*  _buf = nullptr;
+  size_t _len = 0;
+  size_t _cap = 0;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+#include "WiFiUdp.h"
+
+typedef enum {
+  WL_NO_SHIELD = 255,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+  WIFI_AUTH_OPEN = 0,
+  WIFI_AUTH_WEP,
+  WIFI_AUTH_WPA_PSK,
+  WIFI_AUTH_WPA2_PSK,
+  WIFI_AUTH_WPA_WPA2_PSK,
+} wifi_auth_mode_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+// Station on the host's network: begin() associates after --wifi-join-ms of
+// virtual time, any SSID works; sim::setLinkUp(false) drops the link. The
+// scan always finds the one simulated network.
+class WiFiClass {
+public:
+  wl_status_t begin(const char* ssid, const char* pass = nullptr);
+  wl_status_t status();
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  bool mode(wifi_mode_t m) { _mode = m; return true; }
+  wifi_mode_t getMode() const { return _mode; }
+  bool config(IPAddress ip, IPAddress gw, IPAddress sn, IPAddress dns) {
+    (void)ip; (void)gw; (void)sn; (void)dns;
+    return true;
+  }
+  bool setHostname(const char* name) { (void)name; return true; }
+  bool setSleep(bool on) { (void)on; return true; }
+
+  IPAddress localIP();
+  String macAddress();
+  String SSID() const { return _ssid; }
+  int8_t RSSI() { return status() == WL_CONNECTED ? -55 : 0; }
+  int hostByName(const char* host, IPAddress& out);
+
+  bool softAP(const char* ssid, const char* pass = nullptr) { (void)ssid; (void)pass; _ap = true; return true; }
+  bool softAPConfig(IPAddress ip, IPAddress gw, IPAddress sn) { (void)gw; (void)sn; _apIp = ip; return true; }
+  bool softAPdisconnect(bool wifiOff = false) { (void)wifiOff; _ap = false; return true; }
+  IPAddress softAPIP() const { return _apIp; }
+  uint8_t softAPgetStationNum() const { return 0; }
+
+  int16_t scanNetworks(bool async = false, bool showHidden = false) { (void)async; (void)showHidden; _scanned = 1; return async ? WIFI_SCAN_RUNNING : 1; }
+  int16_t scanComplete() const { return _scanned; }
+  void scanDelete() { _scanned = WIFI_SCAN_FAILED; }
+  String SSID(uint8_t i) const { (void)i; return String("sim-net"); }
+  int32_t RSSI(uint8_t i) const { (void)i; return -55; }
+  wifi_auth_mode_t encryptionType(uint8_t i) const { (void)i; return WIFI_AUTH_WPA2_PSK; }
+  String BSSIDstr(uint8_t i) const { (void)i; return String("02:00:00:00:00:01"); }
+
+private:
+  wifi_mode_t _mode = WIFI_STA;
+  String      _ssid;
+  int64_t     _joinAtUs = -1;
+  bool        _ap = false;
+  IPAddress   _apIp;
+  int16_t     _scanned = WIFI_SCAN_FAILED;
+};
+extern WiFiClass WiFi;
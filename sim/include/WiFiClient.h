@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Real non-blocking TCP socket. Fails while the simulated link is down.
+class WiFiClient : public Client {
+public:
+  WiFiClient() {}
+  ~WiFiClient() override { stop(); }
+  WiFiClient(const WiFiClient&) = delete;
+  WiFiClient& operator=(const WiFiClient&) = delete;
+
+  int connect(IPAddress ip, uint16_t port) override { return connect(ip, port, (int32_t)_connectTimeoutMs); }
+  int connect(const char* host, uint16_t port) override { return connect(host, port, (int32_t)_connectTimeoutMs); }
+  int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+  int connect(const char* host, uint16_t port, int32_t timeoutMs);
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+  bool waitData(uint32_t timeoutMs);   // real-time wait for readable bytes
+  void setNoDelay(bool on);
+  void setConnectionTimeout(uint32_t ms) { _connectTimeoutMs = ms; }
+  IPAddress remoteIP() const { return _remote; }
+  uint16_t remotePort() const { return _remotePort; }
+
+protected:
+  int       _fd = -1;
+  bool      _eof = false;
+  IPAddress _remote;
+  uint16_t  _remotePort = 0;
+  uint32_t  _connectTimeoutMs = 3000;
+  uint32_t  _epoch = 0;             // link epoch at connect
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "WiFiClient.h"
+
+// No TLS in the simulator: plain TCP to the same host and port, so a local
+// stand-in (tools/printer_sim.py) plays the printer without certificates.
+class WiFiClientSecure : public WiFiClient {
+public:
+  void setInsecure() {}
+  void setCACert(const char* rootCA) { (void)rootCA; }
+  void setHandshakeTimeout(unsigned long seconds) { (void)seconds; }
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Real UDP socket (multicast loopback on, so several simulated beacons on one
+// host hear each other). Nothing is sent or received while the link is down.
+class WiFiUDP : public Stream {
+public:
+  WiFiUDP() {}
+  ~WiFiUDP() override { stop(); }
+  WiFiUDP(const WiFiUDP&) = delete;
+  WiFiUDP& operator=(const WiFiUDP&) = delete;
+
+  uint8_t begin(uint16_t port);
+  uint8_t begin(IPAddress addr, uint16_t port) { (void)addr; return begin(port); }
+  uint8_t beginMulticast(IPAddress group, uint16_t port);
+  void stop();
+
+  int beginPacket(IPAddress ip, uint16_t port);
+  int beginPacket(const char* host, uint16_t port);
+  int beginMulticastPacket();
+  int endPacket();
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size) override;
+  using Print::write;
+
+  int parsePacket();
+  int available() override { return (int)(_rxLen - _rxPos); }
+  int read() override { return _rxPos < _rxLen ? _rx[_rxPos++] : -1; }
+  int read(unsigned char* buf, size_t len);
+  int read(char* buf, size_t len) { return read(reinterpret_cast<unsigned char*>(buf), len); }
+  int peek() override { return _rxPos < _rxLen ? _rx[_rxPos] : -1; }
+  void flush() override { _rxPos = _rxLen; }
+
+  IPAddress remoteIP() const { return _remote; }
+  uint16_t remotePort() const { return _remotePort; }
+
+private:
+  static const size_t kMaxDatagram = 1472;
+
+  int       _fd = -1;
+  uint16_t  _port = 0;
+  IPAddress _group;
+  IPAddress _txIp;
+  uint16_t  _txPort = 0;
+  bool      _txOpen = false;
+  size_t    _txLen = 0;
+  uint8_t   _tx[kMaxDatagram];
+  size_t    _rxLen = 0;
+  size_t    _rxPos = 0;
+  uint8_t   _rx[kMaxDatagram];
+  IPAddress _remote;
+  uint16_t  _remotePort = 0;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+// ROM tinfl API on top of zlib's raw inflate. zlib's state and window live
+// in the decompressor object itself (a bump arena), so malloc(sizeof
+// tinfl_decompressor) stays the whole cost, like on target; it is larger here
+// (zlib keeps its own 32 KB window besides the caller's dictionary).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+enum {
+  TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+  TINFL_FLAG_HAS_MORE_INPUT = 2,
+  TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+  TINFL_FLAG_COMPUTE_ADLER32 = 8
+};
+
+typedef enum {
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+typedef struct tinfl_decompressor_tag {
+  z_stream z;
+  bool started;
+  size_t used;
+  alignas(16) uint8_t arena[48 * 1024];
+} tinfl_decompressor;
+
+inline void* tinfl_zalloc_(void* opaque, unsigned items, unsigned size) {
+  tinfl_decompressor* r = static_cast<tinfl_decompressor*>(opaque);
+  const size_t n = ((size_t)items * size + 15) & ~(size_t)15;
+  if (r->used + n > sizeof(r->arena)) return Z_NULL;
+  void* p = r->arena + r->used;
+  r->used += n;
+  return p;
+}
+
+inline void tinfl_zfree_(void*, void*) {}
+
+inline void tinfl_init(tinfl_decompressor* r) {
+  r->started = false;
+  r->used = 0;
+}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* in, size_t* inBytes,
+                                     uint8_t* outStart, uint8_t* outNext, size_t* outBytes, uint32_t flags) {
+  (void)outStart;
+  (void)flags;
+  if (!r->started) {
+    r->z = z_stream();
+    r->z.zalloc = tinfl_zalloc_;
+    r->z.zfree = tinfl_zfree_;
+    r->z.opaque = r;
+    if (inflateInit2(&r->z, -15) != Z_OK) return TINFL_STATUS_FAILED;
+    r->started = true;
+  }
+  r->z.next_in = const_cast<uint8_t*>(in);
+  r->z.avail_in = (uInt)*inBytes;
+  r->z.next_out = outNext;
+  r->z.avail_out = (uInt)*outBytes;
+  const int rc = inflate(&r->z, Z_NO_FLUSH);
+  *inBytes -= r->z.avail_in;
+  *outBytes -= r->z.avail_out;
+  if (rc == Z_STREAM_END) return TINFL_STATUS_DONE;
+  if (rc != Z_OK && rc != Z_BUF_ERROR) return TINFL_STATUS_FAILED;
+  return (r->z.avail_out == 0 || r->z.avail_in) ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
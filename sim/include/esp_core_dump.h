@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+
+// Core dumps go to the "coredump" partition, the file <data-dir>/coredump.bin.
+// The simulator never writes one; place a raw image there to serve it.
+#define CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH 1
+
+esp_err_t esp_core_dump_image_get(size_t* outAddr, size_t* outSize);
+esp_err_t esp_core_dump_image_erase();
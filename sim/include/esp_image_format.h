@@ -0,0 +1,11 @@
+#pragma once
+
+#include "esp_partition.h"
+
+typedef struct {
+  uint32_t start_addr;
+  uint32_t image_len;
+} esp_image_metadata_t;
+
+// image_len is the size of <data-dir>/app.bin; fails when there is none
+esp_err_t esp_image_get_metadata(const esp_partition_pos_t* part, esp_image_metadata_t* metadata);
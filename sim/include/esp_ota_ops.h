@@ -0,0 +1,14 @@
+#pragma once
+
+#include "esp_partition.h"
+
+const esp_partition_t* esp_ota_get_running_partition();
+
+typedef struct {
+  char version[32];
+  char project_name[32];
+  uint8_t app_elf_sha256[32];
+} esp_app_desc_t;
+
+// The simulator's own build: the digest is zero
+const esp_app_desc_t* esp_ota_get_app_description();
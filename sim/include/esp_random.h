@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Seeded from --seed, so runs are repeatable
+uint32_t esp_random();
+void esp_fill_random(void* buf, size_t len);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Same convention as the ROM: crc = esp_rom_crc32_le(crc, buf, len), start at 0
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "lwip/ip_addr.h"
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* ipaddr, void* callback_arg);
+
+// Answers from the host resolver right away (ERR_OK, like a cache hit);
+// ERR_VAL while the simulated link is down or the name does not resolve
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg);
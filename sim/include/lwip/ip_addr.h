@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+#define ERR_OK          0
+#define ERR_INPROGRESS  -5
+#define ERR_VAL         -6
+#define ERR_ARG         -16
+
+#define IPADDR_TYPE_V4  0U
+
+struct ip4_addr_t {
+  uint32_t addr;  // network byte order
+};
+
+typedef struct {
+  union {
+    ip4_addr_t ip4;
+  } u_addr;
+  uint8_t type;
+} ip_addr_t;
+
+#define IP_IS_V4(ipaddr) ((ipaddr)->type == IPADDR_TYPE_V4)
+#define ip_2_ip4(ipaddr) (&((ipaddr)->u_addr.ip4))
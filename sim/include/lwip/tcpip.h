@@ -0,0 +1,8 @@
+#pragma once
+
+#include "lwip/ip_addr.h"
+
+typedef void (*tcpip_callback_fn)(void* ctx);
+
+// There is no tcpip task; runs fn on the calling thread
+err_t tcpip_callback(tcpip_callback_fn function, void* ctx);
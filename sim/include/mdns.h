@@ -0,0 +1,11 @@
+#pragma once
+
+#include "esp_err.h"
+
+typedef struct {
+  const char* key;
+  const char* value;
+} mdns_txt_item_t;
+
+// Keeps the record; the simulator prints it when it changes
+esp_err_t mdns_service_txt_set(const char* service, const char* proto, mdns_txt_item_t* txt, uint8_t count);
@@ -0,0 +1,201 @@
+// Virtual clock, esp_timer, randomness and the ESP/Serial globals.
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <random>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace {
+
+using Steady = std::chrono::steady_clock;
+
+const Steady::time_point g_start = Steady::now();
+std::atomic<int64_t> g_skipped{0};
+std::mutex g_waitLock;
+std::condition_variable g_waitCv;
+std::thread::id g_loopThread;
+std::atomic<bool> g_restart{false};
+shutdown_handler_t g_shutdown[5];
+std::atomic<int> g_shutdownCount{0};
+
+int64_t realUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Steady::now() - g_start).count();
+}
+
+std::mt19937& rng() {
+  static std::mt19937 r(sim::options().seed);
+  return r;
+}
+std::mutex g_rngLock;
+
+struct Timer {
+  esp_timer_create_args_t args;
+  int64_t dueUs = -1;
+  uint64_t periodUs = 0;
+};
+std::mutex g_timerLock;
+std::vector<Timer*> g_timers;
+
+}  // namespace
+
+namespace sim {
+
+int64_t nowUs() { return realUs() + g_skipped.load(std::memory_order_relaxed); }
+
+void skipUs(int64_t us) {
+  if (us <= 0) return;
+  {
+    std::lock_guard<std::mutex> lock(g_waitLock);
+    g_skipped.fetch_add(us, std::memory_order_relaxed);
+  }
+  g_waitCv.notify_all();
+}
+
+void sleepUntilUs(int64_t t) {
+  std::unique_lock<std::mutex> lock(g_waitLock);
+  while (nowUs() < t) {
+    // Real time counts too: wake at the latest when it alone gets there
+    const int64_t left = t - nowUs();
+    g_waitCv.wait_for(lock, std::chrono::microseconds(left < 100000 ? (left > 0 ? left : 1) : 100000));
+  }
+}
+
+void markLoopThread() { g_loopThread = std::this_thread::get_id(); }
+bool isLoopThread() { return std::this_thread::get_id() == g_loopThread; }
+
+void runTimers() {
+  const int64_t now = nowUs();
+  std::vector<Timer*> due;
+  {
+    std::lock_guard<std::mutex> lock(g_timerLock);
+    for (Timer* t : g_timers) {
+      if (t->dueUs < 0 || t->dueUs > now) continue;
+      due.push_back(t);
+      t->dueUs = t->periodUs ? t->dueUs + (int64_t)t->periodUs : -1;
+    }
+  }
+  for (Timer* t : due) t->args.callback(t->args.arg);
+}
+
+void requestRestart() { g_restart = true; }
+bool restartRequested() { return g_restart; }
+
+}  // namespace sim
+
+void delay(uint32_t ms) {
+  if (sim::isLoopThread()) sim::skipUs((int64_t)ms * 1000);
+  else sim::sleepUntilUs(sim::nowUs() + (int64_t)ms * 1000);
+}
+
+long random(long max) { return max > 0 ? random(0, max) : 0; }
+
+long random(long min, long max) {
+  if (max <= min) return min;
+  std::lock_guard<std::mutex> lock(g_rngLock);
+  return min + (long)(rng()() % (uint32_t)(max - min));
+}
+
+void randomSeed(unsigned long seed) {
+  std::lock_guard<std::mutex> lock(g_rngLock);
+  rng().seed((uint32_t)seed);
+}
+
+uint32_t esp_random() {
+  std::lock_guard<std::mutex> lock(g_rngLock);
+  return rng()();
+}
+
+void esp_fill_random(void* buf, size_t len) {
+  uint8_t* p = static_cast<uint8_t*>(buf);
+  for (size_t i = 0; i < len; i++) p[i] = (uint8_t)esp_random();
+}
+
+esp_reset_reason_t esp_reset_reason() {
+  const char* r = getenv("BAMBUBEACON_SIM_RESTART");
+  return (r && *r == '1') ? ESP_RST_SW : ESP_RST_POWERON;
+}
+
+void esp_restart() { ESP.restart(); }
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) {
+  const int i = g_shutdownCount.fetch_add(1);
+  if (i >= 5) return ESP_ERR_NO_MEM;   // same table size as IDF
+  g_shutdown[i] = handler;
+  return ESP_OK;
+}
+uint32_t esp_get_free_heap_size() { return ESP.getFreeHeap(); }
+uint32_t esp_get_minimum_free_heap_size() { return ESP.getMinFreeHeap(); }
+
+void EspClass::restart() {
+  for (int i = min(g_shutdownCount.load(), 5) - 1; i >= 0; i--) g_shutdown[i]();
+  Serial.flush();
+  sim::requestRestart();
+  // Callers do not expect restart() to return: unwind to the driver, which
+  // re-execs the binary. Other tasks just stop here until it does.
+  if (sim::isLoopThread()) throw sim::RestartSignal();
+  for (;;) sim::sleepUntilUs(INT64_MAX);
+}
+
+uint64_t EspClass::getEfuseMac() {
+  // Stable per serial number, so several simulated beacons differ
+  uint64_t h = 1469598103934665603ULL;
+  for (const char* p = sim::options().usn.c_str(); *p; p++) h = (h ^ (uint8_t)*p) * 1099511628211ULL;
+  return (h & 0x0000FFFFFFFFFF00ULL) | 0x02;  // locally administered
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+  Timer* t = new Timer();
+  t->args = *args;
+  std::lock_guard<std::mutex> lock(g_timerLock);
+  g_timers.push_back(t);
+  *out = reinterpret_cast<esp_timer_handle_t>(t);
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+  Timer* t = reinterpret_cast<Timer*>(timer);
+  std::lock_guard<std::mutex> lock(g_timerLock);
+  t->dueUs = sim::nowUs() + (int64_t)timeoutUs;
+  t->periodUs = 0;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+  Timer* t = reinterpret_cast<Timer*>(timer);
+  std::lock_guard<std::mutex> lock(g_timerLock);
+  t->dueUs = sim::nowUs() + (int64_t)periodUs;
+  t->periodUs = periodUs;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  Timer* t = reinterpret_cast<Timer*>(timer);
+  std::lock_guard<std::mutex> lock(g_timerLock);
+  t->dueUs = -1;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  Timer* t = reinterpret_cast<Timer*>(timer);
+  {
+    std::lock_guard<std::mutex> lock(g_timerLock);
+    for (size_t i = 0; i < g_timers.size(); i++) {
+      if (g_timers[i] == t) {
+        g_timers.erase(g_timers.begin() + i);
+        break;
+      }
+    }
+  }
+  delete t;
+  return ESP_OK;
+}
@@ -0,0 +1,282 @@
+// Simulated heap: a fixed arena behind malloc/free/realloc/calloc (linker
+// --wrap) and operator new/delete, so getFreeHeap()/getMaxAllocHeap() and
+// fragmentation behave like on target instead of reporting the host's
+// gigabytes. Address-ordered first fit with boundary tags and immediate
+// coalescing; allocation failure returns nullptr (new aborts), as on target.
+// Pointers from before the arena existed or from HeapBypass threads go to
+// the real allocator and are recognised by address on free.
+
+#include <Sim.h>
+#include <esp_heap_caps.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <new>
+
+extern "C" {
+void* __real_malloc(size_t n);
+void  __real_free(void* p);
+void* __real_realloc(void* p, size_t n);
+void* __real_calloc(size_t n, size_t size);
+}
+
+namespace {
+
+constexpr size_t kAlign = 16;
+constexpr size_t kHdr = 16;
+constexpr size_t kMinBlock = 32;
+constexpr size_t kMaxArena = 8UL * 1024UL * 1024UL;
+constexpr size_t kUsed = 1;
+
+struct Block {
+  size_t size;       // whole block incl. header; bit 0 = used
+  size_t prevSize;   // size of the block before, 0 for the first
+  // free blocks only:
+  Block* next;
+  Block* prev;
+};
+
+alignas(kAlign) uint8_t g_arena[kMaxArena];
+std::mutex g_lock;
+size_t g_limit = 0;              // arena bytes in use as heap (0 = not initialised)
+Block* g_free = nullptr;         // address-ordered
+Block* g_last = nullptr;         // highest block
+sim::HeapStats g_stats;
+thread_local int t_bypass = 0;
+bool g_host = false;             // --heap-kb 0: everything to the host allocator (valgrind, ASan)
+
+inline size_t sizeOf(const Block* b) { return b->size & ~kUsed; }
+inline bool isUsed(const Block* b) { return b->size & kUsed; }
+inline Block* nextOf(Block* b) {
+  uint8_t* n = reinterpret_cast<uint8_t*>(b) + sizeOf(b);
+  return n < g_arena + g_limit ? reinterpret_cast<Block*>(n) : nullptr;
+}
+inline Block* prevOf(Block* b) {
+  return b->prevSize ? reinterpret_cast<Block*>(reinterpret_cast<uint8_t*>(b) - b->prevSize) : nullptr;
+}
+inline bool inArena(const void* p) {
+  return p >= g_arena + kHdr && p < g_arena + kMaxArena;
+}
+
+void unlink(Block* b) {
+  if (b->prev) b->prev->next = b->next;
+  else g_free = b->next;
+  if (b->next) b->next->prev = b->prev;
+}
+
+void insert(Block* b) {
+  Block* prev = nullptr;
+  Block* cur = g_free;
+  while (cur && cur < b) {
+    prev = cur;
+    cur = cur->next;
+  }
+  b->prev = prev;
+  b->next = cur;
+  if (prev) prev->next = b;
+  else g_free = b;
+  if (cur) cur->prev = b;
+}
+
+void setSize(Block* b, size_t size, bool used) {
+  b->size = size | (used ? kUsed : 0);
+  Block* n = nextOf(b);
+  if (n) n->prevSize = size;
+  else g_last = b;
+}
+
+// Lock held. Grows the arena to `bytes` (never shrinks).
+void grow(size_t bytes) {
+  bytes &= ~(kAlign - 1);
+  if (bytes > kMaxArena) bytes = kMaxArena;
+  if (bytes <= g_limit + kMinBlock) return;
+  const size_t added = bytes - g_limit;
+  Block* b = reinterpret_cast<Block*>(g_arena + g_limit);
+  b->prevSize = g_last ? sizeOf(g_last) : 0;
+  Block* last = g_last;
+  g_limit = bytes;
+  setSize(b, added, false);
+  g_stats.size += added;
+  g_stats.freeBytes += added;
+  g_stats.minFree += added;
+  if (last && !isUsed(last)) {
+    // Merge into the free tail
+    setSize(last, sizeOf(last) + added, false);
+  } else {
+    insert(b);
+    g_stats.freeChunks++;
+  }
+}
+
+void ensureInit() {
+  if (!g_limit) grow(256UL * 1024UL);
+}
+
+void* arenaAlloc(size_t n) {
+  std::lock_guard<std::mutex> lock(g_lock);
+  ensureInit();
+  // Larger than the whole arena: fail here, before the rounding can wrap
+  if (n > kMaxArena) {
+    g_stats.failed++;
+    return nullptr;
+  }
+  size_t need = (n + kHdr + kAlign - 1) & ~(kAlign - 1);
+  if (need < kMinBlock) need = kMinBlock;
+  for (Block* b = g_free; b; b = b->next) {
+    const size_t size = sizeOf(b);
+    if (size < need) continue;
+    unlink(b);
+    if (size - need >= kMinBlock) {
+      setSize(b, need, true);
+      Block* rest = nextOf(b);
+      rest->prevSize = need;
+      setSize(rest, size - need, false);
+      insert(rest);
+    } else {
+      setSize(b, size, true);
+      g_stats.freeChunks--;
+      need = size;
+    }
+    g_stats.freeBytes -= need;
+    if (g_stats.freeBytes < g_stats.minFree) g_stats.minFree = g_stats.freeBytes;
+    g_stats.allocs++;
+    g_stats.blocks++;
+    return reinterpret_cast<uint8_t*>(b) + kHdr;
+  }
+  g_stats.failed++;
+  return nullptr;
+}
+
+void arenaFree(void* p) {
+  Block* b = reinterpret_cast<Block*>(static_cast<uint8_t*>(p) - kHdr);
+  std::lock_guard<std::mutex> lock(g_lock);
+  size_t size = sizeOf(b);
+  g_stats.freeBytes += size;
+  g_stats.frees++;
+  g_stats.blocks--;
+  g_stats.freeChunks++;
+
+  Block* n = nextOf(b);
+  if (n && !isUsed(n)) {
+    unlink(n);
+    size += sizeOf(n);
+    g_stats.freeChunks--;
+  }
+  Block* prev = prevOf(b);
+  if (prev && !isUsed(prev)) {
+    setSize(prev, sizeOf(prev) + size, false);
+    g_stats.freeChunks--;
+    return;
+  }
+  setSize(b, size, false);
+  insert(b);
+}
+
+size_t usable(void* p) {
+  return sizeOf(reinterpret_cast<Block*>(static_cast<uint8_t*>(p) - kHdr)) - kHdr;
+}
+
+}  // namespace
+
+namespace sim {
+
+void heapInit(size_t bytes) {
+  std::lock_guard<std::mutex> lock(g_lock);
+  if (!bytes) g_host = true;
+  grow(bytes);
+}
+
+HeapStats heapStats() {
+  std::lock_guard<std::mutex> lock(g_lock);
+  ensureInit();
+  HeapStats s = g_stats;
+  for (Block* b = g_free; b; b = b->next) {
+    if (sizeOf(b) > s.largestFree) s.largestFree = sizeOf(b);
+  }
+  // Payload view, like heap_caps: headers are not allocatable
+  s.largestFree = s.largestFree > kHdr ? s.largestFree - kHdr : 0;
+  return s;
+}
+
+HeapBypass::HeapBypass() { t_bypass++; }
+HeapBypass::~HeapBypass() { t_bypass--; }
+
+}  // namespace sim
+
+extern "C" {
+
+void* __wrap_malloc(size_t n) {
+  if (t_bypass || g_host) return __real_malloc(n);
+  return arenaAlloc(n ? n : 1);
+}
+
+void __wrap_free(void* p) {
+  if (!p) return;
+  if (inArena(p)) arenaFree(p);
+  else __real_free(p);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+  if (t_bypass || g_host) return __real_calloc(n, size);
+  if (size && n > (size_t)-1 / size) return nullptr;
+  void* p = arenaAlloc((n * size) != 0 ? n * size : 1);
+  if (p) memset(p, 0, n * size);
+  return p;
+}
+
+void* __wrap_realloc(void* p, size_t n) {
+  if (!p) return __wrap_malloc(n);
+  if (!inArena(p)) return __real_realloc(p, n);
+  if (!n) {
+    arenaFree(p);
+    return nullptr;
+  }
+  const size_t have = usable(p);
+  if (n <= have) return p;
+  void* q = arenaAlloc(n);
+  if (!q) return nullptr;
+  memcpy(q, p, have);
+  arenaFree(p);
+  return q;
+}
+
+}  // extern "C"
+
+// Containers, String via new[] etc.: same arena
+void* operator new(size_t n) {
+  void* p = __wrap_malloc(n);
+  if (!p) std::abort();   // no exceptions on target either
+  return p;
+}
+void* operator new[](size_t n) { return operator new(n); }
+void* operator new(size_t n, const std::nothrow_t&) noexcept { return __wrap_malloc(n); }
+void* operator new[](size_t n, const std::nothrow_t&) noexcept { return __wrap_malloc(n); }
+void operator delete(void* p) noexcept { __wrap_free(p); }
+void operator delete[](void* p) noexcept { __wrap_free(p); }
+void operator delete(void* p, size_t) noexcept { __wrap_free(p); }
+void operator delete[](void* p, size_t) noexcept { __wrap_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { __wrap_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { __wrap_free(p); }
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+  (void)caps;
+  const sim::HeapStats s = sim::heapStats();
+  info->total_free_bytes = s.freeBytes;
+  info->total_allocated_bytes = s.size - s.freeBytes;
+  info->largest_free_block = s.largestFree;
+  info->minimum_free_bytes = s.minFree;
+  info->allocated_blocks = s.blocks;
+  info->free_blocks = s.freeChunks;
+  info->total_blocks = s.blocks + s.freeChunks;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  (void)caps;
+  return sim::heapStats().freeBytes;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  (void)caps;
+  return sim::heapStats().largestFree;
+}
@@ -0,0 +1,175 @@
+// Simulator entry point: runs the firmware's setup()/loop() on virtual time.
+//
+// usage: .pio/build/sim/program [--data-dir DIR] [--printer IP] [--usn SERIAL]
+//          [--ac CODE] [--http-port N] [--speed X] [--loop-us N]
+//          [--duration MS] [--heap-kb N] [--wifi-join-ms N] [--seed N] [--leds]
+//          [--soak DAYS [--soak-window MIN] [--soak-csv FILE]]
+//
+// State (NVS, LittleFS, app image) lives in --data-dir, so a second instance
+// needs its own directory, --usn and --http-port. ESP.restart() re-execs the
+// binary with the same arguments and a software reset reason. --heap-kb 0
+// hands allocations to the host allocator, for valgrind and sanitizers.
+//
+// --soak runs DAYS of virtual printer life against a built-in printer (see
+// SimSoak.cpp) and exits 1 if heap or loop latency drifts; --loop-us 10000
+// gets a week through in minutes. A restart during a soak fails it.
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <Sim.h>
+
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+sim::Options g_opts;
+bool g_showLeds = false;
+char** g_argv = nullptr;
+
+void usage(const char* self) {
+  fprintf(stderr,
+          "usage: %s [--data-dir DIR] [--printer IP] [--usn SERIAL] [--ac CODE] [--http-port N]\n"
+          "          [--speed X] [--loop-us N] [--duration MS] [--heap-kb N] [--wifi-join-ms N]\n"
+          "          [--seed N] [--leds] [--soak DAYS [--soak-window MIN] [--soak-csv FILE]]\n",
+          self);
+  exit(2);
+}
+
+void parseArgs(int argc, char** argv) {
+  sim::HeapBypass bypass;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    if (a == "--leds") {
+      g_showLeds = true;
+      continue;
+    }
+    if (i + 1 >= argc) usage(argv[0]);
+    const char* v = argv[++i];
+    if (a == "--data-dir") g_opts.dataDir = v;
+    else if (a == "--printer") g_opts.printerIp = v;
+    else if (a == "--usn") g_opts.usn = v;
+    else if (a == "--ac") g_opts.accessCode = v;
+    else if (a == "--http-port") g_opts.httpPort = (uint16_t)atoi(v);
+    else if (a == "--speed") g_opts.speed = atof(v);
+    else if (a == "--loop-us") g_opts.loopUs = (uint32_t)atol(v);
+    else if (a == "--duration") g_opts.durationMs = strtoull(v, nullptr, 10);
+    else if (a == "--heap-kb") g_opts.heapKb = (uint32_t)atol(v);
+    else if (a == "--wifi-join-ms") g_opts.wifiJoinMs = (uint32_t)atol(v);
+    else if (a == "--seed") g_opts.seed = (uint32_t)atol(v);
+    else if (a == "--soak") g_opts.soakDays = atof(v);
+    else if (a == "--soak-window") g_opts.soakWindowMin = (uint32_t)atol(v);
+    else if (a == "--soak-csv") g_opts.soakCsv = v;
+    else usage(argv[0]);
+  }
+  if (g_opts.soakDays > 0) {
+    if (!g_opts.soakWindowMin) usage(argv[0]);
+    g_opts.durationMs = (uint64_t)(g_opts.soakDays * 86400000.0);
+  }
+}
+
+// Power-on only: the command line describes the printer; a restart keeps
+// whatever the firmware stored since
+void seedSettings() {
+  if (esp_reset_reason() == ESP_RST_SW) return;
+  Preferences p;
+  p.begin("device", false);
+  p.putString("printerIP", g_opts.printerIp.c_str());
+  p.putString("printerUSN", g_opts.usn.c_str());
+  p.putString("printerAC", g_opts.accessCode.c_str());
+  p.end();
+  p.begin("network", false);
+  if (p.getString("wifiSsid0").isEmpty()) p.putString("wifiSsid0", "sim-net");
+  p.end();
+}
+
+void printHeap() {
+  const sim::HeapStats h = sim::heapStats();
+  printf("[sim] heap: size=%zu free=%zu min=%zu largest=%zu blocks=%u chunks=%u allocs=%llu frees=%llu failed=%llu\n",
+         h.size, h.freeBytes, h.minFree, h.largestFree, h.blocks, h.freeChunks, (unsigned long long)h.allocs,
+         (unsigned long long)h.frees, (unsigned long long)h.failed);
+}
+
+void printLeds() {
+  static auto last = std::chrono::steady_clock::now();
+  static uint32_t lastShows = 0;
+  const auto now = std::chrono::steady_clock::now();
+  const sim::Frame f = sim::frame();
+  if (f.shows == lastShows || now - last < std::chrono::milliseconds(100)) return;
+  last = now;
+  lastShows = f.shows;
+  fputs("\r", stdout);
+  for (uint16_t i = 0; i < f.count; i++) {
+    printf("\x1b[48;2;%u;%u;%um  ", f.rgb[i * 3], f.rgb[i * 3 + 1], f.rgb[i * 3 + 2]);
+  }
+  fputs("\x1b[0m", stdout);
+  fflush(stdout);
+}
+
+[[noreturn]] void reboot() {
+  printHeap();
+  printf("[sim] restart\n");
+  fflush(stdout);
+  if (g_opts.soakDays > 0) {
+    printf("[soak] FAILED: the firmware restarted\n");
+    _exit(1);
+  }
+  setenv("BAMBUBEACON_SIM_RESTART", "1", 1);
+  execv("/proc/self/exe", g_argv);
+  perror("[sim] exec");
+  _exit(1);
+}
+
+[[noreturn]] void finish() {
+  if (g_showLeds) fputs("\n", stdout);
+  printHeap();
+  const int code = g_opts.soakDays > 0 ? sim::soakVerdict() : 0;
+  fflush(stdout);
+  // Firmware tasks are still running: skip static destructors
+  _exit(code);
+}
+
+}  // namespace
+
+namespace sim {
+const Options& options() { return g_opts; }
+}  // namespace sim
+
+int main(int argc, char** argv) {
+  g_argv = argv;
+  parseArgs(argc, argv);
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  sim::heapInit((size_t)g_opts.heapKb * 1024);
+  sim::markLoopThread();
+  if (g_opts.soakDays > 0) g_opts.printerIp = sim::soakStart();
+  seedSettings();
+  sim::startHttpListener(g_opts.httpPort);
+
+  using Steady = std::chrono::steady_clock;
+  const Steady::time_point realStart = Steady::now();
+  const int64_t virtStart = sim::nowUs();
+  try {
+    setup();
+    for (;;) {
+      const int64_t t0 = sim::nowUs();
+      loop();
+      sim::runTimers();
+      sim::pollWeb();
+      if (g_opts.soakDays > 0) sim::soakTick();
+      // loop() never runs more often than the quantum; the rest is idle time
+      const int64_t spent = sim::nowUs() - t0;
+      if (spent < (int64_t)g_opts.loopUs) sim::skipUs((int64_t)g_opts.loopUs - spent);
+      if (g_showLeds) printLeds();
+
+      const int64_t virtElapsed = sim::nowUs() - virtStart;
+      if (g_opts.speed > 0) {
+        const auto target = realStart + std::chrono::microseconds((int64_t)(virtElapsed / g_opts.speed));
+        if (target > Steady::now()) std::this_thread::sleep_until(target);
+      }
+      if (g_opts.durationMs && virtElapsed >= (int64_t)g_opts.durationMs * 1000) finish();
+    }
+  } catch (const sim::RestartSignal&) {
+    reboot();
+  }
+}
@@ -0,0 +1,177 @@
+// ROM/library leftovers: SHA-256 (mbedTLS API), ROM CRC32 and the FastLED
+// output stage.
+
+#include <FastLED.h>
+#include <esp_rom_crc.h>
+#include <mbedtls/sha256.h>
+#include <Sim.h>
+
+#include <mutex>
+
+CFastLED FastLED;
+
+// -------------------- SHA-256 --------------------
+
+namespace {
+
+const uint32_t kK[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+void block(uint32_t state[8], const uint8_t* p) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) | ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int i = 0; i < 64; i++) {
+    const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kK[i] + w[i];
+    const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+}  // namespace
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224) {
+  static const uint32_t kInit[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+  if (is224) return -1;   // not used by the firmware
+  memcpy(ctx->state, kInit, sizeof(kInit));
+  ctx->total = 0;
+  return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t len) {
+  size_t fill = (size_t)(ctx->total & 63);
+  ctx->total += len;
+  if (fill && fill + len >= 64) {
+    memcpy(ctx->buffer + fill, input, 64 - fill);
+    block(ctx->state, ctx->buffer);
+    input += 64 - fill;
+    len -= 64 - fill;
+    fill = 0;
+  }
+  for (; len >= 64; input += 64, len -= 64) block(ctx->state, input);
+  memcpy(ctx->buffer + fill, input, len);
+  return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]) {
+  const uint64_t bits = ctx->total * 8;
+  size_t fill = (size_t)(ctx->total & 63);
+  ctx->buffer[fill++] = 0x80;
+  if (fill > 56) {
+    memset(ctx->buffer + fill, 0, 64 - fill);
+    block(ctx->state, ctx->buffer);
+    fill = 0;
+  }
+  memset(ctx->buffer + fill, 0, 56 - fill);
+  for (int i = 0; i < 8; i++) ctx->buffer[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+  block(ctx->state, ctx->buffer);
+  for (int i = 0; i < 8; i++) {
+    output[4 * i] = (uint8_t)(ctx->state[i] >> 24);
+    output[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+    output[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+    output[4 * i + 3] = (uint8_t)ctx->state[i];
+  }
+  return 0;
+}
+
+// -------------------- CRC32 --------------------
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+  static uint32_t table[256];
+  static std::once_flag once;
+  std::call_once(once, [] {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+  });
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) crc = table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+// -------------------- FastLED --------------------
+
+namespace {
+
+constexpr int kMaxLeds = 1024;
+uint8_t g_frame[kMaxLeds * 3];
+uint16_t g_frameCount = 0;
+uint32_t g_shows = 0;
+std::mutex g_frameLock;
+
+}  // namespace
+
+void CFastLED::show() {
+  if (!_leds) return;
+  const int count = min(_count, kMaxLeds);
+
+  // FastLED's power model: about 20 mA per channel at full drive
+  uint8_t brightness = _brightness;
+  if (_maxMa) {
+    uint64_t sum = 0;
+    for (int i = 0; i < count; i++) sum += (uint32_t)_leds[i].r + _leds[i].g + _leds[i].b;
+    const uint64_t ma = sum * brightness * 20 / (255ULL * 255ULL);
+    if (ma > _maxMa) brightness = (uint8_t)((uint64_t)brightness * _maxMa / ma);
+  }
+
+  std::lock_guard<std::mutex> lock(g_frameLock);
+  for (int i = 0; i < count; i++) {
+    g_frame[i * 3] = scale8_video(_leds[i].r, brightness);
+    g_frame[i * 3 + 1] = scale8_video(_leds[i].g, brightness);
+    g_frame[i * 3 + 2] = scale8_video(_leds[i].b, brightness);
+  }
+  g_frameCount = (uint16_t)count;
+  g_shows++;
+}
+
+namespace sim {
+
+Frame frame() {
+  std::lock_guard<std::mutex> lock(g_frameLock);
+  Frame f;
+  f.rgb = g_frame;
+  f.count = g_frameCount;
+  f.shows = g_shows;
+  return f;
+}
+
+}  // namespace sim
@@ -0,0 +1,497 @@
+// Wi-Fi station model and real host sockets behind WiFiClient, WiFiUDP and
+// HTTPClient. A link drop (sim::setLinkUp(false)) bumps an epoch: sockets
+// opened before it report disconnected, like lwIP after losing the AP.
+
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <ESPmDNS.h>
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+
+WiFiClass WiFi;
+MDNSResponder MDNS;
+
+namespace {
+
+std::atomic<bool> g_linkUp{true};
+std::atomic<uint32_t> g_epoch{0};
+std::atomic<int64_t> g_linkUpAtUs{0};
+
+uint32_t detectLocalAddr() {
+  // The address the host would use for a LAN destination; no packet is sent
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  uint32_t addr = htonl(INADDR_LOOPBACK);
+  if (fd < 0) return addr;
+  sockaddr_in dst = {};
+  dst.sin_family = AF_INET;
+  dst.sin_port = htons(9);
+  inet_pton(AF_INET, "192.0.2.1", &dst.sin_addr);
+  if (connect(fd, reinterpret_cast<sockaddr*>(&dst), sizeof(dst)) == 0) {
+    sockaddr_in self = {};
+    socklen_t len = sizeof(self);
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&self), &len) == 0 && self.sin_addr.s_addr) {
+      addr = self.sin_addr.s_addr;
+    }
+  }
+  close(fd);
+  return addr;
+}
+
+bool resolve(const char* host, IPAddress& out) {
+  if (out.fromString(host)) return true;
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  addrinfo* res = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &res) != 0 || !res) return false;
+  out = IPAddress((uint32_t)reinterpret_cast<sockaddr_in*>(res->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(res);
+  return true;
+}
+
+sockaddr_in toSockaddr(IPAddress ip, uint16_t port) {
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  a.sin_addr.s_addr = (uint32_t)ip;
+  return a;
+}
+
+void setNonBlocking(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); }
+
+}  // namespace
+
+namespace sim {
+
+void setLinkUp(bool up) {
+  if (up == g_linkUp.load()) return;
+  if (!up) g_epoch++;
+  else g_linkUpAtUs = nowUs();
+  g_linkUp = up;
+}
+
+bool linkUp() { return g_linkUp.load() && WiFi.status() == WL_CONNECTED; }
+
+uint32_t localAddr() {
+  static const uint32_t addr = detectLocalAddr();
+  return addr;
+}
+
+}  // namespace sim
+
+// -------------------- WiFi --------------------
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* pass) {
+  (void)pass;
+  _ssid = ssid ? ssid : "";
+  _joinAtUs = sim::nowUs() + (int64_t)sim::options().wifiJoinMs * 1000;
+  return WL_DISCONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+  if (_joinAtUs < 0) return WL_IDLE_STATUS;
+  if (!g_linkUp) return WL_CONNECTION_LOST;
+  const int64_t now = sim::nowUs();
+  const int64_t ready = std::max<int64_t>(_joinAtUs, g_linkUpAtUs + (int64_t)sim::options().wifiJoinMs * 1000);
+  return now >= ready ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+  (void)wifiOff;
+  (void)eraseAp;
+  _joinAtUs = -1;
+  g_epoch++;
+  return true;
+}
+
+IPAddress WiFiClass::localIP() {
+  return status() == WL_CONNECTED ? IPAddress(sim::localAddr()) : IPAddress();
+}
+
+String WiFiClass::macAddress() {
+  const uint64_t mac = ESP.getEfuseMac();
+  char buf[18];
+  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", (unsigned)(uint8_t)mac, (unsigned)(uint8_t)(mac >> 8),
+           (unsigned)(uint8_t)(mac >> 16), (unsigned)(uint8_t)(mac >> 24), (unsigned)(uint8_t)(mac >> 32),
+           (unsigned)(uint8_t)(mac >> 40));
+  return String(buf);
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& out) {
+  if (status() != WL_CONNECTED) return 0;
+  return resolve(host, out) ? 1 : 0;
+}
+
+// -------------------- WiFiClient --------------------
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) return 0;
+  return connect(ip, port, timeoutMs);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+  stop();
+  if (!sim::linkUp()) return 0;
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (_fd < 0) return 0;
+  setNonBlocking(_fd);
+  const sockaddr_in a = toSockaddr(ip, port);
+  int rc = ::connect(_fd, reinterpret_cast<const sockaddr*>(&a), sizeof(a));
+  if (rc != 0 && errno == EINPROGRESS) {
+    pollfd p = { _fd, POLLOUT, 0 };
+    rc = -1;
+    if (poll(&p, 1, timeoutMs > 0 ? timeoutMs : 3000) == 1) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      rc = err ? -1 : 0;
+    }
+  }
+  if (rc != 0) {
+    stop();
+    return 0;
+  }
+  _remote = ip;
+  _remotePort = port;
+  _eof = false;
+  _epoch = g_epoch.load();
+  setNoDelay(true);
+  return 1;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+  if (!connected()) return 0;
+  size_t sent = 0;
+  const int64_t until = sim::nowUs() + (int64_t)_timeout * 1000;
+  while (sent < size) {
+    const ssize_t n = send(_fd, buf + sent, size - sent, MSG_NOSIGNAL);
+    if (n > 0) {
+      sent += (size_t)n;
+      continue;
+    }
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+      _eof = true;
+      break;
+    }
+    if (sim::nowUs() >= until) break;
+    pollfd p = { _fd, POLLOUT, 0 };
+    poll(&p, 1, 10);
+  }
+  return sent;
+}
+
+int WiFiClient::available() {
+  if (!connected()) return 0;
+  int n = 0;
+  if (ioctl(_fd, FIONREAD, &n) != 0) return 0;
+  return n;
+}
+
+int WiFiClient::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+  if (_fd < 0 || _epoch != g_epoch.load()) return -1;
+  const ssize_t n = recv(_fd, buf, size, MSG_DONTWAIT);
+  if (n == 0) _eof = true;
+  if (n <= 0) return -1;
+  return (int)n;
+}
+
+int WiFiClient::peek() {
+  if (!connected()) return -1;
+  uint8_t b;
+  return recv(_fd, &b, 1, MSG_DONTWAIT | MSG_PEEK) == 1 ? b : -1;
+}
+
+void WiFiClient::stop() {
+  if (_fd >= 0) close(_fd);
+  _fd = -1;
+  _eof = false;
+}
+
+uint8_t WiFiClient::connected() {
+  if (_fd < 0 || _eof) return 0;
+  if (_epoch != g_epoch.load() || !sim::linkUp()) return 0;
+  uint8_t b;
+  const ssize_t n = recv(_fd, &b, 1, MSG_DONTWAIT | MSG_PEEK);
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    _eof = true;
+    return 0;
+  }
+  return 1;
+}
+
+bool WiFiClient::waitData(uint32_t timeoutMs) {
+  if (available() > 0) return true;
+  if (!connected()) return false;
+  pollfd p = { _fd, POLLIN, 0 };
+  return poll(&p, 1, (int)timeoutMs) == 1 && available() > 0;
+}
+
+void WiFiClient::setNoDelay(bool on) {
+  if (_fd < 0) return;
+  int v = on ? 1 : 0;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v));
+}
+
+// -------------------- WiFiUDP --------------------
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  stop();
+  _fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (_fd < 0) return 0;
+  int one = 1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+  setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &one, sizeof(one));
+  setNonBlocking(_fd);
+  const sockaddr_in a = toSockaddr(IPAddress(), port);
+  if (bind(_fd, reinterpret_cast<const sockaddr*>(&a), sizeof(a)) != 0) {
+    stop();
+    return 0;
+  }
+  _port = port;
+  return 1;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress group, uint16_t port) {
+  if (!sim::linkUp() || !begin(port)) return 0;
+  ip_mreq m = {};
+  m.imr_multiaddr.s_addr = (uint32_t)group;
+  m.imr_interface.s_addr = htonl(INADDR_ANY);
+  if (setsockopt(_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &m, sizeof(m)) != 0) {
+    stop();
+    return 0;
+  }
+  _group = group;
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  if (_fd >= 0) close(_fd);
+  _fd = -1;
+  _port = 0;
+  _group = IPAddress();
+  _txOpen = false;
+  _rxLen = _rxPos = 0;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+  if (!sim::linkUp()) return 0;
+  if (_fd < 0) {
+    // Send-only use without begin(): an ephemeral socket
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0) return 0;
+    setNonBlocking(_fd);
+  }
+  _txIp = ip;
+  _txPort = port;
+  _txLen = 0;
+  _txOpen = true;
+  return 1;
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port) {
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) return 0;
+  return beginPacket(ip, port);
+}
+
+int WiFiUDP::beginMulticastPacket() {
+  if (!_port || _group == IPAddress()) return 0;
+  return beginPacket(_group, _port);
+}
+
+size_t WiFiUDP::write(const uint8_t* buf, size_t size) {
+  if (!_txOpen) return 0;
+  const size_t n = min(size, kMaxDatagram - _txLen);
+  memcpy(_tx + _txLen, buf, n);
+  _txLen += n;
+  return n;
+}
+
+int WiFiUDP::endPacket() {
+  if (!_txOpen) return 0;
+  _txOpen = false;
+  if (!sim::linkUp()) return 0;
+  const sockaddr_in a = toSockaddr(_txIp, _txPort);
+  return sendto(_fd, _tx, _txLen, 0, reinterpret_cast<const sockaddr*>(&a), sizeof(a)) == (ssize_t)_txLen ? 1 : 0;
+}
+
+int WiFiUDP::parsePacket() {
+  _rxLen = _rxPos = 0;
+  if (_fd < 0) return 0;
+  sockaddr_in from = {};
+  socklen_t len = sizeof(from);
+  const ssize_t n = recvfrom(_fd, _rx, sizeof(_rx), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), &len);
+  if (n <= 0 || !sim::linkUp()) return 0;
+  // Our own multicast comes back through the loop; lwIP filters it on target
+  if (from.sin_addr.s_addr == sim::localAddr() && ntohs(from.sin_port) == _port) return 0;
+  _rxLen = (size_t)n;
+  _remote = IPAddress((uint32_t)from.sin_addr.s_addr);
+  _remotePort = ntohs(from.sin_port);
+  return (int)n;
+}
+
+int WiFiUDP::read(unsigned char* buf, size_t len) {
+  const size_t n = min(len, _rxLen - _rxPos);
+  memcpy(buf, _rx + _rxPos, n);
+  _rxPos += n;
+  return (int)n;
+}
+
+// -------------------- HTTPClient --------------------
+
+bool HTTPClient::begin(WiFiClient& client, const String& url) {
+  end();
+  if (!url.startsWith("http://")) return false;
+  String rest = url.substring(7);
+  const int slash = rest.indexOf('/');
+  String hostPort = slash < 0 ? rest : rest.substring(0, slash);
+  _path = slash < 0 ? String("/") : rest.substring(slash);
+  const int colon = hostPort.indexOf(':');
+  _host = colon < 0 ? hostPort : hostPort.substring(0, colon);
+  _port = colon < 0 ? 80 : (uint16_t)hostPort.substring(colon + 1).toInt();
+  _client = &client;
+  _extra = String();
+  _size = -1;
+  for (size_t i = 0; i < _keyCount; i++) _values[i] = String();
+  return !_host.isEmpty();
+}
+
+void HTTPClient::end() {
+  if (_client) _client->stop();
+  _client = nullptr;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+  _extra += name + ": " + value + "\r\n";
+}
+
+void HTTPClient::collectHeaders(const char* keys[], size_t count) {
+  _keyCount = min(count, sizeof(_keys) / sizeof(_keys[0]));
+  for (size_t i = 0; i < _keyCount; i++) {
+    _keys[i] = keys[i];
+    _values[i] = String();
+  }
+}
+
+bool HTTPClient::readLine(String& line) {
+  line = String();
+  const int64_t until = sim::nowUs() + (int64_t)_timeoutMs * 1000;
+  while (sim::nowUs() < until) {
+    const int c = _client->read();
+    if (c < 0) {
+      if (!_client->waitData(10) && !_client->connected()) return false;
+      continue;
+    }
+    if (c == '\n') {
+      line.trim();
+      return true;
+    }
+    line.concat((char)c);
+  }
+  return false;
+}
+
+int HTTPClient::GET() {
+  if (!_client) return HTTPC_ERROR_NOT_CONNECTED;
+  if (!_client->connect(_host.c_str(), _port, _connectTimeoutMs)) return HTTPC_ERROR_CONNECTION_REFUSED;
+  String req = String("GET ") + _path + " HTTP/1.1\r\nHost: " + _host + "\r\nConnection: close\r\n" +
+               "User-Agent: ESP32HTTPClient\r\n" + _extra + "\r\n";
+  _client->setTimeout(_timeoutMs);
+  if (_client->write(reinterpret_cast<const uint8_t*>(req.c_str()), req.length()) != req.length()) {
+    return HTTPC_ERROR_SEND_HEADER_FAILED;
+  }
+
+  String line;
+  if (!readLine(line)) return HTTPC_ERROR_READ_TIMEOUT;
+  const int sp = line.indexOf(' ');
+  const int code = sp < 0 ? 0 : (int)line.substring(sp + 1).toInt();
+  if (code <= 0) return HTTPC_ERROR_CONNECTION_LOST;
+  while (readLine(line) && line.length()) {
+    const int colon = line.indexOf(':');
+    if (colon <= 0) continue;
+    String name = line.substring(0, colon);
+    String value = line.substring(colon + 1);
+    value.trim();
+    if (name.equalsIgnoreCase("Content-Length")) _size = (int)value.toInt();
+    for (size_t i = 0; i < _keyCount; i++) {
+      if (name.equalsIgnoreCase(_keys[i])) _values[i] = value;
+    }
+  }
+  return code;
+}
+
+String HTTPClient::header(const char* name) {
+  for (size_t i = 0; i < _keyCount; i++) {
+    if (_keys[i].equalsIgnoreCase(name)) return _values[i];
+  }
+  return String();
+}
+
+String HTTPClient::getString() {
+  String body;
+  if (!_client) return body;
+  const int64_t until = sim::nowUs() + (int64_t)_timeoutMs * 1000;
+  uint8_t buf[512];
+  while ((_size < 0 || (int)body.length() < _size) && sim::nowUs() < until) {
+    const int n = _client->read(buf, sizeof(buf));
+    if (n > 0) {
+      body.concat(reinterpret_cast<const char*>(buf), (size_t)n);
+    } else if (!_client->waitData(10) && !_client->connected()) {
+      break;
+    }
+  }
+  return body;
+}
+
+// -------------------- lwIP DNS --------------------
+
+err_t tcpip_callback(tcpip_callback_fn function, void* ctx) {
+  function(ctx);
+  return ERR_OK;
+}
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg) {
+  (void)found;
+  (void)callback_arg;
+  IPAddress ip;
+  if (!hostname || !sim::linkUp() || !resolve(hostname, ip)) return ERR_VAL;
+  addr->type = IPADDR_TYPE_V4;
+  addr->u_addr.ip4.addr = (uint32_t)ip;
+  return ERR_OK;
+}
+
+// -------------------- mDNS --------------------
+
+esp_err_t mdns_service_txt_set(const char* service, const char* proto, mdns_txt_item_t* txt, uint8_t count) {
+  static std::string last;
+  std::string line = std::string(service) + "." + proto;
+  for (uint8_t i = 0; i < count; i++) {
+    line += std::string(" ") + txt[i].key + "=" + (txt[i].value ? txt[i].value : "");
+  }
+  sim::HeapBypass bypass;
+  if (line != last) {
+    printf("[sim] mdns txt %s\n", line.c_str());
+    last.swap(line);
+  }
+  return ESP_OK;
+}
@@ -0,0 +1,262 @@
+// FreeRTOS tasks as detached pthreads, semaphores and task notifications on
+// std::mutex/condition_variable. Priorities are recorded, not enforced.
+
+#include <Arduino.h>
+
+#include <pthread.h>
+#include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <string>
+#include <vector>
+
+struct SimTask {
+  std::string name;
+  TaskFunction_t fn = nullptr;
+  void* arg = nullptr;
+  UBaseType_t priority = 1;
+  uint32_t stackDepth = 0;
+  UBaseType_t number = 0;
+  pthread_t thread{};
+  std::mutex lock;
+  std::condition_variable cv;
+  uint32_t notified = 0;
+};
+
+struct SimSemaphore {
+  std::mutex lock;
+  std::condition_variable cv;
+  int count = 0;
+  int max = 1;
+};
+
+namespace {
+
+std::mutex g_tasksLock;
+std::vector<SimTask*> g_tasks;
+thread_local SimTask* t_self = nullptr;
+UBaseType_t g_taskNumber = 1;  // loopTask is 1
+
+SimTask& loopTask() {
+  static SimTask t;
+  if (t.name.empty()) {
+    t.name = "loopTask";
+    t.stackDepth = getArduinoLoopTaskStackSize();
+    t.number = 1;
+  }
+  return t;
+}
+
+SimTask* self() {
+  return t_self ? t_self : &loopTask();
+}
+
+void* trampoline(void* p) {
+  SimTask* t = static_cast<SimTask*>(p);
+  t_self = t;
+  t->fn(t->arg);
+  vTaskDelete(nullptr);
+  return nullptr;
+}
+
+// Waits up to `ticks` of virtual time for pred(), then runs take() under the
+// same lock. Tasks block; the loop thread skips ahead in 1 ms steps, so a
+// timeout there costs no real time.
+template <typename Pred, typename Take>
+bool waitFor(std::mutex& m, std::condition_variable& cv, TickType_t ticks, Pred pred, Take take) {
+  std::unique_lock<std::mutex> lock(m);
+  const int64_t until = ticks == portMAX_DELAY ? INT64_MAX : sim::nowUs() + (int64_t)ticks * 1000;
+  while (!pred()) {
+    if (sim::nowUs() >= until) return false;
+    if (sim::isLoopThread()) {
+      lock.unlock();
+      sim::skipUs(1000);
+      std::this_thread::yield();
+      lock.lock();
+    } else {
+      cv.wait_for(lock, std::chrono::milliseconds(1));
+    }
+  }
+  take();
+  return true;
+}
+
+}  // namespace
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                       UBaseType_t priority, TaskHandle_t* out) {
+  sim::HeapBypass bypass;
+  SimTask* t = new SimTask();
+  t->name = name ? name : "";
+  t->fn = fn;
+  t->arg = arg;
+  t->priority = priority;
+  t->stackDepth = stackDepth;
+  {
+    std::lock_guard<std::mutex> lock(g_tasksLock);
+    t->number = ++g_taskNumber;
+    g_tasks.push_back(t);
+  }
+  if (out) *out = t;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  const int rc = pthread_create(&t->thread, &attr, trampoline, t);
+  pthread_attr_destroy(&attr);
+  if (rc != 0) {
+    std::lock_guard<std::mutex> lock(g_tasksLock);
+    g_tasks.pop_back();
+    delete t;
+    if (out) *out = nullptr;
+    return pdFAIL;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* out, BaseType_t core) {
+  (void)core;
+  return xTaskCreate(fn, name, stackDepth, arg, priority, out);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  // Only self-deletion is used by the firmware; the task object is kept so
+  // stale handles stay harmless
+  if (task && task != t_self) return;
+  if (!t_self) return;
+  {
+    std::lock_guard<std::mutex> lock(g_tasksLock);
+    for (size_t i = 0; i < g_tasks.size(); i++) {
+      if (g_tasks[i] == t_self) {
+        g_tasks.erase(g_tasks.begin() + i);
+        break;
+      }
+    }
+  }
+  pthread_exit(nullptr);
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return self(); }
+
+TaskHandle_t xTaskGetHandle(const char* name) {
+  if (!name) return nullptr;
+  if (loopTask().name == name) return &loopTask();
+  std::lock_guard<std::mutex> lock(g_tasksLock);
+  for (SimTask* t : g_tasks) {
+    if (t->name == name) return t;
+  }
+  return nullptr;
+}
+
+const char* pcTaskGetName(TaskHandle_t task) { return (task ? task : self())->name.c_str(); }
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) { return (task ? task : self())->priority; }
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) { (task ? task : self())->priority = priority; }
+
+// No stack accounting on the host: reports the whole stack as unused
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return (task ? task : self())->stackDepth; }
+
+UBaseType_t uxTaskGetNumberOfTasks() {
+  std::lock_guard<std::mutex> lock(g_tasksLock);
+  return (UBaseType_t)g_tasks.size() + 1;
+}
+
+namespace {
+
+uint32_t cpuTimeUs(pthread_t thread) {
+  clockid_t clock;
+  timespec ts;
+  if (pthread_getcpuclockid(thread, &clock) != 0 || clock_gettime(clock, &ts) != 0) return 0;
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL);
+}
+
+void fillStatus(TaskStatus_t& s, SimTask* t, bool self) {
+  s.xHandle = t;
+  s.pcTaskName = t->name.c_str();
+  s.xTaskNumber = t->number;
+  s.eCurrentState = self ? eRunning : eBlocked;
+  s.uxCurrentPriority = t->priority;
+  s.uxBasePriority = t->priority;
+  s.ulRunTimeCounter = cpuTimeUs(t->thread);
+  s.pxStackBase = nullptr;
+  s.usStackHighWaterMark = t->stackDepth;
+  s.xCoreID = tskNO_AFFINITY;
+}
+
+}  // namespace
+
+// Total run time is real time since the first call, like the esp_timer based
+// counter on target; a task's counter is its thread's CPU time. Tasks only
+// leave g_tasks under the lock, so their threads are alive while it is held.
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* out, UBaseType_t cap, uint32_t* totalRunTime) {
+  static const auto start = std::chrono::steady_clock::now();
+  if (totalRunTime) {
+    *totalRunTime = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+  if (sim::isLoopThread()) loopTask().thread = pthread_self();
+  std::lock_guard<std::mutex> lock(g_tasksLock);
+  if (!out || cap < g_tasks.size() + 1) return 0;
+  UBaseType_t n = 0;
+  SimTask& lt = loopTask();
+  fillStatus(out[n++], &lt, self() == &lt);
+  for (SimTask* t : g_tasks) fillStatus(out[n++], t, t == t_self);
+  return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  if (!task) return pdFAIL;
+  {
+    std::lock_guard<std::mutex> lock(task->lock);
+    task->notified++;
+  }
+  task->cv.notify_all();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  SimTask* t = self();
+  uint32_t value = 0;
+  waitFor(t->lock, t->cv, ticks, [t] { return t->notified > 0; }, [&] {
+    value = t->notified;
+    t->notified = clearOnExit ? 0 : t->notified - 1;
+  });
+  return value;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  SimSemaphore* s = new SimSemaphore();
+  s->count = 1;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  SimSemaphore* s = new SimSemaphore();
+  s->count = 0;
+  return s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  if (!sem) return pdFALSE;
+  return waitFor(sem->lock, sem->cv, ticks, [sem] { return sem->count > 0; }, [sem] { sem->count--; })
+      ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  if (!sem) return pdFALSE;
+  {
+    std::lock_guard<std::mutex> lock(sem->lock);
+    if (sem->count >= sem->max) return pdFALSE;
+    sem->count++;
+  }
+  sem->cv.notify_one();
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
@@ -0,0 +1,562 @@
+// Accelerated soak (--soak DAYS): weeks of printer life on virtual time, with
+// heap and loop-latency drift checked window by window.
+//
+// A printer broker thread plays the MQTT side on its own loopback address
+// (127.77.x.y:8883, per pid so soaks run side by side): it cycles print jobs,
+// pushes realistically sized deltas every virtual second and raises HMS
+// storms. The loop thread drives the rest of the scenario between loop()
+// passes: Wi-Fi outages and broker-side connection kills, web requests across
+// the JSON endpoints, and settings saves (LED brightness, and the printer
+// config with unchanged values so nothing restarts).
+//
+// Every --soak-window virtual minutes a row records the window's minimum free
+// heap and largest free block, live blocks at its end, allocations, failed
+// allocations and loop() p50/p99/max (from the loopStats histogram delta).
+// After the first quarter (warm-up) a metric fails when it moves the wrong
+// way in at least 80% of its non-flat steps, at least three times, and by
+// more than a floor in total. Any failed allocation fails the run too.
+
+#include <Arduino.h>
+#include <Sim.h>
+
+#include "LoopStats.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+extern LoopStats loopStats;
+
+namespace {
+
+constexpr uint16_t kBrokerPort = 8883;
+constexpr int64_t kSecond = 1000000;
+constexpr int64_t kMinute = 60 * kSecond;
+constexpr int64_t kHour = 60 * kMinute;
+
+// Job cycle: idle, prepare, print, finish
+constexpr int64_t kIdleUs = 40 * kMinute;
+constexpr int64_t kPrepareUs = 6 * kMinute;
+constexpr int64_t kPrintUs = 3 * kHour;
+constexpr int64_t kFinishUs = 20 * kMinute;
+constexpr int64_t kCycleUs = kIdleUs + kPrepareUs + kPrintUs + kFinishUs;
+
+constexpr int64_t kStormUs = 30 * kSecond;
+constexpr int kStormCodes = 24;
+constexpr int64_t kOutageUs = 20 * kSecond;
+constexpr int64_t kWebEveryUs = 15 * kSecond;
+constexpr int64_t kSampleEveryUs = kSecond / 4;
+
+std::string g_addr;
+uint32_t g_addrBe = 0;
+int64_t g_startUs = 0;
+std::atomic<int64_t> g_stormUntilUs{0};
+std::atomic<bool> g_kill{false};
+std::atomic<uint32_t> g_connects{0};
+std::atomic<uint32_t> g_reports{0};
+
+// -------------------- printer --------------------
+
+struct PrinterState {
+  const char* gcode = "IDLE";
+  int percent = 0;
+  int remainingMin = 0;
+  float bed = 25.0f, bedTarget = 0.0f;
+  float nozzle = 25.0f, nozzleTarget = 0.0f;
+  bool storm = false;
+};
+
+PrinterState printerAt(int64_t now) {
+  PrinterState s;
+  const int64_t t = (now - g_startUs) % kCycleUs;
+  float warm = 0.0f;
+  if (t < kIdleUs) {
+    s.gcode = "IDLE";
+  } else if (t < kIdleUs + kPrepareUs) {
+    s.gcode = "PREPARE";
+    warm = (float)(t - kIdleUs) / (float)kPrepareUs;
+  } else if (t < kIdleUs + kPrepareUs + kPrintUs) {
+    const int64_t p = t - kIdleUs - kPrepareUs;
+    s.gcode = "RUNNING";
+    s.percent = (int)(p * 100 / kPrintUs);
+    s.remainingMin = (int)((kPrintUs - p) / kMinute);
+    warm = 1.0f;
+  } else {
+    s.gcode = "FINISH";
+    s.percent = 100;
+  }
+  if (warm > 0.0f) {
+    s.bedTarget = 60.0f;
+    s.nozzleTarget = 220.0f;
+    s.bed = 25.0f + 35.0f * warm;
+    s.nozzle = 25.0f + 195.0f * warm;
+  }
+  s.storm = now < g_stormUntilUs.load();
+  return s;
+}
+
+// push_status body; a real delta carries ~1 KB of fields the beacon filters out
+std::string reportJson(const PrinterState& s, bool full, uint32_t seq) {
+  char head[512];
+  snprintf(head, sizeof(head),
+           "{\"print\":{\"command\":\"push_status\",\"msg\":%d,\"sequence_id\":\"%u\","
+           "\"gcode_state\":\"%s\",\"mc_percent\":%d,\"mc_remaining_time\":%d,"
+           "\"bed_temper\":%.1f,\"bed_target_temper\":%.1f,"
+           "\"nozzle_temper\":%.1f,\"nozzle_target_temper\":%.1f,\"hms\":[",
+           full ? 0 : 1, (unsigned)seq, s.gcode, s.percent, s.remainingMin,
+           s.bed, s.bedTarget, s.nozzle, s.nozzleTarget);
+  std::string out = head;
+  if (s.storm) {
+    for (int i = 0; i < kStormCodes; i++) {
+      char e[64];
+      snprintf(e, sizeof(e), "%s{\"attr\":%u,\"code\":%u}", i ? "," : "",
+               (unsigned)(0x03000100u + ((uint32_t)i << 8)), (unsigned)(0x00030001u + (uint32_t)i));
+      out += e;
+    }
+  }
+  out += "],\"wifi_signal\":\"-48dBm\",\"fan_gear\":0,\"lights_report\":[{\"node\":\"chamber_light\",\"mode\":\"on\"}]";
+  out += ",\"upgrade_state\":{\"sequence_id\":0,\"progress\":\"\",\"status\":\"\",\"consistency_request\":false}";
+  out += ",\"ams\":{\"ams\":[{\"id\":\"0\",\"humidity\":\"4\",\"temp\":\"26.1\",\"tray\":[";
+  for (int i = 0; i < 4; i++) {
+    char tray[192];
+    snprintf(tray, sizeof(tray),
+             "%s{\"id\":\"%d\",\"remain\":%d,\"tag_uid\":\"0000000000000000\",\"tray_type\":\"PLA\","
+             "\"tray_color\":\"FFFFFFFF\",\"nozzle_temp_max\":\"230\",\"nozzle_temp_min\":\"190\"}",
+             i ? "," : "", i, 80 - i * 10);
+    out += tray;
+  }
+  out += "]}]}";
+  if (full) out.append(",\"pad\":\"").append(3000, 'x').append("\"");
+  out += "}}";
+  return out;
+}
+
+void putLen(std::string& out, size_t n) {
+  do {
+    uint8_t b = n % 128;
+    n /= 128;
+    out += (char)(b | (n ? 0x80 : 0));
+  } while (n);
+}
+
+std::string publishPacket(const std::string& topic, const std::string& payload) {
+  std::string body;
+  body += (char)(topic.size() >> 8);
+  body += (char)(topic.size() & 0xFF);
+  body += topic;
+  body += payload;
+  std::string out(1, (char)0x30);
+  putLen(out, body.size());
+  return out + body;
+}
+
+bool sendAll(int fd, const std::string& data) {
+  size_t off = 0;
+  while (off < data.size()) {
+    const ssize_t n = ::send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    off += (size_t)n;
+  }
+  return true;
+}
+
+// Pops one MQTT control packet off the front of buf once it is complete
+bool takePacket(std::string& buf, uint8_t& kind, std::string& body) {
+  if (buf.size() < 2) return false;
+  size_t len = 0, mult = 1, pos = 1;
+  for (;;) {
+    if (pos >= buf.size() || pos > 4) return false;
+    const uint8_t b = (uint8_t)buf[pos++];
+    len += (b & 0x7F) * mult;
+    mult *= 128;
+    if (!(b & 0x80)) break;
+  }
+  if (buf.size() < pos + len) return false;
+  kind = (uint8_t)buf[0];
+  body = buf.substr(pos, len);
+  buf.erase(0, pos + len);
+  return true;
+}
+
+std::string takeStr(const std::string& body, size_t& pos) {
+  if (pos + 2 > body.size()) return std::string();
+  const size_t n = ((uint8_t)body[pos] << 8) | (uint8_t)body[pos + 1];
+  pos += 2;
+  const std::string s = body.substr(pos, n);
+  pos += n;
+  return s;
+}
+
+// Serves one beacon session; returns when it ends or the scenario kills it
+void session(int fd) {
+  const sim::Options& o = sim::options();
+  const std::string report = "device/" + o.usn + "/report";
+  std::string buf, body;
+  bool subscribed = false, sendFull = false;
+  uint32_t seq = 0;
+  int64_t nextPush = sim::nowUs();
+
+  for (;;) {
+    if (g_kill.exchange(false)) break;
+    pollfd p = { fd, POLLIN, 0 };
+    if (::poll(&p, 1, 5) > 0) {
+      char chunk[1024];
+      const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+      if (n <= 0) break;
+      buf.append(chunk, (size_t)n);
+    }
+    uint8_t kind = 0;
+    bool closed = false;
+    while (takePacket(buf, kind, body)) {
+      switch (kind >> 4) {
+        case 1: {  // CONNECT
+          if (body.size() < 10) { closed = true; break; }
+          const uint8_t flags = (uint8_t)body[7];
+          size_t pos = 10;
+          takeStr(body, pos);
+          if (flags & 0x04) { takeStr(body, pos); takeStr(body, pos); }
+          const std::string user = (flags & 0x80) ? takeStr(body, pos) : std::string();
+          const std::string pass = (flags & 0x40) ? takeStr(body, pos) : std::string();
+          const bool ok = user == "bblp" && pass == o.accessCode;
+          sendAll(fd, std::string("\x20\x02\x00", 3) + (char)(ok ? 0 : 5));
+          if (!ok) closed = true;
+          else g_connects++;
+          break;
+        }
+        case 8: {  // SUBSCRIBE
+          size_t pos = 2;
+          const bool ok = body.size() > 2 && takeStr(body, pos) == report;
+          sendAll(fd, std::string("\x90\x03", 2) + body.substr(0, 2) + (char)(ok ? 0x00 : 0x80));
+          subscribed = subscribed || ok;
+          break;
+        }
+        case 3: {  // PUBLISH on device/<usn>/request
+          if (body.find("pushall") != std::string::npos) sendFull = true;
+          break;
+        }
+        case 10:   // UNSUBSCRIBE
+          sendAll(fd, std::string("\xb0\x02", 2) + body.substr(0, 2));
+          subscribed = false;
+          break;
+        case 12:   // PINGREQ
+          sendAll(fd, std::string("\xd0\x00", 2));
+          break;
+        case 14:   // DISCONNECT
+          closed = true;
+          break;
+        default:
+          break;
+      }
+      if (closed) break;
+    }
+    if (closed) break;
+
+    const int64_t now = sim::nowUs();
+    if (subscribed && (sendFull || now >= nextPush)) {
+      if (!sendAll(fd, publishPacket(report, reportJson(printerAt(now), sendFull, seq++)))) break;
+      g_reports++;
+      sendFull = false;
+      // Pushes that fall behind an unpaced clock are skipped, not queued
+      nextPush = std::max(nextPush + kSecond, now);
+    }
+  }
+  ::shutdown(fd, SHUT_RDWR);
+  ::close(fd);
+}
+
+void broker(int srv) {
+  sim::HeapBypass bypass;
+  for (;;) {
+    const int fd = ::accept(srv, nullptr, nullptr);
+    if (fd < 0) continue;
+    g_kill = false;
+    session(fd);
+  }
+}
+
+// -------------------- windows --------------------
+
+struct Row {
+  uint32_t window = 0;
+  double hours = 0;
+  size_t freeMin = 0;
+  size_t largestMin = 0;
+  uint32_t blocks = 0;
+  uint64_t allocs = 0;
+  uint64_t failed = 0;
+  uint32_t p50Us = 0;
+  uint32_t p99Us = 0;
+  uint32_t maxUs = 0;
+};
+
+struct Soak {
+  std::mt19937 rng;
+  FILE* csv = nullptr;
+  std::vector<Row> rows;
+
+  int64_t windowUs = 0;
+  int64_t windowStartUs = 0;
+  LoopStats loopAtStart;
+  sim::HeapStats heapAtStart;
+  size_t freeMin = SIZE_MAX;
+  size_t largestMin = SIZE_MAX;
+  int64_t nextSampleUs = 0;
+
+  int64_t nextOutageUs = 0;
+  int64_t linkBackUs = 0;
+  bool linkDropNext = true;
+  uint32_t outages = 0;
+  uint32_t kills = 0;
+  int64_t nextStormUs = 0;
+  uint32_t storms = 0;
+  int64_t nextWebUs = 0;
+  uint32_t webIndex = 0;
+  uint32_t webErrors = 0;
+  int64_t nextSaveUs = 0;
+  uint32_t saves = 0;
+} g_soak;
+
+int64_t hoursFromNow(double lo, double hi) {
+  std::uniform_real_distribution<double> d(lo, hi);
+  return sim::nowUs() + (int64_t)(d(g_soak.rng) * (double)kHour);
+}
+
+void openWindow(int64_t now) {
+  Soak& s = g_soak;
+  s.windowStartUs = now;
+  s.loopAtStart = loopStats;
+  s.heapAtStart = sim::heapStats();
+  s.freeMin = SIZE_MAX;
+  s.largestMin = SIZE_MAX;
+}
+
+void closeWindow(int64_t now) {
+  Soak& s = g_soak;
+  const sim::HeapStats h = sim::heapStats();
+  const LoopStats cur = loopStats;
+  uint32_t hist[LoopStats::kBuckets];
+  uint8_t top = 0;
+  for (uint8_t i = 0; i < LoopStats::kBuckets; i++) {
+    hist[i] = cur.hist[i] - s.loopAtStart.hist[i];
+    if (hist[i]) top = i;
+  }
+
+  Row r;
+  r.window = (uint32_t)s.rows.size();
+  r.hours = (double)(now - g_startUs) / (double)kHour;
+  r.freeMin = std::min(s.freeMin, h.freeBytes);
+  r.largestMin = std::min(s.largestMin, h.largestFree);
+  r.blocks = h.blocks;
+  r.allocs = h.allocs - s.heapAtStart.allocs;
+  r.failed = h.failed - s.heapAtStart.failed;
+  r.p50Us = LoopStats::percentileUs(hist, 0.50f);
+  r.p99Us = LoopStats::percentileUs(hist, 0.99f);
+  r.maxUs = cur.count != s.loopAtStart.count ? LoopStats::bucketLimitUs(top) : 0;
+
+  sim::HeapBypass bypass;
+  s.rows.push_back(r);
+  printf("[soak] %6.1f h free_min=%zu largest_min=%zu blocks=%u allocs=%llu failed=%llu loop p50=%u p99=%u max<%u us\n",
+         r.hours, r.freeMin, r.largestMin, r.blocks, (unsigned long long)r.allocs, (unsigned long long)r.failed,
+         r.p50Us, r.p99Us, r.maxUs);
+  if (s.csv) {
+    fprintf(s.csv, "%u,%.2f,%zu,%zu,%u,%llu,%llu,%u,%u,%u\n", r.window, r.hours, r.freeMin, r.largestMin, r.blocks,
+            (unsigned long long)r.allocs, (unsigned long long)r.failed, r.p50Us, r.p99Us, r.maxUs);
+    fflush(s.csv);
+  }
+  openWindow(now);
+}
+
+// -------------------- scenario --------------------
+
+const char* const kEndpoints[] = {
+  "/api/state", "/metrics.json", "/status.cbor", "/info.json", "/logs", "/ledconf.json",
+};
+
+void webRequest() {
+  Soak& s = g_soak;
+  const char* path = kEndpoints[s.webIndex++ % (sizeof(kEndpoints) / sizeof(kEndpoints[0]))];
+  const sim::HttpResult r = sim::httpRequest("GET", path);
+  // 503 is the admission gate doing its job under a low heap, not an error
+  if (r.status != 200 && r.status != 503) s.webErrors++;
+}
+
+// Brightness flips between two values; the printer config keeps its values, so
+// the save and reconnect paths run but no restart is scheduled
+void settingsSave() {
+  Soak& s = g_soak;
+  const sim::Options& o = sim::options();
+  sim::HttpResult r;
+  if (s.saves++ % 2 == 0) {
+    r = sim::httpRequest("POST", "/setLedBrightness", "brightness=" + std::to_string(200 + s.saves % 2));
+  } else {
+    r = sim::httpRequest("POST", "/submitPrinterConfig",
+                         "printerip=" + g_addr + "&printerusn=" + o.usn + "&printerac=" + o.accessCode);
+  }
+  if (r.status != 200 && r.status != 503) s.webErrors++;
+}
+
+bool degrading(const std::vector<Row>& rows, size_t from, double (*metric)(const Row&), int sign, double floor,
+               double* net) {
+  uint32_t bad = 0, good = 0;
+  for (size_t i = from + 1; i < rows.size(); i++) {
+    const double d = (metric(rows[i]) - metric(rows[i - 1])) * sign;
+    if (d > 0) bad++;
+    else if (d < 0) good++;
+  }
+  *net = (metric(rows.back()) - metric(rows[from])) * sign;
+  return bad >= 3 && bad * 5 >= (bad + good) * 4 && *net > floor;
+}
+
+}  // namespace
+
+namespace sim {
+
+std::string soakStart() {
+  const Options& o = options();
+  Soak& s = g_soak;
+  HeapBypass bypass;
+  s.rng.seed(o.seed);
+  s.windowUs = (int64_t)o.soakWindowMin * kMinute;
+  g_startUs = nowUs();
+
+  const pid_t pid = getpid();
+  g_addrBe = htonl((127u << 24) | (77u << 16) | std::max<uint32_t>(1, (uint32_t)pid & 0xFFFF));
+  in_addr a;
+  a.s_addr = g_addrBe;
+  g_addr = inet_ntoa(a);
+
+  const int srv = ::socket(AF_INET, SOCK_STREAM, 0);
+  const int one = 1;
+  ::setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in sa = {};
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(kBrokerPort);
+  sa.sin_addr.s_addr = g_addrBe;
+  if (::bind(srv, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0 || ::listen(srv, 2) != 0) {
+    perror("[soak] broker");
+    exit(2);
+  }
+  std::thread(broker, srv).detach();
+
+  if (!o.soakCsv.empty()) {
+    s.csv = fopen(o.soakCsv.c_str(), "w");
+    if (!s.csv) {
+      perror("[soak] csv");
+      exit(2);
+    }
+    fputs("window,hours,free_min,largest_min,blocks,allocs,failed,p50_us,p99_us,max_us\n", s.csv);
+  }
+
+  s.nextOutageUs = hoursFromNow(2, 8);
+  s.nextStormUs = hoursFromNow(4, 16);
+  s.nextSaveUs = hoursFromNow(1, 3);
+  s.nextWebUs = g_startUs + kWebEveryUs;
+  printf("[soak] %.1f days, %u min windows, printer broker on %s:%u\n", o.soakDays, (unsigned)o.soakWindowMin,
+         g_addr.c_str(), (unsigned)kBrokerPort);
+  openWindow(g_startUs);
+  return g_addr;
+}
+
+void soakTick() {
+  Soak& s = g_soak;
+  const int64_t now = nowUs();
+
+  if (now >= s.nextSampleUs) {
+    const HeapStats h = heapStats();
+    s.freeMin = std::min(s.freeMin, h.freeBytes);
+    s.largestMin = std::min(s.largestMin, h.largestFree);
+    s.nextSampleUs = now + kSampleEveryUs;
+  }
+
+  if (s.linkBackUs && now >= s.linkBackUs) {
+    setLinkUp(true);
+    s.linkBackUs = 0;
+  }
+  if (now >= s.nextOutageUs) {
+    // Alternate a Wi-Fi outage with the printer dropping the session
+    if (s.linkDropNext) {
+      setLinkUp(false);
+      s.linkBackUs = now + kOutageUs;
+      s.outages++;
+    } else {
+      g_kill = true;
+      s.kills++;
+    }
+    s.linkDropNext = !s.linkDropNext;
+    s.nextOutageUs = hoursFromNow(2, 8);
+  }
+  if (now >= s.nextStormUs) {
+    g_stormUntilUs = now + kStormUs;
+    s.storms++;
+    s.nextStormUs = hoursFromNow(4, 16);
+  }
+  if (now >= s.nextWebUs && !s.linkBackUs) {
+    webRequest();
+    s.nextWebUs = now + kWebEveryUs;
+  }
+  if (now >= s.nextSaveUs && !s.linkBackUs) {
+    settingsSave();
+    s.nextSaveUs = hoursFromNow(1, 3);
+  }
+
+  if (now - s.windowStartUs >= s.windowUs) closeWindow(now);
+}
+
+int soakVerdict() {
+  Soak& s = g_soak;
+  HeapBypass bypass;
+  std::vector<Row>& rows = s.rows;
+  printf("[soak] %zu windows, %u outages, %u session kills, %u HMS storms, %u saves, %u connects, %u reports, %u web errors\n",
+         rows.size(), s.outages, s.kills, s.storms, s.saves, g_connects.load(), g_reports.load(), s.webErrors);
+  if (s.csv) fclose(s.csv);
+
+  int fail = 0;
+  uint64_t failed = 0;
+  for (const Row& r : rows) failed += r.failed;
+  if (failed) {
+    printf("[soak] FAIL %llu failed allocations\n", (unsigned long long)failed);
+    fail = 1;
+  }
+
+  const size_t from = rows.size() / 4;
+  if (rows.size() - from < 5) {
+    printf("[soak] too few windows after warm-up for a trend (need 5, have %zu)\n", rows.size() - from);
+    return fail;
+  }
+
+  struct Check {
+    const char* name;
+    double (*metric)(const Row&);
+    int sign;        // +1: growth is bad, -1: shrinking is bad
+    double floor;    // net change that counts, absolute or relative to the first window
+    bool relative;
+  };
+  static const Check kChecks[] = {
+    { "free_min", [](const Row& r) { return (double)r.freeMin; }, -1, 256, false },
+    { "largest_min", [](const Row& r) { return (double)r.largestMin; }, -1, 256, false },
+    { "blocks", [](const Row& r) { return (double)r.blocks; }, +1, 4, false },
+    // One histogram bucket is ~19%; a single step up is noise, a staircase is not
+    { "p99_us", [](const Row& r) { return (double)r.p99Us; }, +1, 0.25, true },
+  };
+  for (const Check& c : kChecks) {
+    double net = 0;
+    const double floor = c.relative ? c.floor * std::max(1.0, c.metric(rows[from])) : c.floor;
+    if (degrading(rows, from, c.metric, c.sign, floor, &net)) {
+      printf("[soak] FAIL %s degrades monotonically after warm-up (%+.0f)\n", c.name, net * c.sign);
+      fail = 1;
+    }
+  }
+  printf("[soak] %s\n", fail ? "FAILED" : "ok");
+  return fail;
+}
+
+}  // namespace sim
@@ -0,0 +1,475 @@
+// Persistent state under --data-dir: NVS (Preferences), LittleFS, the OTA
+// slot and the running app image.
+
+#include <Preferences.h>
+#include <LittleFS.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_image_format.h>
+#include <esp_core_dump.h>
+#include <Sim.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+fs::LittleFSFS LittleFS;
+UpdateClass Update;
+
+namespace {
+
+constexpr uint32_t kAppPartitionSize = 0x1E0000;   // partitions.csv app slot
+constexpr uint32_t kCoreDumpAddress = 0x3F0000;
+constexpr uint32_t kCoreDumpSize = 0x10000;
+
+std::string dataPath(const char* rel) { return sim::options().dataDir + "/" + rel; }
+
+void makeDirs(const std::string& path) {
+  for (size_t i = 1; i <= path.size(); i++) {
+    if (i == path.size() || path[i] == '/') ::mkdir(path.substr(0, i).c_str(), 0755);
+  }
+}
+
+long fileSize(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? (long)st.st_size : -1;
+}
+
+}  // namespace
+
+// -------------------- Preferences --------------------
+
+struct Store {
+  std::string path;
+  std::map<std::string, std::string> values;
+
+  void load() {
+    values.clear();
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+      std::string s(line);
+      while (!s.empty() && (s.back() == '\n' || s.back() == '\r')) s.pop_back();
+      const size_t eq = s.find('=');
+      if (eq != std::string::npos) values[s.substr(0, eq)] = unescape(s.substr(eq + 1));
+    }
+    fclose(f);
+  }
+
+  bool save() const {
+    const std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f) return false;
+    for (const auto& kv : values) fprintf(f, "%s=%s\n", kv.first.c_str(), escape(kv.second).c_str());
+    const bool ok = fclose(f) == 0;
+    return ok && rename(tmp.c_str(), path.c_str()) == 0;
+  }
+
+  static std::string escape(const std::string& v) {
+    std::string out;
+    for (char c : v) {
+      if (c == '\\') out += "\\\\";
+      else if (c == '\n') out += "\\n";
+      else out += c;
+    }
+    return out;
+  }
+
+  static std::string unescape(const std::string& v) {
+    std::string out;
+    for (size_t i = 0; i < v.size(); i++) {
+      if (v[i] == '\\' && i + 1 < v.size()) {
+        out += v[i + 1] == 'n' ? '\n' : v[i + 1];
+        i++;
+      } else {
+        out += v[i];
+      }
+    }
+    return out;
+  }
+};
+
+namespace {
+std::mutex g_nvsLock;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition) {
+  (void)partition;
+  end();
+  // NVS keeps its cache outside the application heap
+  sim::HeapBypass bypass;
+  std::lock_guard<std::mutex> lock(g_nvsLock);
+  makeDirs(dataPath("nvs"));
+  _store = new Store();
+  _store->path = dataPath("nvs") + "/" + name + ".txt";
+  _store->load();
+  _readOnly = readOnly;
+  return true;
+}
+
+void Preferences::end() {
+  if (!_store) return;
+  sim::HeapBypass bypass;
+  delete _store;
+  _store = nullptr;
+}
+
+bool Preferences::clear() {
+  if (!_store || _readOnly) return false;
+  sim::HeapBypass bypass;
+  std::lock_guard<std::mutex> lock(g_nvsLock);
+  _store->values.clear();
+  return _store->save();
+}
+
+bool Preferences::remove(const char* key) {
+  if (!_store || _readOnly) return false;
+  sim::HeapBypass bypass;
+  std::lock_guard<std::mutex> lock(g_nvsLock);
+  return _store->values.erase(key) > 0 && _store->save();
+}
+
+bool Preferences::isKey(const char* key) { return find(key) != nullptr; }
+
+size_t Preferences::putFloat(const char* key, float v) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.9g", (double)v);
+  return putValue(key, buf) ? sizeof(float) : 0;
+}
+
+bool Preferences::putValue(const char* key, const char* value) {
+  if (!_store || _readOnly || !key || strlen(key) > 15) return false;   // NVS key limit
+  sim::HeapBypass bypass;
+  std::lock_guard<std::mutex> lock(g_nvsLock);
+  _store->values[key] = value;
+  return _store->save();
+}
+
+const char* Preferences::find(const char* key) {
+  if (!_store || !key) return nullptr;
+  sim::HeapBypass bypass;
+  std::lock_guard<std::mutex> lock(g_nvsLock);
+  const auto it = _store->values.find(key);
+  return it == _store->values.end() ? nullptr : it->second.c_str();
+}
+
+// -------------------- LittleFS --------------------
+
+namespace fs {
+
+struct FileImpl {
+  std::string hostPath;
+  std::string fsPath;
+  std::string name;
+  FILE* fp = nullptr;
+  DIR* dir = nullptr;
+
+  ~FileImpl() {
+    if (fp) fclose(fp);
+    if (dir) closedir(dir);
+  }
+};
+
+size_t File::write(const uint8_t* buf, size_t size) {
+  if (!_p || !_p->fp) return 0;
+  return fwrite(buf, 1, size, _p->fp);
+}
+
+int File::available() {
+  if (!_p || !_p->fp) return 0;
+  const long pos = ftell(_p->fp);
+  return (int)(size() - (size_t)pos);
+}
+
+int File::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+  if (!_p || !_p->fp) return 0;
+  return fread(buf, 1, size, _p->fp);
+}
+
+int File::peek() {
+  if (!_p || !_p->fp) return -1;
+  const int c = fgetc(_p->fp);
+  if (c != EOF) ungetc(c, _p->fp);
+  return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+  if (_p && _p->fp) fflush(_p->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!_p || !_p->fp) return false;
+  const int whence = mode == SeekCur ? SEEK_CUR : mode == SeekEnd ? SEEK_END : SEEK_SET;
+  return fseek(_p->fp, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+  if (!_p || !_p->fp) return 0;
+  return (size_t)ftell(_p->fp);
+}
+
+size_t File::size() const {
+  if (!_p || !_p->fp) return 0;
+  fflush(_p->fp);
+  const long n = fileSize(_p->hostPath);
+  return n < 0 ? 0 : (size_t)n;
+}
+
+const char* File::name() const { return _p ? _p->name.c_str() : ""; }
+const char* File::path() const { return _p ? _p->fsPath.c_str() : ""; }
+bool File::isDirectory() const { return _p && _p->dir; }
+
+File File::openNextFile(const char* mode) {
+  if (!_p || !_p->dir) return File();
+  while (dirent* e = readdir(_p->dir)) {
+    if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+    std::string child = _p->fsPath;
+    if (child.empty() || child.back() != '/') child += '/';
+    child += e->d_name;
+    return LittleFS.open(child.c_str(), mode);
+  }
+  return File();
+}
+
+std::string FS::hostPath(const char* path) const {
+  std::string p = path ? path : "/";
+  if (p.empty() || p[0] != '/') p = "/" + p;
+  return _root + p;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+  if (_root.empty() || !path) return File();
+  const std::string host = hostPath(path);
+  struct stat st;
+  const bool exists = stat(host.c_str(), &st) == 0;
+  if (!exists && !strcmp(mode, FILE_READ)) return File();
+  if (create) {
+    const size_t slash = host.rfind('/');
+    if (slash != std::string::npos) makeDirs(host.substr(0, slash));
+  }
+
+  auto impl = std::make_shared<FileImpl>();
+  impl->hostPath = host;
+  impl->fsPath = path;
+  const size_t slash = impl->fsPath.rfind('/');
+  impl->name = slash == std::string::npos ? impl->fsPath : impl->fsPath.substr(slash + 1);
+  if (exists && S_ISDIR(st.st_mode)) {
+    impl->dir = opendir(host.c_str());
+    if (!impl->dir) return File();
+  } else {
+    const char* m = !strcmp(mode, FILE_READ) ? "rb" : !strcmp(mode, FILE_APPEND) ? "ab" : "wb";
+    impl->fp = fopen(host.c_str(), m);
+    if (!impl->fp) return File();
+  }
+  return File(impl);
+}
+
+bool FS::exists(const char* path) {
+  struct stat st;
+  return !_root.empty() && stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) { return !_root.empty() && ::unlink(hostPath(path).c_str()) == 0; }
+
+bool FS::rename(const char* from, const char* to) {
+  return !_root.empty() && ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+  return !_root.empty() && (::mkdir(hostPath(path).c_str(), 0755) == 0 || errno == EEXIST);
+}
+
+bool FS::rmdir(const char* path) { return !_root.empty() && ::rmdir(hostPath(path).c_str()) == 0; }
+
+namespace {
+
+size_t treeBytes(const std::string& dir) {
+  size_t total = 0;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return 0;
+  while (dirent* e = readdir(d)) {
+    if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+    const std::string p = dir + "/" + e->d_name;
+    struct stat st;
+    if (stat(p.c_str(), &st) != 0) continue;
+    total += S_ISDIR(st.st_mode) ? treeBytes(p) : (size_t)st.st_size;
+  }
+  closedir(d);
+  return total;
+}
+
+void removeTree(const std::string& dir) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) return;
+  while (dirent* e = readdir(d)) {
+    if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+    const std::string p = dir + "/" + e->d_name;
+    struct stat st;
+    if (stat(p.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+      removeTree(p);
+      ::rmdir(p.c_str());
+    } else {
+      ::unlink(p.c_str());
+    }
+  }
+  closedir(d);
+}
+
+}  // namespace
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+  (void)formatOnFail;
+  (void)basePath;
+  (void)maxOpenFiles;
+  (void)partitionLabel;
+  _root = dataPath("fs");
+  makeDirs(_root);
+  return true;
+}
+
+bool LittleFSFS::format() {
+  if (_root.empty()) return false;
+  removeTree(_root);
+  return true;
+}
+
+size_t LittleFSFS::usedBytes() { return _root.empty() ? 0 : treeBytes(_root); }
+
+}  // namespace fs
+
+// -------------------- Update / app partition --------------------
+
+bool UpdateClass::begin(size_t size, int command) {
+  (void)command;
+  abort();
+  _error = UPDATE_ERROR_OK;
+  if (size != UPDATE_SIZE_UNKNOWN && size > kAppPartitionSize) {
+    _error = UPDATE_ERROR_SPACE;
+    return false;
+  }
+  _fp = fopen(dataPath("ota.bin").c_str(), "wb");
+  if (!_fp) {
+    _error = UPDATE_ERROR_WRITE;
+    return false;
+  }
+  _size = size;
+  _written = 0;
+  return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+  if (!_fp || hasError()) return 0;
+  if (_written == 0 && len && data[0] != 0xE9) {   // ESP image magic
+    _error = UPDATE_ERROR_MAGIC_BYTE;
+    abort();
+    return 0;
+  }
+  if (_written + len > kAppPartitionSize || fwrite(data, 1, len, _fp) != len) {
+    _error = _written + len > kAppPartitionSize ? UPDATE_ERROR_SPACE : UPDATE_ERROR_WRITE;
+    abort();
+    return 0;
+  }
+  _written += len;
+  return len;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+  if (!_fp) return false;
+  if (!evenIfRemaining && _size != UPDATE_SIZE_UNKNOWN && _written != _size) {
+    _error = UPDATE_ERROR_SIZE;
+    abort();
+    return false;
+  }
+  fclose(_fp);
+  _fp = nullptr;
+  if (rename(dataPath("ota.bin").c_str(), dataPath("app.bin").c_str()) != 0) {
+    _error = UPDATE_ERROR_WRITE;
+    return false;
+  }
+  return true;
+}
+
+void UpdateClass::abort() {
+  if (_fp) {
+    fclose(_fp);
+    unlink(dataPath("ota.bin").c_str());
+  }
+  _fp = nullptr;
+  if (!hasError()) _error = UPDATE_ERROR_ABORT;
+}
+
+const char* UpdateClass::errorString() const {
+  switch (_error) {
+    case UPDATE_ERROR_OK: return "No Error";
+    case UPDATE_ERROR_WRITE: return "Flash Write Failed";
+    case UPDATE_ERROR_SPACE: return "Not Enough Space";
+    case UPDATE_ERROR_SIZE: return "Bad Size Given";
+    case UPDATE_ERROR_ABORT: return "Update Aborted";
+    case UPDATE_ERROR_MAGIC_BYTE: return "Wrong Magic Byte";
+    default: return "UNKNOWN";
+  }
+}
+
+const esp_partition_t* esp_ota_get_running_partition() {
+  static const esp_partition_t app0 = { 0x10000, kAppPartitionSize, "app0" };
+  return &app0;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+  static const esp_partition_t coredump = { kCoreDumpAddress, kCoreDumpSize, "coredump" };
+  if (type != ESP_PARTITION_TYPE_DATA) return nullptr;
+  if (subtype != ESP_PARTITION_SUBTYPE_DATA_COREDUMP && subtype != ESP_PARTITION_SUBTYPE_ANY) return nullptr;
+  if (label && strcmp(label, coredump.label) != 0) return nullptr;
+  return &coredump;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t srcOffset, void* dst, size_t size) {
+  if (!partition || !dst || srcOffset + size > partition->size) return ESP_ERR_INVALID_ARG;
+  // Past the image the slot reads as erased flash
+  memset(dst, 0xFF, size);
+  const bool coredump = strcmp(partition->label, "coredump") == 0;
+  FILE* f = fopen(dataPath(coredump ? "coredump.bin" : "app.bin").c_str(), "rb");
+  if (!f) return ESP_OK;
+  if (fseek(f, (long)srcOffset, SEEK_SET) == 0) fread(dst, 1, size, f);
+  fclose(f);
+  return ESP_OK;
+}
+
+esp_err_t esp_core_dump_image_get(size_t* outAddr, size_t* outSize) {
+  const long n = fileSize(dataPath("coredump.bin"));
+  if (n <= 0) return ESP_ERR_NOT_FOUND;
+  if ((uint32_t)n > kCoreDumpSize) return ESP_ERR_INVALID_SIZE;
+  if (outAddr) *outAddr = kCoreDumpAddress;
+  if (outSize) *outSize = (size_t)n;
+  return ESP_OK;
+}
+
+esp_err_t esp_core_dump_image_erase() {
+  unlink(dataPath("coredump.bin").c_str());
+  return ESP_OK;
+}
+
+const esp_app_desc_t* esp_ota_get_app_description() {
+  static const esp_app_desc_t desc = { STRVERSION, SOURCE_NAME, {0} };
+  return &desc;
+}
+
+esp_err_t esp_image_get_metadata(const esp_partition_pos_t* part, esp_image_metadata_t* metadata) {
+  if (!part || !metadata) return ESP_ERR_INVALID_ARG;
+  const long n = fileSize(dataPath("app.bin"));
+  if (n <= 0) return ESP_ERR_NOT_FOUND;
+  metadata->start_addr = part->offset;
+  metadata->image_len = (uint32_t)n;
+  return ESP_OK;
+}
@@ -0,0 +1,526 @@
+// AsyncWebServer on the host: a listener thread accepts HTTP/1.1 requests
+// (one per connection, Connection: close) and queues them; pollWeb() parses
+// and dispatches them on the loop thread, then streams the response, retrying
+// RESPONSE_TRY_AGAIN fillers on later polls. sim::httpRequest() feeds the same
+// path in-process.
+
+#include <ESPAsyncWebServer.h>
+#include <Sim.h>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kChunk = 1436;                 // one TCP segment, as AsyncTCP hands them over
+constexpr size_t kMaxRequest = 4UL * 1024UL * 1024UL;
+constexpr int64_t kResponseTimeoutUs = 30LL * 1000 * 1000;
+
+struct RawRequest {
+  int fd = -1;                                  // -1 = in-process
+  std::string method;
+  std::string target;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  bool trusted = false;
+};
+
+struct Conn {
+  int fd = -1;
+  AsyncWebServerRequest* req = nullptr;
+  int64_t startUs = 0;
+  bool headerSent = false;
+  sim::HttpResult* capture = nullptr;           // in-process result
+};
+
+std::mutex g_queueLock;
+std::deque<RawRequest*> g_queue;
+std::vector<Conn*> g_conns;
+AsyncWebServer* g_server = nullptr;
+
+bool iequals(const std::string& a, const char* b) { return strcasecmp(a.c_str(), b) == 0; }
+
+int hexVal(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+std::string urlDecode(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '+') {
+      out += ' ';
+    } else if (s[i] == '%' && i + 2 < s.size() && hexVal(s[i + 1]) >= 0 && hexVal(s[i + 2]) >= 0) {
+      out += (char)(hexVal(s[i + 1]) * 16 + hexVal(s[i + 2]));
+      i += 2;
+    } else {
+      out += s[i];
+    }
+  }
+  return out;
+}
+
+std::string base64Decode(const std::string& in) {
+  static const char* kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  uint32_t acc = 0;
+  int bits = 0;
+  for (char c : in) {
+    const char* p = strchr(kAlphabet, c);
+    if (!p || !c) break;
+    acc = (acc << 6) | (uint32_t)(p - kAlphabet);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out += (char)((acc >> bits) & 0xFF);
+    }
+  }
+  return out;
+}
+
+const char* reason(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+WebRequestMethodComposite methodOf(const std::string& m) {
+  if (m == "GET") return HTTP_GET;
+  if (m == "POST") return HTTP_POST;
+  if (m == "DELETE") return HTTP_DELETE;
+  if (m == "PUT") return HTTP_PUT;
+  if (m == "PATCH") return HTTP_PATCH;
+  if (m == "HEAD") return HTTP_HEAD;
+  if (m == "OPTIONS") return HTTP_OPTIONS;
+  return 0;
+}
+
+bool sendAll(int fd, const void* data, size_t len) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (len) {
+    const ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    p += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+// Listener thread: whole request (headers + Content-Length body) or nothing
+RawRequest* readRequest(int fd) {
+  std::string buf;
+  size_t headerEnd = std::string::npos;
+  size_t need = 0;
+  // Real time: the peer is outside the simulation
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  char chunk[4096];
+  for (;;) {
+    if (headerEnd == std::string::npos) {
+      headerEnd = buf.find("\r\n\r\n");
+      if (headerEnd != std::string::npos) {
+        const std::string head = buf.substr(0, headerEnd);
+        size_t pos = head.find("\r\n");
+        need = headerEnd + 4;
+        while (pos != std::string::npos && pos < head.size()) {
+          const size_t next = head.find("\r\n", pos + 2);
+          const std::string line = head.substr(pos + 2, next == std::string::npos ? std::string::npos : next - pos - 2);
+          if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) need += strtoul(line.c_str() + 15, nullptr, 10);
+          pos = next;
+        }
+      }
+    }
+    if (headerEnd != std::string::npos && buf.size() >= need) break;
+    if (buf.size() > kMaxRequest || std::chrono::steady_clock::now() > deadline) return nullptr;
+    pollfd p = { fd, POLLIN, 0 };
+    if (poll(&p, 1, 100) != 1) continue;
+    const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+    if (n <= 0) return nullptr;
+    buf.append(chunk, (size_t)n);
+  }
+
+  RawRequest* r = new RawRequest();
+  r->fd = fd;
+  const size_t lineEnd = buf.find("\r\n");
+  const std::string first = buf.substr(0, lineEnd);
+  const size_t sp1 = first.find(' ');
+  const size_t sp2 = first.find(' ', sp1 + 1);
+  r->method = first.substr(0, sp1);
+  r->target = first.substr(sp1 + 1, sp2 == std::string::npos ? std::string::npos : sp2 - sp1 - 1);
+  size_t pos = lineEnd + 2;
+  while (pos < headerEnd) {
+    const size_t next = buf.find("\r\n", pos);
+    const std::string line = buf.substr(pos, next - pos);
+    const size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+      size_t v = colon + 1;
+      while (v < line.size() && line[v] == ' ') v++;
+      r->headers.emplace_back(line.substr(0, colon), line.substr(v));
+    }
+    pos = next + 2;
+  }
+  r->body = buf.substr(headerEnd + 4);
+  return r;
+}
+
+void listenerTask(uint16_t port) {
+  sim::HeapBypass bypass;
+  const int srv = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  a.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(srv, reinterpret_cast<sockaddr*>(&a), sizeof(a)) != 0 || listen(srv, 8) != 0) {
+    fprintf(stderr, "[sim] http: cannot listen on port %u\n", port);
+    close(srv);
+    return;
+  }
+  printf("[sim] http: listening on port %u\n", port);
+  for (;;) {
+    const int fd = accept(srv, nullptr, nullptr);
+    if (fd < 0) continue;
+    timeval tv = { 5, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    RawRequest* r = readRequest(fd);
+    if (!r) {
+      close(fd);
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(g_queueLock);
+    g_queue.push_back(r);
+  }
+}
+
+}  // namespace
+
+struct SimWebAccess {
+  static AsyncCallbackWebHandler* route(AsyncWebServer* server, AsyncWebServerRequest* req) {
+    const String& url = req->url();
+    for (AsyncCallbackWebHandler* h : server->_handlers) {
+      if (!(h->method & req->method())) continue;
+      if (h->uri.length() && h->uri.endsWith("*")) {
+        if (url.startsWith(h->uri.substring(0, h->uri.length() - 1))) return h;
+      } else if (url == h->uri || url.startsWith(h->uri + "/")) {
+        return h;
+      }
+    }
+    return nullptr;
+  }
+
+  static void parseQuery(AsyncWebServerRequest* req, const std::string& q, bool form) {
+    size_t pos = 0;
+    while (pos <= q.size()) {
+      size_t amp = q.find('&', pos);
+      if (amp == std::string::npos) amp = q.size();
+      const std::string pair = q.substr(pos, amp - pos);
+      if (!pair.empty()) {
+        const size_t eq = pair.find('=');
+        const std::string name = urlDecode(pair.substr(0, eq));
+        const std::string value = eq == std::string::npos ? std::string() : urlDecode(pair.substr(eq + 1));
+        req->_params.emplace_back(String(name.c_str()), String(value.c_str()), form);
+      }
+      pos = amp + 1;
+    }
+  }
+
+  static void upload(AsyncWebServerRequest* req, AsyncCallbackWebHandler* h, const String& filename,
+                     const std::string& data) {
+    if (!h || !h->onUpload) return;
+    size_t index = 0;
+    do {
+      const size_t n = min(kChunk, data.size() - index);
+      h->onUpload(req, filename, index, (uint8_t*)data.data() + index, n, index + n >= data.size());
+      index += n;
+    } while (index < data.size());
+  }
+
+  static void multipart(AsyncWebServerRequest* req, AsyncCallbackWebHandler* h, const std::string& type,
+                        const std::string& body) {
+    const size_t b = type.find("boundary=");
+    if (b == std::string::npos) return;
+    std::string boundary = type.substr(b + 9);
+    if (!boundary.empty() && boundary[0] == '"') boundary = boundary.substr(1, boundary.find('"', 1) - 1);
+    const std::string delim = "--" + boundary;
+    size_t pos = body.find(delim);
+    while (pos != std::string::npos) {
+      pos += delim.size();
+      if (body.compare(pos, 2, "--") == 0) break;
+      const size_t headEnd = body.find("\r\n\r\n", pos);
+      const size_t next = body.find("\r\n" + delim, headEnd == std::string::npos ? pos : headEnd);
+      if (headEnd == std::string::npos || next == std::string::npos) break;
+      const std::string head = body.substr(pos, headEnd - pos);
+      const std::string data = body.substr(headEnd + 4, next - headEnd - 4);
+      std::string name, filename;
+      const size_t n = head.find("name=\"");
+      if (n != std::string::npos) name = head.substr(n + 6, head.find('"', n + 6) - n - 6);
+      const size_t f = head.find("filename=\"");
+      if (f != std::string::npos) {
+        filename = head.substr(f + 10, head.find('"', f + 10) - f - 10);
+        req->_params.emplace_back(String(name.c_str()), String(filename.c_str()), true, true);
+        upload(req, h, String(filename.c_str()), data);
+      } else if (n != std::string::npos) {
+        req->_params.emplace_back(String(name.c_str()), String(data.c_str()), true);
+      }
+      pos = next + 2;
+    }
+  }
+
+  // Builds the request, runs the body/upload callbacks and the handler
+  static AsyncWebServerRequest* dispatch(const RawRequest& raw) {
+    const size_t q = raw.target.find('?');
+    const std::string path = raw.target.substr(0, q);
+    AsyncWebServerRequest* req = new AsyncWebServerRequest(methodOf(raw.method), String(path.c_str()));
+    req->_trusted = raw.trusted;
+    req->_contentLength = raw.body.size();
+    std::string type;
+    for (const auto& h : raw.headers) {
+      req->_headers.emplace_back(String(h.first.c_str()), String(h.second.c_str()));
+      if (iequals(h.first, "Content-Type")) type = h.second;
+    }
+    req->_contentType = type.c_str();
+    if (q != std::string::npos) parseQuery(req, raw.target.substr(q + 1), false);
+
+    AsyncCallbackWebHandler* h = g_server ? route(g_server, req) : nullptr;
+    if (strncasecmp(type.c_str(), "application/x-www-form-urlencoded", 33) == 0) {
+      parseQuery(req, raw.body, true);
+    } else if (strncasecmp(type.c_str(), "multipart/form-data", 19) == 0) {
+      multipart(req, h, type, raw.body);
+    } else if (!raw.body.empty() && h && h->onBody) {
+      for (size_t index = 0; index < raw.body.size(); index += kChunk) {
+        const size_t n = min(kChunk, raw.body.size() - index);
+        h->onBody(req, (uint8_t*)raw.body.data() + index, n, index, raw.body.size());
+      }
+    }
+
+    if (h && h->onRequest) h->onRequest(req);
+    else if (!h && g_server && g_server->_notFound) g_server->_notFound(req);
+    else req->send(404, "text/plain", "Not found");
+    return req;
+  }
+
+  static AsyncWebServerResponse* response(AsyncWebServerRequest* req) { return req->_response; }
+
+  static void finish(AsyncWebServerRequest* req) {
+    for (auto& fn : req->_onDisconnect) fn();
+    delete req;
+  }
+};
+
+namespace {
+
+// Streams what the response has ready. True once the connection is done.
+bool pump(Conn* c) {
+  AsyncWebServerResponse* r = SimWebAccess::response(c->req);
+  if (!r) {
+    // The handler kept the request to answer later
+    if (sim::nowUs() - c->startUs < kResponseTimeoutUs) return false;
+    c->req->send(500, "text/plain", "no response");
+    r = SimWebAccess::response(c->req);
+  }
+
+  if (!c->headerSent) {
+    sim::HeapBypass bypass;
+    std::string head = "HTTP/1.1 " + std::to_string(r->code()) + " " + reason(r->code()) + "\r\n";
+    if (r->contentType().length()) head += std::string("Content-Type: ") + r->contentType().c_str() + "\r\n";
+    if (r->contentLength() >= 0) head += "Content-Length: " + std::to_string(r->contentLength()) + "\r\n";
+    for (const AsyncWebHeader& h : r->headers()) {
+      head += std::string(h.name().c_str()) + ": " + h.value().c_str() + "\r\n";
+    }
+    head += "Connection: close\r\n\r\n";
+    if (c->capture) {
+      c->capture->status = r->code();
+      c->capture->contentType = r->contentType().c_str();
+    } else {
+      sendAll(c->fd, head.data(), head.size());
+    }
+    c->headerSent = true;
+  }
+
+  uint8_t buf[kChunk];
+  for (;;) {
+    const size_t n = r->fill(buf, sizeof(buf));
+    if (n == RESPONSE_TRY_AGAIN) return sim::nowUs() - c->startUs >= kResponseTimeoutUs;
+    if (n == 0) return true;
+    if (c->capture) {
+      sim::HeapBypass bypass;
+      c->capture->body.append(reinterpret_cast<const char*>(buf), n);
+    } else if (!sendAll(c->fd, buf, n)) {
+      return true;
+    }
+  }
+}
+
+void drop(Conn* c) {
+  if (c->fd >= 0) ::close(c->fd);
+  SimWebAccess::finish(c->req);
+  delete c;
+}
+
+}  // namespace
+
+// -------------------- request / server --------------------
+
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+  delete _response;
+  if (_tempObject) free(_tempObject);
+}
+
+const AsyncWebParameter* AsyncWebServerRequest::getParam(const char* name, bool post, bool file) const {
+  for (const AsyncWebParameter& p : _params) {
+    if (p.name() == name && p.isPost() == post && p.isFile() == file) return &p;
+  }
+  return nullptr;
+}
+
+const AsyncWebHeader* AsyncWebServerRequest::getHeader(const char* name) const {
+  for (const AsyncWebHeader& h : _headers) {
+    if (h.name().equalsIgnoreCase(name)) return &h;
+  }
+  return nullptr;
+}
+
+bool AsyncWebServerRequest::authenticate(const char* user, const char* pass) const {
+  if (_trusted) return true;
+  const AsyncWebHeader* h = getHeader("Authorization");
+  if (!h || !h->value().startsWith("Basic ")) return false;
+  sim::HeapBypass bypass;
+  const std::string decoded = base64Decode(h->value().substring(6).c_str());
+  return decoded == std::string(user ? user : "") + ":" + (pass ? pass : "");
+}
+
+void AsyncWebServerRequest::requestAuthentication(const char* realm, bool digest) {
+  (void)digest;   // Basic only
+  AsyncWebServerResponse* r = beginResponse(401);
+  r->addHeader("WWW-Authenticate", String("Basic realm=\"") + (realm ? realm : "Login Required") + "\"");
+  send(r);
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* response) {
+  if (_response) {
+    delete response;   // first send wins, like the library
+    return;
+  }
+  _response = response;
+}
+
+void AsyncWebServerRequest::redirect(const char* url, int code) {
+  AsyncWebServerResponse* r = beginResponse(code);
+  r->addHeader("Location", url);
+  send(r);
+}
+
+AsyncWebServer::~AsyncWebServer() {
+  for (AsyncCallbackWebHandler* h : _handlers) delete h;
+  if (g_server == this) g_server = nullptr;
+}
+
+void AsyncWebServer::begin() {
+  if (!g_server) g_server = this;
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method,
+                                            ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload,
+                                            ArBodyHandlerFunction onBody) {
+  AsyncCallbackWebHandler* h = new AsyncCallbackWebHandler();
+  h->uri = uri;
+  h->method = method;
+  h->onRequest = onRequest;
+  h->onUpload = onUpload;
+  h->onBody = onBody;
+  _handlers.push_back(h);
+  return *h;
+}
+
+// -------------------- simulator side --------------------
+
+namespace sim {
+
+void startHttpListener(uint16_t port) {
+  if (!port) return;
+  HeapBypass bypass;
+  std::thread(listenerTask, port).detach();
+}
+
+void pollWeb() {
+  for (;;) {
+    RawRequest* raw = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(g_queueLock);
+      if (g_queue.empty()) break;
+      raw = g_queue.front();
+      g_queue.pop_front();
+    }
+    Conn* c;
+    {
+      HeapBypass bypass;
+      c = new Conn();
+    }
+    c->fd = raw->fd;
+    c->startUs = nowUs();
+    c->req = SimWebAccess::dispatch(*raw);
+    delete raw;
+    HeapBypass bypass;
+    g_conns.push_back(c);
+  }
+
+  for (size_t i = 0; i < g_conns.size();) {
+    if (pump(g_conns[i])) {
+      drop(g_conns[i]);
+      g_conns.erase(g_conns.begin() + i);
+    } else {
+      i++;
+    }
+  }
+}
+
+HttpResult httpRequest(const char* method, const std::string& pathAndQuery, const std::string& body,
+                       const char* contentType, bool withAuth) {
+  HttpResult result;
+  RawRequest raw;
+  Conn c;
+  {
+    HeapBypass bypass;
+    raw.method = method;
+    raw.target = pathAndQuery;
+    raw.body = body;
+    if (contentType && *contentType) raw.headers.emplace_back("Content-Type", contentType);
+  }
+  raw.trusted = withAuth;
+  c.startUs = nowUs();
+  c.capture = &result;
+  c.req = SimWebAccess::dispatch(raw);
+  // Fillers waiting on another task (RESPONSE_TRY_AGAIN) get virtual time to finish
+  while (!pump(&c)) {
+    skipUs(1000);
+    std::this_thread::yield();
+  }
+  SimWebAccess::finish(c.req);
+  return result;
+}
+
+}  // namespace sim
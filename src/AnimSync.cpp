@@ -0,0 +1,89 @@
+#include "AnimSync.h"
+
+#include <esp_timer.h>
+#include "SettingsPrefs.h"
+#include "WebSerial.h"
+
+extern Settings settings;
+
+void AnimSync::begin() {
+  // MAC bytes 2..5, unique per device
+  _nodeId = (uint32_t)(ESP.getEfuseMac() >> 16);
+  if (!_nodeId) _nodeId = 1;
+  configure();
+}
+
+void AnimSync::configure() {
+  const bool enabled = settings.get.LEDSync();
+  if (enabled != _enabled) {
+    webSerial.printf("[SYNC] %s (node %08lx)\n", enabled ? "Enabled" : "Disabled", (unsigned long)_nodeId);
+  }
+  _enabled = enabled;
+  _core.configure(_nodeId);
+  _offsetMs = 0;
+  if (!_enabled && _listening) {
+    _udp.stop();
+    _listening = false;
+  }
+  portENTER_CRITICAL(&_statsMux);
+  _stats.enabled = enabled;
+  _stats.node = _nodeId;
+  _stats.proto = _core.stats();
+  portEXIT_CRITICAL(&_statsMux);
+}
+
+void AnimSync::loop() {
+  if (_reload.exchange(false)) configure();
+  if (!_enabled) return;
+
+  // Keep the last offset while offline: the local crystal carries on
+  if (!_wifi.connected()) {
+    if (_listening) {
+      _udp.stop();
+      _listening = false;
+    }
+    return;
+  }
+  if (!_listening) {
+    _listening = _udp.beginMulticast(IPAddress(clocksync::kGroupAddr[0], clocksync::kGroupAddr[1],
+                                               clocksync::kGroupAddr[2], clocksync::kGroupAddr[3]), clocksync::kPort);
+    if (!_listening) return;
+  }
+
+  uint8_t buf[clocksync::kPacketLen];
+  for (uint8_t i = 0; i < 8; i++) {
+    const int n = _udp.parsePacket();
+    if (n <= 0) break;
+    // Receive time as close to the socket as the loop allows
+    const int64_t rxUs = esp_timer_get_time();
+    if ((size_t)n != sizeof(buf)) {
+      _udp.flush();
+      continue;
+    }
+    _udp.read(buf, n);
+    _core.onPacket(buf, (size_t)n, rxUs);
+  }
+
+  const int64_t nowUs = esp_timer_get_time();
+  _core.update(nowUs);
+  if (_core.poll(nowUs, buf)) {
+    _udp.beginMulticastPacket();
+    _udp.write(buf, sizeof(buf));
+    _udp.endPacket();
+  }
+
+  // millis() is esp_timer / 1000, so the shared clock in ms is millis() + this
+  // (wraps with millis(), as the animations expect)
+  _offsetMs = (int32_t)(uint32_t)(_core.shared(nowUs) / 1000 - nowUs / 1000);
+
+  portENTER_CRITICAL(&_statsMux);
+  _stats.proto = _core.stats();
+  portEXIT_CRITICAL(&_statsMux);
+}
+
+AnimSync::Stats AnimSync::stats() const {
+  portENTER_CRITICAL(&_statsMux);
+  Stats s = _stats;
+  portEXIT_CRITICAL(&_statsMux);
+  return s;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "Hal.h"
+#include "ClockSyncProto.h"
+
+// Shared animation clock (setting device/LEDSync): beacons on the LAN
+// multicast their clocks once a second and slew towards a common reference,
+// so LedController animations run in phase across a farm. Estimator and
+// accuracy notes: ClockSyncProto.h, tools/clock_sync_sim.cpp.
+class AnimSync {
+public:
+  explicit AnimSync(hal::Wifi& wifi = hal::wifi()) : _wifi(wifi) {}
+
+  struct Stats {
+    bool     enabled = false;
+    uint32_t node = 0;
+    clocksync::Core::Stats proto;
+  };
+
+  void begin();
+  // Loop task, before ledsCtrl.loop()
+  void loop();
+  // Any task: LED settings changed
+  void reload() { _reload = true; }
+
+  // Add to millis() to get the shared animation clock; 0 when disabled
+  int32_t offsetMs() const { return _offsetMs; }
+
+  Stats stats() const;
+
+private:
+  void configure();
+
+  bool       _enabled = false;
+  uint32_t   _nodeId = 0;
+  clocksync::Core _core;
+  hal::Wifi& _wifi;
+  hal::Udp   _udp;
+  bool       _listening = false;
+  int32_t    _offsetMs = 0;
+  std::atomic<bool> _reload{false};
+
+  // Copied for stats() (read from AsyncTCP)
+  mutable portMUX_TYPE _statsMux = portMUX_INITIALIZER_UNLOCKED;
+  Stats _stats;
+};
@@ -1,4 +1,6 @@
 #include "BambuMqttClient.h"
+#include "Log.h"
+#include "Trace.h"
 
 namespace {
 BambuMqttClient* s_instance = nullptr;
@@ -20,9 +22,10 @@ void mqttCallback(char* topic, uint8_t* payload, unsigned int length) {
 
 const char* BambuMqttClient::kUser = "bblp";
 
-BambuMqttClient::BambuMqttClient()
-: _net(),
-  _mqtt(_net) {}
+BambuMqttClient::BambuMqttClient(hal::Wifi& wifi)
+: _wifi(wifi),
+  _net(),
+  _mqtt(_net.client()) {}
 BambuMqttClient::~BambuMqttClient() {
   if (_events) {
     delete[] _events;
@@ -50,9 +53,7 @@ bool BambuMqttClient::begin(Settings &settings) {
   _events = new HmsEvent[_eventsCap];
 
   _net.setInsecure();
-#if defined(ARDUINO_ARCH_ESP32)
   _net.setHandshakeTimeout(kTlsHandshakeTimeoutMs);
-#endif
   _net.setTimeout(kSocketTimeoutMs);
   _mqtt.setServer(_printerIP.c_str(), kPort);
   _mqtt.setBufferSize(kMqttBufferSize);
@@ -64,7 +65,7 @@ bool BambuMqttClient::begin(Settings &settings) {
 
   _ready = true;
 
-  if (WiFi.status() == WL_CONNECTED) {
+  if (_wifi.connected()) {
     connect();
   } else {
     webSerial.println("[MQTT] WiFi not connected yet - will connect from loopTick().");
@@ -97,9 +98,7 @@ void BambuMqttClient::reloadFromSettings() {
   _events = new HmsEvent[_eventsCap];
 
   _net.setInsecure();
-#if defined(ARDUINO_ARCH_ESP32)
   _net.setHandshakeTimeout(kTlsHandshakeTimeoutMs);
-#endif
   _net.setTimeout(kSocketTimeoutMs);
   _mqtt.setServer(_printerIP.c_str(), kPort);
   _mqtt.setBufferSize(kMqttBufferSize);
@@ -140,14 +139,14 @@ bool BambuMqttClient::configLooksValid() const {
 
 void BambuMqttClient::connect() {
   if (!_ready) return;
-  if (WiFi.status() != WL_CONNECTED) return;
+  if (!_wifi.connected()) return;
 
   if (!configLooksValid()) {
     webSerial.println("[MQTT] Cannot connect: missing settings.");
     return;
   }
 
-  if (_mqtt.connected()) return;
+  if (_mqtt.connected() || _relayFollower) return;
 
   webSerial.printf("[MQTT] Connecting to %s (clientId=%s)\n",
                    _serverUri.c_str(), _clientId.c_str());
@@ -166,15 +165,23 @@ void BambuMqttClient::disconnect() {
 }
 
 bool BambuMqttClient::isConnected() {
+  if (_relayFollower) return _relayConnected;
   return _mqtt.connected();
 }
 
 void BambuMqttClient::loopTick() {
   // NEW: completely safe when not configured yet
   if (!_ready || !_events) return;
-  if (WiFi.status() != WL_CONNECTED) {
+  if (!_wifi.connected()) {
     // Still expire HMS so old errors do not stick forever if WiFi drops
     expireEvents(millis());
+    publishSnapshot();
+    return;
+  }
+
+  if (_relayFollower) {
+    expireEvents(millis());
+    if (millis() - _lastSnapshotMs >= 250UL) publishSnapshot();
     return;
   }
 
@@ -186,18 +193,23 @@ void BambuMqttClient::loopTick() {
       connect();
     }
   } else {
+    TRACE_SCOPE(MqttLoop);
     _mqtt.loop();
   }
 
   const uint32_t now = millis();
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
   if (_mqtt.connected() && now - _lastMqttDebugMs >= 10000UL) {
     const uint32_t age = _lastMsgMs ? (now - _lastMsgMs) : 0;
-    webSerial.printf("[MQTT] Loop ok sub=%d lastMsgAge=%u ms lastLen=%u\n",
-                     _subscribed ? 1 : 0, (unsigned)age, (unsigned)_lastMsgLen);
+    LOGD("[MQTT] Loop ok sub=%d lastMsgAge=%u ms lastLen=%u\n",
+         _subscribed ? 1 : 0, (unsigned)age, (unsigned)_lastMsgLen);
     _lastMqttDebugMs = now;
   }
+#endif
 
   expireEvents(millis());
+
+  if (now - _lastSnapshotMs >= 250UL) publishSnapshot();
 }
 
 bool BambuMqttClient::publishRequest(const JsonDocument& doc, bool retain) {
@@ -215,6 +227,10 @@ void BambuMqttClient::onReport(ReportCallback cb) {
   _reportCb = cb;
 }
 
+void BambuMqttClient::onRawReport(RawReportCallback cb) {
+  _rawReportCb = cb;
+}
+
 const String& BambuMqttClient::topicReport() const { return _topicReport; }
 const String& BambuMqttClient::topicRequest() const { return _topicRequest; }
 const String& BambuMqttClient::gcodeState() const { return _gcodeState; }
@@ -228,8 +244,111 @@ float BambuMqttClient::nozzleTarget() const { return _nozzleTarget; }
 bool BambuMqttClient::nozzleValid() const { return _nozzleValid; }
 bool BambuMqttClient::nozzleHeating() const { return _nozzleHeating; }
 
+void BambuMqttClient::snapshot(PrinterState& out) const {
+  portENTER_CRITICAL(&_snapshotMux);
+  out = _snapshot;
+  portEXIT_CRITICAL(&_snapshotMux);
+}
+
+void BambuMqttClient::publishSnapshot() {
+  // Build outside the critical section, only the copy is guarded.
+  PrinterState s;
+  s.connected = isConnected();
+  strncpy(s.gcodeState, _gcodeState.c_str(), sizeof(s.gcodeState) - 1);
+  s.printProgress = _printProgress;
+  s.downloadProgress = _downloadProgress;
+  s.remainingMin = _remainingMin;
+  s.bedTemp = _bedTemp;
+  s.bedTarget = _bedTarget;
+  s.bedValid = _bedValid;
+  s.nozzleTemp = _nozzleTemp;
+  s.nozzleTarget = _nozzleTarget;
+  s.nozzleValid = _nozzleValid;
+  s.nozzleHeating = _nozzleHeating;
+  s.hmsTop = (uint8_t)computeTopSeverity();
+  s.lastReportMs = _lastMsgMs;
+
+  if (_events) {
+    for (uint8_t i = 0; i < _eventsCap; i++) {
+      if (!_events[i].active) continue;
+      if (s.hmsCount < PrinterState::kMaxHms) {
+        s.hms[s.hmsCount].full = _events[i].full;
+        s.hms[s.hmsCount].severity = (uint8_t)_events[i].severity;
+      }
+      if (s.hmsCount < 255) s.hmsCount++;
+    }
+  }
+
+  portENTER_CRITICAL(&_snapshotMux);
+  _snapshot = s;
+  portEXIT_CRITICAL(&_snapshotMux);
+  _lastSnapshotMs = millis();
+}
+
+void BambuMqttClient::setQuiet(bool quiet) {
+  if (_quiet == quiet) return;
+  _quiet = quiet;
+  webSerial.printf("[MQTT] %s report stream\n", quiet ? "Pausing" : "Resuming");
+
+  if (!_mqtt.connected()) return;
+  if (quiet) {
+    if (_subscribed) _mqtt.unsubscribe(_topicReport.c_str());
+    _subscribed = false;
+  } else {
+    subscribeReportOnce();
+  }
+}
+
+void BambuMqttClient::setRelayFollower(bool follower) {
+  if (_relayFollower == follower) return;
+  _relayFollower = follower;
+  _relayConnected = false;
+  webSerial.printf("[MQTT] %s\n", follower ? "Relay follower, closing printer session" : "Relay leader or standalone, using printer session");
+  if (follower) {
+    if (_mqtt.connected()) _mqtt.disconnect();
+    _subscribed = false;
+  } else {
+    _lastKickMs = 0;  // connect on the next tick
+  }
+}
+
+void BambuMqttClient::applyRelayState(const PrinterState& s) {
+  if (!_relayFollower) return;
+  _relayConnected = s.connected;
+  _gcodeState = s.gcodeState;
+  _printProgress = s.printProgress;
+  _downloadProgress = s.downloadProgress;
+  _remainingMin = s.remainingMin;
+  _bedTemp = s.bedTemp;
+  _bedTarget = s.bedTarget;
+  _bedValid = s.bedValid;
+  _nozzleTemp = s.nozzleTemp;
+  _nozzleTarget = s.nozzleTarget;
+  _nozzleValid = s.nozzleValid;
+  _nozzleHeating = s.nozzleHeating;
+
+  // The leader's list is authoritative: events it no longer reports end here
+  const uint32_t now = millis();
+  _lastMsgMs = now;
+  const uint8_t n = s.hmsCount < PrinterState::kMaxHms ? s.hmsCount : PrinterState::kMaxHms;
+  if (_events) {
+    for (uint8_t i = 0; i < _eventsCap; i++) {
+      if (!_events[i].active) continue;
+      bool listed = false;
+      for (uint8_t j = 0; j < n && !listed; j++) listed = (s.hms[j].full == _events[i].full);
+      if (!listed) _events[i].active = false;
+    }
+  }
+  for (uint8_t j = 0; j < n; j++) {
+    upsertEvent((uint32_t)(s.hms[j].full >> 32), (uint32_t)s.hms[j].full, now);
+  }
+
+  logStatusIfNeeded(now);
+  publishSnapshot();
+}
+
 void BambuMqttClient::subscribeReportOnce() {
-  if (_subscribed) return;
+  if (_subscribed || _quiet) return;
 
   webSerial.printf("[MQTT] Subscribing to %s\n", _topicReport.c_str());
   _mqtt.subscribe(_topicReport.c_str(), 0);
@@ -240,10 +359,20 @@ void BambuMqttClient::handleMqttMessage(char* topic, uint8_t* payload, unsigned
   if (!topic || !payload || length == 0) return;
   if (_topicReport.isEmpty()) return;
   if (strcmp(topic, _topicReport.c_str()) != 0) return;
+  if (_quiet) return; // still in flight from before the unsubscribe
 
   _lastMsgLen = length;
   _lastMsgMs = millis();
 
+#ifdef BAMBU_MQTT_VERBOSE
+  // Log stress test: every report, with a payload excerpt written piecewise
+  webSerial.printf("[MQTT] RX %u bytes: ", (unsigned)length);
+  for (unsigned int i = 0; i < length && i < 160; i++) webSerial.write(payload[i]);
+  webSerial.println();
+#endif
+
+  TRACE_SCOPE(MqttParse, (uint16_t)min(length, 65535u));
+  if (_rawReportCb) _rawReportCb(payload, length);
   handleReportJson(payload, length);
 }
 
@@ -258,6 +387,9 @@ void BambuMqttClient::handleReportJson(const uint8_t* payload, size_t length) {
     filter["print"]["percent"] = true;
     filter["percent"] = true;
 
+    filter["print"]["mc_remaining_time"] = true;
+    filter["mc_remaining_time"] = true;
+
     filter["print"]["download_progress"] = true;
     filter["print"]["download_percent"] = true;
     filter["print"]["dl_percent"] = true;
@@ -328,6 +460,12 @@ void BambuMqttClient::handleReportJson(const uint8_t* payload, size_t length) {
     if (p >= 0 && p <= 100) _printProgress = (uint8_t)p;
   }
 
+  int rem = -1;
+  if (readInt(doc["print"]["mc_remaining_time"], rem) ||
+      readInt(doc["mc_remaining_time"], rem)) {
+    if (rem >= 0 && rem < 0xFFFF) _remainingMin = (uint16_t)rem;
+  }
+
   int dl = -1;
   if (readInt(doc["print"]["download_progress"], dl) ||
       readInt(doc["print"]["download_percent"], dl) ||
@@ -398,6 +536,7 @@ void BambuMqttClient::handleReportJson(const uint8_t* payload, size_t length) {
   parseHmsFromDoc(doc);
 
   logStatusIfNeeded(millis());
+  publishSnapshot();
 
   if (_reportCb) _reportCb(doc);
 }
@@ -476,7 +615,7 @@ void BambuMqttClient::upsertEvent(uint32_t attr, uint32_t code, uint32_t nowMs)
       if (!wasActive) {
         char codeStr[24];
         formatHmsCodeStr(full, codeStr);
-        webSerial.printf("[HMS] %s sev=%s\n", codeStr, severityToStr(severityFromCode(code)));
+        LOGW("[HMS] %s sev=%s\n", codeStr, severityToStr(severityFromCode(code)));
       }
       return;
     }
@@ -513,7 +652,7 @@ void BambuMqttClient::upsertEvent(uint32_t attr, uint32_t code, uint32_t nowMs)
   e.lastSeenMs = nowMs;
   e.count = 1;
   e.active = true;
-  webSerial.printf("[HMS] %s sev=%s\n", e.codeStr, severityToStr(e.severity));
+  LOGW("[HMS] %s sev=%s\n", e.codeStr, severityToStr(e.severity));
 }
 
 void BambuMqttClient::expireEvents(uint32_t nowMs) {
@@ -594,13 +733,13 @@ void BambuMqttClient::logStatusIfNeeded(uint32_t nowMs) {
 
   const char* state = _gcodeState.length() ? _gcodeState.c_str() : "?";
   if (_bedValid) {
-    webSerial.printf("[MQTT] State=%s Print=%u%% DL=%u%% Bed=%.1f/%.1f HMS=%u Top=%s\n",
-                     state, _printProgress, _downloadProgress,
-                     _bedTemp, _bedTarget, (unsigned)hmsCount, severityToStr(top));
+    LOGI("[MQTT] State=%s Print=%u%% DL=%u%% Bed=%.1f/%.1f HMS=%u Top=%s\n",
+         state, _printProgress, _downloadProgress,
+         _bedTemp, _bedTarget, (unsigned)hmsCount, severityToStr(top));
   } else {
-    webSerial.printf("[MQTT] State=%s Print=%u%% DL=%u%% Bed=n/a HMS=%u Top=%s\n",
-                     state, _printProgress, _downloadProgress,
-                     (unsigned)hmsCount, severityToStr(top));
+    LOGI("[MQTT] State=%s Print=%u%% DL=%u%% Bed=n/a HMS=%u Top=%s\n",
+         state, _printProgress, _downloadProgress,
+         (unsigned)hmsCount, severityToStr(top));
   }
 
   _lastStatusLogMs = nowMs;
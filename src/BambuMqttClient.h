@@ -1,13 +1,13 @@
 #pragma once
 
 #include <Arduino.h>
-#include <WiFi.h>
 #include <ArduinoJson.h>
 #include <WebSerial.h>
-#include <WiFiClientSecure.h>
 #include <PubSubClient.h>
 
 #include "SettingsPrefs.h"  // provides Settings + settings.get.printerIP/printerUSN/printerAC
+#include "PrinterState.h"
+#include "Hal.h"
 
 class BambuMqttClient {
 public:
@@ -34,8 +34,9 @@ public:
   };
 
   using ReportCallback = std::function<void(const JsonDocument& doc)>;
+  using RawReportCallback = std::function<void(const uint8_t* payload, size_t length)>;
 
-  BambuMqttClient();
+  explicit BambuMqttClient(hal::Wifi& wifi = hal::wifi());
   ~BambuMqttClient();
 
   // Uses settings.get.printerIP(), settings.get.printerUSN(), settings.get.printerAC()
@@ -49,8 +50,22 @@ public:
 
   bool isConnected();
 
+  // Quiet: drop the report subscription but keep the session alive (pings only).
+  // Leaving quiet resubscribes; the printer's next push refreshes the state.
+  void setQuiet(bool quiet);
+  bool quiet() const { return _quiet; }
+
+  // Relay follower (BeaconLink): no printer session, the state comes from the
+  // elected beacon through applyRelayState(). isConnected() then reports the
+  // leader's printer session.
+  void setRelayFollower(bool follower);
+  bool relayFollower() const { return _relayFollower; }
+  void applyRelayState(const PrinterState& s);
+
   bool publishRequest(const JsonDocument& doc, bool retain = false);
   void onReport(ReportCallback cb);
+  // Unparsed report payload, before filtering (loop task)
+  void onRawReport(RawReportCallback cb);
   void handleMqttMessage(char* topic, uint8_t* payload, unsigned int length);
 
   // HMS / status
@@ -59,6 +74,7 @@ public:
   uint16_t countActive(Severity sev) const;
   uint16_t countActiveTotal() const;
   size_t getActiveEvents(HmsEvent* out, size_t maxOut) const;
+  static void formatHmsCodeStr(uint64_t full, char out[24]);
 
   const String& gcodeState() const;
   uint8_t printProgress() const;
@@ -71,6 +87,9 @@ public:
   bool nozzleValid() const;
   bool nozzleHeating() const;
 
+  // Thread-safe copy of the current state (for readers outside the loop task)
+  void snapshot(PrinterState& out) const;
+
   const String& topicReport() const;
   const String& topicRequest() const;
 
@@ -84,13 +103,13 @@ private:
   void subscribeReportOnce();
   void handleReportJson(const uint8_t* payload, size_t length);
   void logStatusIfNeeded(uint32_t nowMs);
+  void publishSnapshot();
 
   void parseHmsFromDoc(JsonDocument& doc);
   JsonArray findHmsArray(JsonDocument& doc);
   bool isIgnored(const char* codeStr) const;
 
   static Severity severityFromCode(uint32_t code);
-  static void formatHmsCodeStr(uint64_t full, char out[24]);
 
   void upsertEvent(uint32_t attr, uint32_t code, uint32_t nowMs);
   void expireEvents(uint32_t nowMs);
@@ -99,9 +118,13 @@ private:
 private:
   Settings *_settings = nullptr;
 
-  WiFiClientSecure _net;
+  hal::Wifi& _wifi;
+  hal::TlsClient _net;
   PubSubClient _mqtt;
   bool _subscribed = false;
+  bool _quiet = false;
+  bool _relayFollower = false;
+  bool _relayConnected = false;
   uint32_t _lastKickMs = 0;
 
   // Derived config (always from settings)
@@ -126,6 +149,7 @@ private:
 
   String _gcodeState;
   uint8_t _printProgress = 255;    // 0-100, 255 = unknown
+  uint16_t _remainingMin = 0xFFFF; // mc_remaining_time, 0xFFFF = unknown
   uint8_t _downloadProgress = 255; // 0-100, 255 = unknown
   float _bedTemp = 0.0f;
   float _bedTarget = 0.0f;
@@ -152,4 +176,9 @@ private:
   uint32_t _lastReportLogMs = 0;
 
   ReportCallback _reportCb;
+  RawReportCallback _rawReportCb;
+
+  PrinterState _snapshot;
+  mutable portMUX_TYPE _snapshotMux = portMUX_INITIALIZER_UNLOCKED;
+  uint32_t _lastSnapshotMs = 0;
 };
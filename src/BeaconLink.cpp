@@ -0,0 +1,182 @@
+#include "BeaconLink.h"
+
+#include "SettingsPrefs.h"
+#include "BambuMqttClient.h"
+#include "WebSerial.h"
+
+extern Settings settings;
+extern BambuMqttClient bambu;
+
+static_assert(relay::kMaxHms == PrinterState::kMaxHms, "relay HMS slots must match PrinterState");
+
+namespace {
+int16_t deci(float t) {
+  const long v = lroundf(t * 10.0f);
+  return (int16_t)(v < -32768 ? -32768 : (v > 32767 ? 32767 : v));
+}
+}
+
+void BeaconLink::toWire(const PrinterState& ps, relay::Wire& w) {
+  w = relay::Wire();
+  if (ps.connected) w.flags |= relay::kStConnected;
+  if (ps.bedValid) w.flags |= relay::kStBedValid;
+  if (ps.nozzleValid) w.flags |= relay::kStNozzleValid;
+  if (ps.nozzleHeating) w.flags |= relay::kStNozzleHeating;
+  strlcpy(w.state, ps.gcodeState, sizeof(w.state));
+  w.progress = ps.printProgress;
+  w.download = ps.downloadProgress;
+  w.remaining = ps.remainingMin;
+  w.bed = deci(ps.bedTemp);
+  w.bedTarget = deci(ps.bedTarget);
+  w.nozzle = deci(ps.nozzleTemp);
+  w.nozzleTarget = deci(ps.nozzleTarget);
+  w.hmsTop = ps.hmsTop;
+  w.hmsCount = ps.hmsCount;
+  w.hmsN = ps.hmsCount < PrinterState::kMaxHms ? ps.hmsCount : PrinterState::kMaxHms;
+  for (uint8_t i = 0; i < w.hmsN; i++) {
+    w.hmsFull[i] = ps.hms[i].full;
+    w.hmsSev[i] = ps.hms[i].severity;
+  }
+}
+
+void BeaconLink::fromWire(const relay::Wire& w, PrinterState& ps) {
+  ps = PrinterState();
+  ps.connected = w.flags & relay::kStConnected;
+  ps.bedValid = w.flags & relay::kStBedValid;
+  ps.nozzleValid = w.flags & relay::kStNozzleValid;
+  ps.nozzleHeating = w.flags & relay::kStNozzleHeating;
+  strlcpy(ps.gcodeState, w.state, sizeof(ps.gcodeState));
+  ps.printProgress = w.progress;
+  ps.downloadProgress = w.download;
+  ps.remainingMin = w.remaining;
+  ps.bedTemp = w.bed / 10.0f;
+  ps.bedTarget = w.bedTarget / 10.0f;
+  ps.nozzleTemp = w.nozzle / 10.0f;
+  ps.nozzleTarget = w.nozzleTarget / 10.0f;
+  ps.hmsTop = w.hmsTop;
+  ps.hmsCount = w.hmsCount;
+  for (uint8_t i = 0; i < w.hmsN && i < PrinterState::kMaxHms; i++) {
+    ps.hms[i].full = w.hmsFull[i];
+    ps.hms[i].severity = w.hmsSev[i];
+  }
+}
+
+void BeaconLink::begin() {
+  // MAC bytes 2..5, unique per device
+  _nodeId = (uint32_t)(ESP.getEfuseMac() >> 16);
+  if (!_nodeId) _nodeId = 1;
+  _node.setSender([this](const uint8_t* data, size_t len) {
+    if (!_listening) return;
+    _udp.beginMulticastPacket();
+    _udp.write(data, len);
+    _udp.endPacket();
+  });
+  configure();
+}
+
+void BeaconLink::configure() {
+  const char* usn = settings.get.printerUSN();
+  const char* ac = settings.get.printerAC();
+  const bool enabled = settings.get.relayEnabled() && usn && usn[0] && ac && ac[0];
+
+  _node.configure(_nodeId, usn, ac, millis());
+  _appliedVersion = 0;
+  _appliedFresh = false;
+  _role = relay::Role::Listening;
+
+  if (enabled != _enabled) {
+    webSerial.printf("[RELAY] %s (node %08lx)\n", enabled ? "Enabled" : "Disabled", (unsigned long)_nodeId);
+  }
+  _enabled = enabled;
+  portENTER_CRITICAL(&_statsMux);
+  _stats.enabled = enabled;
+  portEXIT_CRITICAL(&_statsMux);
+  if (_enabled) {
+    // Listen first: an existing leader keeps its session
+    bambu.setRelayFollower(true);
+  } else {
+    bambu.setRelayFollower(false);
+    if (_listening) _udp.stop();
+    _listening = false;
+  }
+}
+
+void BeaconLink::setRole(relay::Role role) {
+  if (role == _role) return;
+  webSerial.printf("[RELAY] %s -> %s\n", relay::roleName(_role), relay::roleName(role));
+  _role = role;
+  bambu.setRelayFollower(role != relay::Role::Leader);
+}
+
+void BeaconLink::loop() {
+  if (_reload.exchange(false)) configure();
+  if (!_enabled) return;
+
+  if (!_wifi.connected()) {
+    if (_listening) {
+      _udp.stop();
+      _listening = false;
+      if (_role != relay::Role::Leader && _appliedFresh) {
+        PrinterState ps;
+        bambu.snapshot(ps);
+        ps.connected = false;
+        bambu.applyRelayState(ps);
+        _appliedFresh = false;
+      }
+    }
+    return;
+  }
+  if (!_listening) {
+    _listening = _udp.beginMulticast(IPAddress(relay::kGroupAddr[0], relay::kGroupAddr[1],
+                                               relay::kGroupAddr[2], relay::kGroupAddr[3]), relay::kPort);
+    if (!_listening) return;
+  }
+
+  const uint32_t now = millis();
+  uint8_t buf[relay::kMaxPacket];
+  for (uint8_t i = 0; i < 8; i++) {
+    const int n = _udp.parsePacket();
+    if (n <= 0) break;
+    if ((size_t)n > sizeof(buf)) {
+      _udp.flush();
+      continue;
+    }
+    _udp.read(buf, n);
+    _node.onPacket(buf, (size_t)n, now);
+  }
+
+  PrinterState ps;
+  bambu.snapshot(ps);
+  relay::Wire local;
+  toWire(ps, local);
+  const bool leader = _role == relay::Role::Leader;
+  _node.tick(now, leader && bambu.isConnected(), local);
+  setRole(_node.role());
+
+  if (_role != relay::Role::Leader && _node.haveState()) {
+    const bool fresh = _node.leaderFresh(now);
+    if (_node.stateVersion() != _appliedVersion || fresh != _appliedFresh) {
+      PrinterState rs;
+      fromWire(_node.state(), rs);
+      rs.connected = rs.connected && fresh;
+      bambu.applyRelayState(rs);
+      _appliedVersion = _node.stateVersion();
+      _appliedFresh = fresh;
+    }
+  }
+
+  portENTER_CRITICAL(&_statsMux);
+  _stats.enabled = _enabled;
+  _stats.role = (uint8_t)_role;
+  _stats.leader = _node.leader();
+  _stats.node = _nodeId;
+  _stats.proto = _node.stats();
+  portEXIT_CRITICAL(&_statsMux);
+}
+
+BeaconLink::Stats BeaconLink::stats() const {
+  portENTER_CRITICAL(&_statsMux);
+  Stats s = _stats;
+  portEXIT_CRITICAL(&_statsMux);
+  return s;
+}
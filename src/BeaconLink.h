@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "Hal.h"
+#include "PrinterState.h"
+#include "RelayProto.h"
+
+// Relay mode (setting relay/relayEnabled): beacons watching the same printer
+// elect one leader that keeps the printer MQTT session and multicasts the
+// parsed state; followers put BambuMqttClient into relay-follower mode and
+// skip MQTT entirely. Protocol and election: RelayProto.h.
+class BeaconLink {
+public:
+  explicit BeaconLink(hal::Wifi& wifi = hal::wifi()) : _wifi(wifi) {}
+
+  struct Stats {
+    bool     enabled = false;
+    uint8_t  role = 0;        // relay::Role
+    uint32_t leader = 0;      // node id of the current leader, 0 = none
+    uint32_t node = 0;
+    relay::Node::Stats proto;
+  };
+
+  void begin();
+  // Loop task, before bambu.loopTick()
+  void loop();
+  // Any task: printer settings changed (USN/access code/relay switch)
+  void reload() { _reload = true; }
+
+  Stats stats() const;
+
+  static void toWire(const PrinterState& ps, relay::Wire& w);
+  static void fromWire(const relay::Wire& w, PrinterState& ps);
+
+private:
+  void configure();
+  void setRole(relay::Role role);
+
+  bool       _enabled = false;
+  uint32_t   _nodeId = 0;
+  relay::Node _node;
+  hal::Wifi& _wifi;
+  hal::Udp   _udp;
+  bool       _listening = false;
+  relay::Role _role = relay::Role::Listening;
+  uint32_t   _appliedVersion = 0;
+  bool       _appliedFresh = false;
+  std::atomic<bool> _reload{false};
+
+  // Copied for stats() (read from AsyncTCP)
+  mutable portMUX_TYPE _statsMux = portMUX_INITIALIZER_UNLOCKED;
+  Stats _stats;
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+// Shared animation clock for beacons on one LAN: wire format and estimator,
+// free of Arduino dependencies so the same code runs on the beacon (AnimSync)
+// and in the host simulation (tools/clock_sync_sim.cpp).
+//
+// Every node multicasts its shared clock once a second. The reference is the
+// node whose clock is furthest ahead ("oldest lineage"), ties within
+// kLineageTolUs going to the lowest node id, so a freshly booted beacon
+// joins the farm's clock instead of resetting it. The reference never adjusts.
+// Everyone else estimates offset and drift from the reference's packets:
+//   sample s = T_ref - t_rx = offset - delay,  delay >= 0
+// so the least delayed sample is the best one. The estimate is the upper
+// envelope of the last kSamples samples, each carried forward along the
+// drift (slope of that envelope over the last few minutes). This filters
+// Wi-Fi multicast delay, mostly waiting for the next DTIM beacon (0..100+ ms).
+// The applied offset slews at most kMaxSlewPpm, so animations never run
+// backwards; only a clock that is more than kStepUs behind steps at once.
+// A node takes over as reference only with a full sample window, and a switch
+// within the same lineage keeps the samples, so a failover does not restart
+// the estimate from a single delayed packet.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace clocksync {
+
+static const uint32_t kMagic = 0x31434242UL;  // "BBC1"
+static const uint16_t kPort = 47312;
+static const uint8_t  kGroupAddr[4] = { 239, 255, 47, 12 };
+
+static const int64_t  kIntervalUs = 1000000;
+static const int64_t  kPeerTimeoutUs = 5 * kIntervalUs;
+static const int64_t  kLineageTolUs = 10 * 1000000LL;
+static const int64_t  kStepUs = 200000;
+static const int64_t  kBackStepUs = 2000000;  // behind: step; ahead: slew unless this far
+static const int64_t  kMaxSlewPpm = 50000;  // 5 %
+static const int32_t  kMaxDriftPpm = 200;
+static const size_t   kSamples = 64;
+static const size_t   kMaxPeers = 16;
+static const size_t   kPacketLen = 24;
+
+class Core {
+public:
+  struct Stats {
+    uint32_t reference = 0;    // node id, == own id when we are the reference
+    uint8_t  peers = 0;
+    uint8_t  samples = 0;
+    int64_t  offsetUs = 0;     // applied: shared = local + offset
+    int64_t  errorUs = 0;      // estimate - applied (still to slew)
+    int32_t  driftPpb = 0;     // reference vs local crystal
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    uint32_t rejected = 0;
+    uint32_t steps = 0;
+    uint32_t referenceChanges = 0;
+  };
+
+  void configure(uint32_t node) {
+    *this = Core();
+    _node = node;
+    _stats.reference = node;
+  }
+
+  int64_t shared(int64_t localUs) const { return localUs + _offset; }
+
+  // Packet to send if one is due (returns its length), else 0
+  size_t poll(int64_t localUs, uint8_t* out) {
+    if (_lastSentUs && localUs - _lastSentUs < kIntervalUs) return 0;
+    _lastSentUs = localUs;
+    put32(out, kMagic);
+    put32(out + 4, _node);
+    put32(out + 8, _stats.reference);
+    put64(out + 12, (uint64_t)shared(localUs));
+    put32(out + 20, 0);
+    _stats.sent++;
+    return kPacketLen;
+  }
+
+  void onPacket(const uint8_t* p, size_t len, int64_t localRxUs) {
+    if (len != kPacketLen || get32(p) != kMagic) {
+      _stats.rejected++;
+      return;
+    }
+    const uint32_t node = get32(p + 4);
+    if (node == _node || node == 0) return;
+    _stats.received++;
+    const int64_t t = (int64_t)get64(p + 12);
+
+    Peer* peer = findPeer(node, localRxUs);
+    if (!peer) return;
+    peer->lastRxUs = localRxUs;
+    peer->sharedUs = t;
+
+    if (node != _stats.reference) return;
+    const int64_t s = t - localRxUs;
+    if (_checkLineage) {
+      // New reference: keep the window if it runs the same clock as the old one
+      _checkLineage = false;
+      if (_n && (s > envelope(localRxUs) + kStepUs || s < envelope(localRxUs) - kStepUs)) resetSamples();
+    }
+    addSample(localRxUs, s);
+  }
+
+  // Loop: reference selection and slewing, as often as convenient
+  void update(int64_t localUs) {
+    selectReference(localUs);
+
+    int64_t target = _offset;
+    if (_stats.reference != _node && _n) target = estimate(localUs);
+    const int64_t err = target - _offset;
+    _stats.errorUs = err;
+
+    const int64_t dt = _lastUpdateUs ? localUs - _lastUpdateUs : 0;
+    _lastUpdateUs = localUs;
+    if (err > kStepUs || err < -kBackStepUs) {
+      _offset = target;
+      _stats.steps++;
+    } else {
+      const int64_t maxSlew = dt * kMaxSlewPpm / 1000000;
+      _offset += err > maxSlew ? maxSlew : (err < -maxSlew ? -maxSlew : err);
+    }
+    _stats.offsetUs = _offset;
+  }
+
+  const Stats& stats() const { return _stats; }
+
+private:
+  struct Peer {
+    uint32_t node = 0;
+    int64_t  lastRxUs = 0;
+    int64_t  sharedUs = 0;
+  };
+
+  static void put32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i)); }
+  static void put64(uint8_t* p, uint64_t v) { for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i)); }
+  static uint32_t get32(const uint8_t* p) { uint32_t v = 0; for (int i = 3; i >= 0; i--) v = (v << 8) | p[i]; return v; }
+  static uint64_t get64(const uint8_t* p) { uint64_t v = 0; for (int i = 7; i >= 0; i--) v = (v << 8) | p[i]; return v; }
+
+  Peer* findPeer(uint32_t node, int64_t now) {
+    Peer* free = nullptr;
+    for (Peer& p : _peers) {
+      if (p.node == node) return &p;
+      if (!free && (p.node == 0 || now - p.lastRxUs > kPeerTimeoutUs)) free = &p;
+    }
+    if (free) {
+      *free = Peer();
+      free->node = node;
+    }
+    return free;
+  }
+
+  void selectReference(int64_t now) {
+    // Project everyone's clock to now; our own is exact. We compete only while
+    // we are the reference or once our estimate is settled.
+    const bool selfEligible = _stats.reference == _node || _n == kSamples;
+    uint32_t best = selfEligible ? _node : 0;
+    int64_t bestT = shared(now);
+    uint8_t alive = 0;
+    for (const Peer& p : _peers) {
+      if (!p.node || now - p.lastRxUs > kPeerTimeoutUs) continue;
+      alive++;
+      const int64_t t = p.sharedUs + (now - p.lastRxUs);
+      if (!best || t > bestT + kLineageTolUs || (t >= bestT - kLineageTolUs && p.node < best)) {
+        best = p.node;
+        bestT = t;
+      }
+    }
+    if (!best) best = _node;
+    _stats.peers = alive;
+    if (best != _stats.reference) {
+      _stats.reference = best;
+      _stats.referenceChanges++;
+      _checkLineage = true;
+    }
+  }
+
+  void resetSamples() {
+    _n = 0;
+    _head = 0;
+    _added = 0;
+    _anchors = 0;
+    _anchorHead = 0;
+    _drift = 0.0;
+    _stats.samples = 0;
+    _stats.driftPpb = 0;
+  }
+
+  void addSample(int64_t t, int64_t s) {
+    _t[_head] = t;
+    _s[_head] = s;
+    _head = (_head + 1) % kSamples;
+    if (_n < kSamples) _n++;
+    _stats.samples = (uint8_t)_n;
+
+    // Drift: slope of the envelope over minutes, one anchor per full window.
+    // Within one window the delay jitter is far larger than crystal drift.
+    if (++_added % kSamples == 0) {
+      _anchorT[_anchorHead] = t;
+      _anchorO[_anchorHead] = envelope(t);
+      _anchorHead = (_anchorHead + 1) % kAnchors;
+      if (_anchors < kAnchors) _anchors++;
+      if (_anchors >= 3) {
+        // Least squares over the anchors
+        const int64_t t0 = _anchorT[(_anchorHead + kAnchors - 1) % kAnchors];
+        const int64_t o0 = _anchorO[(_anchorHead + kAnchors - 1) % kAnchors];
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (size_t i = 0; i < _anchors; i++) {
+          const double x = (double)(_anchorT[i] - t0), y = (double)(_anchorO[i] - o0);
+          sx += x; sy += y; sxx += x * x; sxy += x * y;
+        }
+        const double den = _anchors * sxx - sx * sx;
+        const double d = den > 0 ? (_anchors * sxy - sx * sy) / den : 0.0;
+        const double lim = kMaxDriftPpm / 1e6;
+        _drift = d > lim ? lim : (d < -lim ? -lim : d);
+        _stats.driftPpb = (int32_t)(_drift * 1e9);
+      }
+    }
+  }
+
+  // Upper envelope of the samples, carried forward to now along the drift
+  int64_t envelope(int64_t now) const {
+    int64_t best = INT64_MIN;
+    for (size_t i = 0; i < _n; i++) {
+      const int64_t v = _s[i] + (int64_t)(_drift * (double)(now - _t[i]));
+      if (v > best) best = v;
+    }
+    return best;
+  }
+
+  int64_t estimate(int64_t now) const { return envelope(now); }
+
+  uint32_t _node = 0;
+  int64_t  _offset = 0;
+  int64_t  _lastSentUs = 0;
+  int64_t  _lastUpdateUs = 0;
+  Peer     _peers[kMaxPeers];
+
+  int64_t  _t[kSamples] = {0};
+  int64_t  _s[kSamples] = {0};
+  size_t   _head = 0;
+  size_t   _n = 0;
+  uint32_t _added = 0;
+  bool     _checkLineage = false;
+
+  static const size_t kAnchors = 8;
+  int64_t  _anchorT[kAnchors] = {0};
+  int64_t  _anchorO[kAnchors] = {0};
+  size_t   _anchorHead = 0;
+  size_t   _anchors = 0;
+  double   _drift = 0.0;
+
+  Stats _stats;
+};
+
+}  // namespace clocksync
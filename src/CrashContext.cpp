@@ -0,0 +1,416 @@
+#include "CrashContext.h"
+
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <LittleFS.h>
+#include <esp_core_dump.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+#include <memory>
+#include <new>
+#include "LoopStats.h"
+#include "Trace.h"
+#include "WebSerial.h"
+
+#if __has_include(<esp_idf_version.h>)
+#include <esp_idf_version.h>
+#endif
+#if defined(ESP_IDF_VERSION_MAJOR) && ESP_IDF_VERSION_MAJOR >= 5
+#include <esp_app_desc.h>
+#endif
+
+// Panic hook: Arduino-ESP32 3.x has one; on 2.x the build wraps
+// esp_panic_handler (-Wl,--wrap=esp_panic_handler in platformio.ini). Both
+// run before the core dump is written.
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+#define CRASH_PANIC_HOOK_ARDUINO 1
+#elif defined(ARDUINO_ARCH_ESP32) && __has_include(<esp_private/panic_internal.h>)
+#include <esp_private/panic_internal.h>
+#define CRASH_PANIC_HOOK_WRAP 1
+#endif
+
+extern LoopStats loopStats;
+
+// Single definition of the global instance
+CrashContext crashContext;
+
+namespace {
+
+const char* const kContextPath = "/crash.json";
+const char kContainerMagic[8] = { 'B', 'B', 'C', 'O', 'R', 'E', '1', '\0' };
+
+const uint32_t kMagic = 0xBBC0DE01;
+const uint32_t kPanicMagic = 0x9A41C000;
+const size_t kLogBytes = 1024;
+const uint8_t kTraceEvents = 24;
+const uint8_t kTraceTasks = 6;
+const uint8_t kBacktrace = 16;
+
+// Survives panics and watchdog resets; garbage after power-on until reset
+struct Live {
+  uint32_t magic;
+  uint32_t size;              // sizeof(Live): a layout change invalidates it
+  uint32_t loopStartUs;
+  uint32_t loopStartMs;
+  uint32_t loopCount;
+  uint32_t logBytes;          // appended since boot; the ring is full from kLogBytes
+  uint16_t logHead;           // next write position
+
+  // Valid when panicked == kPanicMagic
+  uint32_t panicked;
+  uint32_t panicUs;
+  uint32_t panicMs;
+  uint32_t pc;
+  int32_t core;
+  char reason[64];
+  uint32_t backtrace[kBacktrace];
+  uint8_t depth;
+  uint8_t traceCount;
+  uint8_t taskCount;
+  uint32_t loopMaxUs;
+  uint32_t loopP50Us;
+  uint32_t loopP99Us;
+  Tracer::Record trace[kTraceEvents];
+  void* taskHandles[kTraceTasks];   // keys for trace[].task, stale after reset
+  char taskNames[kTraceTasks][12];
+
+  char log[kLogBytes];
+};
+
+RTC_NOINIT_ATTR Live g_live;
+// Log ring writers; the panic handler reads without it (it may have
+// interrupted the holder)
+portMUX_TYPE g_logMux = portMUX_INITIALIZER_UNLOCKED;
+
+bool liveValid() {
+  return g_live.magic == kMagic && g_live.size == sizeof(Live) && g_live.logHead < kLogBytes &&
+         g_live.depth <= kBacktrace && g_live.traceCount <= kTraceEvents && g_live.taskCount <= kTraceTasks;
+}
+
+void resetLive() {
+  memset(&g_live, 0, sizeof(g_live));
+  g_live.magic = kMagic;
+  g_live.size = sizeof(Live);
+}
+
+bool isCrash(esp_reset_reason_t r) {
+  return r == ESP_RST_PANIC || r == ESP_RST_INT_WDT || r == ESP_RST_TASK_WDT || r == ESP_RST_WDT ||
+         r == ESP_RST_BROWNOUT;
+}
+
+const char* resetName(int r) {
+  switch (r) {
+    case ESP_RST_POWERON:  return "poweron";
+    case ESP_RST_EXT:      return "external";
+    case ESP_RST_SW:       return "software";
+    case ESP_RST_PANIC:    return "panic";
+    case ESP_RST_INT_WDT:  return "int_wdt";
+    case ESP_RST_TASK_WDT: return "task_wdt";
+    case ESP_RST_WDT:      return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    default:               return "unknown";
+  }
+}
+
+void hex32(char* out, size_t cap, uint32_t v) { snprintf(out, cap, "0x%08lx", (unsigned long)v); }
+
+const esp_app_desc_t* appDesc() {
+#if defined(ESP_IDF_VERSION_MAJOR) && ESP_IDF_VERSION_MAJOR >= 5
+  return esp_app_get_description();
+#else
+  return esp_ota_get_app_description();
+#endif
+}
+
+bool dumpImage(size_t& addr, size_t& size) {
+#if CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH
+  return esp_core_dump_image_get(&addr, &size) == ESP_OK && size > 0;
+#else
+  (void)addr;
+  (void)size;
+  return false;
+#endif
+}
+
+#if CRASH_PANIC_HOOK_ARDUINO
+void arduinoPanic(arduino_panic_info_t* info, void* arg) {
+  (void)arg;
+  const uint8_t depth = (uint8_t)min(info->backtrace_len, (unsigned int)kBacktrace);
+  crashContext.onPanic(info->reason, (uint32_t)info->pc, info->core, (const uint32_t*)info->backtrace, depth);
+}
+#endif
+
+}  // namespace
+
+#if CRASH_PANIC_HOOK_WRAP
+extern "C" void __real_esp_panic_handler(panic_info_t* info);
+
+extern "C" void __wrap_esp_panic_handler(panic_info_t* info) {
+  crashContext.onPanic(info->reason, (uint32_t)info->addr, info->core, nullptr, 0);
+  __real_esp_panic_handler(info);
+}
+#endif
+
+void CrashContext::begin() {
+  _resetReason = (int)esp_reset_reason();
+  if (isCrash((esp_reset_reason_t)_resetReason)) saveContext(_resetReason);
+  resetLive();
+#if CRASH_PANIC_HOOK_ARDUINO
+  set_arduino_panic_handler(&arduinoPanic, nullptr);
+#endif
+
+  const Info i = info();
+  if (i.dump || i.context) {
+    webSerial.printf("[CRASH] reset reason %s, core dump %u bytes%s\n", resetName(_resetReason),
+                     (unsigned)i.dumpBytes, i.context ? ", context saved" : "");
+  }
+}
+
+void CrashContext::loopBegin(uint32_t startUs) {
+  g_live.loopStartUs = startUs;
+  g_live.loopStartMs = millis();
+  g_live.loopCount++;
+}
+
+// Keeps the newest kLogBytes; a line cut by the wrap is dropped when saved
+void CrashContext::appendLog(const uint8_t* data, size_t len) {
+  const uint32_t total = (uint32_t)len;
+  if (len > kLogBytes) {
+    data += len - kLogBytes;
+    len = kLogBytes;
+  }
+  // At most 1 KB of memcpy inside the critical section
+  portENTER_CRITICAL(&g_logMux);
+  g_live.logBytes += total;
+  while (len) {
+    const size_t n = min(len, kLogBytes - g_live.logHead);
+    memcpy(g_live.log + g_live.logHead, data, n);
+    g_live.logHead = (uint16_t)((g_live.logHead + n) % kLogBytes);
+    data += n;
+    len -= n;
+  }
+  portEXIT_CRITICAL(&g_logMux);
+}
+
+void CrashContext::onPanic(const char* reason, uint32_t pc, int core, const uint32_t* backtrace, uint8_t depth) {
+  Live& l = g_live;
+  if (l.magic != kMagic || l.size != sizeof(Live)) resetLive();
+  l.panicUs = micros();
+  l.panicMs = millis();
+  l.pc = pc;
+  l.core = core;
+  strlcpy(l.reason, reason ? reason : "", sizeof(l.reason));
+  l.depth = backtrace ? min(depth, kBacktrace) : 0;
+  if (l.depth) memcpy(l.backtrace, backtrace, l.depth * sizeof(uint32_t));
+
+  // Loop latency state: written by the loop task only, read as it stands
+  l.loopMaxUs = loopStats.maxUs;
+  l.loopP50Us = LoopStats::percentileUs(loopStats.hist, 0.50f);
+  l.loopP99Us = LoopStats::percentileUs(loopStats.hist, 0.99f);
+
+  l.traceCount = (uint8_t)tracer.newest(l.trace, kTraceEvents);
+  l.taskCount = 0;
+  for (uint8_t i = 0; i < l.traceCount; i++) {
+    void* task = l.trace[i].task;
+    uint8_t t = 0;
+    while (t < l.taskCount && l.taskHandles[t] != task) t++;
+    if (t == l.taskCount && t < kTraceTasks && task) {
+      l.taskHandles[t] = task;
+      strlcpy(l.taskNames[t], pcTaskGetName((TaskHandle_t)task), sizeof(l.taskNames[t]));
+      l.taskCount++;
+    }
+  }
+  l.panicked = kPanicMagic;
+}
+
+void CrashContext::saveContext(int resetReason) {
+  JsonDocument doc;
+  doc["resetReason"] = resetName(resetReason);
+  doc["fw"] = STRVERSION;
+  doc["hw"] = FW_HW;
+  char sha[65];
+  const esp_app_desc_t* desc = appDesc();
+  for (uint8_t i = 0; i < 32; i++) snprintf(sha + i * 2, 3, "%02x", desc->app_elf_sha256[i]);
+  doc["elfSha256"] = sha;
+
+  if (liveValid()) {
+    const Live& l = g_live;
+    const bool panicked = l.panicked == kPanicMagic;
+    char hex[11];
+
+    JsonObject loopObj = doc["loop"].to<JsonObject>();
+    loopObj["count"] = l.loopCount;
+    loopObj["lastStartMs"] = l.loopStartMs;
+    if (panicked) {
+      // Time spent in the pass that was running when the panic hit
+      loopObj["passUs"] = l.panicUs - l.loopStartUs;
+      loopObj["maxUs"] = l.loopMaxUs;
+      loopObj["p50Us"] = l.loopP50Us;
+      loopObj["p99Us"] = l.loopP99Us;
+
+      JsonObject p = doc["panic"].to<JsonObject>();
+      p["uptimeMs"] = l.panicMs;
+      p["reason"] = l.reason;
+      p["core"] = l.core;
+      hex32(hex, sizeof(hex), l.pc);
+      p["pc"] = hex;
+      JsonArray bt = p["backtrace"].to<JsonArray>();
+      for (uint8_t i = 0; i < l.depth; i++) {
+        hex32(hex, sizeof(hex), l.backtrace[i]);
+        bt.add(hex);
+      }
+
+      JsonArray tr = doc["trace"].to<JsonArray>();
+      for (uint8_t i = 0; i < l.traceCount; i++) {
+        const Tracer::Record& r = l.trace[i];
+        JsonObject e = tr.add<JsonObject>();
+        e["dtUs"] = (int32_t)(r.tsUs - l.panicUs);
+        e["name"] = Tracer::name(r.id);
+        e["ph"] = String(r.ph);
+        uint8_t t = 0;
+        while (t < l.taskCount && l.taskHandles[t] != r.task) t++;
+        e["task"] = t < l.taskCount ? l.taskNames[t] : "?";
+        e["arg"] = r.arg;
+      }
+    }
+
+    // Oldest first; once wrapped, start after the first cut line
+    String log;
+    if (l.logBytes < kLogBytes) {
+      log.concat(l.log, l.logHead);
+    } else {
+      log.reserve(kLogBytes);
+      log.concat(l.log + l.logHead, kLogBytes - l.logHead);
+      log.concat(l.log, l.logHead);
+      log = log.substring(log.indexOf('\n') + 1);
+    }
+    doc["log"] = log;
+  } else {
+    doc["lost"] = true;   // RTC block invalid (first boot of a new layout)
+  }
+
+  File f = LittleFS.open(kContextPath, FILE_WRITE);
+  if (!f) {
+    webSerial.printf("[CRASH] cannot write %s\n", kContextPath);
+    return;
+  }
+  serializeJson(doc, f);
+  f.close();
+}
+
+CrashContext::Info CrashContext::info() const {
+  Info i;
+#if CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH
+  i.supported = true;
+#endif
+  size_t addr = 0;
+  size_t size = 0;
+  i.dump = dumpImage(addr, size);
+  i.dumpBytes = i.dump ? (uint32_t)size : 0;
+  i.context = LittleFS.exists(kContextPath);
+  return i;
+}
+
+void CrashContext::serveInfo(AsyncWebServerRequest* req) const {
+  const Info i = info();
+  JsonDocument doc;
+  doc["supported"] = i.supported;
+  doc["resetReason"] = resetName(_resetReason);
+  doc["dump"] = i.dump;
+  doc["dumpBytes"] = i.dumpBytes;
+  if (i.context) {
+    File f = LittleFS.open(kContextPath, FILE_READ);
+    JsonDocument ctx;
+    if (f && !deserializeJson(ctx, f)) {
+      ctx.remove("log");   // in the download; keeps this response small
+      doc["context"] = ctx;
+    }
+  }
+  String out;
+  serializeJson(doc, out);
+  req->send(200, "application/json", out);
+}
+
+namespace {
+
+struct DumpCursor {
+  uint8_t head[16];
+  String json;
+  const esp_partition_t* part = nullptr;
+  uint32_t dumpOffset = 0;
+  uint32_t dumpLen = 0;
+};
+
+}  // namespace
+
+void CrashContext::serveDump(AsyncWebServerRequest* req) const {
+  std::shared_ptr<DumpCursor> c = std::make_shared<DumpCursor>();
+
+  size_t addr = 0;
+  size_t size = 0;
+  if (dumpImage(addr, size)) {
+    c->part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_COREDUMP, nullptr);
+    if (c->part && addr >= c->part->address && addr - c->part->address + size <= c->part->size) {
+      c->dumpOffset = (uint32_t)(addr - c->part->address);
+      c->dumpLen = (uint32_t)size;
+    }
+  }
+  File f = LittleFS.open(kContextPath, FILE_READ);
+  if (f) {
+    c->json.reserve(f.size());
+    char buf[128];
+    int n;
+    while ((n = f.read((uint8_t*)buf, sizeof(buf))) > 0) c->json.concat(buf, n);
+    f.close();
+  }
+  if (!c->dumpLen && c->json.isEmpty()) {
+    req->send(404, "text/plain", "no core dump");
+    return;
+  }
+
+  const uint32_t jsonLen = c->json.length();
+  memcpy(c->head, kContainerMagic, sizeof(kContainerMagic));
+  for (uint8_t i = 0; i < 4; i++) {
+    c->head[8 + i] = (uint8_t)(jsonLen >> (8 * i));
+    c->head[12 + i] = (uint8_t)(c->dumpLen >> (8 * i));
+  }
+  const size_t total = sizeof(c->head) + jsonLen + c->dumpLen;
+
+  AsyncWebServerResponse* res = req->beginResponse("application/octet-stream", total,
+    [c, jsonLen, total](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+      size_t out = 0;
+      while (out < maxLen && index < total) {
+        size_t n;
+        if (index < sizeof(c->head)) {
+          n = min(maxLen - out, sizeof(c->head) - index);
+          memcpy(buf + out, c->head + index, n);
+        } else if (index < sizeof(c->head) + jsonLen) {
+          const size_t at = index - sizeof(c->head);
+          n = min(maxLen - out, jsonLen - at);
+          memcpy(buf + out, c->json.c_str() + at, n);
+        } else {
+          const size_t at = index - sizeof(c->head) - jsonLen;
+          n = min(maxLen - out, c->dumpLen - at);
+          if (esp_partition_read(c->part, c->dumpOffset + at, buf + out, n) != ESP_OK) break;
+        }
+        out += n;
+        index += n;
+      }
+      return out;
+    });
+  char name[80];
+  snprintf(name, sizeof(name), "attachment; filename=coredump-%s-%s.bin", FW_HW, STRVERSION);
+  res->addHeader("Content-Disposition", name);
+  res->addHeader("Cache-Control", "no-store");
+  req->send(res);
+}
+
+void CrashContext::erase() {
+#if CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH
+  esp_core_dump_image_erase();
+#endif
+  LittleFS.remove(kContextPath);
+  webSerial.println("[CRASH] core dump erased");
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+
+class AsyncWebServerRequest;
+
+// Runtime context for post-mortem debugging, kept next to the ESP-IDF core
+// dump (the "coredump" partition of partitions.csv).
+//
+// A small block in RTC memory survives panics and watchdog resets (not power
+// loss). At runtime it collects the tail of the log output and where the loop
+// task is (start and count of the current pass). The panic handler adds the
+// panic reason and PC, the loop latency state (LoopStats) and the newest trace
+// events; it runs before the core dump is written and only copies memory.
+// After a crash reset, begin() saves the block as JSON on LittleFS.
+//
+// GET /coredump.bin downloads that JSON and the raw core dump image in one
+// file for tools/decode_coredump.py:
+//   "BBCORE1\0", u32 jsonLen, u32 dumpLen (little endian), JSON, dump
+class CrashContext {
+public:
+  struct Info {
+    bool supported = false;   // core dumps to flash in this build
+    bool dump = false;        // image in the partition
+    uint32_t dumpBytes = 0;
+    bool context = false;     // JSON context saved after the last crash
+  };
+
+  // After LittleFS is mounted (persistLog.begin()), before the log tap
+  void begin();
+
+  // Loop task: start of a loop() pass (LoopTimer)
+  void loopBegin(uint32_t startUs);
+
+  // Any task (serialised by a portMUX). Fed with raw webSerial output by the
+  // tap, which runs in webSerial.loop() on the loop task
+  void appendLog(const uint8_t* data, size_t len);
+
+  // Panic handler: copies memory only, no locks or allocation
+  void onPanic(const char* reason, uint32_t pc, int core, const uint32_t* backtrace, uint8_t depth);
+
+  Info info() const;
+
+  // GET /coredump.json: reset reason, dump summary and the saved context
+  void serveInfo(AsyncWebServerRequest* req) const;
+  // GET /coredump.bin: the container above; 404 without dump and context
+  void serveDump(AsyncWebServerRequest* req) const;
+  // Erases the dump partition and the saved context
+  void erase();
+
+private:
+  void saveContext(int resetReason);
+
+  int _resetReason = 0;
+};
+
+// Global instance (defined in CrashContext.cpp)
+extern CrashContext crashContext;
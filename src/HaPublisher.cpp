@@ -0,0 +1,222 @@
+#include "HaPublisher.h"
+
+#include <ArduinoJson.h>
+#include "SettingsPrefs.h"
+#include "WebSerial.h"
+
+namespace {
+const char* const kSeverityNames[] = { "None", "Info", "Warning", "Error", "Fatal" };
+
+struct SensorDef {
+  const char* component;
+  const char* key;
+  const char* name;
+  const char* unit;
+  const char* deviceClass;
+  const char* icon;
+};
+
+const SensorDef kSensors[] = {
+  { "sensor",        "state",         "Print state",        nullptr, nullptr,        "mdi:printer-3d" },
+  { "sensor",        "progress",      "Print progress",     "%",     nullptr,        "mdi:progress-clock" },
+  { "sensor",        "download",      "Download progress",  "%",     nullptr,        "mdi:download" },
+  { "sensor",        "remaining",     "Remaining time",     "min",   "duration",     nullptr },
+  { "sensor",        "bed",           "Bed temperature",    "°C",    "temperature",  nullptr },
+  { "sensor",        "bed_target",    "Bed target",         "°C",    "temperature",  nullptr },
+  { "sensor",        "nozzle",        "Nozzle temperature", "°C",    "temperature",  nullptr },
+  { "sensor",        "nozzle_target", "Nozzle target",      "°C",    "temperature",  nullptr },
+  { "sensor",        "hms",           "HMS severity",       nullptr, nullptr,        "mdi:alert" },
+  { "sensor",        "hms_count",     "HMS events",         nullptr, nullptr,        "mdi:alert-circle" },
+  { "binary_sensor", "connected",     "Printer connected",  nullptr, "connectivity", nullptr },
+};
+
+inline int16_t halfDegrees(float t) { return (int16_t)lroundf(t * 2.0f); }
+}
+
+bool HaPublisher::Key::operator==(const Key& o) const {
+  return strcmp(state, o.state) == 0 && progress == o.progress && download == o.download &&
+         remaining == o.remaining && bed2 == o.bed2 && bedTarget2 == o.bedTarget2 &&
+         nozzle2 == o.nozzle2 && nozzleTarget2 == o.nozzleTarget2 &&
+         hmsTop == o.hmsTop && hmsCount == o.hmsCount && connected == o.connected;
+}
+
+HaPublisher::Key HaPublisher::keyOf(const PrinterState& ps) {
+  Key k;
+  strlcpy(k.state, ps.gcodeState, sizeof(k.state));
+  k.progress = ps.printProgress;
+  k.download = ps.downloadProgress;
+  k.remaining = ps.remainingMin;
+  if (ps.bedValid) {
+    k.bed2 = halfDegrees(ps.bedTemp);
+    k.bedTarget2 = halfDegrees(ps.bedTarget);
+  }
+  if (ps.nozzleValid) {
+    k.nozzle2 = halfDegrees(ps.nozzleTemp);
+    k.nozzleTarget2 = halfDegrees(ps.nozzleTarget);
+  }
+  k.hmsTop = ps.hmsTop;
+  k.hmsCount = ps.hmsCount;
+  k.connected = ps.connected;
+  return k;
+}
+
+void HaPublisher::begin(Settings& settings) {
+  _host = settings.get.haHost();
+  _host.trim();
+  _enabled = _host.length() > 0;
+  if (!_enabled) return;
+
+  _port = settings.get.haPort();
+  _user = settings.get.haUser();
+  _pass = settings.get.haPass();
+  _prefix = settings.get.haPrefix();
+  if (_prefix.isEmpty()) _prefix = "homeassistant";
+  _deviceName = settings.get.deviceName();
+  _minIntervalMs = (uint32_t)settings.get.haMinInterval() * 1000UL;
+
+  String mac = _wifi.macAddress();
+  mac.replace(":", "");
+  mac.toLowerCase();
+  _id = "bambubeacon_" + mac;
+  _base = "bambubeacon/" + _id;
+
+  _resolver.setHost(_host, "HA");
+  _mqtt.setBufferSize(kBufferSize);
+  _mqtt.setSocketTimeout(1);
+  webSerial.printf("[HA] Publishing to %s:%u as %s\n", _host.c_str(), _port, _id.c_str());
+}
+
+bool HaPublisher::connect(const IPAddress& ip) {
+  // PubSubClient reuses an open socket, so the connect timeout is ours
+  _mqtt.setServer(ip, _port);
+  if (!_net.connect(ip, _port, (int32_t)kConnectTimeoutMs)) {
+    _stats.connectFailures++;
+    webSerial.printf("[HA] Connect to %s:%u failed\n", _host.c_str(), _port);
+    return false;
+  }
+  const String status = _base + "/status";
+  const bool ok = _user.length()
+    ? _mqtt.connect(_id.c_str(), _user.c_str(), _pass.c_str(), status.c_str(), 0, true, "offline")
+    : _mqtt.connect(_id.c_str(), status.c_str(), 0, true, "offline");
+  if (!ok) {
+    _stats.connectFailures++;
+    webSerial.printf("[HA] Connect to %s:%u failed rc=%d\n", _host.c_str(), _port, _mqtt.state());
+    return false;
+  }
+  _mqtt.publish(status.c_str(), "online", true);
+  _discoverySent = false;
+  _haveLast = false;  // republish the state on every new session
+  return true;
+}
+
+void HaPublisher::publishDiscovery() {
+  const String stateTopic = _base + "/state";
+  const String statusTopic = _base + "/status";
+
+  for (const SensorDef& s : kSensors) {
+    JsonDocument doc;
+    doc["name"] = s.name;
+    doc["uniq_id"] = _id + "_" + s.key;
+    doc["obj_id"] = _id + "_" + s.key;
+    doc["stat_t"] = stateTopic;
+    doc["avty_t"] = statusTopic;
+    if (strcmp(s.component, "binary_sensor") == 0) {
+      doc["val_tpl"] = String("{{ 'ON' if value_json.") + s.key + " else 'OFF' }}";
+    } else {
+      doc["val_tpl"] = String("{{ value_json.") + s.key + " }}";
+    }
+    if (s.unit) doc["unit_of_meas"] = s.unit;
+    if (s.deviceClass) doc["dev_cla"] = s.deviceClass;
+    if (s.icon) doc["ic"] = s.icon;
+    if (s.unit && strcmp(s.unit, "%") != 0) doc["stat_cla"] = "measurement";
+    JsonObject dev = doc["dev"].to<JsonObject>();
+    dev["ids"][0] = _id;
+    dev["name"] = _deviceName;
+    dev["mf"] = "SoftWareCrash";
+    dev["mdl"] = "BambuBeacon";
+    dev["sw"] = STRVERSION;
+
+    String payload;
+    serializeJson(doc, payload);
+    const String topic = _prefix + "/" + s.component + "/" + _id + "/" + s.key + "/config";
+    if (_mqtt.publish(topic.c_str(), payload.c_str(), true)) _stats.discoveryPublishes++;
+  }
+  _discoverySent = true;
+}
+
+bool HaPublisher::publishState(const PrinterState& ps) {
+  JsonDocument doc;
+  doc["state"] = ps.gcodeState[0] ? ps.gcodeState : "UNKNOWN";
+  if (ps.printProgress <= 100) doc["progress"] = ps.printProgress;
+  else doc["progress"] = nullptr;
+  if (ps.downloadProgress <= 100) doc["download"] = ps.downloadProgress;
+  else doc["download"] = nullptr;
+  if (ps.remainingMin != 0xFFFF) doc["remaining"] = ps.remainingMin;
+  else doc["remaining"] = nullptr;
+  // Always present (null = unknown), every discovery template must resolve
+  if (ps.bedValid) {
+    doc["bed"] = roundf(ps.bedTemp * 10.0f) / 10.0f;
+    doc["bed_target"] = roundf(ps.bedTarget * 10.0f) / 10.0f;
+  } else {
+    doc["bed"] = nullptr;
+    doc["bed_target"] = nullptr;
+  }
+  if (ps.nozzleValid) {
+    doc["nozzle"] = roundf(ps.nozzleTemp * 10.0f) / 10.0f;
+    doc["nozzle_target"] = roundf(ps.nozzleTarget * 10.0f) / 10.0f;
+  } else {
+    doc["nozzle"] = nullptr;
+    doc["nozzle_target"] = nullptr;
+  }
+  doc["hms"] = kSeverityNames[ps.hmsTop < 5 ? ps.hmsTop : 0];
+  doc["hms_count"] = ps.hmsCount;
+  doc["connected"] = ps.connected;
+
+  char payload[384];
+  const size_t n = serializeJson(doc, payload, sizeof(payload));
+  const String topic = _base + "/state";
+  return _mqtt.publish(topic.c_str(), reinterpret_cast<const uint8_t*>(payload), n, true);
+}
+
+void HaPublisher::loop(const PrinterState& ps) {
+  if (!_enabled) return;
+  const uint32_t now = millis();
+
+  _connected = _mqtt.connected();
+  if (!_connected) {
+    if (!_wifi.connected() || (int32_t)(now - _nextConnectMs) < 0) return;
+    IPAddress ip;
+    if (!_resolver.get(ip)) return;  // lookup in flight or backing off
+    if (!connect(ip)) {
+      _nextConnectMs = now + kRetryMs;
+      _resolver.invalidate();
+      return;
+    }
+    _connected = true;
+  }
+  _mqtt.loop();
+  if (!_discoverySent) publishDiscovery();
+
+  const Key k = keyOf(ps);
+  if (_haveLast && k == _last && !_pending) return;
+  if (_haveLast && now - _lastPublishMs < _minIntervalMs) {
+    if (!_pending) _stats.suppressed++;
+    _pending = true;
+    return;
+  }
+
+  if (publishState(ps)) {
+    _stats.statePublishes++;
+    _last = k;
+    _haveLast = true;
+    _pending = false;
+    _lastPublishMs = now;
+  }
+}
+
+HaPublisher::Stats HaPublisher::stats() const {
+  Stats s = _stats;
+  s.enabled = _enabled;
+  s.connected = _connected;
+  return s;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <PubSubClient.h>
+#include "Hal.h"
+#include "HostResolver.h"
+#include "PrinterState.h"
+
+class Settings;
+
+// Publishes a compact, already parsed printer state to a local MQTT broker
+// (settings ha/haHost etc., empty host = off), with Home Assistant discovery.
+//
+// Topics (<id> = bambubeacon_<mac>):
+//   bambubeacon/<id>/state     retained JSON, only on change, at most every haMinInterval s
+//   bambubeacon/<id>/status    retained "online", LWT "offline"
+//   <haPrefix>/<component>/<id>/<key>/config   retained discovery, once per connection
+// Temperatures count as changed from 0.5 C on, so sensor noise does not
+// cause a publish every report. The broker name is resolved without blocking
+// (HostResolver) and the TCP connect is bounded by kConnectTimeoutMs, so a
+// dead broker costs the loop at most that plus the CONNACK wait per retry.
+class HaPublisher {
+public:
+  explicit HaPublisher(hal::Wifi& wifi = hal::wifi()) : _wifi(wifi) {}
+
+  struct Stats {
+    bool     enabled = false;
+    bool     connected = false;
+    uint32_t statePublishes = 0;
+    uint32_t suppressed = 0;     // changes folded into a later publish by the rate limit
+    uint32_t discoveryPublishes = 0;
+    uint32_t connectFailures = 0;
+  };
+
+  void begin(Settings& settings);
+  // Loop task
+  void loop(const PrinterState& ps);
+
+  Stats stats() const;
+
+private:
+  struct Key {
+    char     state[16] = {0};
+    uint8_t  progress = 255;
+    uint8_t  download = 255;
+    uint16_t remaining = 0xFFFF;
+    int16_t  bed2 = 0, bedTarget2 = 0, nozzle2 = 0, nozzleTarget2 = 0;  // half degrees
+    uint8_t  hmsTop = 0;
+    uint8_t  hmsCount = 0;
+    bool     connected = false;
+
+    bool operator==(const Key& o) const;
+  };
+
+  static Key keyOf(const PrinterState& ps);
+  bool connect(const IPAddress& ip);
+  void publishDiscovery();
+  bool publishState(const PrinterState& ps);
+
+  static const uint32_t kRetryMs = 30000UL;
+  static const uint32_t kConnectTimeoutMs = 1000;
+  static const uint16_t kBufferSize = 1024;
+
+  hal::Wifi& _wifi;
+  bool     _enabled = false;
+  String   _host;
+  HostResolver _resolver;
+  uint16_t _port = 1883;
+  String   _user;
+  String   _pass;
+  String   _prefix;
+  String   _deviceName;
+  uint32_t _minIntervalMs = 5000;
+
+  String _id;
+  String _base;
+
+  WiFiClient   _net;
+  PubSubClient _mqtt{_net};
+  bool     _connected = false;      // last seen by loop(), read by stats()
+  bool     _discoverySent = false;
+  uint32_t _nextConnectMs = 0;
+
+  Key      _last;
+  bool     _haveLast = false;
+  bool     _pending = false;
+  uint32_t _lastPublishMs = 0;
+
+  Stats _stats;
+};
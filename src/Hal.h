@@ -0,0 +1,155 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <WiFi.h>
+
+#include <type_traits>
+
+// Thin interfaces for the hardware services the core classes use: the Wi-Fi
+// station/AP, UDP sockets, the TLS client under MQTT, NVS and the LED output.
+//
+// Each port is a CRTP base: it is the API consumers call, and it forwards to
+// the implementation's *Impl() members by static_cast, so a missing hook is a
+// compile error and every call inlines to the Arduino call it wraps (no
+// vtables). The concrete types are chosen per build below; consumers hold
+// hal::Wifi& / hal::LedOut& (injected through their constructors, defaulting
+// to the process-wide instance) and own hal::Udp / hal::TlsClient / hal::Nvs
+// objects. A host build defines BAMBUBEACON_HAL_IMPL to a header of its own
+// that provides the same five aliases; the simulator's is sim/include/HalSim.h.
+//
+// Not behind a port: HaPublisher's plain WiFiClient and OtaPuller's
+// HTTPClient (HTTP streaming into Update). The simulator shims both classes
+// over host sockets, which is all a host build needs from them so far.
+
+namespace hal {
+
+template <class D>
+class WifiPort {
+public:
+  wl_status_t status() { return d().statusImpl(); }
+  bool connected() { return status() == WL_CONNECTED; }
+  IPAddress localIP() { return d().localIPImpl(); }
+  String macAddress() { return d().macAddressImpl(); }
+
+  void mode(wifi_mode_t m) { d().modeImpl(m); }
+  void setHostname(const char* name) { d().setHostnameImpl(name); }
+  void setSleep(bool on) { d().setSleepImpl(on); }
+  void config(IPAddress ip, IPAddress gw, IPAddress sn, IPAddress dns) { d().configImpl(ip, gw, sn, dns); }
+  void begin(const char* ssid, const char* pass) { d().beginImpl(ssid, pass); }
+  void disconnect(bool wifiOff, bool eraseAp) { d().disconnectImpl(wifiOff, eraseAp); }
+
+  void softAPConfig(IPAddress ip, IPAddress gw, IPAddress sn) { d().softAPConfigImpl(ip, gw, sn); }
+  void softAP(const char* ssid) { d().softAPImpl(ssid); }
+  void softAPdisconnect(bool wifiOff) { d().softAPdisconnectImpl(wifiOff); }
+  uint8_t softAPgetStationNum() { return d().softAPgetStationNumImpl(); }
+
+  void scanDelete() { d().scanDeleteImpl(); }
+  int16_t scanNetworks(bool async, bool showHidden) { return d().scanNetworksImpl(async, showHidden); }
+  int16_t scanComplete() { return d().scanCompleteImpl(); }
+
+private:
+  D& d() { return static_cast<D&>(*this); }
+};
+
+template <class D>
+class UdpPort {
+public:
+  bool beginMulticast(IPAddress group, uint16_t port) { return d().beginMulticastImpl(group, port); }
+  void stop() { d().stopImpl(); }
+
+  bool beginPacket(IPAddress ip, uint16_t port) { return d().beginPacketImpl(ip, port); }
+  bool beginMulticastPacket() { return d().beginMulticastPacketImpl(); }
+  size_t write(const uint8_t* data, size_t len) { return d().writeImpl(data, len); }
+  bool endPacket() { return d().endPacketImpl(); }
+
+  int parsePacket() { return d().parsePacketImpl(); }
+  IPAddress remoteIP() { return d().remoteIPImpl(); }
+  int read() { return d().readImpl(); }
+  int read(char* buf, size_t len) { return d().readImpl(reinterpret_cast<uint8_t*>(buf), len); }
+  int read(uint8_t* buf, size_t len) { return d().readImpl(buf, len); }
+  void flush() { d().flushImpl(); }  // drops the rest of the received packet
+
+private:
+  D& d() { return static_cast<D&>(*this); }
+};
+
+// PubSubClient drives the socket through Client; the port only configures it
+template <class D>
+class TlsClientPort {
+public:
+  void setInsecure() { d().setInsecureImpl(); }
+  void setHandshakeTimeout(unsigned long seconds) { d().setHandshakeTimeoutImpl(seconds); }
+  void setTimeout(uint32_t ms) { d().setTimeoutImpl(ms); }
+  Client& client() { return d().clientImpl(); }
+
+private:
+  D& d() { return static_cast<D&>(*this); }
+};
+
+template <class D>
+class NvsPort {
+public:
+  bool begin(const char* ns, bool readOnly) { return d().beginImpl(ns, readOnly); }
+  void end() { d().endImpl(); }
+
+  bool getBool(const char* key, bool def) { return d().getBoolImpl(key, def); }
+  int32_t getInt(const char* key, int32_t def) { return d().getIntImpl(key, def); }
+  uint16_t getUShort(const char* key, uint16_t def) { return d().getUShortImpl(key, def); }
+  uint32_t getUInt(const char* key, uint32_t def) { return d().getUIntImpl(key, def); }
+  float getFloat(const char* key, float def) { return d().getFloatImpl(key, def); }
+  String getString(const char* key, const String& def) { return d().getStringImpl(key, def); }
+
+  void putBool(const char* key, bool v) { d().putBoolImpl(key, v); }
+  void putInt(const char* key, int32_t v) { d().putIntImpl(key, v); }
+  void putUShort(const char* key, uint16_t v) { d().putUShortImpl(key, v); }
+  void putUInt(const char* key, uint32_t v) { d().putUIntImpl(key, v); }
+  void putFloat(const char* key, float v) { d().putFloatImpl(key, v); }
+  void putString(const char* key, const String& v) { d().putStringImpl(key, v); }
+
+private:
+  D& d() { return static_cast<D&>(*this); }
+};
+
+// WS2812B strip on LED_PIN; power limiting at 5 V
+template <class D>
+class LedOutPort {
+public:
+  void attach(CRGB* leds, uint16_t count) { d().attachImpl(leds, count); }
+  void setBrightness(uint8_t b) { d().setBrightnessImpl(b); }
+  void setMaxCurrent(uint32_t mA) { d().setMaxCurrentImpl(mA); }
+  void show() { d().showImpl(); }
+
+private:
+  D& d() { return static_cast<D&>(*this); }
+};
+
+}  // namespace hal
+
+#ifdef BAMBUBEACON_HAL_IMPL
+#include BAMBUBEACON_HAL_IMPL
+#else
+#include "HalArduino.h"
+#endif
+
+namespace hal {
+
+static_assert(std::is_base_of<WifiPort<Wifi>, Wifi>::value, "hal::Wifi must derive from WifiPort<Wifi>");
+static_assert(std::is_base_of<UdpPort<Udp>, Udp>::value, "hal::Udp must derive from UdpPort<Udp>");
+static_assert(std::is_base_of<TlsClientPort<TlsClient>, TlsClient>::value,
+              "hal::TlsClient must derive from TlsClientPort<TlsClient>");
+static_assert(std::is_base_of<NvsPort<Nvs>, Nvs>::value, "hal::Nvs must derive from NvsPort<Nvs>");
+static_assert(std::is_base_of<LedOutPort<LedOut>, LedOut>::value, "hal::LedOut must derive from LedOutPort<LedOut>");
+
+// Process-wide instances, the constructors' defaults
+inline Wifi& wifi() {
+  static Wifi instance;
+  return instance;
+}
+
+inline LedOut& ledOut() {
+  static LedOut instance;
+  return instance;
+}
+
+}  // namespace hal
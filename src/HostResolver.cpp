@@ -0,0 +1,82 @@
+#include "HostResolver.h"
+
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+#include "WebSerial.h"
+
+// Runs on the tcpip task, where lwIP's DNS API must be called
+struct HostResolverLwip {
+  static void store(HostResolver* r, const ip_addr_t* addr) {
+    if (addr && IP_IS_V4(addr)) {
+      r->_answer.store(ip_2_ip4(addr)->addr, std::memory_order_relaxed);
+      r->_state.store(HostResolver::Done, std::memory_order_release);
+    } else {
+      r->_state.store(HostResolver::Failed, std::memory_order_release);
+    }
+  }
+
+  static void found(const char* name, const ip_addr_t* addr, void* arg) {
+    (void)name;
+    store(static_cast<HostResolver*>(arg), addr);
+  }
+
+  static void lookup(void* ctx) {
+    HostResolver* r = static_cast<HostResolver*>(ctx);
+    ip_addr_t addr;
+    const err_t err = dns_gethostbyname(r->_query, &addr, &found, r);
+    if (err == ERR_OK) store(r, &addr);  // cached or literal, no callback follows
+    else if (err != ERR_INPROGRESS) store(r, nullptr);
+  }
+};
+
+void HostResolver::setHost(const String& host, const char* tag) {
+  _host = host;
+  _tag = tag ? tag : "";
+  _gen++;
+  _literal = _ip.fromString(_host);
+  _haveIp = _literal;
+  _nextTryMs = millis();
+}
+
+void HostResolver::start(uint32_t now) {
+  if (_host.length() >= sizeof(_query)) {
+    webSerial.printf("[%s] Host name too long: %s\n", _tag, _host.c_str());
+    _nextTryMs = now + kRetryMs;
+    return;
+  }
+  strlcpy(_query, _host.c_str(), sizeof(_query));
+  _queryGen = _gen;
+  _state.store(Pending, std::memory_order_release);
+  if (tcpip_callback(&HostResolverLwip::lookup, this) != ERR_OK) {
+    _state.store(Idle, std::memory_order_relaxed);
+    _nextTryMs = now + kRetryMs;
+  }
+}
+
+bool HostResolver::get(IPAddress& out) {
+  if (_literal) {
+    out = _ip;
+    return true;
+  }
+  const uint32_t now = millis();
+
+  const uint8_t st = _state.load(std::memory_order_acquire);
+  if (st == Done || st == Failed) {
+    _state.store(Idle, std::memory_order_relaxed);
+    if (_queryGen != _gen) {
+      _nextTryMs = now;  // host changed while the lookup ran
+    } else if (st == Done) {
+      _ip = IPAddress(_answer.load(std::memory_order_relaxed));
+      _haveIp = true;
+      _resolvedMs = now;
+    } else {
+      _nextTryMs = now + kRetryMs;
+      webSerial.printf("[%s] Cannot resolve %s\n", _tag, _host.c_str());
+    }
+  }
+
+  const bool fresh = _haveIp && now - _resolvedMs < kTtlMs;
+  if (!fresh && _state.load(std::memory_order_relaxed) == Idle && (int32_t)(now - _nextTryMs) >= 0) start(now);
+  if (_haveIp) out = _ip;
+  return _haveIp;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <atomic>
+
+// Non-blocking host name lookup for clients driven from the loop task
+// (HaPublisher, SyslogSink). IP literals resolve at once. Names go to lwIP's
+// resolver on the tcpip task and get() only polls for the answer, so a slow
+// or unreachable DNS server never stalls the loop. An address is reused for
+// kTtlMs (and after that until a refresh succeeds); a failed lookup is
+// retried after kRetryMs.
+class HostResolver {
+public:
+  // Loop task. tag prefixes the log line of a failed lookup, e.g. "HA"
+  void setHost(const String& host, const char* tag);
+  // Loop task: true with the address once one is known, otherwise starts or
+  // waits for a lookup
+  bool get(IPAddress& out);
+  // Loop task: the address did not work (connect failed), look it up again
+  void invalidate() { _haveIp = _literal; }
+
+private:
+  enum State : uint8_t { Idle, Pending, Done, Failed };
+
+  static const uint32_t kTtlMs = 10UL * 60UL * 1000UL;
+  static const uint32_t kRetryMs = 30000UL;
+
+  friend struct HostResolverLwip;  // lwIP callbacks (HostResolver.cpp)
+
+  void start(uint32_t now);
+
+  String      _host;
+  const char* _tag = "";
+  bool        _literal = false;
+  IPAddress   _ip;
+  bool        _haveIp = false;
+  uint32_t    _resolvedMs = 0;
+  uint32_t    _nextTryMs = 0;
+  uint32_t    _gen = 0;        // bumped by setHost(); answers to older queries are dropped
+  uint32_t    _queryGen = 0;
+
+  // Owned by the tcpip task while _state is Pending
+  char _query[64] = {0};
+  std::atomic<uint8_t>  _state{Idle};
+  std::atomic<uint32_t> _answer{0};  // IPv4, network byte order
+};
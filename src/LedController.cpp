@@ -2,6 +2,7 @@
 
 #include "main.h"           // LED_PIN via build_flags
 #include "SettingsPrefs.h"
+#include "Trace.h"
 
 static CRGB bootColorForSegment(uint8_t seg) {
   switch (seg) {
@@ -16,8 +17,9 @@ static CRGB bootColorForSegment(uint8_t seg) {
   }
 }
 
-LedController::LedController()
-: _leds(nullptr),
+LedController::LedController(hal::LedOut& out)
+: _out(out),
+  _leds(nullptr),
   _perSeg(0),
   _segments(0),
   _count(0),
@@ -32,7 +34,10 @@ LedController::LedController()
   _bootNextMs(0),
   _st(),
   _test(),
-  _testMode(false) {}
+  _testMode(false),
+  _otaMode(false),
+  _otaProgress(255),
+  _animOffsetMs(0) {}
 
 LedController::~LedController() {
   freeBuf();
@@ -65,13 +70,9 @@ bool LedController::begin(Settings& settings) {
   if (_perSeg == 0 || _segments == 0) return false;
   if (!alloc((uint16_t)_perSeg * _segments)) return false;
 
-#ifndef LED_PIN
-#error "LED_PIN must be defined via build_flags"
-#endif
-
-  FastLED.addLeds<WS2812B, LED_PIN, GRB>(_leds, _count);
-  FastLED.setBrightness(_brightness);
-  FastLED.setMaxPowerInVoltsAndMilliamps(5, _maxCurrentmA);
+  _out.attach(_leds, _count);
+  _out.setBrightness(_brightness);
+  _out.setMaxCurrent(_maxCurrentmA);
 
   clear(true);
 
@@ -88,13 +89,13 @@ void LedController::applySettingsFrom(Settings& settings) {
   uint8_t newBright = (uint8_t)settings.get.LEDBrightness();
   if (newBright != _brightness) {
     _brightness = newBright;
-    FastLED.setBrightness(_brightness);
+    _out.setBrightness(_brightness);
     markDirty();
   }
   uint16_t newMax = settings.get.LEDMaxCurrentmA();
   if (newMax != _maxCurrentmA) {
     _maxCurrentmA = newMax;
-    FastLED.setMaxPowerInVoltsAndMilliamps(5, _maxCurrentmA);
+    _out.setMaxCurrent(_maxCurrentmA);
   }
   bool newReverse = settings.get.LEDReverseOrder();
   if (newReverse != _reverseOrder) {
@@ -174,10 +175,28 @@ void LedController::startSelfTest() {
 
 void LedController::setBrightness(uint8_t b) {
   _brightness = b;
-  FastLED.setBrightness(_brightness);
+  _out.setBrightness(_brightness);
+  markDirty();
+}
+
+void LedController::setOtaMode(bool enabled) {
+  if (_otaMode == enabled) return;
+  _otaMode = enabled;
+  _otaProgress = 255;
   markDirty();
 }
 
+void LedController::setOtaProgress(uint8_t percent) {
+  if (_otaProgress != percent) {
+    _otaProgress = percent;
+    markDirty();
+  }
+}
+
+void LedController::setAnimOffset(int32_t offsetMs) {
+  _animOffsetMs = offsetMs;
+}
+
 void LedController::setTestMode(bool enabled) {
   _testMode = enabled;
   if (_testMode) {
@@ -272,14 +291,14 @@ void LedController::clear(bool showNow) {
   if (!_leds) return;
   fill_solid(_leds, _count, CRGB::Black);
   _dirty = true;
-  if (showNow) FastLED.show();
+  if (showNow) _out.show();
 }
 
 void LedController::setPixel(uint16_t idx, const CRGB& c, bool showNow) {
   if (!_leds || idx >= _count) return;
   _leds[idx] = c;
   markDirty();
-  if (showNow) FastLED.show();
+  if (showNow) _out.show();
 }
 
 void LedController::setSegmentColor(uint8_t seg, const CRGB& c, bool showNow) {
@@ -287,13 +306,14 @@ void LedController::setSegmentColor(uint8_t seg, const CRGB& c, bool showNow) {
   for (uint16_t i = segStart(seg); i < segEnd(seg); i++)
     _leds[i] = c;
   markDirty();
-  if (showNow) FastLED.show();
+  if (showNow) _out.show();
 }
 
 void LedController::showIfDirty() {
   if (!_dirty) return;
   _dirty = false;
-  FastLED.show();
+  TRACE_SCOPE(LedShow);
+  _out.show();
 }
 
 void LedController::setGlobalIdle() {
@@ -361,6 +381,7 @@ void LedController::deriveStateFromReport(JsonObjectConst report, uint32_t nowMs
 }
 
 void LedController::render(uint32_t nowMs) {
+  TRACE_SCOPE(LedRender);
   const uint32_t MQTT_STALE_MS = 15000;
   RenderState& st = _testMode ? _test : _st;
   const bool mqttOk = st.hasMqtt && (_testMode || (uint32_t)(nowMs - st.lastMqttMs) <= MQTT_STALE_MS);
@@ -370,6 +391,9 @@ void LedController::render(uint32_t nowMs) {
     return;
   }
 
+  // Animation phase runs on the shared clock (AnimSync) when LED sync is on
+  const uint32_t animMs = nowMs + (uint32_t)_animOffsetMs;
+
   clear(false);
 
   // LED plan (English, keep synced with behavior):
@@ -384,7 +408,7 @@ void LedController::render(uint32_t nowMs) {
 
   if (st.hmsSev >= 3) {
     if (_segments >= 1 && _perSeg >= 2) {
-      const uint16_t pos = (nowMs / 120) % _perSeg;
+      const uint16_t pos = (animMs / 120) % _perSeg;
       const uint16_t opp = (pos + (_perSeg / 2)) % _perSeg;
       const uint16_t base = segStart(0);
       if (base + pos < _count) _leds[base + pos] = CRGB::Red;
@@ -395,7 +419,7 @@ void LedController::render(uint32_t nowMs) {
       const uint16_t base = segStart(0);
       const uint32_t lapMs = (uint32_t)_perSeg * 180UL;
       const uint32_t pauseMs = 1400UL;
-      const uint32_t phase = (nowMs % (lapMs + pauseMs));
+      const uint32_t phase = (animMs % (lapMs + pauseMs));
       if (phase < lapMs) {
         const uint32_t pos16 = (phase * 256UL) / 180UL;
         const uint16_t head = (uint16_t)((pos16 >> 8) % _perSeg);
@@ -434,7 +458,7 @@ void LedController::render(uint32_t nowMs) {
   } else {
     if (_segments >= 1) {
       if (st.paused) {
-        uint8_t pulse = sin8((nowMs / 10) & 0xFF);
+        uint8_t pulse = sin8((animMs / 10) & 0xFF);
         uint8_t level = scale8(pulse, 200) + 30;
         CRGB c = CRGB::Green;
         c.nscale8_video(level);
@@ -447,13 +471,13 @@ void LedController::render(uint32_t nowMs) {
 
     if (_segments >= 2) {
     if (st.cooling) {
-      uint8_t saw = (nowMs / 8) & 0xFF;
+      uint8_t saw = (animMs / 8) & 0xFF;
       uint8_t level = 255 - saw;
       CRGB c = CRGB(0, 0, 120);
       c.nscale8_video(scale8(level, 180));
       setSegmentColor(1, c, false);
     } else if (st.heating) {
-      uint8_t saw = (nowMs / 8) & 0xFF;
+      uint8_t saw = (animMs / 8) & 0xFF;
       uint8_t level = saw;
       CRGB c = CRGB(255, 80, 0);
       c.nscale8_video(scale8(level, 200));
@@ -461,7 +485,7 @@ void LedController::render(uint32_t nowMs) {
     } else if (st.paused) {
       setSegmentColor(1, CRGB(255, 150, 0), false);
     } else if (st.hmsSev == 2) {
-      uint8_t pulse = sin8((nowMs / 10) & 0xFF);
+      uint8_t pulse = sin8((animMs / 10) & 0xFF);
       uint8_t level = scale8(pulse, 200) + 30;
       CRGB c = CRGB(255, 150, 0);
       c.nscale8_video(level);
@@ -472,7 +496,7 @@ void LedController::render(uint32_t nowMs) {
       setSegmentColor(1, base, false);
       if (_perSeg > 0) {
         const uint16_t span = (uint16_t)max<uint16_t>(1, _perSeg / 4);
-        const uint32_t pos16 = ((uint32_t)nowMs * 256UL / 320UL) % ((uint32_t)_perSeg * 256UL);
+        const uint32_t pos16 = (animMs * 256UL / 320UL) % ((uint32_t)_perSeg * 256UL);
         const uint16_t head = (uint16_t)(pos16 >> 8);
         const uint8_t frac = (uint8_t)(pos16 & 0xFF);
         const uint16_t baseIdx = segStart(1);
@@ -495,7 +519,7 @@ void LedController::render(uint32_t nowMs) {
 
   if (_segments >= 3) {
     if (!st.wifiOk) {
-      uint8_t pulse = sin8((nowMs / 6) & 0xFF);
+      uint8_t pulse = sin8((animMs / 6) & 0xFF);
       uint8_t level = scale8(pulse, 200) + 30;
       CRGB c = CRGB(160, 0, 180);
       c.nscale8_video(level);
@@ -516,7 +540,33 @@ void LedController::render(uint32_t nowMs) {
   markDirty();
 }
 
+// Every ring shows the same cyan fill; unknown size = single LED walking around.
+void LedController::renderOta(uint32_t nowMs) {
+  clear(false);
+  if (_perSeg == 0) return;
+
+  if (_otaProgress <= 100) {
+    const uint16_t lit = (uint32_t)_perSeg * _otaProgress / 100;
+    for (uint8_t seg = 0; seg < _segments; seg++) {
+      for (uint16_t i = 0; i < lit; i++) {
+        _leds[segStart(seg) + i] = CRGB(0, 120, 160);
+      }
+    }
+  } else {
+    const uint16_t pos = (nowMs / 200) % _perSeg;
+    for (uint8_t seg = 0; seg < _segments; seg++) {
+      _leds[segStart(seg) + pos] = CRGB(0, 120, 160);
+    }
+  }
+  markDirty();
+}
+
 void LedController::tick(uint32_t nowMs) {
+  if (_otaMode) {
+    _bootTestActive = false;
+    renderOta(nowMs);
+    return;
+  }
   if (_bootTestActive) {
     tickBootTest(nowMs);
     return;
@@ -528,7 +578,8 @@ void LedController::loop() {
   if (!_leds) return;
 
   uint32_t now = millis();
-  if ((uint32_t)(now - _lastTickMs) >= 25) {
+  const uint32_t frameMs = _otaMode ? 200 : 25; // 5 fps is plenty for a progress bar
+  if ((uint32_t)(now - _lastTickMs) >= frameMs) {
     _lastTickMs = now;
     tick(now);
   }
@@ -4,11 +4,13 @@
 #include <FastLED.h>
 #include <ArduinoJson.h>
 
+#include "Hal.h"
+
 class Settings;
 
 class LedController {
 public:
-  LedController();
+  explicit LedController(hal::LedOut& out = hal::ledOut());
   ~LedController();
 
   bool begin(Settings& settings);
@@ -25,6 +27,13 @@ public:
   void setPaused(bool paused);
   void setFinished(bool finished);
 
+  // Firmware update: replaces the status display with a low-rate progress bar
+  void setOtaMode(bool enabled);
+  void setOtaProgress(uint8_t percent); // 0-100, 255 = unknown
+
+  // Shared animation clock = millis() + offset (AnimSync); 0 = own clock
+  void setAnimOffset(int32_t offsetMs);
+
   void startSelfTest();
 
   void setBrightness(uint8_t b);
@@ -94,8 +103,10 @@ private:
   void tick(uint32_t nowMs);
   void deriveStateFromReport(JsonObjectConst report, uint32_t nowMs);
   void render(uint32_t nowMs);
+  void renderOta(uint32_t nowMs);
 
 private:
+  hal::LedOut& _out;
   CRGB*    _leds;
   uint16_t _perSeg;
   uint8_t  _segments;
@@ -110,4 +121,9 @@ private:
   RenderState _st;
   RenderState _test;
   bool     _testMode;
+
+  bool     _otaMode;
+  uint8_t  _otaProgress;
+
+  int32_t  _animOffsetMs;
 };
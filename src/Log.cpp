@@ -0,0 +1,156 @@
+#include "Log.h"
+
+#include <esp_timer.h>
+#include "PersistLog.h"
+#include "SyslogSink.h"
+#include "WebSerial.h"
+
+extern PersistLog persistLog;
+extern SyslogSink syslogSink;
+
+// Single definition of the global instance
+BinLog binLog;
+
+BinLog::BinLog() {
+  for (uint32_t i = 0; i < kSlots; i++) _slots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+// Bounded MPSC slot ring: a slot is free for position pos when seq == pos and
+// ready for the reader when seq == pos + 1. Never waits: full ring = drop.
+BinLog::Slot* BinLog::reserve(uint32_t& pos) {
+  pos = _head.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& s = _slots[pos & (kSlots - 1)];
+    const int32_t dif = (int32_t)(s.seq.load(std::memory_order_acquire) - pos);
+    if (dif == 0) {
+      if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        _records.fetch_add(1, std::memory_order_relaxed);
+        return &s;
+      }
+    } else if (dif < 0) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    } else {
+      pos = _head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void BinLog::loop() {
+  // Debug records only for a reader; the sinks behind the webSerial tap keep up to INFO
+  const bool attached = webSerial.consumerAttached();
+  const bool sinks = persistLog.enabled() || syslogSink.enabled();
+  const int64_t t0 = esp_timer_get_time();
+  char line[192];
+
+  uint32_t budget = kDrainPerLoop;
+  while (budget--) {
+    Slot& s = _slots[_tail & (kSlots - 1)];
+    if (s.seq.load(std::memory_order_acquire) != _tail + 1) break;
+
+    if (attached || (sinks && s.level <= LOG_LEVEL_INFO)) {
+      line[0] = s.level <= LOG_LEVEL_DEBUG ? "-EWID"[s.level] : '?';
+      line[1] = ' ';
+      const size_t n = format(s, line + 2, sizeof(line) - 2);
+      if (n) webSerial.write(reinterpret_cast<const uint8_t*>(line), n + 2);
+      _formatted++;
+    } else {
+      // Nobody is reading: keep the newest half for a consumer that attaches later
+      const uint32_t pending = _head.load(std::memory_order_relaxed) - _tail;
+      if (pending <= kSlots / 2) break;
+      _discarded++;
+    }
+    s.seq.store(_tail + kSlots, std::memory_order_release);
+    _tail++;
+  }
+
+  _formatUs += (uint32_t)(esp_timer_get_time() - t0);
+}
+
+// printf-style rendering against the stored arguments. The length modifier in
+// the format string is ignored and derived from the stored type instead, and a
+// conversion that does not fit the stored type falls back to a default one, so
+// a mismatched call site prints something sensible instead of reading garbage.
+size_t BinLog::format(const Slot& s, char* out, size_t cap) const {
+  const char* f = s.fmt;
+  const uint8_t* a = s.args;
+  const uint8_t* const aEnd = s.args + s.len;
+  size_t n = 0;
+
+  auto emit = [&](int r) {
+    if (r > 0) n = min(n + (size_t)r, cap - 1);
+  };
+
+  while (*f && n < cap - 1) {
+    if (*f != '%') { out[n++] = *f++; continue; }
+    if (f[1] == '%') { out[n++] = '%'; f += 2; continue; }
+
+    char spec[16];
+    size_t sl = 0;
+    spec[sl++] = *f++;
+    while (*f && strchr("-+ #0123456789.", *f) && sl < sizeof(spec) - 4) spec[sl++] = *f++;
+    while (*f && strchr("hlLzjt", *f)) f++;
+    char conv = *f ? *f++ : 's';
+
+    if (a >= aEnd) { emit(snprintf(out + n, cap - n, "?")); continue; }
+    const Tag tag = (Tag)*a++;
+    char* dst = out + n;
+    const size_t room = cap - n;
+
+    if (tag == kStr) {
+      const uint8_t len = *a++;
+      char tmp[kMaxStr + 1];
+      memcpy(tmp, a, len);
+      tmp[len] = 0;
+      a += len;
+      spec[sl++] = 's';
+      spec[sl] = 0;
+      emit(snprintf(dst, room, spec, tmp));
+      continue;
+    }
+
+    uint64_t raw = 0;
+    const size_t w = (tag == kI32 || tag == kU32 || tag == kPtr) ? 4 : 8;
+    memcpy(&raw, a, w);
+    a += w;
+
+    const bool isFloatConv = strchr("fFeEgGaA", conv) != nullptr;
+    if (tag == kF64) {
+      double d;
+      memcpy(&d, &raw, 8);
+      spec[sl++] = isFloatConv ? conv : 'f';
+      spec[sl] = 0;
+      emit(snprintf(dst, room, spec, d));
+      continue;
+    }
+    if (tag == kPtr) {
+      spec[sl++] = 'p';
+      spec[sl] = 0;
+      emit(snprintf(dst, room, spec, (void*)(uintptr_t)raw));
+      continue;
+    }
+
+    const bool wide = (tag == kI64 || tag == kU64);
+    const bool isSigned = (tag == kI32 || tag == kI64);
+    if (!strchr("diuxXoc", conv)) conv = isSigned ? 'd' : 'u';
+    if (wide) { spec[sl++] = 'l'; spec[sl++] = 'l'; }
+    spec[sl++] = conv;
+    spec[sl] = 0;
+    if (wide) {
+      emit(snprintf(dst, room, spec, isSigned ? (long long)raw : (unsigned long long)raw));
+    } else {
+      emit(snprintf(dst, room, spec, isSigned ? (int)(int32_t)raw : (unsigned)(uint32_t)raw));
+    }
+  }
+  return n;
+}
+
+BinLog::Stats BinLog::stats() const {
+  Stats s;
+  s.records = _records.load(std::memory_order_relaxed);
+  s.dropped = _dropped.load(std::memory_order_relaxed);
+  s.formatted = _formatted;
+  s.discarded = _discarded;
+  s.formatUs = _formatUs;
+  return s;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <initializer_list>
+#include <type_traits>
+
+// Structured logging with deferred formatting.
+//
+// LOGE/LOGW/LOGI/LOGD store the format string pointer (its ID; the macros only
+// accept literals, which live in flash for the life of the image) plus the raw
+// arguments in a fixed RAM ring. Nothing is formatted at the call site.
+// binLog.loop() turns records into text on the loop task, prefixed with the
+// level letter ("W [HMS] ..."), but only for a consumer: any level while one
+// is attached (WebSerial page open or serial logging on, see
+// webSerial.consumerAttached()), up to INFO while the persistent log or syslog
+// is enabled. Otherwise nothing is formatted and the newest half of the ring
+// is kept so a page opened later still sees recent history.
+//
+// Ordering: records are rendered when loop() drains the ring, so a LOG* line
+// can appear after webSerial.printf output that was written later (from any
+// task). LOG* records keep their order among themselves; code that needs a
+// strict sequence with plain output should use one of the two for both.
+//
+// Levels below LOG_LEVEL compile out entirely (arguments are not evaluated).
+// Set it per env in platformio.ini, e.g. -D LOG_LEVEL=4 for debug builds.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+class BinLog {
+public:
+  struct Stats {
+    uint32_t records = 0;    // accepted into the ring
+    uint32_t dropped = 0;    // ring full at the call site
+    uint32_t formatted = 0;  // turned into text for a consumer
+    uint32_t discarded = 0;  // aged out unformatted (no consumer)
+    uint32_t formatUs = 0;   // time spent formatting in loop()
+  };
+
+  BinLog();
+
+  template <typename... Args>
+  void record(uint8_t level, const char* fmt, const Args&... args) {
+    uint32_t pos;
+    Slot* s = reserve(pos);
+    if (!s) return;
+    uint8_t* p = s->args;
+    uint8_t* const end = s->args + kArgBytes;
+    (void)std::initializer_list<int>{(put(p, end, args), 0)...};
+    s->fmt = fmt;
+    s->level = level;
+    s->len = (uint8_t)(p - s->args);
+    s->seq.store(pos + 1, std::memory_order_release);
+  }
+
+  // Call from loop(): formats pending records into webSerial
+  void loop();
+
+  Stats stats() const;
+
+private:
+  static const uint32_t kSlots = 64;       // power of two
+  static const size_t   kArgBytes = 54;    // 64-byte slots
+  static const size_t   kMaxStr = 24;      // longer string args are truncated
+  static const uint32_t kDrainPerLoop = 16;
+
+  enum Tag : uint8_t { kI32 = 1, kU32, kI64, kU64, kF64, kStr, kPtr };
+
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    const char* fmt;
+    uint8_t level;
+    uint8_t len;
+    uint8_t args[kArgBytes];
+  };
+
+  Slot* reserve(uint32_t& pos);
+  size_t format(const Slot& s, char* out, size_t cap) const;
+
+  static inline void putRaw(uint8_t*& p, uint8_t* end, Tag tag, const void* v, size_t n) {
+    if ((size_t)(end - p) < n + 1) { p = end; return; }
+    *p++ = tag;
+    memcpy(p, v, n);
+    p += n;
+  }
+
+  template <typename T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, int>::type = 0>
+  static inline void put(uint8_t*& p, uint8_t* end, T v) {
+    if (sizeof(T) > 4) {
+      const uint64_t x = (uint64_t)v;
+      putRaw(p, end, std::is_signed<T>::value ? kI64 : kU64, &x, 8);
+    } else {
+      const uint32_t x = (uint32_t)v;
+      putRaw(p, end, std::is_signed<T>::value ? kI32 : kU32, &x, 4);
+    }
+  }
+
+  static inline void put(uint8_t*& p, uint8_t* end, double v) { putRaw(p, end, kF64, &v, 8); }
+
+  static inline void put(uint8_t*& p, uint8_t* end, const char* v) {
+    if (!v) v = "(null)";
+    // Bounded by the object too where the compiler knows it (literals and
+    // char arrays once inlined): short buffers are never read past their end
+    size_t n = strnlen(v, min((size_t)kMaxStr, __builtin_object_size(v, 0)));
+    if ((size_t)(end - p) < 2) { p = end; return; }
+    n = min(n, (size_t)(end - p) - 2);
+    *p++ = kStr;
+    *p++ = (uint8_t)n;
+    memcpy(p, v, n);
+    p += n;
+  }
+  static inline void put(uint8_t*& p, uint8_t* end, char* v) { put(p, end, (const char*)v); }
+  static inline void put(uint8_t*& p, uint8_t* end, const String& v) { put(p, end, v.c_str()); }
+
+  template <typename T>
+  static inline void put(uint8_t*& p, uint8_t* end, T* v) {
+    const uint32_t x = (uint32_t)(uintptr_t)v;
+    putRaw(p, end, kPtr, &x, 4);
+  }
+
+  Slot _slots[kSlots];
+  std::atomic<uint32_t> _head{0}; // next slot to reserve (monotonic)
+  uint32_t _tail = 0;             // loop task only
+
+  std::atomic<uint32_t> _records{0};
+  std::atomic<uint32_t> _dropped{0};
+  uint32_t _formatted = 0;
+  uint32_t _discarded = 0;
+  uint32_t _formatUs = 0;
+};
+
+// Global instance (defined in Log.cpp)
+extern BinLog binLog;
+
+#define LOG_AT(level, fmt, ...) binLog.record((level), "" fmt, ##__VA_ARGS__)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOGE(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOGW(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOGI(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOGD(fmt, ...) do {} while (0)
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Duration histogram of loop() passes, cumulative since boot. Four buckets
+// per power of two (exact below 4 us, then ~19% wide) up to ~1 s, so a soak
+// monitor diffs two snapshots and gets percentiles for its own window.
+// Written by the loop task only; readers may see a pass half-counted.
+struct LoopStats {
+  static const uint8_t kBuckets = 80;
+
+  uint32_t count = 0;
+  uint32_t maxUs = 0;
+  uint32_t hist[kBuckets] = {0};
+
+  void record(uint32_t us) {
+    count++;
+    if (us > maxUs) maxUs = us;
+    hist[bucketOf(us)]++;
+  }
+
+  static uint8_t bucketOf(uint32_t us) {
+    if (us < 4) return (uint8_t)us;
+    const uint8_t msb = (uint8_t)(31 - __builtin_clz(us));
+    const uint32_t b = (uint32_t)(msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+    return b < kBuckets ? (uint8_t)b : kBuckets - 1;
+  }
+
+  // Smallest value that lands in bucket b + 1, i.e. the bucket's upper bound
+  static uint32_t bucketLimitUs(uint8_t b) {
+    if (b + 1 < 4) return b + 1;
+    const uint8_t next = b + 1;
+    return (uint32_t)(4 + (next & 3)) << (next / 4 - 1);
+  }
+
+  // Upper bound of the bucket holding quantile q (0..1) of `hist`
+  static uint32_t percentileUs(const uint32_t* hist, float q) {
+    uint64_t total = 0;
+    for (uint8_t i = 0; i < kBuckets; i++) total += hist[i];
+    if (!total) return 0;
+    const uint64_t rank = (uint64_t)(q * (float)total + 0.5f);
+    uint64_t seen = 0;
+    for (uint8_t i = 0; i < kBuckets; i++) {
+      seen += hist[i];
+      if (seen >= rank && seen) return bucketLimitUs(i);
+    }
+    return bucketLimitUs(kBuckets - 1);
+  }
+};
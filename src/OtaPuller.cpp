@@ -0,0 +1,340 @@
+#include "OtaPuller.h"
+
+#include <HTTPClient.h>
+#include "OtaUpdater.h"
+#include "PeerOta.h"
+#include "RestartScheduler.h"
+#include "TaskStats.h"
+#include "WebSerial.h"
+
+extern OtaUpdater otaUpdater;
+extern PeerOta peerOta;
+
+bool OtaPuller::start(const String& url, const String& sha256Hex, uint16_t rateKBps) {
+  if (_task) return false;
+  if (!url.startsWith("http://")) {
+    setError("only http:// URLs are supported");
+    setState(State::Failed);
+    return false;
+  }
+  return launch(url, sha256Hex, rateKBps, false);
+}
+
+bool OtaPuller::startPeer(const String& sha256Hex, uint16_t rateKBps) {
+  if (_task) return false;
+  return launch(String(), sha256Hex, rateKBps, true);
+}
+
+bool OtaPuller::launch(const String& url, const String& sha256Hex, uint16_t rateKBps, bool peer) {
+  _peer = peer;
+  _url = url;
+  _sha = sha256Hex;
+  _etag = "";
+  _rateBps = (uint32_t)rateKBps * 1024UL;
+  _cancel = false;
+
+  portENTER_CRITICAL(&_mux);
+  _status = Status();
+  _status.state = State::Fetching;
+  _status.peer = peer;
+  portEXIT_CRITICAL(&_mux);
+
+  taskStats.noteStackSize("ota_pull", kStackSize);
+  if (xTaskCreate(&OtaPuller::taskEntry, "ota_pull", kStackSize, this, kPriority, &_task) != pdPASS) {
+    _task = nullptr;
+    setError("task create failed");
+    setState(State::Failed);
+    return false;
+  }
+  return true;
+}
+
+void OtaPuller::cancel() {
+  _cancel = true;
+}
+
+OtaPuller::Status OtaPuller::status() const {
+  portENTER_CRITICAL(&_mux);
+  Status s = _status;
+  portEXIT_CRITICAL(&_mux);
+  return s;
+}
+
+const char* OtaPuller::stateName(State s) {
+  switch (s) {
+    case State::Fetching: return "fetching";
+    case State::Waiting:  return "waiting";
+    case State::Done:     return "done";
+    case State::Failed:   return "failed";
+    default:              return "idle";
+  }
+}
+
+void OtaPuller::setState(State s) {
+  portENTER_CRITICAL(&_mux);
+  _status.state = s;
+  portEXIT_CRITICAL(&_mux);
+}
+
+void OtaPuller::setError(const char* reason) {
+  portENTER_CRITICAL(&_mux);
+  strncpy(_status.error, reason ? reason : "", sizeof(_status.error) - 1);
+  _status.error[sizeof(_status.error) - 1] = 0;
+  portEXIT_CRITICAL(&_mux);
+}
+
+bool OtaPuller::fail(const char* reason) {
+  webSerial.printf("[OTA] Pull failed: %s\n", reason);
+  setError(reason);
+  setState(State::Failed);
+  return false;
+}
+
+void OtaPuller::taskEntry(void* arg) {
+  OtaPuller* self = static_cast<OtaPuller*>(arg);
+  self->run();
+  self->_task = nullptr;
+  vTaskDelete(nullptr);
+}
+
+// Blocking mDNS browse; fills _url and _sha from the chosen peer
+bool OtaPuller::resolvePeer() {
+  PeerOta::Peer peer;
+  if (!peerOta.pickPeer(_sha, peer)) return false;
+  _url = String("http://") + peer.ip.toString() + ":" + peer.port + "/firmware.bin";
+  _sha = peer.sha;
+  webSerial.printf("[P2P] Using peer %s v%s (rssi %d, connect %u ms)\n",
+                   peer.ip.toString().c_str(), peer.version, peer.rssi, (unsigned)peer.connectMs);
+  return true;
+}
+
+void OtaPuller::run() {
+  if (_peer && !resolvePeer()) {
+    // Nothing newer around is the normal outcome of a periodic check
+    setError("no suitable peer");
+    setState(State::Idle);
+    return;
+  }
+  webSerial.printf("[OTA] Pulling %s (limit %u KB/s)\n", _url.c_str(), (unsigned)(_rateBps / 1024UL));
+  _startMs = millis();
+
+  if (_sha.isEmpty() && !fetchSidecar()) {
+    fail("no .sha256 next to the image");
+    return;
+  }
+  if (_sha == OtaUpdater::kUnverified) webSerial.println("[OTA] Digest check skipped on request");
+  if (!otaUpdater.begin(this, _sha.c_str(), 0, false)) {
+    fail(otaUpdater.active() ? "another update is in progress" : otaUpdater.error());
+    return;
+  }
+
+  _tokens = kBurstBytes;
+  _lastRefillUs = micros();
+  uint32_t waitSinceMs = 0;
+
+  while (true) {
+    if (_cancel) {
+      otaUpdater.abort("cancelled");
+      fail("cancelled");
+      return;
+    }
+
+    if (!_wifi.connected()) {
+      if (!waitSinceMs) waitSinceMs = millis();
+      if (millis() - waitSinceMs > kWifiWaitMs) {
+        otaUpdater.abort("WiFi lost");
+        fail("WiFi lost");
+        return;
+      }
+      setState(State::Waiting);
+      vTaskDelay(pdMS_TO_TICKS(1000));
+      continue;
+    }
+    waitSinceMs = 0;
+    setState(State::Fetching);
+
+    const Fetch r = fetchFrom(_status.received);
+    if (r == Fetch::Complete) break;
+    if (r == Fetch::Fatal) {
+      if (otaUpdater.ownedBy(this)) otaUpdater.abort(_status.error);
+      setState(State::Failed);
+      return;
+    }
+
+    portENTER_CRITICAL(&_mux);
+    const uint16_t resumes = ++_status.resumes;
+    portEXIT_CRITICAL(&_mux);
+    if (resumes > kMaxResumes) {
+      otaUpdater.abort("too many retries");
+      fail("too many retries");
+      return;
+    }
+    webSerial.printf("[OTA] Pull interrupted at %u bytes, resuming (%u)\n",
+                     (unsigned)_status.received, (unsigned)resumes);
+    vTaskDelay(pdMS_TO_TICKS(2000));
+  }
+
+  if (!otaUpdater.end()) {
+    fail(otaUpdater.error());
+    return;
+  }
+
+  const uint32_t ms = millis() - _startMs;
+  portENTER_CRITICAL(&_mux);
+  _status.rateBps = ms ? (uint32_t)((uint64_t)_status.received * 1000ULL / ms) : 0;
+  _status.state = State::Done;
+  portEXIT_CRITICAL(&_mux);
+  webSerial.println("[OTA] Pull complete, rebooting");
+  restartScheduler.request(1000);
+}
+
+// One GET from offset to the end. Retry = connection problem, try again from the new offset.
+OtaPuller::Fetch OtaPuller::fetchFrom(uint32_t offset) {
+  WiFiClient client;
+  HTTPClient http;
+  http.setReuse(false);
+  http.setTimeout(10000);
+  http.setConnectTimeout(5000);
+  if (!http.begin(client, _url)) {
+    fail("bad URL");
+    return Fetch::Fatal;
+  }
+
+  const char* keys[] = { "ETag", "Content-Range" };
+  http.collectHeaders(keys, 2);
+  if (offset > 0) {
+    http.addHeader("Range", String("bytes=") + offset + "-");
+    if (_etag.length()) http.addHeader("If-Range", _etag);
+  }
+
+  const int code = http.GET();
+  if (code <= 0) {
+    http.end();
+    return Fetch::Retry;
+  }
+
+  uint32_t total = 0;
+  if (code == 206) {
+    // "bytes <start>-<end>/<total>"
+    const String cr = http.header("Content-Range");
+    const int dash = cr.indexOf('-');
+    const int slash = cr.indexOf('/');
+    const uint32_t start = (dash > 6) ? (uint32_t)cr.substring(6, dash).toInt() : 0;
+    if (start != offset || slash < 0) {
+      http.end();
+      fail("bad Content-Range");
+      return Fetch::Fatal;
+    }
+    total = (uint32_t)cr.substring(slash + 1).toInt();
+  } else if (code == 200) {
+    if (offset > 0) {
+      // Range ignored or file changed (If-Range): start the image over
+      webSerial.println("[OTA] Server sent the full file, restarting download");
+      otaUpdater.abort("restarting download");
+      if (!otaUpdater.begin(this, _sha.c_str(), 0, false)) {
+        http.end();
+        fail("another update is in progress");
+        return Fetch::Fatal;
+      }
+      offset = 0;
+      portENTER_CRITICAL(&_mux);
+      _status.received = 0;
+      portEXIT_CRITICAL(&_mux);
+    }
+    const int size = http.getSize();
+    total = size > 0 ? (uint32_t)size : 0;
+  } else {
+    http.end();
+    char reason[32];
+    snprintf(reason, sizeof(reason), "HTTP %d", code);
+    fail(reason);
+    return Fetch::Fatal;
+  }
+
+  if (_etag.isEmpty()) _etag = http.header("ETag");
+  portENTER_CRITICAL(&_mux);
+  _status.total = total;
+  portEXIT_CRITICAL(&_mux);
+
+  WiFiClient* stream = http.getStreamPtr();
+  uint32_t lastDataMs = millis();
+  while (!_cancel) {
+    if (total && offset >= total) break;
+
+    const int avail = stream->available();
+    if (avail <= 0) {
+      if (!stream->connected()) {
+        http.end();
+        return total ? Fetch::Retry : Fetch::Complete; // unknown length ends with the connection
+      }
+      if (millis() - lastDataMs > kStallMs) {
+        http.end();
+        return Fetch::Retry;
+      }
+      vTaskDelay(pdMS_TO_TICKS(5));
+      continue;
+    }
+
+    const size_t n = stream->readBytes(_buf, min((size_t)avail, sizeof(_buf)));
+    if (!n) continue;
+    if (!otaUpdater.write(_buf, n)) {
+      http.end();
+      setError(otaUpdater.error());
+      return Fetch::Fatal;
+    }
+    offset += n;
+    lastDataMs = millis();
+    portENTER_CRITICAL(&_mux);
+    _status.received = offset;
+    portEXIT_CRITICAL(&_mux);
+    throttle(n);
+  }
+
+  http.end();
+  return _cancel ? Fetch::Retry : Fetch::Complete;
+}
+
+// "<url>.sha256", or for ".gz" images also the sidecar of the uncompressed image
+bool OtaPuller::fetchSidecar() {
+  String candidates[2] = { _url + ".sha256", "" };
+  if (_url.endsWith(".gz")) candidates[1] = _url.substring(0, _url.length() - 3) + ".sha256";
+
+  for (const String& u : candidates) {
+    if (u.isEmpty()) continue;
+    WiFiClient client;
+    HTTPClient http;
+    http.setTimeout(5000);
+    if (!http.begin(client, u)) continue;
+    if (http.GET() == 200) {
+      String body = http.getString();
+      body.trim();
+      const int sp = body.indexOf(' ');
+      if (sp > 0) body = body.substring(0, sp);
+      if (body.length() == 64) {
+        _sha = body;
+        webSerial.printf("[OTA] Expecting sha256=%s (from %s)\n", _sha.c_str(), u.c_str());
+        http.end();
+        return true;
+      }
+    }
+    http.end();
+  }
+  return false;
+}
+
+// Token bucket: kBurstBytes of credit, refilled at _rateBps
+void OtaPuller::throttle(size_t n) {
+  if (!_rateBps) {
+    vTaskDelay(1); // still let equal-priority tasks run
+    return;
+  }
+  const uint32_t nowUs = micros();
+  _tokens += (int64_t)(uint32_t)(nowUs - _lastRefillUs) * _rateBps / 1000000LL;
+  _lastRefillUs = nowUs;
+  if (_tokens > (int64_t)kBurstBytes) _tokens = kBurstBytes;
+  _tokens -= (int64_t)n;
+  if (_tokens < 0) {
+    const uint32_t waitMs = (uint32_t)((-_tokens) * 1000LL / _rateBps) + 1;
+    vTaskDelay(pdMS_TO_TICKS(waitMs));
+  }
+}
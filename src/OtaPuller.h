@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Hal.h"
+
+// Pull-based OTA: downloads an image from a LAN HTTP URL in a low-priority task
+// and streams it through otaUpdater (gzip/delta/SHA-256 handled there).
+// Interrupted downloads resume with an HTTP Range request (If-Range on the ETag,
+// so a changed file restarts from zero). The download rate is capped with a
+// token bucket so LED rendering and MQTT on the loop task are not starved.
+class OtaPuller {
+public:
+  explicit OtaPuller(hal::Wifi& wifi = hal::wifi()) : _wifi(wifi) {}
+
+  enum class State : uint8_t { Idle, Fetching, Waiting, Done, Failed };
+
+  struct Status {
+    State    state = State::Idle;
+    uint32_t received = 0; // bytes of the image fetched so far
+    uint32_t total = 0;    // 0 = unknown
+    uint16_t resumes = 0;
+    uint32_t rateBps = 0;  // measured over the whole download
+    bool     peer = false; // source is another beacon
+    char     error[48] = {0};
+  };
+
+  // sha256Hex empty: read "<url>.sha256" (sha256sum format) before downloading,
+  // the pull fails without it; OtaUpdater::kUnverified skips the check.
+  // rateKBps 0 = unlimited. Returns false if a download is already running.
+  bool start(const String& url, const String& sha256Hex, uint16_t rateKBps);
+  // Same, but the source is a peer beacon found via mDNS (see PeerOta):
+  // the one running sha256Hex, or the newest version above ours if empty.
+  bool startPeer(const String& sha256Hex, uint16_t rateKBps);
+  void cancel();
+  bool busy() const { return _task != nullptr; }
+
+  // Thread-safe copy for the web handlers
+  Status status() const;
+
+  static const char* stateName(State s);
+
+private:
+  enum class Fetch : uint8_t { Complete, Retry, Fatal };
+
+  static void taskEntry(void* arg);
+  bool launch(const String& url, const String& sha256Hex, uint16_t rateKBps, bool peer);
+  void run();
+  bool resolvePeer();
+  Fetch fetchFrom(uint32_t offset);
+  bool fetchSidecar();
+  void throttle(size_t n);
+  void setState(State s);
+  void setError(const char* reason);
+  bool fail(const char* reason);
+
+  static const uint32_t kStackSize = 8192;
+  static const UBaseType_t kPriority = 1;        // same as loopTask, below AsyncTCP/WiFi/lwIP
+  static const uint16_t kMaxResumes = 30;
+  static const uint32_t kWifiWaitMs = 10UL * 60UL * 1000UL;
+  static const uint32_t kStallMs = 15000;
+  static const uint32_t kBurstBytes = 4096;
+
+  hal::Wifi& _wifi;
+  TaskHandle_t _task = nullptr;
+  volatile bool _cancel = false;
+  bool _peer = false;
+
+  String   _url;
+  String   _sha;
+  String   _etag;
+  uint32_t _rateBps = 0;
+  int64_t  _tokens = 0;
+  uint32_t _lastRefillUs = 0;
+  uint32_t _startMs = 0;
+
+  Status _status;
+  mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  uint8_t _buf[1024];
+};
@@ -0,0 +1,519 @@
+#include "OtaUpdater.h"
+
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_image_format.h>
+#include <esp_rom_crc.h>
+#include "WebSerial.h"
+
+#if CONFIG_IDF_TARGET_ESP32C3
+#include "esp32c3/rom/miniz.h"
+#else
+#include "esp32/rom/miniz.h"
+#endif
+
+namespace {
+constexpr uint8_t kGzipId1 = 0x1F;
+constexpr uint8_t kGzipId2 = 0x8B;
+constexpr uint8_t kGzipDeflate = 8;
+constexpr uint8_t kGzipFlagHcrc = 0x02;
+constexpr uint8_t kGzipFlagExtra = 0x04;
+constexpr uint8_t kGzipFlagName = 0x08;
+constexpr uint8_t kGzipFlagComment = 0x10;
+
+int hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseSha256Hex(const char* hex, uint8_t out[32]) {
+  if (!hex || strlen(hex) != 64) return false;
+  for (size_t i = 0; i < 32; i++) {
+    const int hi = hexNibble(hex[i * 2]);
+    const int lo = hexNibble(hex[i * 2 + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out[i] = (uint8_t)((hi << 4) | lo);
+  }
+  return true;
+}
+
+void formatSha256Hex(const uint8_t digest[32], char out[65]) {
+  for (size_t i = 0; i < 32; i++) snprintf(out + i * 2, 3, "%02x", digest[i]);
+}
+
+constexpr char kDeltaMagic[8] = { 'B', 'B', 'D', 'E', 'L', 'T', 'A', '1' };
+
+uint32_t readLe32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+}
+
+OtaUpdater::OtaUpdater() {
+  mbedtls_sha256_init(&_sha);
+}
+
+OtaUpdater::~OtaUpdater() {
+  freeInflater();
+  mbedtls_sha256_free(&_sha);
+}
+
+size_t OtaUpdater::workingSetBytes(bool gzip) {
+  return gzip ? (sizeof(tinfl_decompressor) + TINFL_LZ_DICT_SIZE) : 0;
+}
+
+bool OtaUpdater::begin(const void* owner, const char* expectedSha256Hex, uint32_t sizeHint, bool quiesce) {
+  const void* none = nullptr;
+  if (!owner || !_owner.compare_exchange_strong(none, owner)) {
+    webSerial.println("[OTA] Refused, another update is in progress");
+    return false;
+  }
+
+  _error[0] = 0;
+  _format = Format::Unknown;
+  _received = 0;
+  _written = 0;
+  _gzStage = GzStage::Fixed;
+  _gzFlags = 0;
+  _gzPos = 0;
+  _gzSkip = 0;
+  _crc = 0;
+  _inflated = 0;
+  _dictOfs = 0;
+  _payload = Payload::Unknown;
+  _dStage = DeltaStage::Header;
+  _dPos = 0;
+  _dOldSize = 0;
+  _dNewSize = 0;
+  _dOldPos = 0;
+  _dDiffLeft = 0;
+  _dExtraLeft = 0;
+  _dSeek = 0;
+  _dBase = nullptr;
+
+  _hasExpected = false;
+  if (!expectedSha256Hex || !*expectedSha256Hex) return fail("SHA-256 required");
+  if (strcmp(expectedSha256Hex, kUnverified) != 0) {
+    if (!parseSha256Hex(expectedSha256Hex, _expected)) return fail("bad SHA-256 header");
+    _hasExpected = true;
+  }
+
+  if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
+    Update.printError(webSerial);
+    return fail("Update.begin failed");
+  }
+
+  mbedtls_sha256_starts(&_sha, 0);
+  _sizeHint = sizeHint;
+  _startMs = millis();
+  _quiesce.store(quiesce, std::memory_order_relaxed);
+  _active = true;
+  webSerial.printf("[OTA] Started (sha256 check %s, quiesce %s)\n",
+                   _hasExpected ? "on" : "off", quiesce ? "on" : "off");
+  return true;
+}
+
+bool OtaUpdater::write(const uint8_t* data, size_t len) {
+  if (!_active) return false;
+  if (!len) return true;
+  _received += len;
+
+  if (_format == Format::Unknown) {
+    // App images start with 0xE9, so a gzip magic byte is unambiguous
+    if (data[0] == kGzipId1) {
+      if (!allocInflater()) return fail("no memory for inflate window");
+      _format = Format::Gzip;
+      webSerial.println("[OTA] gzip image, inflating on the fly");
+    } else {
+      _format = Format::Raw;
+    }
+  }
+
+  if (_format == Format::Gzip) return feedGzip(data, len);
+  return emit(data, len);
+}
+
+bool OtaUpdater::end() {
+  if (!_active) return false;
+
+  if (_format == Format::Gzip && _gzStage != GzStage::Done) return fail("gzip stream truncated");
+  if (_payload == Payload::Delta && _dStage != DeltaStage::Done) return fail("delta patch truncated");
+  if (_written == 0) return fail("empty image");
+
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&_sha, digest);
+  char hex[65];
+  formatSha256Hex(digest, hex);
+
+  if (_hasExpected && memcmp(digest, _expected, sizeof(digest)) != 0) {
+    webSerial.printf("[OTA] SHA-256 mismatch, got %s\n", hex);
+    return fail("SHA-256 mismatch");
+  }
+
+  // Only now the new partition becomes bootable
+  if (!Update.end(true)) {
+    Update.printError(webSerial);
+    return fail("Update.end failed");
+  }
+
+  freeInflater();
+  finishSession(true);
+  _owner.store(nullptr);
+  webSerial.printf("[OTA] Done%s: %u bytes received, %u bytes written, sha256=%s\n",
+                   _payload == Payload::Delta ? " (delta)" : "",
+                   (unsigned)_received, (unsigned)_written, hex);
+  return true;
+}
+
+void OtaUpdater::abort(const char* reason) {
+  if (reason && !_error[0]) {
+    strncpy(_error, reason, sizeof(_error) - 1);
+    _error[sizeof(_error) - 1] = 0;
+  }
+  if (_active) {
+    Update.abort();
+    webSerial.printf("[OTA] Aborted: %s\n", _error[0] ? _error : "unknown");
+    finishSession(false);
+  }
+  freeInflater();
+  _active = false;
+  _owner.store(nullptr);
+}
+
+void OtaUpdater::finishSession(bool ok) {
+  _last.owner = _owner.load();
+  _last.bytes = _received;
+  _last.ms = millis() - _startMs;
+  _last.quiesced = quiesced();
+  _last.ok = ok;
+  _active = false;
+  _quiesce.store(false, std::memory_order_relaxed);
+
+  const uint32_t ms = _last.ms ? _last.ms : 1;
+  webSerial.printf("[OTA] %u bytes in %u ms (%u KB/s, quiesce %s)\n",
+                   (unsigned)_last.bytes, (unsigned)_last.ms,
+                   (unsigned)((uint64_t)_last.bytes * 1000ULL / ms / 1024ULL),
+                   _last.quiesced ? "on" : "off");
+}
+
+uint8_t OtaUpdater::progressPercent() const {
+  if (!_active || _sizeHint == 0) return 255;
+  const uint32_t received = _received;
+  return received >= _sizeHint ? 100 : (uint8_t)((uint64_t)received * 100ULL / _sizeHint);
+}
+
+bool OtaUpdater::fail(const char* reason) {
+  abort(reason);
+  return false;
+}
+
+// Decoded payload (after gzip, if any): either the app image or a delta patch
+bool OtaUpdater::emit(const uint8_t* data, size_t len) {
+  if (!len) return true;
+  if (_payload == Payload::Unknown) {
+    _payload = (data[0] == (uint8_t)kDeltaMagic[0]) ? Payload::Delta : Payload::Image;
+  }
+  if (_payload == Payload::Delta) return feedDelta(data, len);
+  return writeImage(data, len);
+}
+
+bool OtaUpdater::writeImage(const uint8_t* data, size_t len) {
+  if (!len) return true;
+  mbedtls_sha256_update(&_sha, data, len);
+  if (Update.write(const_cast<uint8_t*>(data), len) != len) {
+    Update.printError(webSerial);
+    return fail("flash write failed");
+  }
+  _written += len;
+  return true;
+}
+
+bool OtaUpdater::allocInflater() {
+  freeInflater();
+  _inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  _dict = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+  if (!_inflator || !_dict) {
+    freeInflater();
+    return false;
+  }
+  tinfl_init(_inflator);
+  return true;
+}
+
+void OtaUpdater::freeInflater() {
+  if (_inflator) {
+    free(_inflator);
+    _inflator = nullptr;
+  }
+  if (_dict) {
+    free(_dict);
+    _dict = nullptr;
+  }
+}
+
+OtaUpdater::GzStage OtaUpdater::nextHeaderStage(GzStage after) const {
+  switch (after) {
+    case GzStage::Fixed:
+      if (_gzFlags & kGzipFlagExtra) return GzStage::ExtraLen;
+      // fall through
+    case GzStage::ExtraLen:
+    case GzStage::ExtraData:
+      if (_gzFlags & kGzipFlagName) return GzStage::Name;
+      // fall through
+    case GzStage::Name:
+      if (_gzFlags & kGzipFlagComment) return GzStage::Comment;
+      // fall through
+    case GzStage::Comment:
+      if (_gzFlags & kGzipFlagHcrc) return GzStage::HeaderCrc;
+      // fall through
+    default:
+      return GzStage::Deflate;
+  }
+}
+
+// Header fields may be split across chunks, so parse byte by byte.
+size_t OtaUpdater::consumeGzipHeader(const uint8_t* data, size_t len) {
+  size_t i = 0;
+  while (i < len && _gzStage < GzStage::Deflate) {
+    const uint8_t b = data[i++];
+    switch (_gzStage) {
+      case GzStage::Fixed:
+        if ((_gzPos == 0 && b != kGzipId1) || (_gzPos == 1 && b != kGzipId2)) {
+          fail("bad gzip magic");
+          return i;
+        }
+        if (_gzPos == 2 && b != kGzipDeflate) {
+          fail("unsupported gzip method");
+          return i;
+        }
+        if (_gzPos == 3) _gzFlags = b;
+        if (++_gzPos == 10) {
+          _gzPos = 0;
+          _gzStage = nextHeaderStage(GzStage::Fixed);
+        }
+        break;
+      case GzStage::ExtraLen:
+        _gzSkip |= (uint16_t)b << (8 * _gzPos);
+        if (++_gzPos == 2) {
+          _gzPos = 0;
+          _gzStage = _gzSkip ? GzStage::ExtraData : nextHeaderStage(GzStage::ExtraData);
+        }
+        break;
+      case GzStage::ExtraData:
+        if (--_gzSkip == 0) _gzStage = nextHeaderStage(GzStage::ExtraData);
+        break;
+      case GzStage::Name:
+        if (b == 0) _gzStage = nextHeaderStage(GzStage::Name);
+        break;
+      case GzStage::Comment:
+        if (b == 0) _gzStage = nextHeaderStage(GzStage::Comment);
+        break;
+      case GzStage::HeaderCrc:
+        if (++_gzPos == 2) {
+          _gzPos = 0;
+          _gzStage = GzStage::Deflate;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return i;
+}
+
+bool OtaUpdater::feedGzip(const uint8_t* data, size_t len) {
+  if (_gzStage < GzStage::Deflate) {
+    const size_t used = consumeGzipHeader(data, len);
+    if (!_active) return false;
+    data += used;
+    len -= used;
+  }
+
+  while (_gzStage == GzStage::Deflate) {
+    size_t inBytes = len;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - _dictOfs;
+    const tinfl_status st = tinfl_decompress(_inflator, data, &inBytes,
+                                             _dict, _dict + _dictOfs, &outBytes,
+                                             TINFL_FLAG_HAS_MORE_INPUT);
+    data += inBytes;
+    len -= inBytes;
+
+    if (outBytes) {
+      _crc = esp_rom_crc32_le(_crc, _dict + _dictOfs, outBytes);
+      _inflated += outBytes;
+      if (!emit(_dict + _dictOfs, outBytes)) return false;
+      _dictOfs = (_dictOfs + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+
+    if (st < TINFL_STATUS_DONE) return fail("corrupt gzip data");
+    if (st == TINFL_STATUS_DONE) {
+      _gzStage = GzStage::Trailer;
+      _gzPos = 0;
+      break;
+    }
+    if (st == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) return true;
+  }
+
+  // Trailer: CRC32 + ISIZE (little endian). Anything after it is ignored.
+  while (_gzStage == GzStage::Trailer && len > 0) {
+    _gzTrailer[_gzPos++] = *data++;
+    len--;
+    if (_gzPos == sizeof(_gzTrailer)) {
+      const uint32_t crc = (uint32_t)_gzTrailer[0] | ((uint32_t)_gzTrailer[1] << 8) |
+                           ((uint32_t)_gzTrailer[2] << 16) | ((uint32_t)_gzTrailer[3] << 24);
+      const uint32_t isize = (uint32_t)_gzTrailer[4] | ((uint32_t)_gzTrailer[5] << 8) |
+                             ((uint32_t)_gzTrailer[6] << 16) | ((uint32_t)_gzTrailer[7] << 24);
+      if (crc != _crc) return fail("gzip CRC mismatch");
+      if (isize != _inflated) return fail("gzip size mismatch");
+      _gzStage = GzStage::Done;
+      freeInflater();
+    }
+  }
+  return true;
+}
+
+bool OtaUpdater::startDelta() {
+  if (memcmp(_dHdr, kDeltaMagic, sizeof(kDeltaMagic)) != 0) return fail("bad delta magic");
+  _dOldSize = readLe32(_dHdr + 8);
+  _dNewSize = readLe32(_dHdr + 12);
+  const uint8_t* oldSha = _dHdr + 16;
+  const uint8_t* newSha = _dHdr + 48;
+
+  _dBase = esp_ota_get_running_partition();
+  if (!_dBase || _dOldSize == 0 || _dOldSize > _dBase->size) return fail("delta base size mismatch");
+  if (_dNewSize == 0) return fail("delta target empty");
+
+  // The patch is only valid against the exact image it was made from; the
+  // boot-time digest saves hashing ~1 MB of flash in the upload callback
+  if (!_runLen) return fail("running image digest unavailable");
+  if (_dOldSize != _runLen || memcmp(_runSha, oldSha, sizeof(_runSha)) != 0) {
+    return fail("delta base is not the running firmware");
+  }
+
+  // Unverified sessions still get the patch's own target hash
+  if (!_hasExpected) {
+    memcpy(_expected, newSha, sizeof(_expected));
+    _hasExpected = true;
+  }
+
+  webSerial.printf("[OTA] Delta patch %u -> %u bytes against %s\n",
+                   (unsigned)_dOldSize, (unsigned)_dNewSize, _dBase->label);
+  _dOldPos = 0;
+  _dPos = 0;
+  _dStage = DeltaStage::Control;
+  return true;
+}
+
+// Over the image length from its header (incl. the appended hash), not the partition
+void OtaUpdater::hashRunningImage() {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  if (!running) return;
+
+  const esp_partition_pos_t pos = { running->address, running->size };
+  esp_image_metadata_t meta = {};
+  if (esp_image_get_metadata(&pos, &meta) != ESP_OK || meta.image_len == 0 || meta.image_len > running->size) {
+    webSerial.println("[OTA] Running image metadata unavailable");
+    return;
+  }
+
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  uint8_t buf[512];
+  for (uint32_t off = 0; off < meta.image_len; off += sizeof(buf)) {
+    const size_t n = min<size_t>(sizeof(buf), meta.image_len - off);
+    if (esp_partition_read(running, off, buf, n) != ESP_OK) {
+      mbedtls_sha256_free(&ctx);
+      return;
+    }
+    mbedtls_sha256_update(&ctx, buf, n);
+  }
+  mbedtls_sha256_finish(&ctx, _runSha);
+  mbedtls_sha256_free(&ctx);
+
+  for (size_t i = 0; i < sizeof(_runSha); i++) snprintf(_runShaHex + i * 2, 3, "%02x", _runSha[i]);
+  _runLen = meta.image_len;
+  webSerial.printf("[OTA] Running image %u bytes, sha256=%s\n", (unsigned)_runLen, _runShaHex);
+}
+
+// new[i] = old[pos + i] + diff[i], reading the base in small blocks
+bool OtaUpdater::applyDiff(const uint8_t* data, size_t len) {
+  while (len > 0) {
+    const size_t n = min<size_t>(len, sizeof(_dBuf));
+    if (esp_partition_read(_dBase, _dOldPos, _dBuf, n) != ESP_OK) return fail("delta base read failed");
+    for (size_t i = 0; i < n; i++) _dBuf[i] = (uint8_t)(_dBuf[i] + data[i]);
+    if (!writeImage(_dBuf, n)) return false;
+    _dOldPos += n;
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+// Moves past finished (possibly empty) record sections without waiting for more input
+bool OtaUpdater::advanceDelta() {
+  if (_dStage == DeltaStage::Diff && _dDiffLeft == 0) _dStage = DeltaStage::Extra;
+  if (_dStage == DeltaStage::Extra && _dExtraLeft == 0) {
+    const int64_t pos = (int64_t)_dOldPos + _dSeek;
+    if (pos < 0 || pos > (int64_t)_dOldSize) return fail("delta seek out of range");
+    _dOldPos = (uint32_t)pos;
+    _dStage = (_written == _dNewSize) ? DeltaStage::Done : DeltaStage::Control;
+  }
+  return true;
+}
+
+bool OtaUpdater::feedDelta(const uint8_t* data, size_t len) {
+  while (len > 0 && _active) {
+    switch (_dStage) {
+      case DeltaStage::Header:
+      case DeltaStage::Control: {
+        const size_t need = (_dStage == DeltaStage::Header ? kDeltaHeaderLen : kDeltaControlLen) - _dPos;
+        const size_t n = min(need, len);
+        memcpy(_dHdr + _dPos, data, n);
+        _dPos += n;
+        data += n;
+        len -= n;
+        if (n < need) break;
+
+        if (_dStage == DeltaStage::Header) {
+          if (!startDelta()) return false;
+          break;
+        }
+
+        _dPos = 0;
+        _dDiffLeft = readLe32(_dHdr);
+        _dExtraLeft = readLe32(_dHdr + 4);
+        _dSeek = (int32_t)readLe32(_dHdr + 8);
+        if ((uint64_t)_dOldPos + _dDiffLeft > _dOldSize ||
+            (uint64_t)_written + _dDiffLeft + _dExtraLeft > _dNewSize) {
+          return fail("delta record out of range");
+        }
+        _dStage = DeltaStage::Diff;
+        if (!advanceDelta()) return false;
+        break;
+      }
+      case DeltaStage::Diff: {
+        const size_t n = min<size_t>(_dDiffLeft, len);
+        if (!applyDiff(data, n)) return false;
+        _dDiffLeft -= n;
+        data += n;
+        len -= n;
+        if (!advanceDelta()) return false;
+        break;
+      }
+      case DeltaStage::Extra: {
+        const size_t n = min<size_t>(_dExtraLeft, len);
+        if (!writeImage(data, n)) return false;
+        _dExtraLeft -= n;
+        data += n;
+        len -= n;
+        if (!advanceDelta()) return false;
+        break;
+      }
+      case DeltaStage::Done:
+        return fail("data after delta patch");
+    }
+  }
+  return _active;
+}
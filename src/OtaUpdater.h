@@ -0,0 +1,138 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+
+struct tinfl_decompressor_tag;
+
+// Streaming firmware writer in front of Update.
+// Accepts a raw app image or a gzip-compressed one (detected from the first byte),
+// inflates with a bounded 32 KB window, hashes everything written and only marks
+// the new partition bootable if the SHA-256 matches the expected digest.
+//
+// The (inflated) payload may also be a delta patch made by tools/make_delta.py.
+// It is applied against the running partition while streaming:
+//   header  "BBDELTA1", u32 oldSize, u32 newSize, oldSha256[32], newSha256[32]
+//   records u32 diffLen, u32 extraLen, i32 seek, diff[diffLen], extra[extraLen]
+// new = old[pos..] + diff (bytewise), then extra verbatim, then pos += seek.
+class OtaUpdater {
+public:
+  OtaUpdater();
+  ~OtaUpdater();
+
+  static constexpr const char* kUnverified = "unverified";
+
+  struct SessionStats {
+    const void* owner = nullptr;
+    uint32_t bytes = 0;   // received (compressed) bytes
+    uint32_t ms = 0;
+    bool     quiesced = false;
+    bool     ok = false;
+  };
+
+  // owner: identifies the session (upload request, puller); only one may be active.
+  //        Returns false without touching the running session if another owner holds it.
+  // expectedSha256Hex: 64 hex chars, required; kUnverified is the explicit opt-out
+  // sizeHint: expected upload size for progress (0 = unknown)
+  // quiesce: ask the loop task to pause background work for the session
+  bool begin(const void* owner, const char* expectedSha256Hex, uint32_t sizeHint = 0, bool quiesce = true);
+  bool write(const uint8_t* data, size_t len);
+  bool end();
+  void abort(const char* reason);
+
+  bool active() const { return _active; }
+  bool ownedBy(const void* owner) const { return owner && _owner.load() == owner; }
+  bool hasError() const { return _error[0] != 0; }
+  const char* error() const { return _error; }
+  bool compressed() const { return _format == Format::Gzip; }
+  bool delta() const { return _payload == Payload::Delta; }
+  uint32_t receivedBytes() const { return _received; }
+  uint32_t writtenBytes() const { return _written; }
+
+  // Read from the loop task while the web task writes
+  bool quiesced() const { return _quiesce.load(std::memory_order_relaxed); }
+  uint8_t progressPercent() const; // 0-100, 255 = unknown
+  const SessionStats& lastSession() const { return _last; }
+
+  // Peak heap needed for a session; raw images only need Update's own buffer.
+  static size_t workingSetBytes(bool gzip);
+
+  // Once at boot (setup): SHA-256 of the running image, the same digest as its
+  // .bin.ota.sha256 file. Shared by delta patches (base check) and PeerOta (TXT sha).
+  void hashRunningImage();
+  uint32_t runningImageLen() const { return _runLen; }  // 0 = digest unavailable
+  const char* runningImageSha() const { return _runShaHex; }
+
+private:
+  enum class Format : uint8_t { Unknown, Raw, Gzip };
+  enum class GzStage : uint8_t { Fixed, ExtraLen, ExtraData, Name, Comment, HeaderCrc, Deflate, Trailer, Done };
+  enum class Payload : uint8_t { Unknown, Image, Delta };
+  enum class DeltaStage : uint8_t { Header, Control, Diff, Extra, Done };
+
+  static const size_t kDeltaHeaderLen = 80;
+  static const size_t kDeltaControlLen = 12;
+
+  bool fail(const char* reason);
+  void finishSession(bool ok);
+  bool emit(const uint8_t* data, size_t len);
+  bool writeImage(const uint8_t* data, size_t len);
+
+  bool feedDelta(const uint8_t* data, size_t len);
+  bool startDelta();
+  bool applyDiff(const uint8_t* data, size_t len);
+  bool advanceDelta();
+
+  bool feedGzip(const uint8_t* data, size_t len);
+  size_t consumeGzipHeader(const uint8_t* data, size_t len);
+  GzStage nextHeaderStage(GzStage after) const;
+  bool allocInflater();
+  void freeInflater();
+
+  std::atomic<bool> _active{false};  // written by the session's task, read by the loop task
+  Format   _format = Format::Unknown;
+  char     _error[48] = {0};
+  uint8_t  _expected[32] = {0};
+  bool     _hasExpected = false;
+  uint32_t _received = 0;
+  uint32_t _written = 0;
+  mbedtls_sha256_context _sha;
+
+  std::atomic<const void*> _owner{nullptr};
+  std::atomic<bool> _quiesce{false};
+  uint32_t _sizeHint = 0;
+  uint32_t _startMs = 0;
+  SessionStats _last;
+
+  // gzip state
+  GzStage  _gzStage = GzStage::Fixed;
+  uint8_t  _gzFlags = 0;
+  uint16_t _gzPos = 0;
+  uint16_t _gzSkip = 0;
+  uint8_t  _gzTrailer[8] = {0};
+  uint32_t _crc = 0;
+  uint32_t _inflated = 0;
+  tinfl_decompressor_tag* _inflator = nullptr;
+  uint8_t* _dict = nullptr;
+  size_t   _dictOfs = 0;
+
+  // delta state
+  Payload  _payload = Payload::Unknown;
+  DeltaStage _dStage = DeltaStage::Header;
+  uint8_t  _dHdr[kDeltaHeaderLen] = {0};
+  size_t   _dPos = 0;
+  uint32_t _dOldSize = 0;
+  uint32_t _dNewSize = 0;
+  uint32_t _dOldPos = 0;
+  uint32_t _dDiffLeft = 0;
+  uint32_t _dExtraLeft = 0;
+  int32_t  _dSeek = 0;
+  const esp_partition_t* _dBase = nullptr;
+  uint8_t  _dBuf[256];
+
+  // running image
+  uint32_t _runLen = 0;
+  uint8_t  _runSha[32] = {0};
+  char     _runShaHex[65] = {0};
+};
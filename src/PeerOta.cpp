@@ -0,0 +1,318 @@
+#include "PeerOta.h"
+
+#include <WiFi.h>
+#include <ESPmDNS.h>
+#include <mdns.h>
+#include <esp_ota_ops.h>
+#include <esp_random.h>
+#include <mbedtls/sha256.h>
+#include "SettingsPrefs.h"
+#include "OtaUpdater.h"
+#include "OtaPuller.h"
+#include "WebSerial.h"
+
+extern Settings settings;
+extern OtaUpdater otaUpdater;
+extern OtaPuller otaPuller;
+
+#ifndef FW_HW
+#define FW_HW CONFIG_IDF_TARGET
+#endif
+
+namespace {
+
+// HMAC-SHA256 (RFC 2104) over the parts joined with '|'
+void hmacSha256(const uint8_t* key, size_t keyLen, const char* const* parts, size_t count, uint8_t out[32]) {
+  uint8_t k[64] = {0};
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  if (keyLen > sizeof(k)) {
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, key, keyLen);
+    mbedtls_sha256_finish(&ctx, k);
+  } else {
+    memcpy(k, key, keyLen);
+  }
+
+  uint8_t pad[64];
+  for (size_t i = 0; i < sizeof(pad); i++) pad[i] = k[i] ^ 0x36;
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, pad, sizeof(pad));
+  for (size_t i = 0; i < count; i++) {
+    if (i) mbedtls_sha256_update(&ctx, reinterpret_cast<const uint8_t*>("|"), 1);
+    mbedtls_sha256_update(&ctx, reinterpret_cast<const uint8_t*>(parts[i]), strlen(parts[i]));
+  }
+  uint8_t inner[32];
+  mbedtls_sha256_finish(&ctx, inner);
+
+  for (size_t i = 0; i < sizeof(pad); i++) pad[i] = k[i] ^ 0x5c;
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, pad, sizeof(pad));
+  mbedtls_sha256_update(&ctx, inner, sizeof(inner));
+  mbedtls_sha256_finish(&ctx, out);
+  mbedtls_sha256_free(&ctx);
+}
+
+// Compares all 64 characters whatever the first mismatch
+bool sameHex64(const char* a, const char* b) {
+  if (strlen(a) != 64 || strlen(b) != 64) return false;
+  uint8_t diff = 0;
+  for (size_t i = 0; i < 64; i++) diff |= (uint8_t)(a[i] ^ b[i]);
+  return diff == 0;
+}
+
+}  // namespace
+
+void PeerOta::begin() {
+  _nextCheckMs = millis() + kFirstCheckMs + (esp_random() % 60000UL);
+
+  MDNS.addService("bambubeacon", "tcp", 80);
+  _announced = true;
+  updateTxt(true);
+}
+
+bool PeerOta::enabled() const {
+  return settings.get.otaP2P() && imageReady();
+}
+
+bool PeerOta::imageReady() const { return otaUpdater.runningImageLen() != 0; }
+uint32_t PeerOta::imageLen() const { return otaUpdater.runningImageLen(); }
+const char* PeerOta::imageSha() const { return otaUpdater.runningImageSha(); }
+
+// Short keys are refused: the mac is public and would allow an offline guess
+bool PeerOta::hasFleetKey() const {
+  const char* key = settings.get.otaFleetKey();
+  return key && strlen(key) >= kMinFleetKeyLen;
+}
+
+bool PeerOta::fleetMac(const char* use, const char* fw, const char* sha, char out[65]) const {
+  out[0] = 0;
+  if (!hasFleetKey()) return false;
+  const char* key = settings.get.otaFleetKey();
+  const char* parts[] = { "bambubeacon-p2p", use, FW_HW, fw, sha };
+  uint8_t mac[32];
+  hmacSha256(reinterpret_cast<const uint8_t*>(key), strlen(key), parts, sizeof(parts) / sizeof(parts[0]), mac);
+  for (size_t i = 0; i < sizeof(mac); i++) snprintf(out + i * 2, 3, "%02x", mac[i]);
+  return true;
+}
+
+void PeerOta::updateTxt(bool force) {
+  if (!_announced) return;
+  const uint32_t now = millis();
+  bool changed = force;
+
+  if (force || now - _lastTxtMs >= kTxtRefreshMs) {
+    _lastTxtMs = now;
+    const int8_t rssi = (WiFi.status() == WL_CONNECTED) ? (int8_t)WiFi.RSSI() : -127;
+    if (force || abs(rssi - _txtRssi) >= 3) {
+      _txtRssi = rssi;
+      changed = true;
+    }
+    if (enabled() != _txtP2p || hasFleetKey() != _txtKey) {
+      _txtP2p = enabled();
+      _txtKey = hasFleetKey();
+      changed = true;
+    }
+    const char* usn = settings.get.printerUSN();
+    if (strcmp(usn ? usn : "", _txtUsn) != 0) {
+      strlcpy(_txtUsn, usn ? usn : "", sizeof(_txtUsn));
+      changed = true;
+    }
+  }
+  if (!(_status == _txtStatus) && (force || now - _lastStatusMs >= kStatusMinMs)) {
+    _lastStatusMs = now;
+    _txtStatus = _status;
+    changed = true;
+  }
+  if (!changed) return;
+
+  // The whole record in one call: one announcement per change, not per key.
+  // No mac while P2P is off: nothing to verify, so nothing to publish.
+  char rssi[5], prog[4], hms[2], mac[65];
+  if (!_txtP2p || !fleetMac("image", STRVERSION, imageSha(), mac)) mac[0] = 0;
+  snprintf(rssi, sizeof(rssi), "%d", _txtRssi);
+  if (_txtStatus.progress <= 100) snprintf(prog, sizeof(prog), "%u", _txtStatus.progress);
+  else prog[0] = 0;
+  snprintf(hms, sizeof(hms), "%u", _txtStatus.hms < 10 ? _txtStatus.hms : 9);
+  mdns_txt_item_t txt[] = {
+    { "fw",    STRVERSION },
+    { "hw",    FW_HW },
+    { "sha",   imageSha() },
+    { "rssi",  rssi },
+    { "p2p",   _txtP2p ? "1" : "0" },
+    { "usn",   _txtUsn },
+    { "pc",    _txtStatus.connected ? "1" : "0" },
+    { "state", _txtStatus.state },
+    { "prog",  prog },
+    { "hms",   hms },
+    { "mac",   mac },  // last: left out when empty
+  };
+  const size_t count = sizeof(txt) / sizeof(txt[0]) - (mac[0] ? 0 : 1);
+  mdns_service_txt_set("_bambubeacon", "_tcp", txt, count);
+}
+
+void PeerOta::setStatus(const PrinterState& ps) {
+  Status st;
+  st.connected = ps.connected;
+  strlcpy(st.state, ps.gcodeState, sizeof(st.state));
+  st.progress = ps.printProgress;
+  st.hms = ps.hmsTop;
+  _status = st;
+}
+
+void PeerOta::loop() {
+  updateTxt(false);
+
+  if (!enabled() || WiFi.status() != WL_CONNECTED) return;
+  const uint32_t now = millis();
+  if ((int32_t)(now - _nextCheckMs) < 0) return;
+  _nextCheckMs = now + kCheckIntervalMs + (esp_random() % 300000UL);
+
+  if (!hasFleetKey()) {
+    if (!_keyWarned) webSerial.println("[P2P] Auto-update needs a fleet key, skipped");
+    _keyWarned = true;
+    return;
+  }
+  if (otaPuller.busy() || otaUpdater.active()) return;
+  otaPuller.startPeer(String(), settings.get.otaRateKBps());
+}
+
+int PeerOta::compareVersions(const char* a, const char* b) {
+  for (int i = 0; i < 4; i++) {
+    const long va = a ? strtol(a, const_cast<char**>(&a), 10) : 0;
+    const long vb = b ? strtol(b, const_cast<char**>(&b), 10) : 0;
+    if (va != vb) return va < vb ? -1 : 1;
+    if (a && *a == '.') a++;
+    if (b && *b == '.') b++;
+  }
+  return 0;
+}
+
+bool PeerOta::pickPeer(const String& wantSha, Peer& out) {
+  // A sha the user asked for is trusted as given; a newer version only with its mac
+  if (!wantSha.length() && !hasFleetKey()) return false;
+  const int n = MDNS.queryService("bambubeacon", "tcp");
+  if (n <= 0) return false;
+
+  Peer cands[kMaxProbes];
+  uint8_t count = 0;
+  for (int i = 0; i < n; i++) {
+    if (MDNS.txt(i, "hw") != FW_HW || MDNS.txt(i, "p2p") != "1") continue;
+    const String sha = MDNS.txt(i, "sha");
+    const String fw = MDNS.txt(i, "fw");
+    if (sha.length() != 64 || sha == imageSha()) continue;
+    if (wantSha.length() ? (sha != wantSha) : (compareVersions(fw.c_str(), STRVERSION) <= 0)) continue;
+    if (!wantSha.length()) {
+      char mac[65];
+      fleetMac("image", fw.c_str(), sha.c_str(), mac);
+      if (!sameHex64(MDNS.txt(i, "mac").c_str(), mac)) {
+        webSerial.printf("[P2P] Ignoring %s v%s: not signed with our fleet key\n",
+                         MDNS.address(i).toString().c_str(), fw.c_str());
+        continue;
+      }
+    }
+
+    Peer p;
+    p.ip = MDNS.address(i);
+    p.port = MDNS.port(i);
+    p.rssi = (int8_t)constrain(MDNS.txt(i, "rssi").toInt(), -127L, 0L);
+    strlcpy(p.version, fw.c_str(), sizeof(p.version));
+    strlcpy(p.sha, sha.c_str(), sizeof(p.sha));
+
+    // Without a wanted sha only the newest version counts
+    if (count && !wantSha.length()) {
+      const int cmp = compareVersions(p.version, cands[0].version);
+      if (cmp < 0) continue;
+      if (cmp > 0) count = 0;
+    }
+
+    // Keep the kMaxProbes strongest (best link to the AP)
+    if (count < kMaxProbes) {
+      cands[count++] = p;
+    } else {
+      uint8_t weakest = 0;
+      for (uint8_t k = 1; k < count; k++) if (cands[k].rssi < cands[weakest].rssi) weakest = k;
+      if (p.rssi > cands[weakest].rssi) cands[weakest] = p;
+    }
+  }
+  if (!count) return false;
+
+  // Nearest = fastest TCP connect; RSSI breaks ties and covers failed probes
+  int best = -1;
+  for (uint8_t k = 0; k < count; k++) {
+    WiFiClient c;
+    const uint32_t t0 = millis();
+    if (c.connect(cands[k].ip, cands[k].port, 1000)) {
+      cands[k].connectMs = (uint16_t)min<uint32_t>(millis() - t0, 0xFFFE);
+      c.stop();
+    }
+    webSerial.printf("[P2P] Peer %s v%s rssi=%d connect=%u ms\n", cands[k].ip.toString().c_str(),
+                     cands[k].version, cands[k].rssi, (unsigned)cands[k].connectMs);
+    if (best < 0 || cands[k].connectMs < cands[best].connectMs ||
+        (cands[k].connectMs == cands[best].connectMs && cands[k].rssi > cands[best].rssi)) {
+      best = k;
+    }
+  }
+  if (cands[best].connectMs == 0xFFFF) return false;
+  out = cands[best];
+  return true;
+}
+
+void PeerOta::serveImage(AsyncWebServerRequest* req) {
+  if (!enabled()) {
+    req->send(404, "text/plain", "Not found");
+    return;
+  }
+
+  const uint32_t size = imageLen();
+  uint32_t start = 0;
+  uint32_t end = size - 1;
+  bool partial = false;
+  if (req->hasHeader("Range")) {
+    const String r = req->getHeader("Range")->value();
+    const AsyncWebHeader* ifRange = req->getHeader("If-Range");
+    const bool etagOk = !ifRange || ifRange->value() == String("\"") + imageSha() + "\"";
+    if (etagOk && r.startsWith("bytes=")) {
+      // "a-", "a-b" or the suffix form "-n" (last n bytes); anything else is 416
+      const char* spec = r.c_str() + 6;
+      const char* dash = strchr(spec, '-');
+      char* stop = nullptr;
+      bool ok = dash && !strchr(dash + 1, ',');
+      if (ok && dash == spec) {
+        const unsigned long n = strtoul(dash + 1, &stop, 10);
+        ok = isdigit((unsigned char)dash[1]) && *stop == 0 && n > 0;
+        if (ok) start = n >= size ? 0 : size - (uint32_t)n;
+      } else if (ok) {
+        start = (uint32_t)strtoul(spec, &stop, 10);
+        ok = isdigit((unsigned char)*spec) && stop == dash;
+        if (ok && dash[1]) {
+          const unsigned long last = strtoul(dash + 1, &stop, 10);
+          ok = isdigit((unsigned char)dash[1]) && *stop == 0 && last >= start;
+          if (ok) end = min<uint32_t>((uint32_t)min<unsigned long>(last, 0xFFFFFFFFUL), end);
+        }
+      }
+      if (!ok || start > end) {
+        AsyncWebServerResponse* res = req->beginResponse(416, "text/plain", "Range Not Satisfiable");
+        res->addHeader("Content-Range", String("bytes */") + size);
+        req->send(res);
+        return;
+      }
+      partial = true;
+    }
+  }
+
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  const uint32_t len = end - start + 1;
+  AsyncWebServerResponse* res = req->beginResponse("application/octet-stream", len,
+    [running, start, len](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+      if (index >= len) return 0;
+      const size_t n = min<size_t>(maxLen, len - index);
+      if (esp_partition_read(running, start + index, buf, n) != ESP_OK) return 0;
+      return n;
+    });
+  res->setCode(partial ? 206 : 200);
+  res->addHeader("Accept-Ranges", "bytes");
+  res->addHeader("ETag", String("\"") + imageSha() + "\"");
+  if (partial) res->addHeader("Content-Range", String("bytes ") + start + "-" + end + "/" + size);
+  req->send(res);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <ESPAsyncWebServer.h>
+#include "PrinterState.h"
+
+// Peer-to-peer firmware distribution (opt-in via settings ota/otaP2P).
+// Every beacon announces _bambubeacon._tcp with TXT fw/hw/sha/rssi/p2p and
+// its live printer status (usn/pc/state/prog/hms, see setStatus), so one
+// mDNS browse shows the whole fleet (tools/fleet_browse.py).
+// With P2P enabled it serves its running image at /firmware.bin (Range, ETag = sha),
+// and periodically looks for a peer with the same hw tag running a newer version,
+// which it then pulls through otaPuller (the peer's sha is enforced by otaUpdater).
+//
+// Trust: the fleet key (ota/otaFleetKey) is a random secret generated in the
+// web UI and copied to every beacon of the fleet; it is never derived from the
+// login. TXT "mac" is an HMAC-SHA256 over hw/fw/sha of the announcing beacon's
+// image and is only published while P2P is on, and auto-update only takes a
+// peer whose mac checks out, so a LAN host without the key cannot push an
+// image. Without a key (or one shorter than kMinFleetKeyLen) auto-update stays off.
+// /firmware.bin needs no login: the image is the public release build, and the
+// puller checks what it receives against the sha from the verified mac.
+class PeerOta {
+public:
+  static const size_t kMinFleetKeyLen = 32;
+
+  struct Peer {
+    IPAddress ip;
+    uint16_t  port = 80;
+    int8_t    rssi = -127;
+    uint16_t  connectMs = 0xFFFF;
+    char      version[16] = {0};
+    char      sha[65] = {0};
+  };
+
+  // After MDNS.begin (wifiManager.begin)
+  void begin();
+  // Loop task: TXT refresh and the periodic auto-update check
+  void loop();
+  // Loop task: printer status for the TXT record; republished on change,
+  // at most every kStatusMinMs
+  void setStatus(const PrinterState& ps);
+
+  bool enabled() const;
+  // The running image as hashed by otaUpdater at boot
+  bool imageReady() const;
+  uint32_t imageLen() const;
+  const char* imageSha() const;
+
+  // GET /firmware.bin with optional "Range: bytes=a-[b]"
+  void serveImage(AsyncWebServerRequest* req);
+
+  bool hasFleetKey() const;
+
+  // Blocking mDNS browse + connect probe; call from a background task only.
+  // wantSha empty: newest version above ours. Returns false if nothing suitable.
+  bool pickPeer(const String& wantSha, Peer& out);
+
+  static int compareVersions(const char* a, const char* b);
+
+private:
+  void updateTxt(bool force);
+  bool fleetMac(const char* use, const char* fw, const char* sha, char out[65]) const;
+
+  static const uint32_t kTxtRefreshMs = 60000UL;
+  static const uint32_t kStatusMinMs = 5000UL;
+  static const uint32_t kFirstCheckMs = 2UL * 60UL * 1000UL;
+  static const uint32_t kCheckIntervalMs = 15UL * 60UL * 1000UL;
+  static const uint8_t  kMaxProbes = 3;
+
+  bool     _announced = false;
+  int8_t   _txtRssi = 0;
+  bool     _txtP2p = false;
+  bool     _txtKey = false;
+  char     _txtUsn[32] = {0};
+  uint32_t _lastTxtMs = 0;
+
+  // Status as last published / as last seen
+  struct Status {
+    bool    connected = false;
+    char    state[16] = {0};
+    uint8_t progress = 255;
+    uint8_t hms = 0;
+    bool operator==(const Status& o) const {
+      return connected == o.connected && progress == o.progress && hms == o.hms && !strcmp(state, o.state);
+    }
+  };
+  Status   _txtStatus;
+  Status   _status;
+  uint32_t _lastStatusMs = 0;
+  uint32_t _nextCheckMs = 0;
+  bool     _keyWarned = false;
+};
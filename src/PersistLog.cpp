@@ -0,0 +1,323 @@
+#include "PersistLog.h"
+
+#include <LittleFS.h>
+#include <cstddef>
+#include <esp_rom_crc.h>
+#include <esp_system.h>
+#include <memory>
+#include "OtaUpdater.h"
+#include "TaskStats.h"
+#include "WebSerial.h"
+
+extern OtaUpdater otaUpdater;
+
+namespace {
+const char* const kDir = "/logs";
+const uint8_t kMaxListed = 8;
+
+struct LogCursor {
+  uint32_t segs[kMaxListed];
+  uint8_t  count = 0;
+  uint8_t  idx = 0;
+  uint32_t off = 0;
+  char     text[320];
+  size_t   textLen = 0;
+  size_t   textOff = 0;
+};
+}
+
+uint32_t PersistLog::crcRecord(const RecHdr& h, const uint8_t* payload) {
+  const uint32_t c = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&h), offsetof(RecHdr, crc));
+  return esp_rom_crc32_le(c, payload, h.len);
+}
+
+// Reads the next valid record at or after the file position. Garbage (torn
+// writes, sub-header filler from older firmware) is skipped by scanning for
+// the next magic. Pad records are skipped unread. Returns false at end of file.
+bool PersistLog::readRecord(File& f, RecHdr& h, uint8_t* payload, size_t cap) {
+  while (true) {
+    const size_t pos = f.position();
+    if (f.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) != sizeof(h)) return false;
+    if (h.magic == kMagic && h.len <= kBlock - sizeof(h)) {
+      if (h.type == kTypePad) return f.seek(pos + sizeof(h) + h.len);
+      if (h.len <= cap && f.read(payload, h.len) == h.len && crcRecord(h, payload) == h.crc) return true;
+    }
+
+    uint8_t win[64];
+    size_t from = pos + 1;
+    while (true) {
+      if (!f.seek(from)) return false;
+      const size_t n = f.read(win, sizeof(win));
+      if (n < 2) return false;
+      size_t i = 0;
+      while (i + 1 < n && !(win[i] == (kMagic & 0xFF) && win[i + 1] == (kMagic >> 8))) i++;
+      if (i + 1 < n) { from += i; break; }
+      from += n - 1;
+    }
+    f.seek(from);
+  }
+}
+
+void PersistLog::segmentPath(uint32_t seq, char* out, size_t cap) {
+  snprintf(out, cap, "%s/%08lu.log", kDir, (unsigned long)seq);
+}
+
+// Ascending; keeps the newest cap entries if there are more
+uint8_t PersistLog::listSegments(uint32_t* out, uint8_t cap) {
+  uint8_t n = 0;
+  File dir = LittleFS.open(kDir);
+  if (!dir || !dir.isDirectory()) return 0;
+  for (File e = dir.openNextFile(); e; e = dir.openNextFile()) {
+    const char* name = strrchr(e.name(), '/');
+    name = name ? name + 1 : e.name();
+    char* end = nullptr;
+    const uint32_t seq = strtoul(name, &end, 10);
+    if (end == name || strcmp(end, ".log") != 0) continue;
+    if (n < cap) {
+      out[n++] = seq;
+    } else {
+      uint8_t minIdx = 0;
+      for (uint8_t i = 1; i < n; i++) if (out[i] < out[minIdx]) minIdx = i;
+      if (seq > out[minIdx]) out[minIdx] = seq;
+    }
+  }
+  for (uint8_t i = 1; i < n; i++) {
+    const uint32_t v = out[i];
+    uint8_t j = i;
+    while (j > 0 && out[j - 1] > v) { out[j] = out[j - 1]; j--; }
+    out[j] = v;
+  }
+  return n;
+}
+
+bool PersistLog::begin() {
+  _lock = xSemaphoreCreateMutex();
+  if (!_lock) return false;
+
+  if (!LittleFS.begin(true)) {
+    webSerial.println("[LOGFS] LittleFS mount failed, persistent log off");
+    return false;
+  }
+  if (!LittleFS.exists(kDir)) LittleFS.mkdir(kDir);
+
+  uint32_t segs[kMaxListed];
+  const uint8_t n = listSegments(segs, kMaxListed);
+  _segSeq = n ? segs[n - 1] : 1;
+  _boot = scanLastBoot() + 1;
+  _mounted = true;
+
+  taskStats.noteStackSize("logfs", kStackSize);
+  if (xTaskCreate(&PersistLog::taskEntry, "logfs", kStackSize, this, kPriority, &_task) != pdPASS) {
+    _mounted = false;
+    return false;
+  }
+  webSerial.printf("[LOGFS] boot %u, %u segment(s), reset reason %d\n", _boot, n, (int)esp_reset_reason());
+  return true;
+}
+
+uint16_t PersistLog::scanLastBoot() {
+  char path[24];
+  segmentPath(_segSeq, path, sizeof(path));
+  File f = LittleFS.open(path, FILE_READ);
+  if (!f) return 0;
+  uint16_t last = 0;
+  RecHdr h;
+  uint8_t payload[kMaxLine];  // line records only; pad records are skipped unread
+  while (readRecord(f, h, payload, sizeof(payload))) last = h.boot;
+  f.close();
+  return last;
+}
+
+void PersistLog::append(const uint8_t* data, size_t len) {
+  if (!_mounted) return;
+  for (size_t i = 0; i < len; i++) {
+    const char c = (char)data[i];
+    if (c == '\r') continue;
+    if (c == '\n') {
+      frameLine();
+      continue;
+    }
+    _line[_lineLen++] = c;
+    if (_lineLen == kMaxLine) frameLine();
+  }
+}
+
+void PersistLog::frameLine() {
+  if (!_lineLen) return;
+  const size_t need = sizeof(RecHdr) + _lineLen;
+  if (_fill + need > kBlock && !seal()) {
+    // Writer still busy: keep the batch, lose the newest line
+    _stats.droppedLines++;
+    _lineLen = 0;
+    return;
+  }
+
+  RecHdr h;
+  h.magic = kMagic;
+  h.len = (uint16_t)_lineLen;
+  h.boot = _boot;
+  h.type = kTypeLine;
+  h.ms = millis();
+  h.crc = crcRecord(h, reinterpret_cast<const uint8_t*>(_line));
+  if (_fill == 0) _batchSinceMs = h.ms;
+  memcpy(_active + _fill, &h, sizeof(h));
+  memcpy(_active + _fill + sizeof(h), _line, _lineLen);
+  _fill += need;
+  _blockLines++;
+  _stats.lines++;
+  _lineLen = 0;
+}
+
+// Hands the batch to the writer; false while the writer still owns the other buffer
+bool PersistLog::seal() {
+  if (!_fill) return true;
+  if (_busy) return false;
+  _sealed = _active;
+  _sealedLen = _fill;
+  _sealedLines = _blockLines;
+  _active = (_active == _bufA) ? _bufB : _bufA;
+  _busy = true;
+  xTaskNotifyGive(_task);
+  _fill = 0;
+  _blockLines = 0;
+  return true;
+}
+
+void PersistLog::loop() {
+  if (!_mounted || !_fill || _busy) return;
+  if (blockFull() || millis() - _batchSinceMs >= kMaxBatchAgeMs) seal();
+}
+
+void PersistLog::taskEntry(void* arg) {
+  static_cast<PersistLog*>(arg)->writerLoop();
+}
+
+void PersistLog::writerLoop() {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    // Flash writes stall both cores' caches; never compete with an OTA session
+    while (otaUpdater.active()) vTaskDelay(pdMS_TO_TICKS(500));
+    if (!writeBlock(_sealed, _sealedLen)) _stats.droppedLines += _sealedLines;
+    vTaskDelay(pdMS_TO_TICKS(kMinWriteIntervalMs));
+    _sealed = nullptr;
+    _busy = false;
+  }
+}
+
+bool PersistLog::writeBlock(const uint8_t* block, size_t len) {
+  if (xSemaphoreTake(_lock, pdMS_TO_TICKS(1000)) != pdTRUE) return false;
+  const uint32_t t0 = millis();
+
+  char path[24];
+  segmentPath(_segSeq, path, sizeof(path));
+  File f = LittleFS.open(path, FILE_APPEND);
+  if (f && f.size() + len > kSegmentBytes) {
+    f.close();
+    _segSeq++;
+    uint32_t segs[kMaxListed];
+    uint8_t n = listSegments(segs, kMaxListed);
+    for (uint8_t i = 0; n >= kSegments; i++, n--) {
+      segmentPath(segs[i], path, sizeof(path));
+      LittleFS.remove(path);
+    }
+    segmentPath(_segSeq, path, sizeof(path));
+    f = LittleFS.open(path, FILE_APPEND);
+  }
+  const bool ok = f && f.write(block, len) == len;
+  if (f) f.close();
+
+  // Under the lock: the writer task and flush() both get here
+  const uint32_t ms = millis() - t0;
+  _stats.lastWriteMs = ms;
+  if (ms > _stats.maxWriteMs) _stats.maxWriteMs = ms;
+  if (ok) _stats.blocks++;
+  xSemaphoreGive(_lock);
+  return ok;
+}
+
+// _active belongs to the loop task and the writer only touches _sealed, so
+// the batch is written here directly; _lock orders it after a running append.
+void PersistLog::flush() {
+  if (!_mounted) return;
+  frameLine();
+  if (!_fill) return;
+  if (!writeBlock(_active, _fill)) _stats.droppedLines += _blockLines;
+  _fill = 0;
+  _blockLines = 0;
+}
+
+PersistLog::Stats PersistLog::stats() const {
+  Stats s = _stats;
+  s.mounted = _mounted;
+  s.boot = _boot;
+  return s;
+}
+
+void PersistLog::serve(AsyncWebServerRequest* req) {
+  if (!_mounted) {
+    req->send(503, "text/plain", "persistent log unavailable");
+    return;
+  }
+
+  std::shared_ptr<LogCursor> c = std::make_shared<LogCursor>();
+  if (xSemaphoreTake(_lock, pdMS_TO_TICKS(200)) == pdTRUE) {
+    c->count = listSegments(c->segs, kMaxListed);
+    xSemaphoreGive(_lock);
+  }
+  c->textLen = snprintf(c->text, sizeof(c->text),
+                        "# BambuBeacon persistent log: boot %u, %u segment(s); up to %lu s of recent lines are still in RAM\n",
+                        _boot, c->count, (unsigned long)(kMaxBatchAgeMs / 1000UL));
+
+  AsyncWebServerResponse* res = req->beginChunkedResponse("text/plain",
+    [this, c](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+      (void)index;
+      // The writer holds the lock for the length of one block append
+      if (xSemaphoreTake(_lock, 0) != pdTRUE) return RESPONSE_TRY_AGAIN;
+
+      size_t n = 0;
+      File f;
+      uint8_t payload[kMaxLine];
+      while (n < maxLen) {
+        if (c->textOff < c->textLen) {
+          const size_t k = min(maxLen - n, c->textLen - c->textOff);
+          memcpy(buf + n, c->text + c->textOff, k);
+          n += k;
+          c->textOff += k;
+          continue;
+        }
+        if (c->idx >= c->count) break;
+
+        if (!f) {
+          char path[24];
+          segmentPath(c->segs[c->idx], path, sizeof(path));
+          f = LittleFS.open(path, FILE_READ);
+          if (!f || !f.seek(c->off)) {
+            if (f) f.close();
+            c->idx++;
+            c->off = 0;
+            continue;
+          }
+        }
+
+        RecHdr h;
+        if (!readRecord(f, h, payload, sizeof(payload))) {
+          f.close();
+          c->idx++;
+          c->off = 0;
+          continue;
+        }
+        c->off = f.position();
+        if (h.type != kTypeLine) continue;
+        c->textOff = 0;
+        c->textLen = snprintf(c->text, sizeof(c->text), "[b%u %lu.%03lu] %.*s\n",
+                              h.boot, (unsigned long)(h.ms / 1000UL), (unsigned long)(h.ms % 1000UL),
+                              (int)h.len, reinterpret_cast<const char*>(payload));
+        if (c->textLen >= sizeof(c->text)) c->textLen = sizeof(c->text) - 1;
+      }
+      if (f) f.close();
+      xSemaphoreGive(_lock);
+      return n;
+    });
+  res->addHeader("Cache-Control", "no-store");
+  req->send(res);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+// Crash-safe log ring on LittleFS (the "spiffs" partition of partitions.csv).
+//
+// Every line written to webSerial is framed as a CRC32-protected record and
+// batched in RAM into blocks of up to 4 KB. A batch is sealed when the next
+// line does not fit or once it is kMaxBatchAgeMs old, and appended as is (no
+// padding) to the newest segment file by a low-priority writer task.
+// Segments rotate (oldest deleted); LittleFS does the wear levelling.
+// A torn record from a brownout fails its CRC and is skipped when reading.
+//
+// Rate limit: at most one block per kMinWriteIntervalMs. While the writer is
+// busy (or an OTA is running) the batch keeps collecting; lines that no
+// longer fit are dropped and counted, the older ones are kept.
+class PersistLog {
+public:
+  struct Stats {
+    bool     mounted = false;
+    uint16_t boot = 0;
+    uint32_t lines = 0;         // framed into a batch
+    uint32_t droppedLines = 0;  // not written (batch full while the writer is busy / FS error)
+    uint32_t blocks = 0;        // blocks appended to flash
+    uint32_t lastWriteMs = 0;   // duration of the last block append
+    uint32_t maxWriteMs = 0;    // worst block append since boot
+  };
+
+  // Mounts LittleFS (formats it on first use) and starts the writer task
+  bool begin();
+  // Loop task only: raw webSerial output (see WebSerialClass::setTap)
+  void append(const uint8_t* data, size_t len);
+  // Loop task: seals a batch once it is kMaxBatchAgeMs old, or full, when the writer is free
+  void loop();
+
+  Stats stats() const;
+  bool enabled() const { return _mounted; }
+
+  // GET /logs: all segments oldest first as text, "[b<boot> <sec>.<ms>] line"
+  void serve(AsyncWebServerRequest* req);
+
+  // Loop task only, before a restart (RestartScheduler): writes the pending
+  // batch synchronously, even within the rate limit
+  void flush();
+
+private:
+  struct RecHdr {
+    uint16_t magic;
+    uint16_t len;   // payload bytes
+    uint16_t boot;
+    uint16_t type;  // kTypeLine / kTypePad
+    uint32_t ms;    // millis() when framed
+    uint32_t crc;   // CRC32 over the first 12 header bytes and the payload
+  };
+
+  static const uint16_t kMagic = 0xB10C;
+  static const uint16_t kTypeLine = 0;
+  static const uint16_t kTypePad = 1;   // sector filler written by older firmware
+  static const size_t   kBlock = 4096;
+  static const size_t   kMaxLine = 240;
+  static const uint32_t kSegmentBytes = 16UL * 1024UL;
+  static const uint8_t  kSegments = 4;             // 64 KB of the 128 KB partition
+  static const uint32_t kMaxBatchAgeMs = 5UL * 60UL * 1000UL;
+  static const uint32_t kMinWriteIntervalMs = 10000UL;
+  static const uint32_t kStackSize = 4096;
+  static const UBaseType_t kPriority = 1;
+
+  static void taskEntry(void* arg);
+  void writerLoop();
+  bool writeBlock(const uint8_t* block, size_t len);
+  void frameLine();
+  bool seal();
+  bool blockFull() const { return _fill + sizeof(RecHdr) + kMaxLine > kBlock; }
+  uint16_t scanLastBoot();
+  static void segmentPath(uint32_t seq, char* out, size_t cap);
+  static uint8_t listSegments(uint32_t* out, uint8_t cap);
+  static uint32_t crcRecord(const RecHdr& h, const uint8_t* payload);
+  static bool readRecord(fs::File& f, RecHdr& h, uint8_t* payload, size_t cap);
+
+  bool _mounted = false;
+  uint16_t _boot = 1;
+  uint32_t _segSeq = 0;
+  TaskHandle_t _task = nullptr;
+  SemaphoreHandle_t _lock = nullptr;  // guards file access (writer vs. /logs reader)
+
+  // Double buffer: the loop task fills _active, the writer owns _sealed while _busy
+  alignas(4) uint8_t _bufA[kBlock];
+  alignas(4) uint8_t _bufB[kBlock];
+  uint8_t* _active = _bufA;
+  uint8_t* _sealed = nullptr;
+  size_t   _sealedLen = 0;
+  volatile bool _busy = false;
+  size_t   _fill = 0;
+  uint16_t _blockLines = 0;
+  uint16_t _sealedLines = 0;
+  uint32_t _batchSinceMs = 0;
+
+  char   _line[kMaxLine];
+  size_t _lineLen = 0;
+
+  Stats _stats;
+};
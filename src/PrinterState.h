@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Compact, copyable snapshot of the parsed printer report.
+// Written by the loop task (BambuMqttClient), read by other tasks (web handlers)
+// via BambuMqttClient::snapshot(), so it must stay plain data (no String).
+struct PrinterState {
+  static const uint8_t kMaxHms = 8;
+
+  struct Hms {
+    uint64_t full = 0;
+    uint8_t  severity = 0; // BambuMqttClient::Severity
+  };
+
+  bool     connected = false;
+  char     gcodeState[16] = {0};
+  uint8_t  printProgress = 255;    // 0-100, 255 = unknown
+  uint8_t  downloadProgress = 255; // 0-100, 255 = unknown
+  uint16_t remainingMin = 0xFFFF;  // minutes, 0xFFFF = unknown
+  float    bedTemp = 0.0f;
+  float    bedTarget = 0.0f;
+  bool     bedValid = false;
+  float    nozzleTemp = 0.0f;
+  float    nozzleTarget = 0.0f;
+  bool     nozzleValid = false;
+  bool     nozzleHeating = false;
+
+  uint8_t  hmsTop = 0;   // BambuMqttClient::Severity
+  uint8_t  hmsCount = 0; // active events, may exceed kMaxHms
+  Hms      hms[kMaxHms];
+
+  uint32_t lastReportMs = 0;
+};
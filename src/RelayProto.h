@@ -0,0 +1,484 @@
+#pragma once
+
+// Beacon-to-beacon state relay: wire format and election, free of Arduino
+// dependencies so the same code runs on the beacon (BeaconLink) and in the
+// host test (tools/relay_loopback.cpp).
+//
+// Beacons configured for the same printer (group = hash of the USN) share one
+// printer MQTT session: the elected leader multicasts the parsed state, the
+// others follow. Every packet is
+//   Hdr (20 B) | body | tag (8 B, SipHash-2-4 keyed with the access code)
+// Key frames carry the full state and double as the leader heartbeat (every
+// kKeyMs); deltas carry only the changed fields and apply only on seq + 1,
+// otherwise the follower waits for the next key frame.
+//
+// Election: a beacon that hears no leader for kLeaderTimeoutMs claims for
+// kClaimMs and becomes leader unless a higher-ranked claim or any leader shows
+// up. Rank = (printer session up, node id); of two leaders the lower one yields.
+// Fresh beacons listen first, so a reboot never takes over a running leader.
+// A leader whose own printer session stays down for kLeaderDownMs steps down
+// and sits out kStepDownHoldMs, so another beacon gets to try the printer.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+
+namespace relay {
+
+static const uint32_t kMagic = 0x31524242UL;  // "BBR1"
+static const uint16_t kPort = 47311;
+static const uint8_t  kGroupAddr[4] = { 239, 255, 47, 11 };
+
+static const uint32_t kKeyMs = 1000;
+static const uint32_t kMinDeltaMs = 100;
+static const uint32_t kLeaderTimeoutMs = 3500;
+static const uint32_t kClaimMs = 1500;
+static const uint32_t kClaimRepeatMs = 300;
+static const uint32_t kLeaderDownMs = 20000;
+static const uint32_t kStepDownHoldMs = kLeaderTimeoutMs + 2 * kClaimMs + 3000;
+
+static const size_t kMaxHms = 8;
+static const size_t kMaxPacket = 192;
+static const size_t kTagLen = 8;
+
+enum class Type : uint8_t { Claim = 1, Key = 2, Delta = 3 };
+enum class Role : uint8_t { Listening, Candidate, Follower, Leader };
+
+inline const char* roleName(Role r) {
+  switch (r) {
+    case Role::Candidate: return "candidate";
+    case Role::Follower:  return "follower";
+    case Role::Leader:    return "leader";
+    default:              return "listening";
+  }
+}
+
+// Header flags
+static const uint8_t kFlagPrinterUp = 0x01;
+
+// Wire::flags
+static const uint8_t kStConnected = 0x01;
+static const uint8_t kStBedValid = 0x02;
+static const uint8_t kStNozzleValid = 0x04;
+static const uint8_t kStNozzleHeating = 0x08;
+
+// Quantized printer state as it goes over the wire (temperatures in 0.1 C)
+struct Wire {
+  uint8_t  flags = 0;
+  char     state[16] = {0};
+  uint8_t  progress = 255;
+  uint8_t  download = 255;
+  uint16_t remaining = 0xFFFF;
+  int16_t  bed = 0, bedTarget = 0, nozzle = 0, nozzleTarget = 0;
+  uint8_t  hmsTop = 0;
+  uint8_t  hmsCount = 0;   // may exceed hmsN
+  uint8_t  hmsN = 0;
+  uint64_t hmsFull[kMaxHms] = {0};
+  uint8_t  hmsSev[kMaxHms] = {0};
+};
+
+// Delta field mask, in encoding order
+enum : uint16_t {
+  kFFlags = 1u << 0, kFState = 1u << 1, kFProgress = 1u << 2, kFDownload = 1u << 3,
+  kFRemaining = 1u << 4, kFBed = 1u << 5, kFBedTarget = 1u << 6, kFNozzle = 1u << 7,
+  kFNozzleTarget = 1u << 8, kFHms = 1u << 9,
+  kFAll = (1u << 10) - 1
+};
+
+inline bool sameHms(const Wire& a, const Wire& b) {
+  if (a.hmsTop != b.hmsTop || a.hmsCount != b.hmsCount || a.hmsN != b.hmsN) return false;
+  for (uint8_t i = 0; i < a.hmsN; i++) {
+    if (a.hmsFull[i] != b.hmsFull[i] || a.hmsSev[i] != b.hmsSev[i]) return false;
+  }
+  return true;
+}
+
+inline uint16_t diff(const Wire& a, const Wire& b) {
+  uint16_t m = 0;
+  if (a.flags != b.flags) m |= kFFlags;
+  if (strncmp(a.state, b.state, sizeof(a.state)) != 0) m |= kFState;
+  if (a.progress != b.progress) m |= kFProgress;
+  if (a.download != b.download) m |= kFDownload;
+  if (a.remaining != b.remaining) m |= kFRemaining;
+  if (a.bed != b.bed) m |= kFBed;
+  if (a.bedTarget != b.bedTarget) m |= kFBedTarget;
+  if (a.nozzle != b.nozzle) m |= kFNozzle;
+  if (a.nozzleTarget != b.nozzleTarget) m |= kFNozzleTarget;
+  if (!sameHms(a, b)) m |= kFHms;
+  return m;
+}
+
+// ---- little-endian cursor ----
+
+struct Writer {
+  uint8_t* p;
+  size_t cap;
+  size_t n = 0;
+  bool ok = true;
+  Writer(uint8_t* buf, size_t c) : p(buf), cap(c) {}
+  void u8(uint8_t v) { if (n + 1 > cap) { ok = false; return; } p[n++] = v; }
+  void u16(uint16_t v) { u8((uint8_t)v); u8((uint8_t)(v >> 8)); }
+  void u32(uint32_t v) { u16((uint16_t)v); u16((uint16_t)(v >> 16)); }
+  void u64(uint64_t v) { u32((uint32_t)v); u32((uint32_t)(v >> 32)); }
+  void bytes(const void* s, size_t len) {
+    if (n + len > cap) { ok = false; return; }
+    memcpy(p + n, s, len);
+    n += len;
+  }
+};
+
+struct Reader {
+  const uint8_t* p;
+  size_t len;
+  size_t n = 0;
+  bool ok = true;
+  Reader(const uint8_t* buf, size_t l) : p(buf), len(l) {}
+  uint8_t u8() { if (n + 1 > len) { ok = false; return 0; } return p[n++]; }
+  uint16_t u16() { uint16_t v = u8(); return (uint16_t)(v | ((uint16_t)u8() << 8)); }
+  uint32_t u32() { uint32_t v = u16(); return v | ((uint32_t)u16() << 16); }
+  uint64_t u64() { uint64_t v = u32(); return v | ((uint64_t)u32() << 32); }
+};
+
+// ---- SipHash-2-4 (64-bit tag) ----
+
+inline uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+inline uint64_t siphash(const uint8_t key[16], const uint8_t* in, size_t len) {
+  uint64_t k0 = 0, k1 = 0;
+  for (int i = 7; i >= 0; i--) { k0 = (k0 << 8) | key[i]; k1 = (k1 << 8) | key[8 + i]; }
+  uint64_t v0 = 0x736f6d6570736575ULL ^ k0, v1 = 0x646f72616e646f6dULL ^ k1;
+  uint64_t v2 = 0x6c7967656e657261ULL ^ k0, v3 = 0x7465646279746573ULL ^ k1;
+  auto round = [&]() {
+    v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+    v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+  };
+  const size_t end = len - (len % 8);
+  for (size_t i = 0; i < end; i += 8) {
+    uint64_t m = 0;
+    for (int j = 7; j >= 0; j--) m = (m << 8) | in[i + j];
+    v3 ^= m; round(); round(); v0 ^= m;
+  }
+  uint64_t b = (uint64_t)len << 56;
+  for (size_t j = 0; j < len % 8; j++) b |= (uint64_t)in[end + j] << (8 * j);
+  v3 ^= b; round(); round(); v0 ^= b;
+  v2 ^= 0xff;
+  round(); round(); round(); round();
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+inline uint32_t fnv1a(const char* s) {
+  uint32_t h = 2166136261UL;
+  for (; s && *s; s++) { h ^= (uint8_t)*s; h *= 16777619UL; }
+  return h;
+}
+
+// ---- state codec ----
+
+inline void encodeState(Writer& w, const Wire& s, uint16_t mask) {
+  w.u16(mask);
+  if (mask & kFFlags) w.u8(s.flags);
+  if (mask & kFState) {
+    const uint8_t n = (uint8_t)strnlen(s.state, sizeof(s.state) - 1);
+    w.u8(n);
+    w.bytes(s.state, n);
+  }
+  if (mask & kFProgress) w.u8(s.progress);
+  if (mask & kFDownload) w.u8(s.download);
+  if (mask & kFRemaining) w.u16(s.remaining);
+  if (mask & kFBed) w.u16((uint16_t)s.bed);
+  if (mask & kFBedTarget) w.u16((uint16_t)s.bedTarget);
+  if (mask & kFNozzle) w.u16((uint16_t)s.nozzle);
+  if (mask & kFNozzleTarget) w.u16((uint16_t)s.nozzleTarget);
+  if (mask & kFHms) {
+    w.u8(s.hmsTop);
+    w.u8(s.hmsCount);
+    w.u8(s.hmsN);
+    for (uint8_t i = 0; i < s.hmsN; i++) {
+      w.u64(s.hmsFull[i]);
+      w.u8(s.hmsSev[i]);
+    }
+  }
+}
+
+// Applies the encoded fields onto s; false (s untouched) on a malformed body
+inline bool decodeState(Reader& r, Wire& s) {
+  Wire t = s;
+  const uint16_t mask = r.u16();
+  if (mask & ~kFAll) return false;
+  if (mask & kFFlags) t.flags = r.u8();
+  if (mask & kFState) {
+    const uint8_t n = r.u8();
+    if (n >= sizeof(t.state) || r.n + n > r.len) return false;
+    memset(t.state, 0, sizeof(t.state));
+    memcpy(t.state, r.p + r.n, n);
+    r.n += n;
+  }
+  if (mask & kFProgress) t.progress = r.u8();
+  if (mask & kFDownload) t.download = r.u8();
+  if (mask & kFRemaining) t.remaining = r.u16();
+  if (mask & kFBed) t.bed = (int16_t)r.u16();
+  if (mask & kFBedTarget) t.bedTarget = (int16_t)r.u16();
+  if (mask & kFNozzle) t.nozzle = (int16_t)r.u16();
+  if (mask & kFNozzleTarget) t.nozzleTarget = (int16_t)r.u16();
+  if (mask & kFHms) {
+    t.hmsTop = r.u8();
+    t.hmsCount = r.u8();
+    t.hmsN = r.u8();
+    if (t.hmsN > kMaxHms) return false;
+    for (uint8_t i = 0; i < t.hmsN; i++) {
+      t.hmsFull[i] = r.u64();
+      t.hmsSev[i] = r.u8();
+    }
+  }
+  if (!r.ok || r.n != r.len) return false;
+  s = t;
+  return true;
+}
+
+// ---- node: election + leader/follower state machine ----
+
+class Node {
+public:
+  struct Stats {
+    uint32_t sentKeys = 0;
+    uint32_t sentDeltas = 0;
+    uint32_t sentClaims = 0;
+    uint32_t sentBytes = 0;
+    uint32_t rxPackets = 0;
+    uint32_t rxRejected = 0;   // bad magic/tag/body or another group
+    uint32_t rxGaps = 0;       // deltas skipped until the next key frame
+    uint32_t elections = 0;    // times this node became leader
+    uint32_t stepDowns = 0;    // leaderships given up for a dead printer session
+  };
+
+  using SendFn = std::function<void(const uint8_t* data, size_t len)>;
+
+  // accessCode keys the tag; usn selects the group
+  void configure(uint32_t node, const char* usn, const char* accessCode, uint32_t now) {
+    _node = node;
+    _group = fnv1a(usn);
+    memset(_key, 0, sizeof(_key));
+    for (size_t i = 0; accessCode && accessCode[i]; i++) _key[i % sizeof(_key)] ^= (uint8_t)accessCode[i];
+    _key[15] ^= 0xB5;
+    setRole(Role::Listening, now);
+    _leader = 0;
+    _synced = false;
+    _haveState = false;
+    _holding = false;
+  }
+
+  void setSender(SendFn fn) { _send = fn; }
+
+  // printerUp: this node's own printer session (only meaningful as leader)
+  // local: this node's parsed state, sent while leader
+  void tick(uint32_t now, bool printerUp, const Wire& local) {
+    _printerUp = printerUp;
+    switch (_role) {
+      case Role::Listening:
+      case Role::Follower:
+        if (_holding && now - _stepDownMs >= kStepDownHoldMs) _holding = false;
+        if (now - _lastLeaderMs > kLeaderTimeoutMs && !_holding) {
+          setRole(Role::Candidate, now);
+          _leader = 0;
+          _synced = false;
+          sendClaim(now);
+        }
+        break;
+      case Role::Candidate:
+        if (now - _roleSinceMs >= kClaimMs) {
+          setRole(Role::Leader, now);
+          _stats.elections++;
+          _seq = 0;
+          sendState(local, now, true);
+        } else if (now - _lastClaimMs >= kClaimRepeatMs) {
+          sendClaim(now);
+        }
+        break;
+      case Role::Leader:
+        if (printerUp) {
+          _printerUpMs = now;
+        } else if (now - _printerUpMs >= kLeaderDownMs) {
+          // Stop heartbeating: followers time out and elect someone else
+          setRole(Role::Listening, now);
+          _leader = 0;
+          _holding = true;
+          _stepDownMs = now;
+          _stats.stepDowns++;
+          break;
+        }
+        if (now - _lastKeyMs >= kKeyMs || _keyNow) {
+          sendState(local, now, true);
+        } else if (now - _lastSentMs >= kMinDeltaMs && diff(local, _sent)) {
+          sendState(local, now, false);
+        }
+        break;
+    }
+  }
+
+  void onPacket(const uint8_t* data, size_t len, uint32_t now) {
+    _stats.rxPackets++;
+    if (len < 20 + kTagLen || len > kMaxPacket) return reject();
+    Reader r(data, len - kTagLen);
+    const uint32_t magic = r.u32();
+    const Type type = (Type)r.u8();
+    const uint8_t flags = r.u8();
+    const uint16_t bodyLen = r.u16();
+    const uint32_t node = r.u32();
+    const uint32_t group = r.u32();
+    const uint32_t seq = r.u32();
+    if (magic != kMagic || group != _group || node == _node || r.n + bodyLen != r.len) return reject();
+    uint64_t tag = 0;
+    for (int i = (int)kTagLen - 1; i >= 0; i--) tag = (tag << 8) | data[len - kTagLen + i];
+    if (tag != siphash(_key, data, len - kTagLen)) return reject();
+
+    const uint64_t rank = rankOf(flags, node);
+    if (type == Type::Claim) {
+      if (_role == Role::Leader) {
+        _keyNow = true;  // answer right away so the claimant backs off
+      } else if (_role == Role::Candidate && rank > rankOf(0, _node)) {
+        setRole(Role::Listening, now);
+        _lastLeaderMs = now;  // give the better candidate its claim window
+      }
+      return;
+    }
+    if (type != Type::Key && type != Type::Delta) return reject();
+
+    // Leader traffic
+    if (_role == Role::Leader) {
+      if (rank < myRank()) { _keyNow = true; return; }
+      setRole(Role::Follower, now);
+    } else if (_leader && node != _leader && now - _lastLeaderMs <= kLeaderTimeoutMs && rank < _leaderRank) {
+      return;  // a second, lower leader that is about to yield
+    }
+    if (node != _leader) {
+      _leader = node;
+      _synced = false;
+    }
+    _leaderRank = rank;
+    _lastLeaderMs = now;
+    if (_role != Role::Follower) setRole(Role::Follower, now);
+
+    Reader body(data + r.n, bodyLen);
+    if (type == Type::Delta && (!_synced || seq != _rxSeq + 1)) {
+      if (_synced) _stats.rxGaps++;
+      _synced = false;
+      return;
+    }
+    if (!decodeState(body, _state)) return reject();
+    _rxSeq = seq;
+    _synced = true;
+    _haveState = true;
+    _stateVersion++;
+  }
+
+  Role role() const { return _role; }
+  uint32_t leader() const { return _role == Role::Leader ? _node : _leader; }
+  bool haveState() const { return _haveState; }
+  bool leaderFresh(uint32_t now) const { return _role == Role::Follower && now - _lastLeaderMs <= kLeaderTimeoutMs; }
+  const Wire& state() const { return _state; }
+  uint32_t stateVersion() const { return _stateVersion; }
+  const Stats& stats() const { return _stats; }
+
+private:
+  static uint64_t rankOf(uint8_t flags, uint32_t node) {
+    return ((flags & kFlagPrinterUp) ? (1ULL << 32) : 0) | node;
+  }
+  uint64_t myRank() const { return rankOf(_printerUp ? kFlagPrinterUp : 0, _node); }
+
+  void setRole(Role r, uint32_t now) {
+    _role = r;
+    _roleSinceMs = now;
+    if (r == Role::Listening) _lastLeaderMs = now;
+    if (r == Role::Leader) _printerUpMs = now;  // grace period to bring the session up
+    _keyNow = false;
+  }
+
+  void reject() { _stats.rxRejected++; }
+
+  size_t header(Writer& w, Type type, uint32_t seq) {
+    w.u32(kMagic);
+    w.u8((uint8_t)type);
+    w.u8(_printerUp ? kFlagPrinterUp : 0);
+    const size_t lenAt = w.n;
+    w.u16(0);
+    w.u32(_node);
+    w.u32(_group);
+    w.u32(seq);
+    return lenAt;
+  }
+
+  void finish(Writer& w, size_t lenAt) {
+    const uint16_t bodyLen = (uint16_t)(w.n - 20);
+    w.p[lenAt] = (uint8_t)bodyLen;
+    w.p[lenAt + 1] = (uint8_t)(bodyLen >> 8);
+    const uint64_t tag = siphash(_key, w.p, w.n);
+    for (size_t i = 0; i < kTagLen; i++) w.u8((uint8_t)(tag >> (8 * i)));
+    if (w.ok && _send) {
+      _send(w.p, w.n);
+      _stats.sentBytes += w.n;
+    }
+  }
+
+  void sendClaim(uint32_t now) {
+    uint8_t buf[kMaxPacket];
+    Writer w(buf, sizeof(buf));
+    const size_t lenAt = header(w, Type::Claim, 0);
+    finish(w, lenAt);
+    _stats.sentClaims++;
+    _lastClaimMs = now;
+  }
+
+  void sendState(const Wire& local, uint32_t now, bool key) {
+    uint8_t buf[kMaxPacket];
+    Writer w(buf, sizeof(buf));
+    const size_t lenAt = header(w, key ? Type::Key : Type::Delta, ++_seq);
+    encodeState(w, local, key ? (uint16_t)kFAll : diff(local, _sent));
+    finish(w, lenAt);
+    if (key) {
+      _stats.sentKeys++;
+      _lastKeyMs = now;
+      _keyNow = false;
+    } else {
+      _stats.sentDeltas++;
+    }
+    _sent = local;
+    _lastSentMs = now;
+  }
+
+  uint32_t _node = 0;
+  uint32_t _group = 0;
+  uint8_t  _key[16] = {0};
+  SendFn   _send;
+
+  Role     _role = Role::Listening;
+  uint32_t _roleSinceMs = 0;
+  bool     _printerUp = false;
+  bool     _holding = false;  // stepped down: no claims for kStepDownHoldMs
+  uint32_t _stepDownMs = 0;
+
+  // Leader
+  uint32_t _seq = 0;
+  Wire     _sent;
+  uint32_t _lastKeyMs = 0;
+  uint32_t _lastSentMs = 0;
+  uint32_t _lastClaimMs = 0;
+  uint32_t _printerUpMs = 0;
+  bool     _keyNow = false;
+
+  // Follower
+  uint32_t _leader = 0;
+  uint64_t _leaderRank = 0;
+  uint32_t _lastLeaderMs = 0;
+  uint32_t _rxSeq = 0;
+  bool     _synced = false;
+  bool     _haveState = false;
+  uint32_t _stateVersion = 0;
+  Wire     _state;
+
+  Stats _stats;
+};
+
+}  // namespace relay
@@ -0,0 +1,139 @@
+#include "ReportProxy.h"
+
+#include <ArduinoJson.h>
+#include "BambuMqttClient.h"
+#include "WebSerial.h"
+
+extern BambuMqttClient bambu;
+
+void ReportProxy::begin(AsyncWebServer& server, const char* user, const char* pass) {
+  if (user && *user) _ws.setAuthentication(user, pass ? pass : "");
+  _ws.onEvent([this](AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
+                     void* arg, uint8_t* data, size_t len) {
+    (void)server;
+    (void)arg;
+    (void)data;
+    (void)len;
+    onEvent(client, type);
+  });
+  server.addHandler(&_ws);
+}
+
+// AsyncTCP task. Clients are read-only; anything they send is ignored.
+void ReportProxy::onEvent(AsyncWebSocketClient* client, AwsEventType type) {
+  if (type == WS_EVT_CONNECT) {
+    bool added = false;
+    portENTER_CRITICAL(&_mux);
+    for (uint8_t i = 0; i < kMaxClients; i++) {
+      if (_subs[i].id) continue;
+      _subs[i].id = client->id();
+      _subs[i].next = _seq;
+      _subs[i].dropped = 0;
+      added = true;
+      break;
+    }
+    portEXIT_CRITICAL(&_mux);
+    if (!added) {
+      _stats.rejectedClients++;
+      client->close(1013);  // try again later
+      return;
+    }
+    _wantPushall = true;
+    webSerial.printf("[PROXY] Client %lu connected\n", (unsigned long)client->id());
+  } else if (type == WS_EVT_DISCONNECT) {
+    portENTER_CRITICAL(&_mux);
+    for (uint8_t i = 0; i < kMaxClients; i++) {
+      if (_subs[i].id == client->id()) _subs[i].id = 0;
+    }
+    portEXIT_CRITICAL(&_mux);
+  }
+}
+
+void ReportProxy::publish(const uint8_t* payload, size_t len) {
+  bool any = false;
+  portENTER_CRITICAL(&_mux);
+  for (uint8_t i = 0; i < kMaxClients; i++) any |= (_subs[i].id != 0);
+  portEXIT_CRITICAL(&_mux);
+  if (!any || !len) return;
+
+  if (len > kMaxBytes || ESP.getMaxAllocHeap() < len + kHeapReserve) {
+    _stats.skippedHeap++;
+    return;
+  }
+
+  // Make room: never more than kDepth reports or kMaxBytes in the ring
+  while (_oldest != _seq && (_seq - _oldest >= kDepth || _ringBytes + len > kMaxBytes)) {
+    AsyncWebSocketSharedBuffer& old = _ring[_oldest % kDepth];
+    _ringBytes -= old ? old->size() : 0;
+    old.reset();
+    _oldest++;
+  }
+
+  _ring[_seq % kDepth] = std::make_shared<std::vector<uint8_t>>(payload, payload + len);
+  _ringBytes += len;
+  _seq++;
+  _stats.published++;
+  _stats.publishedBytes += len;
+}
+
+void ReportProxy::loop() {
+  const uint32_t now = millis();
+
+  static uint32_t lastCleanupMs = 0;
+  if (now - lastCleanupMs >= 1000UL) {
+    lastCleanupMs = now;
+    _ws.cleanupClients(kMaxClients);
+  }
+
+  if (_wantPushall && bambu.isConnected() && (!_lastPushallMs || now - _lastPushallMs >= kPushallIntervalMs)) {
+    JsonDocument req;
+    req["pushing"]["sequence_id"] = "0";
+    req["pushing"]["command"] = "pushall";
+    req["pushing"]["version"] = 1;
+    req["pushing"]["push_target"] = 1;
+    bambu.publishRequest(req);
+    _wantPushall = false;
+    _lastPushallMs = now;
+    _stats.pushallRequests++;
+  }
+
+  Sub subs[kMaxClients];
+  portENTER_CRITICAL(&_mux);
+  memcpy(subs, _subs, sizeof(subs));
+  portEXIT_CRITICAL(&_mux);
+
+  for (uint8_t i = 0; i < kMaxClients; i++) {
+    Sub& s = subs[i];
+    if (!s.id || s.next == _seq) continue;
+    AsyncWebSocketClient* c = _ws.client(s.id);
+    if (!c || c->status() != WS_CONNECTED) continue;
+
+    while (s.next != _seq && c->queueLen() < kLibQueue) {
+      if ((int32_t)(_oldest - s.next) > 0) {
+        // Fell behind the ring: the oldest reports are gone for this client
+        s.dropped += _oldest - s.next;
+        _stats.dropped += _oldest - s.next;
+        s.next = _oldest;
+        continue;
+      }
+      c->text(_ring[s.next % kDepth]);
+      s.next++;
+      _stats.sent++;
+    }
+
+    portENTER_CRITICAL(&_mux);
+    if (_subs[i].id == s.id) {
+      _subs[i].next = s.next;
+      _subs[i].dropped = s.dropped;
+    }
+    portEXIT_CRITICAL(&_mux);
+  }
+}
+
+ReportProxy::Stats ReportProxy::stats() const {
+  Stats s = _stats;
+  portENTER_CRITICAL(&_mux);
+  for (uint8_t i = 0; i < kMaxClients; i++) s.clients += (_subs[i].id != 0);
+  portEXIT_CRITICAL(&_mux);
+  return s;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+
+// Re-exposes the printer's MQTT report stream on the WebSocket /ws/report, so
+// local tools can share the beacon's single printer connection instead of
+// each taking one of the printer's few LAN MQTT slots.
+//
+// Each report is copied once into a shared buffer and kept in a small ring
+// (kDepth messages / kMaxBytes, whichever is hit first). Every client has its
+// own read position in that ring, i.e. a bounded queue of at most kDepth;
+// a client that falls behind loses the oldest reports (counted) and never
+// stalls the others. Only kLibQueue messages per client are handed to
+// AsyncWebSocket at a time, so its own queue never fills up.
+// New clients trigger a rate-limited pushall so they start with full state.
+class ReportProxy {
+public:
+  struct Stats {
+    uint8_t  clients = 0;
+    uint32_t published = 0;        // reports put into the ring
+    uint32_t publishedBytes = 0;
+    uint32_t skippedHeap = 0;      // reports not copied (heap too low)
+    uint32_t sent = 0;             // messages handed to clients
+    uint32_t dropped = 0;          // reports a slow client missed (drop-oldest)
+    uint32_t rejectedClients = 0;  // refused: kMaxClients reached
+    uint32_t pushallRequests = 0;
+  };
+
+  ReportProxy() : _ws("/ws/report") {}
+
+  void begin(AsyncWebServer& server, const char* user, const char* pass);
+  // Loop task: raw report payload from BambuMqttClient::onRawReport
+  void publish(const uint8_t* payload, size_t len);
+  // Loop task: feeds clients from the ring
+  void loop();
+
+  Stats stats() const;
+
+private:
+  struct Sub {
+    uint32_t id = 0;       // AsyncWebSocketClient id, 0 = free
+    uint32_t next = 0;     // sequence of the next report to send
+    uint32_t dropped = 0;
+  };
+
+  static const uint8_t  kMaxClients = 4;
+  static const uint8_t  kDepth = 4;
+  static const size_t   kMaxBytes = 40UL * 1024UL;
+  static const size_t   kHeapReserve = 16UL * 1024UL;
+  static const size_t   kLibQueue = 2;
+  static const uint32_t kPushallIntervalMs = 60000UL;
+
+  void onEvent(AsyncWebSocketClient* client, AwsEventType type);
+
+  AsyncWebSocket _ws;
+
+  // Ring, loop task only
+  AsyncWebSocketSharedBuffer _ring[kDepth];
+  uint32_t _seq = 0;            // sequence of the next report
+  uint32_t _oldest = 0;         // sequence of the oldest report still held
+  size_t   _ringBytes = 0;
+
+  // Written on connect/disconnect (AsyncTCP), read by loop()
+  Sub _subs[kMaxClients];
+  mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  std::atomic<bool> _wantPushall{false};
+  uint32_t _lastPushallMs = 0;
+
+  Stats _stats;
+};
@@ -0,0 +1,38 @@
+#include "RestartScheduler.h"
+
+#include <esp_timer.h>
+#include "PersistLog.h"
+
+extern PersistLog persistLog;
+
+// Single definition of the global instance
+RestartScheduler restartScheduler;
+
+static void restartNow(void* arg) {
+  (void)arg;
+  ESP.restart();
+}
+
+void RestartScheduler::request(uint32_t delayMs) {
+  _delayMs.store(delayMs + 1, std::memory_order_relaxed);
+}
+
+void RestartScheduler::loop() {
+  const uint32_t req = _delayMs.exchange(0, std::memory_order_relaxed);
+  if (!req || _armed) return;
+  _armed = true;
+
+  persistLog.flush();
+
+  esp_timer_handle_t t = nullptr;
+  esp_timer_create_args_t args = {};
+  args.callback = &restartNow;
+  args.arg = nullptr;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "bb_restart";
+  if (esp_timer_create(&args, &t) == ESP_OK && t) {
+    esp_timer_start_once(t, (uint64_t)(req - 1) * 1000ULL);
+  } else {
+    ESP.restart();
+  }
+}
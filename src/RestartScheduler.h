@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// Deferred restarts. HTTP handlers (async_tcp task) and the ota_pull task only
+// post a request; the loop task writes the pending persistent log batch
+// (PersistLog::flush(), which owns that batch) and then arms a one-shot
+// esp_timer, so the handler's response still goes out before the reboot.
+class RestartScheduler {
+public:
+  // Any task: restart about delayMs after the loop task picks this up
+  void request(uint32_t delayMs);
+  // Loop task, also while an OTA has the loop quiesced
+  void loop();
+
+  bool pending() const { return _delayMs.load(std::memory_order_relaxed) != 0 || _armed; }
+
+private:
+  std::atomic<uint32_t> _delayMs{0};  // requested delay + 1, 0 = none
+  bool _armed = false;
+};
+
+// Global instance (defined in RestartScheduler.cpp)
+extern RestartScheduler restartScheduler;
@@ -1,5 +1,7 @@
 #include "SettingsPrefs.h"
 #include "SettingsPrefs.schema.h"
+#include "Hal.h"
+#include "Trace.h"
 
 // ---------- SettingsGetter / SettingsSetter ctors ----------
 
@@ -28,7 +30,7 @@ void Settings::begin() {
 }
 
 void Settings::loadFromNvs() {
-  Preferences prefs;
+  hal::Nvs prefs;
 
   // Load each item from its NVS namespace.
   // If not existing, default value from schema is used.
@@ -103,7 +105,8 @@ void Settings::loadFromNvs() {
 }
 
 void Settings::writeToNvs() {
-  Preferences prefs;
+  TRACE_SCOPE(NvsSave);
+  hal::Nvs prefs;
 
   #define SAVE_BOOL(group, name, api, def, minv, maxv) \
   { \
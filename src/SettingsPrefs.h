@@ -1,7 +1,6 @@
 #pragma once
 
 #include <Arduino.h>
-#include <Preferences.h>
 #include <ArduinoJson.h>
 
 #include "SettingsPrefs.schema.h"
@@ -35,4 +35,26 @@
   X(UINT16, "device",   "LEDBrightness",      LEDBrightness,    50,         0,     255) \
   X(UINT16, "device",   "LEDMaxCurrentmA",    LEDMaxCurrentmA,  500,       100,    5000) \
   X(BOOL,   "device",   "LEDReverseOrder",    LEDReverseOrder,  false,       0,     0) \
+  X(BOOL,   "device",   "LEDSync",            LEDSync,          false,       0,     0) \
+  \
+  /* ---- OTA section ---- */ \
+  X(STRING, "ota",      "otaUrl",             otaUrl,           "",          0,     0) \
+  X(UINT16, "ota",      "otaRateKBps",        otaRateKBps,      64,          0,     4096) \
+  X(BOOL,   "ota",      "otaP2P",             otaP2P,           false,       0,     0) \
+  X(STRING, "ota",      "otaFleetKey",        otaFleetKey,      "",          0,     0) \
+  \
+  /* ---- Log section ---- */ \
+  X(STRING, "log",      "syslogHost",         syslogHost,       "",          0,     0) \
+  X(UINT16, "log",      "syslogPort",         syslogPort,       514,         1,     65535) \
+  \
+  /* ---- Relay section ---- */ \
+  X(BOOL,   "relay",    "relayEnabled",       relayEnabled,     false,       0,     0) \
+  \
+  /* ---- Home Assistant section ---- */ \
+  X(STRING, "ha",       "haHost",             haHost,           "",          0,     0) \
+  X(UINT16, "ha",       "haPort",             haPort,           1883,        1,     65535) \
+  X(STRING, "ha",       "haUser",             haUser,           "",          0,     0) \
+  X(STRING, "ha",       "haPass",             haPass,           "",          0,     0) \
+  X(STRING, "ha",       "haPrefix",           haPrefix,         "homeassistant", 0, 0) \
+  X(UINT16, "ha",       "haMinInterval",      haMinInterval,    5,           1,     3600) \
   /* End of settings items */
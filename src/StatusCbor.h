@@ -0,0 +1,124 @@
+#pragma once
+
+// /status.cbor: fixed-schema binary status for fleet polling (RFC 8949 CBOR).
+// One map with small integer keys (kKey*), written field by field into a
+// caller buffer without a JsonDocument. Free of Arduino dependencies so the
+// host poller (tools/fleet_poller.cpp) shares the key table.
+//
+// Schema 1 (absent values are CBOR null):
+//   0 schema        uint     1
+//   1 uptimeMs      uint
+//   2 fw            text
+//   3 rssi          int      dBm, 0 = not connected
+//   4 heapFree      uint     bytes
+//   5 heapBlock     uint     largest free block
+//   6 connected     bool     printer session (or relay) up
+//   7 gcodeState    text
+//   8 progress      uint     0-100 | null
+//   9 download      uint     0-100 | null
+//  10 remainingMin  uint     | null
+//  11 bed           int      0.1 C | null
+//  12 bedTarget     int      0.1 C | null
+//  13 nozzle        int      0.1 C | null
+//  14 nozzleTarget  int      0.1 C | null
+//  15 hmsTop        uint     0 none .. 4 fatal
+//  16 hmsCount      uint
+//  17 reportAgeMs   uint     since the last printer report | null
+// New fields get new keys; a key's meaning never changes within a schema.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace statuscbor {
+
+static const uint8_t kSchema = 1;
+
+enum Key : uint8_t {
+  kKeySchema = 0,
+  kKeyUptimeMs,
+  kKeyFw,
+  kKeyRssi,
+  kKeyHeapFree,
+  kKeyHeapBlock,
+  kKeyConnected,
+  kKeyGcodeState,
+  kKeyProgress,
+  kKeyDownload,
+  kKeyRemainingMin,
+  kKeyBed,
+  kKeyBedTarget,
+  kKeyNozzle,
+  kKeyNozzleTarget,
+  kKeyHmsTop,
+  kKeyHmsCount,
+  kKeyReportAgeMs,
+  kKeyCount
+};
+
+static const char* const kKeyNames[kKeyCount] = {
+  "schema", "uptimeMs", "fw", "rssi", "heapFree", "heapBlock", "connected", "gcodeState",
+  "progress", "download", "remainingMin", "bed", "bedTarget", "nozzle", "nozzleTarget",
+  "hmsTop", "hmsCount", "reportAgeMs"
+};
+
+// Largest document: every field present, fw and state at their limits
+static const size_t kMaxLen = 160;
+
+// Minimal CBOR encoder over a fixed buffer; ok() is false once it overflowed
+class Writer {
+public:
+  Writer(uint8_t* buf, size_t cap) : _buf(buf), _cap(cap) {}
+
+  void map(size_t n) { head(5, n); }
+  void key(Key k) { head(0, k); }
+  void uint(uint64_t v) { head(0, v); }
+  void sint(int64_t v) {
+    if (v >= 0) head(0, (uint64_t)v);
+    else head(1, (uint64_t)(-1 - v));
+  }
+  void text(const char* s) {
+    const size_t n = s ? strlen(s) : 0;
+    head(3, n);
+    put(s, n);
+  }
+  void boolean(bool b) { byte(b ? 0xF5 : 0xF4); }
+  void null() { byte(0xF6); }
+
+  size_t length() const { return _len; }
+  bool ok() const { return _len <= _cap; }
+
+private:
+  void byte(uint8_t b) {
+    if (_len < _cap) _buf[_len] = b;
+    _len++;
+  }
+  void put(const void* p, size_t n) {
+    if (_len + n <= _cap) memcpy(_buf + _len, p, n);
+    _len += n;
+  }
+  void head(uint8_t major, uint64_t v) {
+    const uint8_t m = (uint8_t)(major << 5);
+    if (v < 24) {
+      byte(m | (uint8_t)v);
+    } else if (v <= 0xFF) {
+      byte(m | 24);
+      byte((uint8_t)v);
+    } else if (v <= 0xFFFF) {
+      byte(m | 25);
+      for (int i = 1; i >= 0; i--) byte((uint8_t)(v >> (8 * i)));
+    } else if (v <= 0xFFFFFFFFULL) {
+      byte(m | 26);
+      for (int i = 3; i >= 0; i--) byte((uint8_t)(v >> (8 * i)));
+    } else {
+      byte(m | 27);
+      for (int i = 7; i >= 0; i--) byte((uint8_t)(v >> (8 * i)));
+    }
+  }
+
+  uint8_t* _buf;
+  size_t   _cap;
+  size_t   _len = 0;
+};
+
+}  // namespace statuscbor
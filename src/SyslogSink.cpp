@@ -0,0 +1,120 @@
+#include "SyslogSink.h"
+
+#include "SettingsPrefs.h"
+#include "WebSerial.h"
+
+void SyslogSink::begin(Settings& settings) {
+  _host = settings.get.syslogHost();
+  _host.trim();
+  _port = settings.get.syslogPort();
+  _enabled = _host.length() > 0;
+  if (_enabled) _resolver.setHost(_host, "SYSLOG");
+
+  // HOSTNAME: printable US-ASCII without spaces (RFC 5424 6.2.4)
+  const char* name = settings.get.deviceName();
+  size_t n = 0;
+  for (; name && name[n] && n < sizeof(_hostname) - 1; n++) {
+    const char c = name[n];
+    _hostname[n] = (c > 32 && c < 127) ? c : '-';
+  }
+  if (n) _hostname[n] = 0;
+
+  if (_enabled) webSerial.printf("[SYSLOG] Forwarding to %s:%u\n", _host.c_str(), _port);
+}
+
+void SyslogSink::append(const uint8_t* data, size_t len) {
+  if (!_enabled) return;
+  for (size_t i = 0; i < len; i++) {
+    const char c = (char)data[i];
+    if (c == '\r') continue;
+    if (c == '\n') {
+      addLine();
+      continue;
+    }
+    _line[_lineLen++] = c;
+    if (_lineLen == kMaxLine) addLine();
+  }
+}
+
+void SyslogSink::addLine() {
+  if (!_lineLen) return;
+
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    if (!_open) {
+      if (_count >= kQueue) {
+        _stats.droppedLines++;
+        _lineLen = 0;
+        return;
+      }
+      Batch& b = _q[(_head + _count) % kQueue];
+      b.len = 0;
+      b.lines = 0;
+      b.firstSeq = _seq;
+      b.sinceMs = millis();
+      _open = true;
+    }
+
+    Batch& b = _q[(_head + _count) % kQueue];
+    const size_t need = _lineLen + (b.len ? 1 : 0);
+    if (b.len + need > kBodySize) {
+      closeBatch();
+      continue;
+    }
+    if (b.len) b.body[b.len++] = '\n';
+    memcpy(b.body + b.len, _line, _lineLen);
+    b.len += _lineLen;
+    b.lines++;
+    _stats.lines++;
+    // meta sequenceId range is 1..2147483647
+    _seq = (_seq >= 2147483647UL) ? 1 : _seq + 1;
+    break;
+  }
+  _lineLen = 0;
+}
+
+void SyslogSink::closeBatch() {
+  if (!_open) return;
+  _open = false;
+  _count++;
+}
+
+void SyslogSink::loop() {
+  if (!_enabled) return;
+  const uint32_t now = millis();
+
+  if (_open && now - _q[(_head + _count) % kQueue].sinceMs >= kBatchMs) closeBatch();
+  if (!_count) return;
+  if (!_wifi.connected()) return;
+  if (!_resolver.get(_ip)) return;  // lookup in flight or backing off
+  if (now - _lastSendMs < kMinGapMs) return;
+
+  if (!sendBatch(_q[_head])) _stats.sendErrors++;
+  _head = (_head + 1) % kQueue;
+  _count--;
+  _lastSendMs = now;
+}
+
+bool SyslogSink::sendBatch(const Batch& b) {
+  // <PRI>VERSION TIMESTAMP HOSTNAME APP-NAME PROCID MSGID [SD] MSG
+  // sysUpTime is in hundredths of a second (RFC 5424 7.3.2)
+  char hdr[192];
+  const int h = snprintf(hdr, sizeof(hdr),
+                         "<%u>1 - %s BambuBeacon - log [meta sequenceId=\"%lu\" sysUpTime=\"%lu\"][bb@32473 lines=\"%u\"] ",
+                         kPri, _hostname, (unsigned long)b.firstSeq, (unsigned long)(millis() / 10UL), b.lines);
+  if (h <= 0) return false;
+
+  if (!_udp.beginPacket(_ip, _port)) return false;
+  _udp.write(reinterpret_cast<const uint8_t*>(hdr), (size_t)h);
+  _udp.write(reinterpret_cast<const uint8_t*>(b.body), b.len);
+  if (!_udp.endPacket()) return false;
+
+  _stats.datagrams++;
+  _stats.bytes += (uint32_t)h + b.len;
+  return true;
+}
+
+SyslogSink::Stats SyslogSink::stats() const {
+  Stats s = _stats;
+  s.enabled = _enabled;
+  return s;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include "Hal.h"
+#include "HostResolver.h"
+
+class Settings;
+
+// Optional RFC 5424 syslog over UDP (settings log/syslogHost, log/syslogPort).
+//
+// Fed from the webSerial tap like PersistLog. Consecutive lines are packed
+// into one message per datagram (multi-line MSG, up to kBodySize bytes, sent
+// after kBatchMs at the latest) to keep the packet rate low. Each datagram
+// carries [meta sequenceId] = sequence number of its first line and
+// [bb@32473 lines] = line count, so a collector can check ordering and loss
+// (tools/syslog_collector.py). Sending runs from loop() at most one datagram
+// per kMinGapMs; when the queue is full or the stack refuses a packet, lines
+// are dropped and counted, never waited for. A host name is resolved in the
+// background (HostResolver); batches queue up meanwhile.
+class SyslogSink {
+public:
+  explicit SyslogSink(hal::Wifi& wifi = hal::wifi()) : _wifi(wifi) {}
+
+  struct Stats {
+    bool     enabled = false;
+    uint32_t lines = 0;         // queued
+    uint32_t datagrams = 0;     // sent
+    uint32_t bytes = 0;         // UDP payload bytes sent
+    uint32_t droppedLines = 0;  // queue full (network slow or down)
+    uint32_t sendErrors = 0;    // datagrams the stack refused (lines lost)
+  };
+
+  void begin(Settings& settings);
+  // Loop task only: raw webSerial output (see WebSerialClass::setTap)
+  void append(const uint8_t* data, size_t len);
+  // Loop task: closes aged batches, resolves the host and sends
+  void loop();
+
+  bool enabled() const { return _enabled; }
+  Stats stats() const;
+
+private:
+  struct Batch {
+    uint16_t len = 0;
+    uint16_t lines = 0;
+    uint32_t firstSeq = 0;
+    uint32_t sinceMs = 0;
+    char     body[1200];
+  };
+
+  static const uint8_t  kQueue = 4;
+  static const size_t   kBodySize = sizeof(Batch::body);  // + header stays below a 1472-byte UDP payload
+  static const size_t   kMaxLine = 240;
+  static const uint32_t kBatchMs = 1000;
+  static const uint32_t kMinGapMs = 10;
+  static const uint8_t  kPri = 16 * 8 + 6;  // local0.info
+
+  void addLine();
+  void closeBatch();
+  bool sendBatch(const Batch& b);
+
+  bool     _enabled = false;
+  String   _host;
+  uint16_t _port = 514;
+  char     _hostname[33] = "-";
+  HostResolver _resolver;
+  IPAddress _ip;
+  uint32_t _lastSendMs = 0;
+
+  hal::Wifi& _wifi;
+  hal::Udp _udp;
+
+  // FIFO of batches; _count closed ones starting at _head, then the open one
+  Batch   _q[kQueue];
+  uint8_t _head = 0;
+  uint8_t _count = 0;
+  bool    _open = false;
+  uint32_t _seq = 1;
+
+  char   _line[kMaxLine];
+  size_t _lineLen = 0;
+
+  Stats _stats;
+};
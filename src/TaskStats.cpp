@@ -0,0 +1,292 @@
+#include "TaskStats.h"
+
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <memory>
+#include <new>
+
+// Single definition of the global instance
+TaskStats taskStats;
+
+namespace {
+
+// Stack sizes fixed by the build; a name ending in '*' matches a prefix
+// (IDLE0/IDLE1, ipc0/ipc1). The firmware's own tasks use noteStackSize().
+struct KnownStack {
+  const char* name;
+  uint32_t bytes;
+};
+
+const KnownStack kKnownStacks[] = {
+#ifdef CONFIG_ASYNC_TCP_STACK_SIZE
+  { "async_tcp", CONFIG_ASYNC_TCP_STACK_SIZE },
+#endif
+#ifdef CONFIG_ESP_TIMER_TASK_STACK_SIZE
+  { "esp_timer", CONFIG_ESP_TIMER_TASK_STACK_SIZE },
+#endif
+#ifdef CONFIG_LWIP_TCPIP_TASK_STACK_SIZE
+  { "tiT", CONFIG_LWIP_TCPIP_TASK_STACK_SIZE },
+#endif
+#ifdef CONFIG_ESP_SYSTEM_EVENT_TASK_STACK_SIZE
+  { "sys_evt", CONFIG_ESP_SYSTEM_EVENT_TASK_STACK_SIZE },
+#endif
+#ifdef CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH
+  { "Tmr Svc", CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH },
+#endif
+#ifdef CONFIG_FREERTOS_IDLE_TASK_STACKSIZE
+  { "IDLE*", CONFIG_FREERTOS_IDLE_TASK_STACKSIZE },
+#endif
+#ifdef CONFIG_ESP_IPC_TASK_STACK_SIZE
+  { "ipc*", CONFIG_ESP_IPC_TASK_STACK_SIZE },
+#endif
+#ifdef CONFIG_MDNS_TASK_STACK_SIZE
+  { "mdns", CONFIG_MDNS_TASK_STACK_SIZE },
+#endif
+  { nullptr, 0 },
+};
+
+bool nameMatches(const char* pattern, const char* name) {
+  const size_t n = strlen(pattern);
+  if (n && pattern[n - 1] == '*') return strncmp(pattern, name, n - 1) == 0;
+  return strncmp(pattern, name, configMAX_TASK_NAME_LEN) == 0;
+}
+
+// One task as read from FreeRTOS, before it is merged into the table. The
+// name is copied: a task deleted meanwhile takes its TCB with it.
+struct Probe {
+  char name[configMAX_TASK_NAME_LEN];
+  uint32_t runTime;
+  uint32_t stackFree;
+  uint8_t prio;
+  int8_t core;
+  char state;
+};
+
+#if configUSE_TRACE_FACILITY
+char stateChar(eTaskState s) {
+  switch (s) {
+    case eRunning:   return 'R';
+    case eReady:     return 'r';
+    case eBlocked:   return 'B';
+    case eSuspended: return 'S';
+    case eDeleted:   return 'D';
+    default:         return '?';
+  }
+}
+#endif
+
+const char* stateName(char s) {
+  switch (s) {
+    case 'R': return "running";
+    case 'r': return "ready";
+    case 'B': return "blocked";
+    case 'S': return "suspended";
+    case 'D': return "deleted";
+    case 'X': return "gone";
+    default:  return "unknown";
+  }
+}
+
+}  // namespace
+
+void TaskStats::loop() {
+  const uint32_t nowMs = millis();
+  if (_samples && nowMs - _lastMs < kIntervalMs) return;
+  _lastMs = nowMs;
+  sample();
+}
+
+void TaskStats::noteStackSize(const char* name, uint32_t bytes) {
+  portENTER_CRITICAL(&_mux);
+  uint8_t i = 0;
+  while (i < _notedCount && strcmp(_noted[i].name, name) != 0) i++;
+  if (i < kMaxNoted) {
+    _noted[i].name = name;
+    _noted[i].bytes = bytes;
+    if (i == _notedCount) _notedCount++;
+  }
+  Task* t = entryFor(name, false);
+  if (t) t->stackSize = bytes;
+  portEXIT_CRITICAL(&_mux);
+}
+
+uint32_t TaskStats::stackSizeOf(const char* name) const {
+  for (uint8_t i = 0; i < _notedCount; i++) {
+    if (nameMatches(_noted[i].name, name)) return _noted[i].bytes;
+  }
+  if (nameMatches("loopTask", name)) return (uint32_t)getArduinoLoopTaskStackSize();
+  for (const KnownStack* k = kKnownStacks; k->name; k++) {
+    if (nameMatches(k->name, name)) return k->bytes;
+  }
+  return 0;
+}
+
+// Finds (or adds) the entry for `name`; nullptr when missing or the table is
+// full. Caller holds _mux.
+TaskStats::Task* TaskStats::entryFor(const char* name, bool add) {
+  for (uint8_t i = 0; i < _count; i++) {
+    if (strncmp(_tasks[i].name, name, configMAX_TASK_NAME_LEN) == 0) return &_tasks[i];
+  }
+  if (!add || _count >= kMaxTasks) return nullptr;
+  Task& t = _tasks[_count];
+  strlcpy(t.name, name, sizeof(t.name));
+  t.stackSize = stackSizeOf(name);
+  t.stackFree = UINT32_MAX;
+  t.state = 'X';
+  _counted[_count] = false;
+  _count++;
+  return &t;
+}
+
+void TaskStats::sample() {
+  Probe probes[kMaxTasks];
+  uint8_t n = 0;
+  uint32_t total = 0;
+  uint32_t left = 0;  // tasks without a probe or a table entry
+
+#if configUSE_TRACE_FACILITY
+  // A few spare slots for tasks created while the array is allocated
+  const UBaseType_t cap = uxTaskGetNumberOfTasks() + 4;
+  std::unique_ptr<TaskStatus_t[]> sys(new (std::nothrow) TaskStatus_t[cap]);
+  if (!sys) return;
+  const UBaseType_t got = uxTaskGetSystemState(sys.get(), cap, &total);
+  for (UBaseType_t i = 0; i < got && n < kMaxTasks; i++) {
+    const TaskStatus_t& s = sys[i];
+    Probe& p = probes[n++];
+    strlcpy(p.name, s.pcTaskName, sizeof(p.name));
+#if configGENERATE_RUN_TIME_STATS
+    p.runTime = s.ulRunTimeCounter;
+#else
+    p.runTime = 0;
+#endif
+    p.stackFree = s.usStackHighWaterMark;
+    p.prio = (uint8_t)s.uxCurrentPriority;
+#if configTASKLIST_INCLUDE_COREID
+    p.core = s.xCoreID == tskNO_AFFINITY ? -1 : (int8_t)s.xCoreID;
+#else
+    p.core = -1;
+#endif
+    p.state = stateChar(s.eCurrentState);
+  }
+  if (got > kMaxTasks) left = got - kMaxTasks;
+#else
+  // No task list in this build: the tasks we know by name, stacks only
+  const char* names[kMaxTasks];
+  uint8_t count = 0;
+  names[count++] = "loopTask";
+  portENTER_CRITICAL(&_mux);
+  for (uint8_t i = 0; i < _notedCount && count < kMaxTasks; i++) names[count++] = _noted[i].name;
+  portEXIT_CRITICAL(&_mux);
+  for (const KnownStack* k = kKnownStacks; k->name && count < kMaxTasks; k++) {
+    if (!strchr(k->name, '*')) names[count++] = k->name;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    TaskHandle_t h = xTaskGetHandle(names[i]);
+    if (!h) continue;
+    Probe& p = probes[n++];
+    strlcpy(p.name, names[i], sizeof(p.name));
+    p.runTime = 0;
+    p.stackFree = uxTaskGetStackHighWaterMark(h);
+    p.prio = (uint8_t)uxTaskPriorityGet(h);
+    p.core = -1;
+    p.state = '?';
+  }
+#endif
+
+  // Bounded by kMaxTasks entries of a few compares each
+  const uint32_t totalDelta = total - _lastTotal;
+  bool seen[kMaxTasks] = {false};
+  portENTER_CRITICAL(&_mux);
+  for (uint8_t i = 0; i < n; i++) {
+    const Probe& p = probes[i];
+    Task* t = entryFor(p.name, true);
+    if (!t) {
+      left++;
+      continue;
+    }
+    const uint8_t idx = (uint8_t)(t - _tasks);
+    seen[idx] = true;
+    t->prio = p.prio;
+    t->core = p.core;
+    t->state = p.state;
+    if (p.stackFree < t->stackFree) t->stackFree = p.stackFree;
+    uint32_t permille = 0;
+    if (_counted[idx] && totalDelta) {
+      permille = (uint32_t)((uint64_t)(p.runTime - _counters[idx]) * 1000ULL / totalDelta);
+      if (permille > 1000) permille = 1000;
+    }
+    t->cpuPermille = (uint16_t)permille;
+    if (permille > t->cpuPeakPermille) t->cpuPeakPermille = (uint16_t)permille;
+    _counters[idx] = p.runTime;
+    _counted[idx] = true;
+  }
+  for (uint8_t i = 0; i < _count; i++) {
+    if (seen[i]) continue;
+    _tasks[i].state = 'X';
+    _tasks[i].cpuPermille = 0;
+    _counted[i] = false;
+  }
+  if (left > _overflow) _overflow = (uint8_t)min(left, (uint32_t)255);
+  _lastTotal = total;
+  _samples++;
+  portEXIT_CRITICAL(&_mux);
+}
+
+TaskStats::Stats TaskStats::stats() const {
+  Stats s;
+  portENTER_CRITICAL(&_mux);
+  s.samples = _samples;
+  s.tasks = _count;
+  s.overflow = _overflow;
+  s.minStackFree = UINT32_MAX;
+  for (uint8_t i = 0; i < _count; i++) {
+    if (_tasks[i].stackFree < s.minStackFree) {
+      s.minStackFree = _tasks[i].stackFree;
+      strlcpy(s.minStackTask, _tasks[i].name, sizeof(s.minStackTask));
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+  if (s.minStackFree == UINT32_MAX) s.minStackFree = 0;
+  return s;
+}
+
+void TaskStats::serve(AsyncWebServerRequest* req) const {
+  std::unique_ptr<Task[]> copy(new (std::nothrow) Task[kMaxTasks]);
+  if (!copy) {
+    req->send(503, "application/json", "{\"success\":false}");
+    return;
+  }
+  portENTER_CRITICAL(&_mux);
+  const uint8_t count = _count;
+  const uint32_t samples = _samples;
+  const uint32_t sampledMs = _lastMs;
+  const uint8_t overflow = _overflow;
+  memcpy(copy.get(), _tasks, sizeof(Task) * count);
+  portEXIT_CRITICAL(&_mux);
+
+  JsonDocument doc;
+  doc["uptimeMs"] = millis();
+  doc["sampledMs"] = sampledMs;
+  doc["intervalMs"] = kIntervalMs;
+  doc["samples"] = samples;
+  doc["cores"] = portNUM_PROCESSORS;
+  doc["runTimeStats"] = (bool)(configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS);
+  doc["overflow"] = overflow;
+  JsonArray arr = doc["tasks"].to<JsonArray>();
+  for (uint8_t i = 0; i < count; i++) {
+    const Task& t = copy[i];
+    JsonObject o = arr.add<JsonObject>();
+    o["name"] = t.name;
+    o["state"] = stateName(t.state);
+    o["prio"] = t.prio;
+    o["core"] = t.core;
+    o["cpu"] = t.cpuPermille / 10.0f;
+    o["cpuPeak"] = t.cpuPeakPermille / 10.0f;
+    o["stackSize"] = t.stackSize;
+    o["stackFree"] = t.stackFree == UINT32_MAX ? 0 : t.stackFree;
+  }
+
+  String out;
+  serializeJson(doc, out);
+  req->send(200, "application/json", out);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+class AsyncWebServerRequest;
+
+// Per-task CPU share and stack headroom, sampled by the loop task every
+// kIntervalMs and served on /tasks.json (Maintenance page, stack_report.py).
+//
+// CPU is the FreeRTOS run-time counter (esp_timer microseconds) diffed
+// between two samples, in permille of one core; the 32-bit counters wrap
+// after ~71 minutes, so only per-interval shares are kept. Stack headroom is
+// the task's high-water mark, the least free stack it ever had (bytes on
+// ESP-IDF). An entry outlives its task (ota_pull) and keeps the worst mark
+// of every task that ran under the name.
+//
+// Stack sizes come from the build configuration (sdkconfig, build flags) or
+// from noteStackSize() where the firmware creates a task; 0 = unknown.
+class TaskStats {
+public:
+  struct Task {
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t stackSize;        // bytes, 0 if unknown
+    uint32_t stackFree;        // high-water mark, bytes
+    uint16_t cpuPermille;      // last interval, of one core
+    uint16_t cpuPeakPermille;  // worst interval since boot
+    uint8_t prio;
+    int8_t core;               // -1: either core
+    char state;                // R running, r ready, B blocked, S suspended, D deleted, X gone
+  };
+
+  struct Stats {
+    uint32_t samples = 0;
+    uint8_t tasks = 0;         // entries in the table
+    uint8_t overflow = 0;      // most tasks one sample had no entry for
+    uint32_t minStackFree = 0; // smallest high-water mark in the table
+    char minStackTask[configMAX_TASK_NAME_LEN] = {0};
+  };
+
+  static const uint8_t kMaxTasks = 24;
+  static const uint32_t kIntervalMs = 5000;
+
+  // Loop task: samples once per kIntervalMs
+  void loop();
+
+  // Any task: records the stack size a task is created with
+  void noteStackSize(const char* name, uint32_t bytes);
+
+  Stats stats() const;
+
+  // GET /tasks.json
+  void serve(AsyncWebServerRequest* req) const;
+
+private:
+  static const uint8_t kMaxNoted = 8;
+
+  struct Noted {
+    const char* name;          // string literal of the creator
+    uint32_t bytes;
+  };
+
+  void sample();
+  Task* entryFor(const char* name, bool add);
+  uint32_t stackSizeOf(const char* name) const;
+
+  Task _tasks[kMaxTasks] = {};
+  uint32_t _counters[kMaxTasks] = {0};  // run time at the last sample
+  bool _counted[kMaxTasks] = {false};   // _counters[i] is from the last sample
+  uint8_t _count = 0;
+  uint8_t _overflow = 0;
+  uint32_t _samples = 0;
+  uint32_t _lastMs = 0;
+  uint32_t _lastTotal = 0;
+
+  Noted _noted[kMaxNoted] = {};
+  uint8_t _notedCount = 0;
+
+  mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+// Global instance (defined in TaskStats.cpp)
+extern TaskStats taskStats;
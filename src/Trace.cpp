@@ -0,0 +1,194 @@
+#include "Trace.h"
+
+#include <ESPAsyncWebServer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <memory>
+#include <vector>
+
+// Single definition of the global instance
+Tracer tracer;
+
+namespace {
+
+const char* const kNames[] = {
+  "mqtt.loop", "mqtt.parse", "led.render", "led.show", "http.inflight", "nvs.save", "ssdp.send", "ssdp.packet",
+  "wifi.connecting", "wifi.up", "wifi.down", "ap.start", "ap.stop",
+};
+static_assert(sizeof(kNames) / sizeof(kNames[0]) == (size_t)TraceId::kCount, "one name per TraceId");
+
+// Category = the name up to the dot
+const char* const kCats[] = {
+  "mqtt", "mqtt", "led", "led", "http", "nvs", "ssdp", "ssdp", "wifi", "wifi", "wifi", "wifi", "wifi",
+};
+static_assert(sizeof(kCats) / sizeof(kCats[0]) == (size_t)TraceId::kCount, "one category per TraceId");
+
+// Export state across chunk callbacks: one JSON element per line buffer
+struct TraceCursor {
+  std::vector<Tracer::Record> events;
+  std::vector<void*> tasks;     // tid = index + 1
+  uint32_t baseUs = 0;         // oldest timestamp in the snapshot
+  uint8_t stage = 0;            // 0 header, 1 thread names, 2 events, 3 footer, 4 done
+  size_t next = 0;
+  bool first = true;
+  char line[224];
+  size_t lineLen = 0;
+  size_t lineOff = 0;
+};
+
+size_t tidOf(const TraceCursor& c, void* task) {
+  for (size_t i = 0; i < c.tasks.size(); i++) {
+    if (c.tasks[i] == task) return i + 1;
+  }
+  return 0;
+}
+
+// Fills c.line with the next element; false when the document is complete
+bool nextLine(TraceCursor& c) {
+  const char* sep = c.first ? "" : ",";
+  int n = 0;
+  while (n == 0) {
+    switch (c.stage) {
+      case 0:
+        n = snprintf(c.line, sizeof(c.line), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+        c.stage = 1;
+        c.next = 0;
+        continue;
+      case 1:
+        if (c.next >= c.tasks.size()) {
+          c.stage = 2;
+          c.next = 0;
+          break;
+        }
+        // The traced tasks live for the whole run, so their handles stay valid
+        n = snprintf(c.line, sizeof(c.line),
+                     "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", sep,
+                     (unsigned)(c.next + 1), pcTaskGetName((TaskHandle_t)c.tasks[c.next]));
+        c.next++;
+        c.first = false;
+        break;
+      case 2: {
+        if (c.next >= c.events.size()) {
+          c.stage = 3;
+          break;
+        }
+        const Tracer::Record& e = c.events[c.next++];
+        const uint8_t idx = (uint8_t)e.id;
+        if (idx >= (uint8_t)TraceId::kCount) break;
+        // Writers stamp before claiming a slot, so ring order is only roughly
+        // time order; the base is the oldest stamp and the clamp keeps ts >= 0
+        const int32_t rel = (int32_t)(e.tsUs - c.baseUs);
+        const uint32_t ts = rel > 0 ? (uint32_t)rel : 0;
+        n = snprintf(c.line, sizeof(c.line), "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%u,\"pid\":1,\"tid\":%u",
+                     sep, kNames[idx], kCats[idx], e.ph, (unsigned)ts, (unsigned)tidOf(c, e.task));
+        if (e.ph == 'b' || e.ph == 'e') {
+          n += snprintf(c.line + n, sizeof(c.line) - n, ",\"id\":%u}", (unsigned)e.arg);
+        } else if (e.ph == 'i') {
+          n += snprintf(c.line + n, sizeof(c.line) - n, ",\"s\":\"t\",\"args\":{\"v\":%u}}", (unsigned)e.arg);
+        } else if (e.arg) {
+          n += snprintf(c.line + n, sizeof(c.line) - n, ",\"args\":{\"v\":%u}}", (unsigned)e.arg);
+        } else {
+          n += snprintf(c.line + n, sizeof(c.line) - n, "}");
+        }
+        c.first = false;
+        break;
+      }
+      case 3:
+        n = snprintf(c.line, sizeof(c.line), "]}");
+        c.stage = 4;
+        continue;
+      default:
+        return false;
+    }
+  }
+  c.lineLen = min((size_t)n, sizeof(c.line) - 1);
+  c.lineOff = 0;
+  return true;
+}
+
+}  // namespace
+
+Tracer::Tracer() {
+  for (uint32_t i = 0; i < kSlots; i++) _events[i].seq.store(0, std::memory_order_relaxed);
+}
+
+void Tracer::setEnabled(bool on) { _on.store(on, std::memory_order_relaxed); }
+
+// Seqlock per slot: 0 while the fields change, position + 1 once they are
+// consistent; the exporter re-reads seq after copying. Two writers only meet
+// in one slot if 256 events land while one of them is mid-write.
+void Tracer::record(TraceId id, char ph, uint16_t arg) {
+  const uint32_t ts = micros();
+  const uint32_t pos = _head.fetch_add(1, std::memory_order_relaxed);
+  Event& e = _events[pos & (kSlots - 1)];
+  e.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.tsUs = ts;
+  e.task = xTaskGetCurrentTaskHandle();
+  e.arg = arg;
+  e.id = id;
+  e.ph = ph;
+  e.seq.store(pos + 1, std::memory_order_release);
+}
+
+// Position `pos` if its slot still holds it and was not rewritten meanwhile
+bool Tracer::read(uint32_t pos, Record& out) const {
+  const Event& e = _events[pos & (kSlots - 1)];
+  if (e.seq.load(std::memory_order_acquire) != pos + 1) return false;
+  out = { e.tsUs, e.task, e.arg, e.id, e.ph };
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return e.seq.load(std::memory_order_relaxed) == pos + 1;
+}
+
+size_t Tracer::newest(Record* out, size_t cap) const {
+  const uint32_t head = _head.load(std::memory_order_acquire);
+  uint32_t count = head < kSlots ? head : kSlots;
+  if (count > cap) count = cap;
+  size_t n = 0;
+  for (uint32_t pos = head - count; pos != head; pos++) {
+    if (read(pos, out[n])) n++;
+  }
+  return n;
+}
+
+const char* Tracer::name(TraceId id) {
+  return (uint8_t)id < (uint8_t)TraceId::kCount ? kNames[(uint8_t)id] : "?";
+}
+
+Tracer::Stats Tracer::stats() const {
+  Stats s;
+  s.enabled = enabled();
+  s.events = _head.load(std::memory_order_relaxed);
+  return s;
+}
+
+void Tracer::serve(AsyncWebServerRequest* req) {
+  std::shared_ptr<TraceCursor> c = std::make_shared<TraceCursor>();
+
+  const uint32_t head = _head.load(std::memory_order_acquire);
+  const uint32_t count = head < kSlots ? head : kSlots;
+  c->events.reserve(count);
+  for (uint32_t pos = head - count; pos != head; pos++) {
+    Record s;
+    if (!read(pos, s)) continue;
+    if (c->events.empty() || (int32_t)(s.tsUs - c->baseUs) < 0) c->baseUs = s.tsUs;
+    c->events.push_back(s);
+    if (!tidOf(*c, s.task)) c->tasks.push_back(s.task);
+  }
+
+  AsyncWebServerResponse* res = req->beginChunkedResponse("application/json",
+    [c](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+      (void)index;
+      size_t out = 0;
+      while (out < maxLen) {
+        if (c->lineOff == c->lineLen && !nextLine(*c)) break;
+        const size_t n = min(maxLen - out, c->lineLen - c->lineOff);
+        memcpy(buf + out, c->line + c->lineOff, n);
+        c->lineOff += n;
+        out += n;
+      }
+      return out;
+    });
+  res->addHeader("Cache-Control", "no-store");
+  req->send(res);
+}
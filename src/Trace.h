@@ -0,0 +1,117 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+class AsyncWebServerRequest;
+
+// Cross-subsystem trace recorder, exported as Chrome Trace Event JSON on
+// /trace.json (chrome://tracing, ui.perfetto.dev).
+//
+// A fixed ring of the newest kSlots events: begin/end pairs per task, async
+// spans that may end on another task (HTTP requests) and instants (Wi-Fi).
+// Writers claim a slot with one fetch_add and never wait; a slot carries its
+// position once complete, so the exporter skips slots being rewritten.
+// Recording is off by default (POST /trace enable=1); while off, every call
+// site costs the one load and branch in enabled().
+
+enum class TraceId : uint8_t {
+  MqttLoop,      // PubSubClient::loop(): TLS read and dispatch
+  MqttParse,     // one report through filter, JSON parse and state update
+  LedRender,
+  LedShow,
+  HttpInFlight,  // in-flight slot of an admitted request: admission to disconnect (async)
+  NvsSave,
+  SsdpSend,
+  SsdpPacket,
+  WifiConnecting,  // arg: SSID slot
+  WifiUp,          // arg: wl_status_t
+  WifiDown,
+  ApStart,
+  ApStop,
+  kCount
+};
+
+class Tracer {
+public:
+  struct Stats {
+    bool enabled = false;
+    uint32_t events = 0;     // recorded since boot
+  };
+
+  struct Record {
+    uint32_t tsUs;
+    void* task;
+    uint16_t arg;
+    TraceId id;
+    char ph;
+  };
+
+  Tracer();
+
+  bool enabled() const { return _on.load(std::memory_order_relaxed); }
+  void setEnabled(bool on);
+
+  void begin(TraceId id, uint16_t arg = 0) { if (enabled()) record(id, 'B', arg); }
+  void end(TraceId id, uint16_t arg = 0) { if (enabled()) record(id, 'E', arg); }
+  void instant(TraceId id, uint16_t arg = 0) { if (enabled()) record(id, 'i', arg); }
+  // Spans keyed by `cookie` instead of the task, may end anywhere
+  void asyncBegin(TraceId id, uint16_t cookie) { if (enabled()) record(id, 'b', cookie); }
+  void asyncEnd(TraceId id, uint16_t cookie) { if (enabled()) record(id, 'e', cookie); }
+
+  // Out of line so call sites stay a load and a branch
+  void record(TraceId id, char ph, uint16_t arg);
+
+  // Chunked Chrome Trace Event JSON of the events in the ring
+  void serve(AsyncWebServerRequest* req);
+
+  Stats stats() const;
+
+  // Copies up to `cap` of the newest complete events, oldest first. No locks
+  // or allocation, so the panic handler can use it (CrashContext).
+  size_t newest(Record* out, size_t cap) const;
+
+  static const char* name(TraceId id);
+
+private:
+  static const uint32_t kSlots = 256;  // power of two
+
+  struct Event {
+    std::atomic<uint32_t> seq;  // position + 1 once written, 0 while writing
+    uint32_t tsUs;
+    void* task;
+    uint16_t arg;
+    TraceId id;
+    char ph;
+  };
+
+  bool read(uint32_t pos, Record& out) const;
+
+  Event _events[kSlots];
+  std::atomic<uint32_t> _head{0};
+  std::atomic<bool> _on{false};
+};
+
+// Global instance (defined in Trace.cpp)
+extern Tracer tracer;
+
+// Begin/end pair for the enclosing scope; ends only what it began
+class TraceScope {
+public:
+  explicit TraceScope(TraceId id, uint16_t arg = 0) : _id(id), _on(tracer.enabled()) {
+    if (_on) tracer.record(id, 'B', arg);
+  }
+  ~TraceScope() {
+    if (_on) tracer.record(_id, 'E', 0);
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+  const TraceId _id;
+  const bool _on;
+};
+
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT2(a, b)
+#define TRACE_SCOPE(id, ...) TraceScope TRACE_CAT(_traceScope, __LINE__)(TraceId::id, ##__VA_ARGS__)
@@ -1,4 +1,231 @@
 #include "WebSerial.h"
 
+#include <esp_timer.h>
+#include <memory>
+
 // Single definition of the global instance
 WebSerialClass webSerial;
+
+namespace {
+// Record header (4 bytes, written last with release semantics):
+//   bits 31..16 payload length, bits 15..0 state
+constexpr uint32_t kStateEmpty = 0;
+constexpr uint32_t kStateReady = 1;
+constexpr uint32_t kStatePad   = 2;
+
+inline uint32_t recordSpan(uint32_t len) {
+  return 4 + ((len + 3) & ~3u);
+}
+}
+
+void WebSerialClass::enqueue(const uint8_t* data, size_t len) {
+  if (!_wsReady || !len) return;
+  const int64_t t0 = esp_timer_get_time();
+  while (len > 0) {
+    const uint32_t n = (uint32_t)min<size_t>(len, kMaxRecord);
+    if (!reserveAndCopy(data, n)) {
+      _dropped.fetch_add((uint32_t)len, std::memory_order_relaxed);
+      break;
+    }
+    data += n;
+    len -= n;
+  }
+  _writes.fetch_add(1, std::memory_order_relaxed);
+  _producerUs.fetch_add((uint32_t)(esp_timer_get_time() - t0), std::memory_order_relaxed);
+}
+
+// Claims space with a CAS on _head; a record never wraps, the tail end of the
+// ring is filled with a pad record instead. Never waits: full ring = drop.
+bool WebSerialClass::reserveAndCopy(const uint8_t* data, uint32_t len) {
+  const uint32_t need = recordSpan(len);
+  uint32_t head = _head.load(std::memory_order_relaxed);
+  uint32_t pad = 0;
+  while (true) {
+    const uint32_t contiguous = kRingSize - (head & (kRingSize - 1));
+    pad = (need <= contiguous) ? 0 : contiguous;
+    const uint32_t total = pad + need;
+    if (head + total - _tail.load(std::memory_order_acquire) > kRingSize) return false;
+    if (_head.compare_exchange_weak(head, head + total, std::memory_order_acq_rel, std::memory_order_relaxed)) break;
+  }
+
+  if (pad) {
+    uint8_t* p = &_ring[head & (kRingSize - 1)];
+    __atomic_store_n(reinterpret_cast<uint32_t*>(p), ((pad - 4) << 16) | kStatePad, __ATOMIC_RELEASE);
+    head += pad;
+  }
+
+  uint8_t* p = &_ring[head & (kRingSize - 1)];
+  memcpy(p + 4, data, len);
+  __atomic_store_n(reinterpret_cast<uint32_t*>(p), (len << 16) | kStateReady, __ATOMIC_RELEASE);
+  return true;
+}
+
+void WebSerialClass::loop() {
+  if (!_wsReady) return;
+  const int64_t t0 = esp_timer_get_time();
+  const uint32_t now = millis();
+
+  // Records are consumed in order; an unfinished one (still being copied) stops the drain.
+  uint32_t tail = _tail.load(std::memory_order_relaxed);
+  const uint32_t head = _head.load(std::memory_order_acquire);
+  while (tail != head) {
+    uint8_t* p = &_ring[tail & (kRingSize - 1)];
+    const uint32_t hdr = __atomic_load_n(reinterpret_cast<uint32_t*>(p), __ATOMIC_ACQUIRE);
+    const uint32_t state = hdr & 0xFFFF;
+    if (state == kStateEmpty) break;
+
+    const uint32_t len = hdr >> 16;
+    if (state == kStateReady) {
+      if (_frameLen == 0) _frameSinceMs = now;
+      appendToFrame(p + 4, len);
+      appendBacklog(p + 4, len);
+      if (_tap) _tap(p + 4, len);
+    }
+    // Zero the span so stale payload can never look like a ready header later
+    const uint32_t span = (state == kStatePad) ? len + 4 : recordSpan(len);
+    memset(p, 0, span);
+    tail += span;
+    _tail.store(tail, std::memory_order_release);
+  }
+
+  if (_frameLen) {
+    // Whole lines, at most one frame per kBatchMs; a dangling partial line after kMaxHoldMs
+    if (now - _lastSendMs >= kBatchMs) {
+      size_t cut = _frameLen;
+      while (cut > 0 && _frame[cut - 1] != '\n') cut--;
+      if (cut) sendFrame(cut);
+    }
+    if (_frameLen && now - _frameSinceMs >= kMaxHoldMs) sendFrame(_frameLen);
+  }
+
+  _drainUs += (uint32_t)(esp_timer_get_time() - t0);
+}
+
+void WebSerialClass::appendToFrame(const uint8_t* data, size_t len) {
+  while (len > 0) {
+    const size_t n = min(len, kFrameSize - _frameLen);
+    memcpy(_frame + _frameLen, data, n);
+    _frameLen += n;
+    data += n;
+    len -= n;
+    if (_frameLen == kFrameSize) sendFrame(_frameLen);
+  }
+}
+
+void WebSerialClass::sendFrame(size_t len) {
+  // The page adds its own line break per message
+  size_t sendLen = len;
+  while (sendLen > 0 && (_frame[sendLen - 1] == '\n' || _frame[sendLen - 1] == '\r')) sendLen--;
+  if (sendLen) {
+    _ws.write(reinterpret_cast<const uint8_t*>(_frame), sendLen);
+    _frames++;
+    _bytes += sendLen;
+  }
+
+  memmove(_frame, _frame + len, _frameLen - len);
+  _frameLen -= len;
+  _frameSinceMs = millis();
+  _lastSendMs = _frameSinceMs;
+}
+
+void WebSerialClass::appendBacklog(const uint8_t* data, size_t len) {
+  if (len > kBacklogSize) {
+    data += len - kBacklogSize;
+    len = kBacklogSize;
+  }
+  portENTER_CRITICAL(&_bkMux);
+  const uint32_t head = _bkHead.load(std::memory_order_relaxed);
+  const uint32_t at = head & (kBacklogSize - 1);
+  const size_t first = min<size_t>(len, kBacklogSize - at);
+  memcpy(_backlog + at, data, first);
+  memcpy(_backlog, data + first, len - first);
+  _bkHead.store(head + len, std::memory_order_relaxed);
+  if (head + len >= kBacklogSize) _bkFull.store(true, std::memory_order_relaxed);
+  portEXIT_CRITICAL(&_bkMux);
+}
+
+// Positions are free-running and wrap after 4 GB; compare by difference
+static inline bool lapped(uint32_t head, uint32_t pos, uint32_t size) {
+  return (int32_t)(head - pos) > (int32_t)size;
+}
+
+namespace {
+struct BacklogCursor {
+  uint32_t pos = 0;
+  uint32_t end = 0;
+  bool aligned = false;
+  bool gap = false;  // gap marker still to send
+};
+}
+
+// Runs on the AsyncTCP task while the loop task keeps appending. Each step
+// (at most kBacklogStep bytes) runs under _bkMux, so it never reads bytes the
+// writer is replacing. If the writer lapped the reader between steps a gap
+// marker is sent and reading continues at the first whole line still held.
+void WebSerialClass::serveBacklog(AsyncWebServerRequest* req) {
+  std::shared_ptr<BacklogCursor> c = std::make_shared<BacklogCursor>();
+  portENTER_CRITICAL(&_bkMux);
+  c->end = _bkHead.load(std::memory_order_relaxed);
+  const bool full = _bkFull.load(std::memory_order_relaxed);
+  portEXIT_CRITICAL(&_bkMux);
+  c->pos = full ? c->end - kBacklogSize : 0;
+  c->aligned = !full;
+  _bkReplays.fetch_add(1, std::memory_order_relaxed);
+
+  AsyncWebServerResponse* res = req->beginChunkedResponse("text/plain",
+    [this, c](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+      (void)index;
+      static const char kGap[] = "[...]\n";
+      size_t out = 0;
+      while (out < maxLen) {
+        if (c->gap) {
+          if (maxLen - out < sizeof(kGap) - 1) break;
+          memcpy(buf + out, kGap, sizeof(kGap) - 1);
+          out += sizeof(kGap) - 1;
+          c->gap = false;
+        }
+        if (c->pos == c->end) break;
+
+        portENTER_CRITICAL(&_bkMux);
+        const uint32_t head = _bkHead.load(std::memory_order_relaxed);
+        if (lapped(head, c->pos, kBacklogSize)) {
+          c->pos = ((int32_t)(c->end - (head - kBacklogSize)) > 0) ? head - kBacklogSize : c->end;
+          c->aligned = false;
+          c->gap = true;
+        } else if (!c->aligned) {
+          // Start at the first complete line
+          for (size_t k = 0; k < kBacklogStep && c->pos != c->end; k++) {
+            if (_backlog[c->pos++ & (kBacklogSize - 1)] == '\n') {
+              c->aligned = true;
+              break;
+            }
+          }
+        } else {
+          const size_t n = min<size_t>(min<size_t>(maxLen - out, c->end - c->pos), kBacklogStep);
+          const uint32_t at = c->pos & (kBacklogSize - 1);
+          const size_t first = min<size_t>(n, kBacklogSize - at);
+          memcpy(buf + out, _backlog + at, first);
+          memcpy(buf + out + first, _backlog, n - first);
+          c->pos += n;
+          out += n;
+        }
+        portEXIT_CRITICAL(&_bkMux);
+      }
+      return out;
+    });
+  res->addHeader("Cache-Control", "no-store");
+  req->send(res);
+}
+
+WebSerialClass::Stats WebSerialClass::stats() const {
+  Stats s;
+  s.frames = _frames;
+  s.bytes = _bytes;
+  s.writes = _writes.load(std::memory_order_relaxed);
+  s.dropped = _dropped.load(std::memory_order_relaxed);
+  s.producerUs = _producerUs.load(std::memory_order_relaxed);
+  s.drainUs = _drainUs;
+  s.backlogBytes = _bkFull.load(std::memory_order_relaxed) ? kBacklogSize : _bkHead.load(std::memory_order_relaxed);
+  s.backlogReplays = _bkReplays.load(std::memory_order_relaxed);
+  return s;
+}
@@ -1,24 +1,54 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 #include <MycilaWebSerial.h>
 
 class AsyncWebServer;
 
 // WebSerialClass mirrors Serial output to WebSerial (WS) and keeps Serial RX working.
+//
+// Serial gets every write immediately. The WS side goes through a lock-free
+// multi-producer ring (CAS on the reserve position, per-record ready flag), so
+// writers on any task (loop, AsyncTCP, OTA puller) never take a lock or block.
+// loop() drains it on the loop task and sends whole lines as one frame, batched
+// for up to kBatchMs; a partial line is forced out after kMaxHoldMs.
+//
+// The drain also copies everything into a fixed backlog ring (kBacklogSize,
+// the hard cap). serveBacklog() streams it straight from that ring into each
+// response buffer, so late-joining pages share one copy of the history.
 class WebSerialClass : public Stream {
 public:
+  struct Stats {
+    uint32_t frames = 0;      // WS messages sent
+    uint32_t bytes = 0;       // payload bytes sent
+    uint32_t writes = 0;      // write() calls accepted into the ring
+    uint32_t dropped = 0;     // bytes dropped because the ring was full
+    uint32_t producerUs = 0;  // time spent in write() (ring side only)
+    uint32_t drainUs = 0;     // time spent in loop() incl. sending
+    uint32_t backlogBytes = 0;    // bytes currently held in the backlog ring
+    uint32_t backlogReplays = 0;  // backlog responses served
+  };
+
   void begin(unsigned long baud = 115200) {
     Serial.begin(baud);
   }
 
-  void begin(AsyncWebServer* server, unsigned long baud = 115200, size_t bufferSize = 100) {
+  void begin(AsyncWebServer* server, unsigned long baud = 115200) {
     Serial.begin(baud);
 
     _ws.begin(server);
-    _ws.setBuffer(bufferSize);
-
-    _ws.onMessage([](const std::string& msg) {
+    _wsReady = true;
+
+    _ws.onMessage([this](const std::string& msg) {
+      if (msg == kAttachMsg) {
+        _lastAttachMs.store(millis(), std::memory_order_relaxed);
+        return;
+      }
+      if (_rx) {
+        _rx(msg);
+        return;
+      }
       Serial.print("[WebSerial RX] ");
       Serial.println(msg.c_str());
     });
@@ -35,7 +65,12 @@ public:
 #endif
 
   void onMessage(std::function<void(const std::string&)> cb) {
-    _ws.onMessage(cb);
+    _rx = cb;
+  }
+
+  // Loop task: receives every byte that goes out on the WS path (persistent log)
+  void setTap(std::function<void(const uint8_t*, size_t)> tap) {
+    _tap = tap;
   }
 
   void setAuthentication(const char* user, const char* pass) {
@@ -44,10 +79,26 @@ public:
     }
   }
 
-  void setBuffer(size_t size) {
-    _ws.setBuffer(size);
+  // Call from loop(): moves ring contents into WS frames
+  void loop();
+
+  Stats stats() const;
+
+  // GET /logtail: the backlog as text, oldest complete line first. The page
+  // fetches it before opening the WebSocket.
+  void serveBacklog(AsyncWebServerRequest* req);
+
+  // True while someone reads the log: a WebSerial page is open (it sends
+  // kAttachMsg with every ping) or serial logging is switched on. Deferred
+  // records (Log.h) are only formatted while this holds.
+  bool consumerAttached() const {
+    if (_serialConsumer) return true;
+    const uint32_t last = _lastAttachMs.load(std::memory_order_relaxed);
+    return last && (millis() - last < kAttachTimeoutMs);
   }
 
+  void setSerialConsumer(bool on) { _serialConsumer = on; }
+
   // Stream
   int available() override { return Serial.available(); }
   int read() override { return Serial.read(); }
@@ -56,13 +107,13 @@ public:
 
   size_t write(uint8_t b) override {
     Serial.write(b);
-    _ws.write(&b, 1);
+    enqueue(&b, 1);
     return 1;
   }
 
   size_t write(const uint8_t* buffer, size_t size) override {
     Serial.write(buffer, size);
-    _ws.write(buffer, size);
+    enqueue(buffer, size);
     return size;
   }
 
@@ -70,7 +121,59 @@ public:
   operator bool() { return (bool)Serial; }
 
 private:
+  static const uint32_t kRingSize = 4096;      // power of two
+  static const uint32_t kMaxRecord = 512;      // longer writes are split
+  static const size_t   kFrameSize = 1024;
+  static const uint32_t kBatchMs = 20;
+  static const uint32_t kMaxHoldMs = 100;
+  static const uint32_t kAttachTimeoutMs = 6000;
+  static const uint32_t kBacklogSize = 8192;   // power of two
+  static const size_t   kBacklogStep = 512;    // most bytes copied per critical section
+  static constexpr const char* kAttachMsg = "attach";
+
+  void enqueue(const uint8_t* data, size_t len);
+  bool reserveAndCopy(const uint8_t* data, uint32_t len);
+  void appendToFrame(const uint8_t* data, size_t len);
+  void sendFrame(size_t len);
+  void appendBacklog(const uint8_t* data, size_t len);
+
   WebSerial _ws;
+  bool _wsReady = false;
+  std::function<void(const std::string&)> _rx;
+  std::function<void(const uint8_t*, size_t)> _tap;
+
+  std::atomic<uint32_t> _lastAttachMs{0};
+#ifdef LOG_SERIAL
+  bool _serialConsumer = true;
+#else
+  bool _serialConsumer = false;
+#endif
+
+  alignas(4) uint8_t _ring[kRingSize] = {0};
+  std::atomic<uint32_t> _head{0}; // next reserve position (monotonic)
+  std::atomic<uint32_t> _tail{0}; // next record to drain (monotonic)
+
+  // loop task only
+  char     _frame[kFrameSize];
+  size_t   _frameLen = 0;
+  uint32_t _frameSinceMs = 0;
+  uint32_t _lastSendMs = 0;
+
+  // Backlog: written by the loop task only. _bkMux covers every copy into or
+  // out of _backlog together with the _bkHead update, so a reader sees whole
+  // appends and knows exactly which bytes are still valid.
+  char _backlog[kBacklogSize];
+  std::atomic<uint32_t> _bkHead{0};
+  mutable portMUX_TYPE _bkMux = portMUX_INITIALIZER_UNLOCKED;
+  std::atomic<uint32_t> _bkReplays{0};
+  std::atomic<bool> _bkFull{false};
+
+  std::atomic<uint32_t> _writes{0};
+  std::atomic<uint32_t> _dropped{0};
+  std::atomic<uint32_t> _producerUs{0};
+  uint32_t _frames = 0;
+  uint32_t _bytes = 0;
+  uint32_t _drainUs = 0;
 };
 
 // Global instance (defined in webSerial.cpp)
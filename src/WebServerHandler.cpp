@@ -1,23 +1,59 @@
 #include "WebServerHandler.h"
 #include <WiFi.h>
 #include <ArduinoJson.h>
-#include <esp_timer.h>
-#include <Update.h>
+#include <esp_random.h>
+#include <esp_heap_caps.h>
 #include "SettingsPrefs.h"
 #include "WiFiManager.h"
 #include "www.h"
 #include "WebSerial.h"
+#include "Log.h"
 #include "bblPrinterDiscovery.h"
 #include "BambuMqttClient.h"
 #include "LedController.h"
+#include "OtaUpdater.h"
+#include "OtaPuller.h"
+#include "PeerOta.h"
+#include "PersistLog.h"
+#include "SyslogSink.h"
+#include "HaPublisher.h"
+#include "BeaconLink.h"
+#include "AnimSync.h"
+#include "ReportProxy.h"
+#include "StatusCbor.h"
+#include "LoopStats.h"
+#include "Trace.h"
+#include "TaskStats.h"
+#include "CrashContext.h"
+#include "RestartScheduler.h"
 
 extern Settings settings;
 extern WiFiManager wifiManager;
 extern BBLPrinterDiscovery printerDiscovery;
 extern BambuMqttClient bambu;
 extern LedController ledsCtrl;
+extern OtaUpdater otaUpdater;
+extern OtaPuller otaPuller;
+extern PeerOta peerOta;
+extern PersistLog persistLog;
+extern SyslogSink syslogSink;
+extern HaPublisher haPublisher;
+extern BeaconLink beaconLink;
+extern AnimSync animSync;
+extern ReportProxy reportProxy;
+extern LoopStats loopStats;
 static void scheduleRestart(uint32_t delayMs);
 
+namespace {
+// Admission budgets: free heap and largest contiguous block that must be available
+// before a handler may run. Sized for what the handler allocates plus TCP/response overhead.
+constexpr WebServerHandler::RouteBudget kBudgetPage   = { 10UL * 1024UL, 4UL * 1024UL };
+constexpr WebServerHandler::RouteBudget kBudgetJson   = { 16UL * 1024UL, 8UL * 1024UL };
+constexpr WebServerHandler::RouteBudget kBudgetUpload = { 32UL * 1024UL, 8UL * 1024UL };
+constexpr uint8_t  kMaxInFlight = 6;
+constexpr uint32_t kRetryAfterSec = 2;
+}
+
 const uint8_t* webserialHtml() {
   return WebSerial_html_gz;
 }
@@ -98,31 +134,244 @@ namespace NetScanCache
   }
 } // namespace NetScanCache
 
-// -------------------- Restart scheduling (no delay in handlers) --------------------
-static void bb_restart_cb(void* arg)
+// -------------------- Versioned /api/state document --------------------
+// One document for device info, printer telemetry, HMS, discovery and LED config.
+// Every section carries the version at which it last changed. Clients pass
+// ?since=<version>&boot=<boot> and get only newer sections, or 304 if nothing changed.
+// Change detection hashes each section's serialized form, so no producer needs hooks.
+namespace StateDoc
 {
-  (void)arg;
-  ESP.restart();
-}
+  static const char* const kSections[] = { "device", "printer", "hms", "discovery", "led" };
+  static const size_t kSectionCount = sizeof(kSections) / sizeof(kSections[0]);
+
+  static uint32_t bootId = 0;
+  static uint32_t version = 0;
+  static uint32_t sectionVersion[kSectionCount] = {0};
+  static uint32_t sectionHash[kSectionCount] = {0};
+
+  // FNV-1a over the serialized bytes, avoids building a String per section
+  class HashPrint : public Print {
+  public:
+    size_t write(uint8_t b) override {
+      _h = (_h ^ b) * 16777619UL;
+      return 1;
+    }
+    uint32_t value() const { return _h; }
+  private:
+    uint32_t _h = 2166136261UL;
+  };
+
+  static const char* severityName(uint8_t sev)
+  {
+    static const char* const names[] = { "None", "Info", "Warning", "Error", "Fatal" };
+    return sev < 5 ? names[sev] : "None";
+  }
+
+  static void fillDevice(JsonObject o)
+  {
+    o["deviceName"] = settings.get.deviceName();
+    o["mode"] = wifiManager.isApMode() ? "AP" : "STA";
+    o["ip"] = wifiManager.isApMode() ? WiFi.softAPIP().toString() : WiFi.localIP().toString();
+    // 5 dB steps: the raw value changes on nearly every poll and would bump the version
+    o["rssi"] = (WiFi.status() == WL_CONNECTED) ? (int)lroundf(WiFi.RSSI() / 5.0f) * 5 : 0;
+    o["version"] = STRVERSION;
+  }
 
+  static void fillPrinter(JsonObject o, const PrinterState& ps)
+  {
+    o["connected"] = ps.connected;
+    o["gcodeState"] = ps.gcodeState;
+    if (ps.printProgress <= 100) o["printProgress"] = ps.printProgress;
+    else o["printProgress"] = nullptr;
+    if (ps.downloadProgress <= 100) o["downloadProgress"] = ps.downloadProgress;
+    else o["downloadProgress"] = nullptr;
+    if (ps.remainingMin != 0xFFFF) o["remainingMin"] = ps.remainingMin;
+    else o["remainingMin"] = nullptr;
+    // 0.1 C resolution, sensor noise below that would only bump the version
+    if (ps.bedValid) {
+      o["bedTemp"] = roundf(ps.bedTemp * 10.0f) / 10.0f;
+      o["bedTarget"] = roundf(ps.bedTarget * 10.0f) / 10.0f;
+    }
+    if (ps.nozzleValid) {
+      o["nozzleTemp"] = roundf(ps.nozzleTemp * 10.0f) / 10.0f;
+      o["nozzleTarget"] = roundf(ps.nozzleTarget * 10.0f) / 10.0f;
+    }
+    o["nozzleHeating"] = ps.nozzleHeating;
+  }
+
+  static void fillHms(JsonObject o, const PrinterState& ps)
+  {
+    o["top"] = severityName(ps.hmsTop);
+    o["active"] = ps.hmsCount;
+    JsonArray arr = o["events"].to<JsonArray>();
+    const uint8_t n = ps.hmsCount < PrinterState::kMaxHms ? ps.hmsCount : PrinterState::kMaxHms;
+    for (uint8_t i = 0; i < n; i++) {
+      char code[24];
+      BambuMqttClient::formatHmsCodeStr(ps.hms[i].full, code);
+      JsonObject e = arr.add<JsonObject>();
+      e["code"] = code;
+      e["severity"] = severityName(ps.hms[i].severity);
+    }
+  }
+
+  static void fillDiscovery(JsonObject o)
+  {
+    o["busy"] = printerDiscovery.isBusy();
+    JsonArray arr = o["printers"].to<JsonArray>();
+    const int n = printerDiscovery.knownCount();
+    const BBLPrinter* printers = printerDiscovery.knownPrinters();
+    for (int i = 0; i < n; i++) {
+      JsonObject p = arr.add<JsonObject>();
+      p["usn"] = printers[i].usn;
+      p["ip"] = printers[i].ip.toString();
+    }
+  }
+
+  static void fillLed(JsonObject o)
+  {
+    o["ledBrightness"] = settings.get.LEDBrightness();
+    o["ledSegments"] = settings.get.LEDSegments();
+    o["ledPerSeg"] = settings.get.LEDperSeg();
+    o["ledMaxCurrentmA"] = settings.get.LEDMaxCurrentmA();
+    o["ledReverseOrder"] = settings.get.LEDReverseOrder();
+    o["testMode"] = ledsCtrl.testMode();
+  }
+
+  // Builds all sections into doc and bumps versions of the ones that changed.
+  static void build(JsonDocument& doc)
+  {
+    if (bootId == 0) bootId = esp_random() | 1UL;
+
+    PrinterState ps;
+    bambu.snapshot(ps);
+
+    fillDevice(doc["device"].to<JsonObject>());
+    fillPrinter(doc["printer"].to<JsonObject>(), ps);
+    fillHms(doc["hms"].to<JsonObject>(), ps);
+    fillDiscovery(doc["discovery"].to<JsonObject>());
+    fillLed(doc["led"].to<JsonObject>());
+
+    bool changed = false;
+    uint32_t hashes[kSectionCount];
+    for (size_t i = 0; i < kSectionCount; i++) {
+      HashPrint hp;
+      serializeJson(doc[kSections[i]], hp);
+      hashes[i] = hp.value();
+      if (version == 0 || hashes[i] != sectionHash[i]) changed = true;
+    }
+    if (changed) {
+      version++;
+      for (size_t i = 0; i < kSectionCount; i++) {
+        if (sectionVersion[i] == 0 || hashes[i] != sectionHash[i]) {
+          sectionHash[i] = hashes[i];
+          sectionVersion[i] = version;
+        }
+      }
+    }
+
+    for (size_t i = 0; i < kSectionCount; i++) {
+      doc[kSections[i]]["v"] = sectionVersion[i];
+    }
+    doc["boot"] = bootId;
+    doc["version"] = version;
+  }
+
+  // Drops sections not newer than since. Returns false if nothing is left.
+  static bool filterSince(JsonDocument& doc, uint32_t since)
+  {
+    bool any = false;
+    for (size_t i = 0; i < kSectionCount; i++) {
+      if (sectionVersion[i] > since) any = true;
+      else doc.remove(kSections[i]);
+    }
+    return any;
+  }
+} // namespace StateDoc
+
+// -------------------- Restart scheduling (no delay in handlers) --------------------
+// The loop task flushes the persistent log first (RestartScheduler)
 static void scheduleRestart(uint32_t delayMs)
 {
-  esp_timer_handle_t t = nullptr;
-  esp_timer_create_args_t args = {};
-  args.callback = &bb_restart_cb;
-  args.arg = nullptr;
-  args.dispatch_method = ESP_TIMER_TASK;
-  args.name = "bb_restart";
-
-  if (esp_timer_create(&args, &t) == ESP_OK && t) {
-    esp_timer_start_once(t, (uint64_t)delayMs * 1000ULL);
-  } else {
-    ESP.restart();
-  }
+  restartScheduler.request(delayMs);
 }
 
 WebServerHandler::WebServerHandler(AsyncWebServer& s) : server(s) {}
 
+bool WebServerHandler::admit(AsyncWebServerRequest* req, const RouteBudget& budget, bool respond) {
+  const uint32_t freeHeap = ESP.getFreeHeap();
+  const uint32_t largest = ESP.getMaxAllocHeap();
+
+  bool ok = true;
+  if (_inFlight >= kMaxInFlight) {
+    _rejectedBusy++;
+    ok = false;
+  } else if (freeHeap < budget.minFreeHeap) {
+    _rejectedHeap++;
+    ok = false;
+  } else if (largest < budget.minLargestBlock) {
+    _rejectedBlock++;
+    ok = false;
+  }
+
+  if (!ok) {
+    if (respond) sendBusy(req);
+    else req->onDisconnect([this, req]() { forgetUpload(req); });
+    return false;
+  }
+
+  _admitted++;
+  _inFlight++;
+  if (_inFlight > _peakInFlight) _peakInFlight = _inFlight;
+  const uint16_t cookie = (uint16_t)_admitted;
+  tracer.asyncBegin(TraceId::HttpInFlight, cookie);
+  req->onDisconnect([this, req, cookie]() {
+    tracer.asyncEnd(TraceId::HttpInFlight, cookie);
+    if (_inFlight) _inFlight--;
+    forgetUpload(req);
+  });
+  return true;
+}
+
+// Uploads are checked once, on the first body chunk (before anything is
+// buffered), and answered in the final handler. Only one upload may run at a
+// time; a request refused at index 0 stays refused for the rest of its body.
+bool WebServerHandler::admitUpload(AsyncWebServerRequest* req, const RouteBudget& budget, size_t index) {
+  if (req == _uploadAdmitted) return true;
+  if (index != 0) return false;
+
+  const bool busy = (_uploadAdmitted != nullptr);
+  if (busy) _rejectedBusy++;
+  if (busy || !admit(req, budget, false)) return false;
+  _uploadAdmitted = req;
+  return true;
+}
+
+// Called from the final upload handler. Sends 503 and returns false if the upload was refused.
+bool WebServerHandler::finishUpload(AsyncWebServerRequest* req, const RouteBudget& budget) {
+  if (req == _uploadAdmitted) return true;
+  if (req->contentLength() > 0) {
+    // Had a body, but not as the admitted upload
+    sendBusy(req);
+    return false;
+  }
+  return admit(req, budget); // request without body
+}
+
+void WebServerHandler::forgetUpload(AsyncWebServerRequest* req) {
+  if (_uploadAdmitted == req) {
+    // Client went away mid-upload: do not leave Update half-open
+    if (otaUpdater.ownedBy(req)) otaUpdater.abort("client disconnected");
+    _uploadAdmitted = nullptr;
+  }
+}
+
+void WebServerHandler::sendBusy(AsyncWebServerRequest* req) {
+  AsyncWebServerResponse* r = req->beginResponse(503, "application/json", "{\"success\":false,\"reason\":\"busy\"}");
+  r->addHeader("Retry-After", String(kRetryAfterSec));
+  r->addHeader("Cache-Control", "no-store");
+  req->send(r);
+}
+
 bool WebServerHandler::isAuthorized(AsyncWebServerRequest* req) {
   // If user is empty => no auth
   if (!settings.get.webUIuser() || !*settings.get.webUIuser()) return true;
@@ -136,6 +385,45 @@ void WebServerHandler::sendGz(AsyncWebServerRequest* req, const uint8_t* data, s
   req->send(r);
 }
 
+void WebServerHandler::handleStatusCbor(AsyncWebServerRequest* req) {
+  using namespace statuscbor;
+  PrinterState ps;
+  bambu.snapshot(ps);
+  const uint32_t now = millis();
+
+  uint8_t buf[kMaxLen];
+  Writer w(buf, sizeof(buf));
+  w.map(kKeyCount);
+  w.key(kKeySchema);       w.uint(kSchema);
+  w.key(kKeyUptimeMs);     w.uint(now);
+  w.key(kKeyFw);           w.text(STRVERSION);
+  w.key(kKeyRssi);         w.sint((WiFi.status() == WL_CONNECTED) ? WiFi.RSSI() : 0);
+  w.key(kKeyHeapFree);     w.uint(ESP.getFreeHeap());
+  w.key(kKeyHeapBlock);    w.uint(ESP.getMaxAllocHeap());
+  w.key(kKeyConnected);    w.boolean(ps.connected);
+  w.key(kKeyGcodeState);   w.text(ps.gcodeState);
+  w.key(kKeyProgress);     if (ps.printProgress <= 100) w.uint(ps.printProgress); else w.null();
+  w.key(kKeyDownload);     if (ps.downloadProgress <= 100) w.uint(ps.downloadProgress); else w.null();
+  w.key(kKeyRemainingMin); if (ps.remainingMin != 0xFFFF) w.uint(ps.remainingMin); else w.null();
+  w.key(kKeyBed);          if (ps.bedValid) w.sint(lroundf(ps.bedTemp * 10.0f)); else w.null();
+  w.key(kKeyBedTarget);    if (ps.bedValid) w.sint(lroundf(ps.bedTarget * 10.0f)); else w.null();
+  w.key(kKeyNozzle);       if (ps.nozzleValid) w.sint(lroundf(ps.nozzleTemp * 10.0f)); else w.null();
+  w.key(kKeyNozzleTarget); if (ps.nozzleValid) w.sint(lroundf(ps.nozzleTarget * 10.0f)); else w.null();
+  w.key(kKeyHmsTop);       w.uint(ps.hmsTop);
+  w.key(kKeyHmsCount);     w.uint(ps.hmsCount);
+  w.key(kKeyReportAgeMs);  if (ps.lastReportMs) w.uint(now - ps.lastReportMs); else w.null();
+
+  if (!w.ok()) {
+    req->send(500, "text/plain", "Status too large");
+    return;
+  }
+  // The stream copies: buf lives on this stack frame only
+  AsyncResponseStream* res = req->beginResponseStream("application/cbor", w.length());
+  res->write(buf, w.length());
+  res->addHeader("Cache-Control", "no-store");
+  req->send(res);
+}
+
 void WebServerHandler::handleNetlist(AsyncWebServerRequest* req) {
   // Never run synchronous WiFi scans inside AsyncTCP handlers.
   // Trigger async scan and return cached results immediately.
@@ -175,6 +463,20 @@ void WebServerHandler::handleSubmitConfig(AsyncWebServerRequest* req) {
   settings.set.webUIuser(getP("webUser"));
   settings.set.webUIPass(getP("webPass"));
 
+  settings.set.syslogHost(getP("syslogHost"));
+  const String syslogPort = getP("syslogPort");
+  if (syslogPort.length()) settings.set.syslogPort((uint16_t)syslogPort.toInt());
+
+  settings.set.haHost(getP("haHost"));
+  const String haPort = getP("haPort");
+  if (haPort.length()) settings.set.haPort((uint16_t)haPort.toInt());
+  settings.set.haUser(getP("haUser"));
+  settings.set.haPass(getP("haPass"));
+  const String haPrefix = getP("haPrefix");
+  if (haPrefix.length()) settings.set.haPrefix(haPrefix);
+  const String haMinInterval = getP("haMinInterval");
+  if (haMinInterval.length()) settings.set.haMinInterval((uint16_t)haMinInterval.toInt());
+
   settings.save();
 
   req->send(200, "application/json", "{\"success\":true}");
@@ -244,10 +546,20 @@ void WebServerHandler::handleSubmitPrinterConfig(AsyncWebServerRequest* req) {
     settings.set.LEDReverseOrder(enabled);
   }
 
+  if (req->hasParam("relay", true)) {
+    settings.set.relayEnabled(getP("relay") == "1");
+  }
+
+  if (req->hasParam("ledsync", true)) {
+    settings.set.LEDSync(getP("ledsync") == "1");
+  }
+
   settings.save();
   ledsCtrl.applySettingsFrom(settings);
 
   bambu.reloadFromSettings();
+  beaconLink.reload();
+  animSync.reload();
   if (WiFi.status() == WL_CONNECTED) bambu.connect();
 
   req->send(200, "application/json", "{\"success\":true}");
@@ -257,6 +569,51 @@ void WebServerHandler::handleSubmitPrinterConfig(AsyncWebServerRequest* req) {
   }
 }
 
+void WebServerHandler::handleOtaPullStatus(AsyncWebServerRequest* req, int code) {
+  const OtaPuller::Status st = otaPuller.status();
+  JsonDocument doc;
+  doc["success"] = (code == 200);
+  doc["state"] = OtaPuller::stateName(st.state);
+  doc["url"] = settings.get.otaUrl();
+  doc["rateKBps"] = settings.get.otaRateKBps();
+  doc["received"] = st.received;
+  doc["total"] = st.total;
+  doc["resumes"] = st.resumes;
+  doc["peer"] = st.peer;
+  doc["p2p"] = settings.get.otaP2P();
+  doc["fleetKey"] = settings.get.otaFleetKey();
+  if (st.rateBps) doc["avgBps"] = st.rateBps;
+  if (st.error[0]) doc["reason"] = st.error;
+
+  String out;
+  serializeJson(doc, out);
+  req->send(code, "application/json", out);
+}
+
+void WebServerHandler::handleApiState(AsyncWebServerRequest* req) {
+  JsonDocument doc;
+  StateDoc::build(doc);
+
+  // since only applies to the same boot, versions restart after a reboot
+  const bool sameBoot = req->hasParam("boot") &&
+                        (uint32_t)strtoul(req->getParam("boot")->value().c_str(), nullptr, 10) == StateDoc::bootId;
+  if (sameBoot && req->hasParam("since")) {
+    const uint32_t since = (uint32_t)strtoul(req->getParam("since")->value().c_str(), nullptr, 10);
+    if (!StateDoc::filterSince(doc, since)) {
+      AsyncWebServerResponse* r = req->beginResponse(304);
+      r->addHeader("Cache-Control", "no-store");
+      req->send(r);
+      return;
+    }
+  }
+
+  String out;
+  serializeJson(doc, out);
+  AsyncWebServerResponse* r = req->beginResponse(200, "application/json", out);
+  r->addHeader("Cache-Control", "no-store");
+  req->send(r);
+}
+
 void WebServerHandler::handleLedTestCmd(AsyncWebServerRequest* req) {
   auto getP = [&](const char* name) -> String {
     if (!req->hasParam(name, true)) return "";
@@ -304,6 +661,7 @@ void WebServerHandler::handleLedTestCmd(AsyncWebServerRequest* req) {
 
 void WebServerHandler::begin() {
   auto captivePortalResponse = [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     if (wifiManager.isApMode()) {
       sendGz(req, WiFiSetup_html_gz, WiFiSetup_html_gz_len, WiFiSetup_html_gz_mime);
       return;
@@ -313,6 +671,7 @@ void WebServerHandler::begin() {
 
   // Root
   server.on("/", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     if (wifiManager.isApMode()) {
       req->redirect("/wifisetup");
       return;
@@ -323,6 +682,7 @@ void WebServerHandler::begin() {
 
   // WiFi setup should always be reachable in AP mode without login
   server.on("/wifisetup", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -341,6 +701,7 @@ void WebServerHandler::begin() {
   server.on("/fwlink", HTTP_GET, captivePortalResponse);
 
   server.on("/printersetup", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -348,6 +709,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/maintenance", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -355,6 +717,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/ledtest", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -362,22 +725,27 @@ void WebServerHandler::begin() {
   });
 
   server.on("/style.css", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     sendGz(req, Style_css_gz, Style_css_gz_len, Style_css_gz_mime);
   });
 
   server.on("/logo.svg", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     sendGz(req, logo_svg_gz, logo_svg_gz_len, logo_svg_gz_mime);
   });
 
   server.on("/favicon.ico", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     sendGz(req, logo_ico_gz, logo_ico_gz_len, logo_ico_gz_mime);
   });
 
   server.on("/backgroundCanvas.js", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     sendGz(req, backgroundCanvas_js_gz, backgroundCanvas_js_gz_len, backgroundCanvas_js_gz_mime);
   });
 
   server.on("/netlist", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -385,6 +753,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/bblprinterdiscovery", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -392,6 +761,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/submitConfig", HTTP_POST, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -399,6 +769,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/submitPrinterConfig", HTTP_POST, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -406,6 +777,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/ledtestcmd", HTTP_POST, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -413,6 +785,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/config/backup", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -427,6 +800,7 @@ void WebServerHandler::begin() {
 
   server.on("/config/restore", HTTP_POST,
     [&](AsyncWebServerRequest* req) {
+      if (!finishUpload(req, kBudgetJson)) return;
       if (!wifiManager.isApMode()) {
         if (!isAuthorized(req)) {
           if (req->_tempObject) {
@@ -453,6 +827,10 @@ void WebServerHandler::begin() {
     },
     nullptr,
     [&](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t index, size_t total) {
+      // The whole body is buffered, so it must fit into one block
+      const RouteBudget budget = { kBudgetJson.minFreeHeap + (uint32_t)total,
+                                   kBudgetJson.minLargestBlock + (uint32_t)total };
+      if (!admitUpload(req, budget, index)) return;
       if (!wifiManager.isApMode() && !isAuthorized(req)) return;
       String* body = (String*)req->_tempObject;
       if (!body) {
@@ -466,33 +844,140 @@ void WebServerHandler::begin() {
 
   server.on("/update", HTTP_POST,
     [&](AsyncWebServerRequest* req) {
+      if (!finishUpload(req, kBudgetJson)) return;
       if (!wifiManager.isApMode()) {
         if (!isAuthorized(req)) return req->requestAuthentication();
       }
-      const bool ok = !Update.hasError();
-      req->send(ok ? 200 : 500, "application/json", ok ? "{\"success\":true}" : "{\"success\":false}");
+      if (otaUpdater.ownedBy(req)) otaUpdater.abort("upload incomplete");
+
+      const OtaUpdater::SessionStats& stats = otaUpdater.lastSession();
+      const bool ok = (stats.owner == req) && stats.ok;
+      JsonDocument doc;
+      doc["success"] = ok;
+      if (!ok) {
+        if (otaUpdater.active()) doc["reason"] = "another update is in progress";
+        else doc["reason"] = otaUpdater.hasError() ? otaUpdater.error() : "no image";
+      }
+      doc["bytes"] = stats.bytes;
+      doc["ms"] = stats.ms;
+      doc["quiesce"] = stats.quiesced;
+      String out;
+      serializeJson(doc, out);
+      req->send(ok ? 200 : 500, "application/json", out);
       if (ok) scheduleRestart(600);
     },
     [&](AsyncWebServerRequest* req, String filename, size_t index, uint8_t* data, size_t len, bool final) {
       (void)filename;
+      // gzip images additionally need the inflate window
+      RouteBudget budget = kBudgetUpload;
+      if (index == 0 && len > 0) {
+        const uint32_t extra = (uint32_t)OtaUpdater::workingSetBytes(data[0] == 0x1F);
+        budget.minFreeHeap += extra;
+        if (extra > budget.minLargestBlock) budget.minLargestBlock = extra;
+      }
+      if (!admitUpload(req, budget, index)) return;
       if (!wifiManager.isApMode() && !isAuthorized(req)) return;
       if (index == 0) {
-        if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
-          Update.printError(webSerial);
-        }
-      }
-      if (Update.write(data, len) != len) {
-        Update.printError(webSerial);
-      }
-      if (final) {
-        if (!Update.end(true)) {
-          Update.printError(webSerial);
-        }
+        const AsyncWebHeader* sha = req->getHeader("X-Firmware-SHA256");
+        // ?quiesce=0 keeps background work running (for throughput comparisons)
+        const bool quiesce = !(req->hasParam("quiesce") && req->getParam("quiesce")->value() == "0");
+        otaUpdater.begin(req, sha ? sha->value().c_str() : nullptr, (uint32_t)req->contentLength(), quiesce);
       }
+      if (!otaUpdater.ownedBy(req)) return;
+      if (!otaUpdater.write(data, len)) return;
+      if (final) otaUpdater.end();
     }
   );
 
+  server.on("/ota/p2p", HTTP_POST, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!wifiManager.isApMode()) {
+      if (!isAuthorized(req)) return req->requestAuthentication();
+    }
+    const bool hasKey = req->hasParam("key", true);
+    if (!req->hasParam("enabled", true) && !hasKey) {
+      req->send(400, "application/json", "{\"success\":false}");
+      return;
+    }
+    if (hasKey) {
+      String key = req->getParam("key", true)->value();
+      key.trim();
+      if (key.length() && key.length() < PeerOta::kMinFleetKeyLen) {
+        req->send(400, "application/json", "{\"success\":false,\"reason\":\"fleet key too short\"}");
+        return;
+      }
+      settings.set.otaFleetKey(key);
+    }
+    if (req->hasParam("enabled", true)) settings.set.otaP2P(req->getParam("enabled", true)->value() == "1");
+    settings.save();
+    req->send(200, "application/json", "{\"success\":true}");
+  });
+
+  // Running image for peer beacons (P2P setting only). No login: the image is
+  // the public release build, and pullers verify it against the fleet-key mac (PeerOta)
+  server.on("/firmware.bin", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    peerOta.serveImage(req);
+  });
+
+  // Pull OTA: GET = status, POST url/sha256/rate[/unverified] = start (url and rate are saved),
+  // POST peer=1 = from the best peer beacon, POST cancel=1 = stop
+  server.on("/ota/pull", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!wifiManager.isApMode()) {
+      if (!isAuthorized(req)) return req->requestAuthentication();
+    }
+    handleOtaPullStatus(req);
+  });
+
+  server.on("/ota/pull", HTTP_POST, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!wifiManager.isApMode()) {
+      if (!isAuthorized(req)) return req->requestAuthentication();
+    }
+
+    if (req->hasParam("cancel", true)) {
+      otaPuller.cancel();
+      handleOtaPullStatus(req);
+      return;
+    }
+
+    const bool peer = req->hasParam("peer", true) && req->getParam("peer", true)->value() == "1";
+    String url = req->hasParam("url", true) ? req->getParam("url", true)->value() : String(settings.get.otaUrl());
+    url.trim();
+    // unverified=1: explicit opt-out for servers without .sha256 files
+    const bool unverified = req->hasParam("unverified", true) && req->getParam("unverified", true)->value() == "1";
+    String sha = req->hasParam("sha256", true) ? req->getParam("sha256", true)->value() : String();
+    if (sha.isEmpty() && unverified && !peer) sha = OtaUpdater::kUnverified;
+    uint16_t rate = settings.get.otaRateKBps();
+    if (req->hasParam("rate", true)) {
+      const long v = req->getParam("rate", true)->value().toInt();
+      rate = (uint16_t)constrain(v, 0L, 4096L);
+    }
+    if (url.isEmpty() && !peer) {
+      req->send(400, "application/json", "{\"success\":false,\"reason\":\"no url\"}");
+      return;
+    }
+    if (otaPuller.busy() || otaUpdater.active()) {
+      req->send(409, "application/json", "{\"success\":false,\"reason\":\"update in progress\"}");
+      return;
+    }
+
+    if ((!peer && url != settings.get.otaUrl()) || rate != settings.get.otaRateKBps()) {
+      if (!peer) settings.set.otaUrl(url);
+      settings.set.otaRateKBps(rate);
+      settings.save();
+    }
+    const bool started = peer ? otaPuller.startPeer(sha, rate) : otaPuller.start(url, sha, rate);
+    if (!started) {
+      handleOtaPullStatus(req, 400);
+      return;
+    }
+    handleOtaPullStatus(req);
+  });
+
   server.on("/netconf.json", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -511,6 +996,14 @@ void WebServerHandler::begin() {
     doc["webUser"] = settings.get.webUIuser();
     // FIX: return the password, not the user name
     doc["webPass"] = settings.get.webUIPass();
+    doc["syslogHost"] = settings.get.syslogHost();
+    doc["syslogPort"] = settings.get.syslogPort();
+    doc["haHost"] = settings.get.haHost();
+    doc["haPort"] = settings.get.haPort();
+    doc["haUser"] = settings.get.haUser();
+    doc["haPass"] = settings.get.haPass();
+    doc["haPrefix"] = settings.get.haPrefix();
+    doc["haMinInterval"] = settings.get.haMinInterval();
 
     String out;
     serializeJson(doc, out);
@@ -518,6 +1011,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/printerconf.json", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -530,6 +1024,8 @@ void WebServerHandler::begin() {
     doc["ledPerSeg"] = settings.get.LEDperSeg();
     doc["ledMaxCurrentmA"] = settings.get.LEDMaxCurrentmA();
     doc["ledReverseOrder"] = settings.get.LEDReverseOrder();
+    doc["relayEnabled"] = settings.get.relayEnabled();
+    doc["ledSync"] = settings.get.LEDSync();
 
     String out;
     serializeJson(doc, out);
@@ -537,6 +1033,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/ledconf.json", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -550,6 +1047,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/setLedBrightness", HTTP_POST, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!wifiManager.isApMode()) {
       if (!isAuthorized(req)) return req->requestAuthentication();
     }
@@ -572,6 +1070,7 @@ void WebServerHandler::begin() {
   });
 
   server.on("/info.json", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
     if (!isAuthorized(req)) return req->requestAuthentication();
 
     JsonDocument doc;
@@ -586,7 +1085,236 @@ void WebServerHandler::begin() {
     req->send(200, "application/json", out);
   });
 
+  // Fleet polling: fixed-schema CBOR (StatusCbor.h), ~100 bytes, no JsonDocument
+  server.on("/status.cbor", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+    handleStatusCbor(req);
+  });
+
+  server.on("/metrics.json", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+
+    JsonDocument doc;
+    JsonObject heap = doc["heap"].to<JsonObject>();
+    heap["free"] = ESP.getFreeHeap();
+    heap["largestBlock"] = ESP.getMaxAllocHeap();
+    heap["minFree"] = ESP.getMinFreeHeap();
+    multi_heap_info_t hi;
+    heap_caps_get_info(&hi, MALLOC_CAP_8BIT);
+    heap["blocks"] = hi.allocated_blocks;
+    heap["freeBlocks"] = hi.free_blocks;
+
+    // Cumulative: a monitor diffs two samples for its own window
+    const LoopStats ls = loopStats;
+    JsonObject loopObj = doc["loop"].to<JsonObject>();
+    loopObj["count"] = ls.count;
+    loopObj["maxUs"] = ls.maxUs;
+    loopObj["p50Us"] = LoopStats::percentileUs(ls.hist, 0.50f);
+    loopObj["p99Us"] = LoopStats::percentileUs(ls.hist, 0.99f);
+    uint8_t used = LoopStats::kBuckets;
+    while (used && !ls.hist[used - 1]) used--;
+    JsonArray hist = loopObj["hist"].to<JsonArray>();
+    for (uint8_t i = 0; i < used; i++) hist.add(ls.hist[i]);
+
+    JsonObject web = doc["web"].to<JsonObject>();
+    web["inFlight"] = _inFlight;
+    web["peakInFlight"] = _peakInFlight;
+    web["admitted"] = _admitted;
+    web["rejectedBusy"] = _rejectedBusy;
+    web["rejectedHeap"] = _rejectedHeap;
+    web["rejectedBlock"] = _rejectedBlock;
+
+    const WebSerialClass::Stats log = webSerial.stats();
+    JsonObject logObj = doc["log"].to<JsonObject>();
+    logObj["frames"] = log.frames;
+    logObj["bytes"] = log.bytes;
+    logObj["writes"] = log.writes;
+    logObj["dropped"] = log.dropped;
+    logObj["producerUs"] = log.producerUs;
+    logObj["drainUs"] = log.drainUs;
+    logObj["backlogBytes"] = log.backlogBytes;
+    logObj["backlogReplays"] = log.backlogReplays;
+    logObj["uptimeMs"] = millis();
+
+    const BinLog::Stats bin = binLog.stats();
+    JsonObject binObj = logObj["deferred"].to<JsonObject>();
+    binObj["records"] = bin.records;
+    binObj["dropped"] = bin.dropped;
+    binObj["formatted"] = bin.formatted;
+    binObj["discarded"] = bin.discarded;
+    binObj["formatUs"] = bin.formatUs;
+    logObj["consumer"] = webSerial.consumerAttached();
+
+    const PersistLog::Stats fs = persistLog.stats();
+    JsonObject fsObj = logObj["persist"].to<JsonObject>();
+    fsObj["mounted"] = fs.mounted;
+    fsObj["boot"] = fs.boot;
+    fsObj["lines"] = fs.lines;
+    fsObj["droppedLines"] = fs.droppedLines;
+    fsObj["blocks"] = fs.blocks;
+    fsObj["lastWriteMs"] = fs.lastWriteMs;
+    fsObj["maxWriteMs"] = fs.maxWriteMs;
+
+    const SyslogSink::Stats sl = syslogSink.stats();
+    JsonObject slObj = logObj["syslog"].to<JsonObject>();
+    slObj["enabled"] = sl.enabled;
+    slObj["lines"] = sl.lines;
+    slObj["datagrams"] = sl.datagrams;
+    slObj["bytes"] = sl.bytes;
+    slObj["droppedLines"] = sl.droppedLines;
+    slObj["sendErrors"] = sl.sendErrors;
+
+    const ReportProxy::Stats px = reportProxy.stats();
+    JsonObject pxObj = doc["proxy"].to<JsonObject>();
+    pxObj["clients"] = px.clients;
+    pxObj["published"] = px.published;
+    pxObj["publishedBytes"] = px.publishedBytes;
+    pxObj["skippedHeap"] = px.skippedHeap;
+    pxObj["sent"] = px.sent;
+    pxObj["dropped"] = px.dropped;
+    pxObj["rejectedClients"] = px.rejectedClients;
+    pxObj["pushallRequests"] = px.pushallRequests;
+
+    const HaPublisher::Stats ha = haPublisher.stats();
+    JsonObject haObj = doc["ha"].to<JsonObject>();
+    haObj["enabled"] = ha.enabled;
+    haObj["connected"] = ha.connected;
+    haObj["statePublishes"] = ha.statePublishes;
+    haObj["suppressed"] = ha.suppressed;
+    haObj["discoveryPublishes"] = ha.discoveryPublishes;
+    haObj["connectFailures"] = ha.connectFailures;
+
+    const BeaconLink::Stats rl = beaconLink.stats();
+    JsonObject rlObj = doc["relay"].to<JsonObject>();
+    rlObj["enabled"] = rl.enabled;
+    rlObj["role"] = relay::roleName((relay::Role)rl.role);
+    char nodeHex[9];
+    snprintf(nodeHex, sizeof(nodeHex), "%08lx", (unsigned long)rl.node);
+    rlObj["node"] = nodeHex;
+    snprintf(nodeHex, sizeof(nodeHex), "%08lx", (unsigned long)rl.leader);
+    rlObj["leader"] = nodeHex;
+    rlObj["elections"] = rl.proto.elections;
+    rlObj["stepDowns"] = rl.proto.stepDowns;
+    rlObj["sentKeys"] = rl.proto.sentKeys;
+    rlObj["sentDeltas"] = rl.proto.sentDeltas;
+    rlObj["sentClaims"] = rl.proto.sentClaims;
+    rlObj["sentBytes"] = rl.proto.sentBytes;
+    rlObj["rxPackets"] = rl.proto.rxPackets;
+    rlObj["rxRejected"] = rl.proto.rxRejected;
+    rlObj["rxGaps"] = rl.proto.rxGaps;
+
+    const AnimSync::Stats as = animSync.stats();
+    JsonObject asObj = doc["animSync"].to<JsonObject>();
+    asObj["enabled"] = as.enabled;
+    snprintf(nodeHex, sizeof(nodeHex), "%08lx", (unsigned long)as.proto.reference);
+    asObj["reference"] = nodeHex;
+    asObj["peers"] = as.proto.peers;
+    asObj["samples"] = as.proto.samples;
+    asObj["offsetMs"] = (double)as.proto.offsetUs / 1000.0;
+    asObj["errorUs"] = as.proto.errorUs;
+    asObj["driftPpm"] = as.proto.driftPpb / 1000.0f;
+    asObj["sent"] = as.proto.sent;
+    asObj["received"] = as.proto.received;
+    asObj["steps"] = as.proto.steps;
+    asObj["referenceChanges"] = as.proto.referenceChanges;
+
+    const OtaUpdater::SessionStats& ota = otaUpdater.lastSession();
+    JsonObject otaObj = doc["ota"].to<JsonObject>();
+    otaObj["active"] = otaUpdater.active();
+    otaObj["lastBytes"] = ota.bytes;
+    otaObj["lastMs"] = ota.ms;
+    otaObj["lastQuiesce"] = ota.quiesced;
+    otaObj["lastOk"] = ota.ok;
+
+    const Tracer::Stats tr = tracer.stats();
+    JsonObject trObj = doc["trace"].to<JsonObject>();
+    trObj["enabled"] = tr.enabled;
+    trObj["events"] = tr.events;
+
+    const TaskStats::Stats ts = taskStats.stats();
+    JsonObject tsObj = doc["tasks"].to<JsonObject>();
+    tsObj["samples"] = ts.samples;
+    tsObj["count"] = ts.tasks;
+    tsObj["minStackFree"] = ts.minStackFree;
+    tsObj["minStackTask"] = ts.minStackTask;
+
+    String out;
+    serializeJson(doc, out);
+    req->send(200, "application/json", out);
+  });
+
+  // Per-task CPU share and stack high-water marks (TaskStats)
+  server.on("/tasks.json", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+    taskStats.serve(req);
+  });
+
+  // Core dump of the last crash with its runtime context (CrashContext)
+  server.on("/coredump.json", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+    crashContext.serveInfo(req);
+  });
+
+  server.on("/coredump.bin", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+    crashContext.serveDump(req);
+  });
+
+  server.on("/coredump/erase", HTTP_POST, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+    crashContext.erase();
+    req->send(200, "application/json", "{\"success\":true}");
+  });
+
+  // Newest trace events as Chrome Trace Event JSON (chrome://tracing, Perfetto)
+  server.on("/trace.json", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+    tracer.serve(req);
+  });
+
+  server.on("/trace", HTTP_POST, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+
+    if (!req->hasParam("enable", true)) {
+      req->send(400, "application/json", "{\"success\":false}");
+      return;
+    }
+    const bool on = req->getParam("enable", true)->value() == "1";
+    tracer.setEnabled(on);
+    webSerial.printf("[TRACE] Recording %s\n", on ? "on" : "off");
+    req->send(200, "application/json", on ? "{\"success\":true,\"enabled\":true}" : "{\"success\":true,\"enabled\":false}");
+  });
+
+  server.on("/logtail", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+    webSerial.serveBacklog(req);
+  });
+
+  server.on("/logs", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!isAuthorized(req)) return req->requestAuthentication();
+    persistLog.serve(req);
+  });
+
+  server.on("/api/state", HTTP_GET, [&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetJson)) return;
+    if (!wifiManager.isApMode()) {
+      if (!isAuthorized(req)) return req->requestAuthentication();
+    }
+    handleApiState(req);
+  });
+
   server.onNotFound([&](AsyncWebServerRequest* req) {
+    if (!admit(req, kBudgetPage)) return;
     // Nice fallback: if in AP mode, redirect everything to setup page
     if (wifiManager.isApMode()) {
       req->redirect("/wifisetup");
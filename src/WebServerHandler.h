@@ -4,12 +4,32 @@
 
 class WebServerHandler {
 public:
+  struct RouteBudget {
+    uint32_t minFreeHeap;     // free heap required to serve the route
+    uint32_t minLargestBlock; // largest contiguous block required
+  };
+
   explicit WebServerHandler(AsyncWebServer& s);
   void begin();
 
 private:
   AsyncWebServer& server;
 
+  // Admission control (all handlers run on the AsyncTCP task, no locking needed)
+  uint8_t  _inFlight = 0;
+  uint8_t  _peakInFlight = 0;
+  uint32_t _admitted = 0;
+  uint32_t _rejectedBusy = 0;
+  uint32_t _rejectedHeap = 0;
+  uint32_t _rejectedBlock = 0;
+  AsyncWebServerRequest* _uploadAdmitted = nullptr;
+
+  bool admit(AsyncWebServerRequest* req, const RouteBudget& budget, bool respond = true);
+  bool admitUpload(AsyncWebServerRequest* req, const RouteBudget& budget, size_t index);
+  bool finishUpload(AsyncWebServerRequest* req, const RouteBudget& budget);
+  void forgetUpload(AsyncWebServerRequest* req);
+  void sendBusy(AsyncWebServerRequest* req);
+
   bool isAuthorized(AsyncWebServerRequest* req);
   void sendGz(AsyncWebServerRequest* req, const uint8_t* data, size_t len, const char* mime);
 
@@ -18,6 +38,9 @@ private:
   void handlePrinterDiscovery(AsyncWebServerRequest* req);
   void handleSubmitPrinterConfig(AsyncWebServerRequest* req);
   void handleLedTestCmd(AsyncWebServerRequest* req);
+  void handleApiState(AsyncWebServerRequest* req);
+  void handleStatusCbor(AsyncWebServerRequest* req);
+  void handleOtaPullStatus(AsyncWebServerRequest* req, int code = 200);
 };
 
 const uint8_t* webserialHtml();
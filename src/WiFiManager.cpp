@@ -1,9 +1,9 @@
 #include "WiFiManager.h"
-#include <WiFi.h>
 #include <DNSServer.h>
 #include <ESPmDNS.h>
 #include "SettingsPrefs.h"
 #include "WebSerial.h"
+#include "Trace.h"
 
 extern Settings settings;
 
@@ -20,8 +20,8 @@ void WiFiManager::startConnectAttempt() {
   }
 
   _lastFailNoAp = false;
-  WiFi.mode(_apMode ? WIFI_AP_STA : WIFI_STA);
-  WiFi.setHostname(settings.get.deviceName());
+  _wifi.mode(_apMode ? WIFI_AP_STA : WIFI_STA);
+  _wifi.setHostname(settings.get.deviceName());
 
   // Optional static IP
   IPAddress ip, sn, gw, dnsip;
@@ -31,23 +31,24 @@ void WiFiManager::startConnectAttempt() {
   const bool dnsOk = dnsip.fromString(settings.get.staticDNS()) && dnsip != IPAddress(0,0,0,0);
   const bool useStatic = ipOk && snOk && gwOk && dnsOk;
   if (useStatic) {
-    WiFi.config(ip, gw, sn, dnsip);
+    _wifi.config(ip, gw, sn, dnsip);
   }
 
-  WiFi.begin(ssid0, pass0);
+  tracer.instant(TraceId::WifiConnecting, 0);
+  _wifi.begin(ssid0, pass0);
   _connectPhase = ConnectPhase::SSID0;
   _connectStart = millis();
 }
 
 WiFiManager::AttemptResult WiFiManager::processConnectAttempt() {
   if (_connectPhase == ConnectPhase::IDLE) return AttemptResult::InProgress;
-  if (WiFi.status() == WL_CONNECTED) {
+  if (_wifi.connected()) {
     _connectPhase = ConnectPhase::IDLE;
     return AttemptResult::Connected;
   }
 
   const unsigned long now = millis();
-  const wl_status_t st = WiFi.status();
+  const wl_status_t st = _wifi.status();
   if ((st == WL_NO_SSID_AVAIL || st == WL_CONNECT_FAILED) &&
       (now - _connectStart) >= kFastFailNoApMs) {
     _lastFailNoAp = true;
@@ -59,7 +60,8 @@ WiFiManager::AttemptResult WiFiManager::processConnectAttempt() {
       const char* ssid1 = settings.get.wifiSsid1();
       const char* pass1 = settings.get.wifiPass1();
       if (ssid1 && *ssid1) {
-        WiFi.begin(ssid1, pass1);
+        tracer.instant(TraceId::WifiConnecting, 1);
+        _wifi.begin(ssid1, pass1);
         _connectPhase = ConnectPhase::SSID1;
         _connectStart = now;
         return AttemptResult::InProgress;
@@ -76,7 +78,8 @@ WiFiManager::AttemptResult WiFiManager::processConnectAttempt() {
     const char* ssid1 = settings.get.wifiSsid1();
     const char* pass1 = settings.get.wifiPass1();
     if (ssid1 && *ssid1) {
-      WiFi.begin(ssid1, pass1);
+      tracer.instant(TraceId::WifiConnecting, 1);
+      _wifi.begin(ssid1, pass1);
       _connectPhase = ConnectPhase::SSID1;
       _connectStart = now;
       return AttemptResult::InProgress;
@@ -88,30 +91,31 @@ WiFiManager::AttemptResult WiFiManager::processConnectAttempt() {
 }
 
 void WiFiManager::startAP() {
+  tracer.instant(TraceId::ApStart);
   _apMode = true;
   _connectPhase = ConnectPhase::IDLE;
   _connectStart = 0;
 
-  WiFi.disconnect(true, true);
+  _wifi.disconnect(true, true);
   delay(150);
 
   // IMPORTANT: AP+STA mode enables stable WiFi scanning while AP is active
-  WiFi.mode(WIFI_AP_STA);
-  WiFi.setSleep(false);
-  WiFi.softAPConfig(apIP, apIP, IPAddress(255,255,255,0));
+  _wifi.mode(WIFI_AP_STA);
+  _wifi.setSleep(false);
+  _wifi.softAPConfig(apIP, apIP, IPAddress(255,255,255,0));
 
   String apName = String("BambuBeacon-") + String((uint32_t)ESP.getEfuseMac(), HEX);
-  WiFi.softAP(apName.c_str()); // open for now
+  _wifi.softAP(apName.c_str()); // open for now
 
   dns.start(53, "*", apIP);
 
   // Kick an async scan early so the setup page can show networks immediately
-  WiFi.scanDelete();
-  WiFi.scanNetworks(true /* async */, true /* show hidden */);
+  _wifi.scanDelete();
+  _wifi.scanNetworks(true /* async */, true /* show hidden */);
 
   // Optional pre-warm: wait briefly for the first scan results (not in AsyncTCP context)
   const unsigned long t0 = millis();
-  while (WiFi.scanComplete() == WIFI_SCAN_RUNNING && (millis() - t0) < 2500UL) {
+  while (_wifi.scanComplete() == WIFI_SCAN_RUNNING && (millis() - t0) < 2500UL) {
     delay(20);
   }
 }
@@ -139,8 +143,14 @@ void WiFiManager::loop() {
     dns.processNextRequest();
   }
 
-  if (WiFi.status() == WL_CONNECTED) {
-    if (_apMode && WiFi.localIP() != IPAddress(0,0,0,0)) {
+  const bool up = _wifi.connected();
+  if (up != _wasConnected) {
+    _wasConnected = up;
+    tracer.instant(up ? TraceId::WifiUp : TraceId::WifiDown, (uint16_t)_wifi.status());
+  }
+
+  if (up) {
+    if (_apMode && _wifi.localIP() != IPAddress(0,0,0,0)) {
       webSerial.println("[WiFi] Connected in AP mode, stopping AP");
       stopAP();
     }
@@ -182,7 +192,7 @@ void WiFiManager::loop() {
 
   const unsigned long retryInterval = _apMode ? kApRetryIntervalMs : kRetryIntervalMs;
   if (now - _lastTry < retryInterval) return;
-  if (_apMode && WiFi.softAPgetStationNum() > 0) return;
+  if (_apMode && _wifi.softAPgetStationNum() > 0) return;
   _lastTry = now;
 
   if (!_apMode && _tries >= kMaxTriesBeforeAp) {
@@ -196,8 +206,9 @@ void WiFiManager::loop() {
 }
 
 void WiFiManager::stopAP() {
+  tracer.instant(TraceId::ApStop);
   dns.stop();
-  WiFi.softAPdisconnect(true);
-  WiFi.mode(WIFI_STA);
+  _wifi.softAPdisconnect(true);
+  _wifi.mode(WIFI_STA);
   _apMode = false;
 }
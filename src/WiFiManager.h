@@ -1,15 +1,20 @@
 #pragma once
 #include <Arduino.h>
+#include "Hal.h"
 
 class WiFiManager {
 public:
+  explicit WiFiManager(hal::Wifi& wifi = hal::wifi()) : _wifi(wifi) {}
+
   void begin();
   void loop();
 
   bool isApMode() const { return _apMode; }
 
 private:
+  hal::Wifi& _wifi;
   bool _apMode = false;
+  bool _wasConnected = false;
 
   unsigned long _lastTry = 0;
   uint8_t _tries = 0;
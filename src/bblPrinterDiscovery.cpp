@@ -1,9 +1,10 @@
 #include "bblPrinterDiscovery.h"
 #include "BambuMqttClient.h"
+#include "Trace.h"
 
 extern BambuMqttClient bambu;
 
-BBLPrinterDiscovery::BBLPrinterDiscovery() {}
+BBLPrinterDiscovery::BBLPrinterDiscovery(hal::Wifi& wifi) : wifi_(wifi) {}
 
 void BBLPrinterDiscovery::begin()
 {
@@ -61,7 +62,7 @@ void BBLPrinterDiscovery::update()
   if (!enabled_) return;
 
   // Do nothing if WiFi is not connected
-  if (WiFi.status() != WL_CONNECTED)
+  if (!wifi_.connected())
   {
     state_ = State::IDLE;
     return;
@@ -121,6 +122,7 @@ void BBLPrinterDiscovery::sendMSearch()
     "MX: 5\r\n"
     "ST: urn:bambulab-com:device:3dprinter:1\r\n\r\n";
 
+  TRACE_SCOPE(SsdpSend);
   udp_.beginPacket(BBL_SSDP_MCAST_IP, BBL_SSDP_PORT);
   udp_.write(reinterpret_cast<const uint8_t*>(msearch), sizeof(msearch) - 1);
   udp_.endPacket();
@@ -183,6 +185,7 @@ void BBLPrinterDiscovery::readPacketsNonBlocking(unsigned long now)
   {
     const int size = udp_.parsePacket();
     if (!size) break;
+    TRACE_SCOPE(SsdpPacket, (uint16_t)size);
 
     const IPAddress senderIP = udp_.remoteIP();
 
@@ -224,7 +227,7 @@ void BBLPrinterDiscovery::readPacketsNonBlocking(unsigned long now)
         settings.set.printerIP(currentIP.c_str());
         settings.save();
         bambu.reloadFromSettings();
-        if (WiFi.status() == WL_CONNECTED) bambu.connect();
+        if (wifi_.connected()) bambu.connect();
       }
     }
 
@@ -2,8 +2,8 @@
 #define _BBLPRINTERDISCOVERY_H
 
 #include <Arduino.h>
-#include <WiFi.h>
-#include <WiFiUdp.h>
+
+#include "Hal.h"
 
 #include "WebSerial.h"
 #include "SettingsPrefs.h"
@@ -33,7 +33,7 @@ struct BBLPrinter
 class BBLPrinterDiscovery
 {
 public:
-  BBLPrinterDiscovery();
+  explicit BBLPrinterDiscovery(hal::Wifi& wifi = hal::wifi());
 
   void begin();
   void end();
@@ -90,7 +90,8 @@ private:
   unsigned long sendAtMs_      = 0;
   unsigned long listenUntilMs_ = 0;
 
-  WiFiUDP udp_;
+  hal::Wifi& wifi_;
+  hal::Udp udp_;
 
   // Session / known printers
   BBLPrinter knownPrinters_[BBL_MAX_PRINTERS];
@@ -3,12 +3,27 @@
 #include "LedController.h"
 #include <ESPAsyncWebServer.h>
 #include <WiFi.h>
+#include <esp_task.h>
 #include "bblPrinterDiscovery.h"
 #include "SettingsPrefs.h"
 #include "WiFiManager.h"
 #include "BambuMqttClient.h"
 #include "WebServerHandler.h"
 #include "WebSerial.h"
+#include "Log.h"
+#include "OtaUpdater.h"
+#include "OtaPuller.h"
+#include "PeerOta.h"
+#include "PersistLog.h"
+#include "SyslogSink.h"
+#include "ReportProxy.h"
+#include "HaPublisher.h"
+#include "BeaconLink.h"
+#include "AnimSync.h"
+#include "LoopStats.h"
+#include "TaskStats.h"
+#include "CrashContext.h"
+#include "RestartScheduler.h"
 
 LedController ledsCtrl;
 Settings settings;
@@ -17,22 +32,69 @@ AsyncWebServer server(80);
 WebServerHandler web(server);
 BBLPrinterDiscovery printerDiscovery;
 BambuMqttClient bambu;
+OtaUpdater otaUpdater;
+OtaPuller otaPuller;
+PeerOta peerOta;
+PersistLog persistLog;
+SyslogSink syslogSink;
+ReportProxy reportProxy;
+HaPublisher haPublisher;
+BeaconLink beaconLink;
+AnimSync animSync;
+LoopStats loopStats;
+
+// OTA session mode: discovery paused, MQTT keepalive only (relay heartbeats and
+// LED sync keep running), LEDs show progress and the AsyncTCP task (which
+// receives and flashes the image) runs just below lwIP.
+static void setOtaQuiesce(bool on) {
+  static UBaseType_t asyncTcpPrio = 0;
+  TaskHandle_t asyncTcp = xTaskGetHandle("async_tcp");
+  if (asyncTcp) {
+    if (on) {
+      asyncTcpPrio = uxTaskPriorityGet(asyncTcp);
+      vTaskPrioritySet(asyncTcp, ESP_TASK_TCPIP_PRIO - 1);
+    } else if (asyncTcpPrio) {
+      vTaskPrioritySet(asyncTcp, asyncTcpPrio);
+    }
+  }
+  bambu.setQuiet(on);
+  ledsCtrl.setOtaMode(on);
+  webSerial.printf("[OTA] Quiesce %s\n", on ? "on" : "off");
+}
 
 void setup() {
 #ifdef WSL_CUSTOM_PAGE
   webSerial.setCustomHtmlPage(webserialHtml(), webserialHtmlLen(), "gzip");
 #endif
-  webSerial.begin(&server, 115200, 200);
+  webSerial.begin(&server, 115200);
+  persistLog.begin();
+  crashContext.begin();
+  // Runs from webSerial.loop() on the loop task, whichever task printed
+  webSerial.setTap([](const uint8_t* data, size_t len) {
+    crashContext.appendLog(data, len);
+    persistLog.append(data, len);
+    syslogSink.append(data, len);
+  });
 
   settings.begin();
   webSerial.setAuthentication(settings.get.webUIuser(), settings.get.webUIPass());
+  syslogSink.begin(settings);
+  haPublisher.begin(settings);
   ledsCtrl.begin(settings);
+  animSync.begin();
   wifiManager.begin();
+  otaUpdater.hashRunningImage();  // before peerOta.begin(): TXT sha
+  peerOta.begin();
   web.begin();
+  reportProxy.begin(server, settings.get.webUIuser(), settings.get.webUIPass());
 
   bambu.onReport([](const JsonDocument& doc) {
     ledsCtrl.ingestBambuReport(doc.as<JsonObjectConst>(), millis());
   });
+  bambu.onRawReport([](const uint8_t* payload, size_t len) {
+    reportProxy.publish(payload, len);
+  });
+  beaconLink.begin();  // before bambu.begin(): followers never open a printer session
  bambu.begin(settings);
 
 printerDiscovery.begin();
@@ -45,12 +107,56 @@ printerDiscovery.forceRescan(2000UL);      // first scan shortly after boot
   webSerial.println("[BOOT] BambuBeacon started");
 }
 
+// Times one loop() pass into loopStats, including the early quiesce return;
+// the start also goes to the crash context
+struct LoopTimer {
+  const uint32_t startUs = micros();
+  LoopTimer() { crashContext.loopBegin(startUs); }
+  ~LoopTimer() { loopStats.record(micros() - startUs); }
+};
+
 void loop() {
+  LoopTimer timer;
+  binLog.loop();
+  taskStats.loop();
+  webSerial.loop();
+  persistLog.loop();
+  restartScheduler.loop();
+  syslogSink.loop();
   wifiManager.loop();
+
+  static bool otaQuiet = false;
+  const bool quiet = otaUpdater.quiesced();
+  if (quiet != otaQuiet) {
+    otaQuiet = quiet;
+    setOtaQuiesce(quiet);
+  }
+  if (quiet) {
+    // Relay heartbeats and LED clock sync keep running: a silent leader would
+    // be voted out by its followers halfway through the update
+    beaconLink.loop();
+    bambu.loopTick();
+    animSync.loop();
+    ledsCtrl.setAnimOffset(animSync.offsetMs());
+    ledsCtrl.setOtaProgress(otaUpdater.progressPercent());
+    ledsCtrl.loop();
+    delay(10);
+    return;
+  }
+
   printerDiscovery.update();
+  peerOta.loop();
+  reportProxy.loop();
+  beaconLink.loop();
   if (bambu.isConnected() || !printerDiscovery.isBusy()) {
     bambu.loopTick();
   }
+  {
+    PrinterState ps;
+    bambu.snapshot(ps);
+    haPublisher.loop(ps);
+    peerOta.setStatus(ps);
+  }
   const uint32_t nowMs = millis();
   ledsCtrl.setMqttConnected(bambu.isConnected(), nowMs);
   ledsCtrl.setHmsSeverity((uint8_t)bambu.topSeverity());
@@ -91,5 +197,7 @@ void loop() {
   const bool bedHot = bambu.bedValid() && (bambu.bedTemp() > 45.0f);
   const bool showFinish = finished && (finishMinActive || bedHot);
   ledsCtrl.setFinished(showFinish);
+  animSync.loop();
+  ledsCtrl.setAnimOffset(animSync.offsetMs());
   ledsCtrl.loop();
 }
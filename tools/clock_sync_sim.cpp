@@ -0,0 +1,227 @@
+// Simulates a farm of beacons running the shared animation clock
+// (src/ClockSyncProto.h, the firmware's own estimator) in virtual time and
+// measures how closely their animation clocks agree.
+//
+// Every node has its own crystal error (--ppm, uniform +-), its own boot time
+// (the local clock is uptime) and sees multicast through a delay model:
+// with --dtim-ms > 0 the AP holds multicast until the next DTIM beacon, as it
+// does once any station sleeps (0..dtim ms), plus airtime and receive jitter;
+// --dtim-ms 0 is a wired-like LAN. --loss drops packets at random.
+// The scenario: nodes boot over the first 20 s (the lowest node id last, so it
+// must join rather than reset the farm's clock), the reference is killed at
+// --kill s and rebooted 30 s later.
+//
+// Reported: spread (max - min animation clock over synced nodes) p50/p99/max
+// outside the settle windows, time to sync after boot, steps and backward
+// jumps of any node's animation clock. Exit code 1 if p99 spread exceeds
+// --limit-ms or a clock ran backwards after its first sync.
+//
+// Build and run:
+//   g++ -O2 -std=c++17 -Isrc tools/clock_sync_sim.cpp -o clock_sync_sim
+//   ./clock_sync_sim --nodes 8 --minutes 30 --dtim-ms 102.4 --loss 0.05
+
+#include "ClockSyncProto.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Node {
+  uint32_t id = 0;
+  double ppm = 0;
+  int64_t bootUs = 0;     // true time of boot
+  bool alive = false;
+  int64_t syncedAtUs = -1;
+  int64_t lastSharedUs = 0;
+  clocksync::Core core;
+
+  int64_t local(int64_t t) const { return (int64_t)((double)(t - bootUs) * (1.0 + ppm * 1e-6)); }
+};
+
+struct Delivery {
+  int64_t at;
+  size_t to;
+  uint8_t data[clocksync::kPacketLen];
+  bool operator>(const Delivery& o) const { return at > o.at; }
+};
+
+double pct(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(v.size() * p / 100.0))];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int nodesN = 8;
+  double minutes = 30, ppmRange = 30, dtimMs = 102.4, loss = 0.0, killS = 600, limitMs = 10;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string k = argv[i];
+    const double v = atof(argv[i + 1]);
+    if (k == "--nodes") nodesN = (int)v;
+    else if (k == "--minutes") minutes = v;
+    else if (k == "--ppm") ppmRange = v;
+    else if (k == "--dtim-ms") dtimMs = v;
+    else if (k == "--loss") loss = v;
+    else if (k == "--kill") killS = v;
+    else if (k == "--limit-ms") limitMs = v;
+    else {
+      fprintf(stderr, "usage: %s [--nodes N] [--minutes M] [--ppm P] [--dtim-ms D] [--loss L] [--kill S] [--limit-ms X]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::mt19937_64 rng(1234);
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  std::exponential_distribution<double> jitter(1.0 / 300.0);  // mean 0.3 ms, in us
+
+  std::vector<Node> nodes(nodesN);
+  for (int i = 0; i < nodesN; i++) {
+    Node& n = nodes[i];
+    n.id = 0x100 + (uint32_t)i;
+    n.ppm = (u(rng) * 2 - 1) * ppmRange;
+    // Node 0 (lowest id) boots last
+    n.bootUs = i == 0 ? 20000000 : (int64_t)(u(rng) * 15e6);
+    n.core.configure(n.id);
+  }
+
+  const int64_t stepUs = 10000;  // loop granularity
+  const int64_t endUs = (int64_t)(minutes * 60e6);
+  const int64_t killUs = (int64_t)(killS * 1e6);
+  const int64_t rebootUs = killUs + 30000000;
+  const int64_t settleUs = 60000000;  // excluded after boot and after the kill
+  std::priority_queue<Delivery, std::vector<Delivery>, std::greater<Delivery>> q;
+
+  std::vector<double> spread;
+  double maxSpreadKill = 0;
+  int backwards = 0;
+  size_t killed = SIZE_MAX;
+  uint32_t sent = 0, dropped = 0;
+
+  for (int64_t t = 0; t < endUs; t += stepUs) {
+    // Lifecycle
+    for (size_t i = 0; i < nodes.size(); i++) {
+      Node& n = nodes[i];
+      if (!n.alive && t >= n.bootUs && (i != killed || t >= rebootUs)) {
+        if (i == killed) {
+          n.bootUs = t;
+          killed = SIZE_MAX - 1;
+        }
+        n.alive = true;
+        n.core.configure(n.id);
+        n.syncedAtUs = -1;
+        n.lastSharedUs = 0;
+      }
+    }
+    if (killed == SIZE_MAX && t >= killUs) {
+      // Kill whoever the farm follows
+      const uint32_t ref = nodes[nodesN - 1].core.stats().reference;
+      for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].id == ref) {
+          nodes[i].alive = false;
+          killed = i;
+          printf("[%7.1f s] killed reference %03x\n", t / 1e6, ref);
+        }
+      }
+    }
+
+    // Deliveries due
+    while (!q.empty() && q.top().at <= t) {
+      const Delivery d = q.top();
+      q.pop();
+      Node& n = nodes[d.to];
+      if (n.alive) n.core.onPacket(d.data, sizeof(d.data), n.local(d.at));
+    }
+
+    // Node loops
+    for (size_t i = 0; i < nodes.size(); i++) {
+      Node& n = nodes[i];
+      if (!n.alive) continue;
+      const int64_t local = n.local(t);
+      n.core.update(local);
+      uint8_t pkt[clocksync::kPacketLen];
+      if (n.core.poll(local, pkt)) {
+        sent++;
+        for (size_t j = 0; j < nodes.size(); j++) {
+          if (j == i) continue;
+          if (u(rng) < loss) {
+            dropped++;
+            continue;
+          }
+          int64_t at = t + 300 + (int64_t)jitter(rng);
+          if (dtimMs > 0) {
+            const int64_t period = (int64_t)(dtimMs * 1000);
+            at = ((t / period) + 1) * period + 300 + (int64_t)jitter(rng);
+          }
+          Delivery d;
+          d.at = at;
+          d.to = j;
+          memcpy(d.data, pkt, sizeof(pkt));
+          q.push(d);
+        }
+      }
+
+      const int64_t sh = n.core.shared(local);
+      const clocksync::Core::Stats& st = n.core.stats();
+      // As reference only once it had time to hear a farm it should join
+      const bool synced = (st.reference == n.id && local > clocksync::kPeerTimeoutUs) ||
+                          (st.reference != n.id && st.samples > 0 && std::llabs(st.errorUs) < 1000);
+      if (synced && n.syncedAtUs < 0) {
+        n.syncedAtUs = t;
+        if (st.reference != n.id) {
+          printf("[%7.1f s] %03x synced to %03x after %.1f s\n", t / 1e6, n.id, st.reference, (t - n.bootUs) / 1e6);
+        }
+      } else if (n.syncedAtUs >= 0 && sh < n.lastSharedUs) {
+        backwards++;
+        printf("[%7.1f s] %03x clock went back %.3f ms\n", t / 1e6, n.id, (n.lastSharedUs - sh) / 1e3);
+      }
+      n.lastSharedUs = sh;
+    }
+
+    // Spread across synced nodes, every 100 ms
+    if (t % 100000 == 0) {
+      int64_t lo = INT64_MAX, hi = INT64_MIN;
+      int counted = 0;
+      for (const Node& n : nodes) {
+        if (!n.alive || n.syncedAtUs < 0) continue;
+        const int64_t sh = n.core.shared(n.local(t));
+        lo = std::min(lo, sh);
+        hi = std::max(hi, sh);
+        counted++;
+      }
+      if (counted >= 2) {
+        const double ms = (hi - lo) / 1000.0;
+        const bool settling = t < 20000000 + settleUs || (t >= killUs && t < rebootUs + settleUs);
+        if (!settling) spread.push_back(ms);
+        else if (t >= killUs) maxSpreadKill = std::max(maxSpreadKill, ms);
+      }
+    }
+  }
+
+  uint32_t steps = 0, refChanges = 0;
+  printf("\nnodes %d, %.0f min, crystal +-%.0f ppm, DTIM %.1f ms, loss %.0f%%\n", nodesN, minutes, ppmRange, dtimMs, loss * 100);
+  for (const Node& n : nodes) {
+    const clocksync::Core::Stats& st = n.core.stats();
+    steps += st.steps;
+    refChanges += st.referenceChanges;
+    printf("  %03x %+6.1f ppm  ref %03x  drift est %+7.2f ppm  offset %+12.3f ms  samples %2u\n",
+           n.id, n.ppm, st.reference, st.driftPpb / 1000.0, st.offsetUs / 1000.0, st.samples);
+  }
+  const double p99 = pct(spread, 99);
+  printf("spread p50 %.2f ms, p99 %.2f ms, max %.2f ms (%zu samples); during failover max %.2f ms\n",
+         pct(spread, 50), p99, spread.empty() ? 0.0 : *std::max_element(spread.begin(), spread.end()),
+         spread.size(), maxSpreadKill);
+  printf("packets %u sent, %u dropped; steps %u, reference changes %u, backward jumps %d\n",
+         sent, dropped, steps, refChanges, backwards);
+  const bool ok = !spread.empty() && p99 <= limitMs && backwards == 0;
+  printf("%s (p99 limit %.1f ms)\n", ok ? "OK" : "FAIL", limitMs);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Decode a beacon's /coredump.bin: crash context plus the ESP-IDF core dump.
+
+The download (CrashContext) is one file:
+
+  "BBCORE1\\0", u32 jsonLen, u32 dumpLen (little endian), JSON, raw dump
+
+The JSON is what the firmware knew when it crashed: reset and panic reason,
+PC and backtrace, the loop pass that was running and the loop latency
+percentiles, the newest trace events (ms before the panic, per task) and the
+tail of the log. It is printed first; the raw dump is then handed to
+esp-coredump (pip install esp-coredump, or ESP-IDF's espcoredump.py) with the
+firmware.elf of the same build for the task list, registers and backtraces.
+The ELF is checked against the SHA-256 the firmware reports: a dump decoded
+against another build shows wrong symbols.
+
+Usage:
+  python tools/decode_coredump.py coredump-esp32-1.2.3.bin --elf .pio/build/<env>/firmware.elf
+  python tools/decode_coredump.py 192.168.1.50 --user admin --password secret --elf firmware.elf
+  python tools/decode_coredump.py coredump.bin --context-only
+  python tools/decode_coredump.py --selftest
+"""
+import argparse
+import base64
+import hashlib
+import importlib.util
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import urllib.request
+
+MAGIC = b"BBCORE1\0"
+HEADER = struct.Struct("<8sII")
+ADDR2LINE = "xtensa-esp32-elf-addr2line"
+
+
+def parse(blob):
+    """(context dict or None, raw dump bytes) of a container."""
+    if len(blob) < HEADER.size:
+        raise ValueError("file too short")
+    magic, json_len, dump_len = HEADER.unpack_from(blob)
+    if magic != MAGIC:
+        raise ValueError("not a beacon core dump (bad magic)")
+    if HEADER.size + json_len + dump_len != len(blob):
+        raise ValueError(f"length mismatch: header says {HEADER.size + json_len + dump_len}, file is {len(blob)}")
+    text = blob[HEADER.size:HEADER.size + json_len]
+    context = json.loads(text) if json_len else None
+    return context, blob[HEADER.size + json_len:]
+
+
+def fetch(host, user, password):
+    req = urllib.request.Request(f"http://{host}/coredump.bin")
+    if user:
+        req.add_header("Authorization", "Basic " + base64.b64encode(f"{user}:{password}".encode()).decode())
+    with urllib.request.urlopen(req, timeout=30) as r:
+        return r.read()
+
+
+def elf_sha256(path):
+    h = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(65536), b""):
+            h.update(chunk)
+    return h.hexdigest()
+
+
+def format_context(ctx, out=sys.stdout):
+    """Prints the crash context; returns the code addresses worth resolving."""
+    addrs = []
+    if ctx is None:
+        print("No context saved (crash before LittleFS came up, or erased).", file=out)
+        return addrs
+    print(f"Firmware {ctx.get('fw', '?')} ({ctx.get('hw', '?')}), reset reason {ctx.get('resetReason', '?')}", file=out)
+    if ctx.get("lost"):
+        print("Runtime context lost (RTC memory invalid after the reset).", file=out)
+
+    panic = ctx.get("panic")
+    if panic:
+        print(f"Panic on core {panic.get('core')} at {panic.get('uptimeMs', 0) / 1000:.1f} s uptime: "
+              f"{panic.get('reason') or '?'}", file=out)
+        print(f"  PC {panic.get('pc')}", file=out)
+        addrs.append(panic.get("pc"))
+        bt = panic.get("backtrace") or []
+        if bt:
+            print("  Backtrace " + " ".join(bt), file=out)
+            addrs.extend(bt)
+    elif not ctx.get("lost"):
+        print("No panic recorded (watchdog or brownout reset).", file=out)
+
+    loop = ctx.get("loop")
+    if loop:
+        line = f"Loop pass #{loop.get('count')} started at {loop.get('lastStartMs', 0) / 1000:.1f} s"
+        if "passUs" in loop:
+            line += (f", running {loop['passUs'] / 1000:.1f} ms at the panic"
+                     f" (p50 {loop.get('p50Us', 0) / 1000:.1f} ms, p99 {loop.get('p99Us', 0) / 1000:.1f} ms,"
+                     f" max {loop.get('maxUs', 0) / 1000:.1f} ms)")
+        print(line, file=out)
+
+    trace = ctx.get("trace") or []
+    if trace:
+        print("Trace (newest last, ms before the panic):", file=out)
+        for e in trace:
+            print(f"  {e.get('dtUs', 0) / 1000:9.2f}  {e.get('ph', '?')} {e.get('name', '?'):<16} "
+                  f"{e.get('task', '?'):<12} arg={e.get('arg', 0)}", file=out)
+
+    log = ctx.get("log")
+    if log:
+        print("Log tail:", file=out)
+        for line in log.rstrip("\n").split("\n"):
+            print("  " + line, file=out)
+    return [a for a in addrs if a and a != "0x00000000"]
+
+
+def addr2line(tool, elf, addrs):
+    if not addrs:
+        return
+    exe = shutil.which(tool)
+    if not exe:
+        print(f"({tool} not found; skipping symbol lookup)")
+        return
+    print("Symbols:")
+    res = subprocess.run([exe, "-pfiaC", "-e", elf] + addrs, capture_output=True, text=True)
+    for line in res.stdout.splitlines():
+        print("  " + line)
+
+
+def coredump_cmd():
+    """esp-coredump command line prefix, or None when it is not installed."""
+    if shutil.which("esp-coredump"):
+        return ["esp-coredump"]
+    if importlib.util.find_spec("esp_coredump"):
+        return [sys.executable, "-m", "esp_coredump"]
+    return None
+
+
+def selftest():
+    failures = []
+
+    def check(name, ok):
+        if not ok:
+            failures.append(name)
+            print("FAIL", name)
+
+    ctx = {"resetReason": "panic", "fw": "1.2.3", "hw": "esp32", "elfSha256": "ab" * 32,
+           "loop": {"count": 42, "lastStartMs": 9000, "passUs": 5100000, "maxUs": 90000, "p50Us": 1200, "p99Us": 30000},
+           "panic": {"uptimeMs": 14100, "reason": "LoadProhibited", "core": 1, "pc": "0x400d1234",
+                     "backtrace": ["0x400d1234", "0x00000000", "0x400d5678"]},
+           "trace": [{"dtUs": -1500, "name": "mqtt", "ph": "B", "task": "loopTask", "arg": 3}],
+           "log": "[MQTT] connected\n[LED] state 4\n"}
+    text = json.dumps(ctx).encode()
+    dump = bytes(range(256)) * 3
+    blob = HEADER.pack(MAGIC, len(text), len(dump)) + text + dump
+
+    c, d = parse(blob)
+    check("roundtrip context", c == ctx)
+    check("roundtrip dump", d == dump)
+    c, d = parse(HEADER.pack(MAGIC, 0, 4) + b"\1\2\3\4")
+    check("dump only", c is None and d == b"\1\2\3\4")
+    for name, bad in (("magic", b"XXCORE1\0" + blob[8:]), ("truncated", blob[:-1]), ("short", blob[:10])):
+        try:
+            parse(bad)
+            check(f"rejects {name}", False)
+        except ValueError:
+            pass
+
+    class Sink:
+        text = ""
+
+        def write(self, x):
+            self.text += x
+
+    sink = Sink()
+    addrs = format_context(ctx, out=sink)
+    check("addresses", addrs == ["0x400d1234", "0x400d1234", "0x400d5678"])
+    check("panic line", "LoadProhibited" in sink.text and "core 1" in sink.text)
+    check("loop line", "running 5100.0 ms" in sink.text)
+    check("trace line", "-1.50" in sink.text and "loopTask" in sink.text)
+    check("log", "  [LED] state 4" in sink.text)
+    sink = Sink()
+    format_context({"resetReason": "task_wdt", "lost": True}, out=sink)
+    check("lost", "lost" in sink.text and "No panic" not in sink.text)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        p = os.path.join(tmp, "f.elf")
+        with open(p, "wb") as f:
+            f.write(b"elf")
+        check("elf sha", elf_sha256(p) == hashlib.sha256(b"elf").hexdigest())
+
+    print("selftest", "FAILED" if failures else "ok")
+    return 1 if failures else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", nargs="?", help="downloaded coredump .bin, or a beacon host to fetch it from")
+    ap.add_argument("--user", default="")
+    ap.add_argument("--password", default="")
+    ap.add_argument("--elf", default="", help="firmware.elf of the build that crashed")
+    ap.add_argument("--context-only", action="store_true", help="print the context, skip esp-coredump")
+    ap.add_argument("--save-raw", default="", help="also write the raw core dump image here")
+    ap.add_argument("--addr2line", default=ADDR2LINE, help="addr2line of the toolchain")
+    ap.add_argument("--gdb", action="store_true", help="open esp-coredump's gdb session (dbg_corefile)")
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+
+    if args.selftest:
+        return selftest()
+    if not args.source:
+        ap.error("give a file or a host")
+
+    if os.path.exists(args.source):
+        with open(args.source, "rb") as f:
+            blob = f.read()
+    else:
+        blob = fetch(args.source, args.user, args.password)
+    context, dump = parse(blob)
+
+    addrs = format_context(context)
+    if args.save_raw and dump:
+        with open(args.save_raw, "wb") as f:
+            f.write(dump)
+        print(f"Saved {args.save_raw} ({len(dump)} bytes)")
+
+    if args.context_only:
+        return 0
+    if not args.elf:
+        print("No --elf given; pass the build's firmware.elf to decode symbols and the dump.")
+        return 0
+
+    want = (context or {}).get("elfSha256", "")
+    if want and want.strip("0"):
+        have = elf_sha256(args.elf)
+        if not have.startswith(want.lower()):
+            print(f"WARNING: {args.elf} is not the crashed build (ELF SHA-256 {have[:16]}..., "
+                  f"firmware reports {want[:16]}...)")
+    addr2line(args.addr2line, args.elf, addrs)
+
+    if not dump:
+        print("No core dump image in the download (context only).")
+        return 0
+    with tempfile.TemporaryDirectory() as tmp:
+        raw = os.path.join(tmp, "core.raw")
+        with open(raw, "wb") as f:
+            f.write(dump)
+        cmd = coredump_cmd()
+        if not cmd:
+            print("esp-coredump not found (pip install esp-coredump); use --save-raw and ESP-IDF's espcoredump.py")
+            return 1
+        action = "dbg_corefile" if args.gdb else "info_corefile"
+        return subprocess.run(cmd + [action, "--core", raw, "--core-format", "raw", args.elf]).returncode
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""Fleet status from one mDNS browse, without an HTTP request per beacon.
+
+Every beacon announces _bambubeacon._tcp with its status in the TXT record
+(PeerOta::updateTxt): fw, hw, sha, rssi, p2p, usn, pc (printer connected),
+state (gcode state), prog (0-100, empty = unknown) and hms (top HMS severity,
+0 none .. 4 fatal). This sends one PTR query to 224.0.0.251:5353, collects
+the answers for --timeout seconds and prints one line per beacon.
+
+--watch keeps listening and prints each beacon's line again whenever its TXT
+changes (beacons announce changes themselves, at most every 5 s), so a
+dashboard needs no polling at all. --selftest parses a response built the
+way the firmware's record looks.
+
+Usage:
+  python tools/fleet_browse.py --timeout 3
+  python tools/fleet_browse.py --watch
+  python tools/fleet_browse.py --selftest
+"""
+import argparse
+import socket
+import struct
+import sys
+import time
+
+MDNS_ADDR = "224.0.0.251"
+MDNS_PORT = 5353
+SERVICE = "_bambubeacon._tcp.local"
+T_A, T_PTR, T_TXT, T_SRV = 1, 12, 16, 33
+HMS = ["-", "info", "warn", "error", "fatal"]
+
+
+def encode_name(name):
+    out = b""
+    for label in name.rstrip(".").split("."):
+        out += bytes([len(label)]) + label.encode()
+    return out + b"\0"
+
+
+def read_name(data, off):
+    labels = []
+    jumped = False
+    end = off
+    for _ in range(64):
+        n = data[off]
+        if n == 0:
+            off += 1
+            break
+        if n & 0xC0 == 0xC0:
+            ptr = ((n & 0x3F) << 8) | data[off + 1]
+            if not jumped:
+                end = off + 2
+            jumped = True
+            off = ptr
+            continue
+        labels.append(data[off + 1:off + 1 + n].decode(errors="replace"))
+        off += 1 + n
+    return ".".join(labels), (end if jumped else off)
+
+
+def query_packet():
+    return struct.pack(">HHHHHH", 0, 0, 1, 0, 0, 0) + encode_name(SERVICE) + struct.pack(">HH", T_PTR, 1)
+
+
+def parse(data, beacons, hosts):
+    """Folds one mDNS packet into beacons {instance: dict} and hosts {host: ip}."""
+    try:
+        _, flags, qd, an, ns, ar = struct.unpack_from(">HHHHHH", data)
+        if not flags & 0x8000:
+            return
+        off = 12
+        for _ in range(qd):
+            _, off = read_name(data, off)
+            off += 4
+        for _ in range(an + ns + ar):
+            name, off = read_name(data, off)
+            rtype, _, _, rdlen = struct.unpack_from(">HHIH", data, off)
+            off += 10
+            rdata = off
+            off += rdlen
+            if rtype == T_PTR and name.lower() == SERVICE.lower():
+                inst, _ = read_name(data, rdata)
+                beacons.setdefault(inst, {})
+            elif rtype == T_SRV:
+                _, _, port = struct.unpack_from(">HHH", data, rdata)
+                host, _ = read_name(data, rdata + 6)
+                b = beacons.setdefault(name, {})
+                b["_host"] = host
+                b["_port"] = port
+            elif rtype == T_TXT:
+                b = beacons.setdefault(name, {})
+                p = rdata
+                while p < rdata + rdlen:
+                    n = data[p]
+                    item = data[p + 1:p + 1 + n].decode(errors="replace")
+                    p += 1 + n
+                    k, _, v = item.partition("=")
+                    b[k] = v
+            elif rtype == T_A and rdlen == 4:
+                hosts[name.lower()] = socket.inet_ntoa(data[rdata:rdata + 4])
+    except (IndexError, struct.error):
+        pass  # truncated or foreign packet
+
+
+def line(inst, b, hosts):
+    ip = hosts.get(b.get("_host", "").lower(), "?")
+    prog = b.get("prog", "")
+    hms = b.get("hms", "0")
+    hms = HMS[int(hms)] if hms.isdigit() and int(hms) < len(HMS) else hms
+    printer = (b.get("state", "") or "-") if b.get("pc") == "1" else "offline"
+    return (f"{inst.split('.')[0]:<24} {ip:<15} fw {b.get('fw', '?'):<10} rssi {b.get('rssi', '?'):>4}  "
+            f"usn {b.get('usn', '') or '-':<16} {printer:<9} {prog + '%' if prog else '-':>4}  hms {hms}")
+
+
+def open_socket():
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, "SO_REUSEPORT"):
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+    s.bind(("", MDNS_PORT))
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP,
+                 socket.inet_aton(MDNS_ADDR) + socket.inet_aton("0.0.0.0"))
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 255)
+    return s
+
+
+def browse(args):
+    s = open_socket()
+    s.sendto(query_packet(), (MDNS_ADDR, MDNS_PORT))
+    beacons, hosts, shown = {}, {}, {}
+    t0 = time.monotonic()
+    deadline = t0 + args.timeout
+    while args.watch or time.monotonic() < deadline:
+        s.settimeout(max(0.05, deadline - time.monotonic()) if not args.watch else 1.0)
+        try:
+            data, _ = s.recvfrom(9000)
+        except socket.timeout:
+            continue
+        parse(data, beacons, hosts)
+        if args.watch:
+            for inst, b in beacons.items():
+                if "fw" not in b:
+                    continue
+                txt = line(inst, b, hosts)
+                if shown.get(inst) != txt:
+                    shown[inst] = txt
+                    print(f"[{time.monotonic() - t0:7.1f} s] {txt}", flush=True)
+    found = {k: v for k, v in beacons.items() if "fw" in v}
+    for inst in sorted(found):
+        print(line(inst, found[inst], hosts))
+    print(f"{len(found)} beacons in {args.timeout:.1f} s, one query")
+    return 0
+
+
+def selftest():
+    inst = "BambuBeacon-1a2b." + SERVICE
+    host = "bambubeacon-1a2b.local"
+    txt = b""
+    for kv in ["fw=1.4.0", "hw=esp32s3", "sha=" + "ab" * 32, "rssi=-58", "p2p=0", "usn=01S00C123456789",
+               "pc=1", "state=RUNNING", "prog=42", "hms=2"]:
+        txt += bytes([len(kv)]) + kv.encode()
+
+    def rr(name, rtype, rdata):
+        return encode_name(name) + struct.pack(">HHIH", rtype, 0x8001, 120, len(rdata)) + rdata
+
+    body = (rr(SERVICE, T_PTR, encode_name(inst)) + rr(inst, T_TXT, txt) +
+            rr(inst, T_SRV, struct.pack(">HHH", 0, 0, 80) + encode_name(host)) +
+            rr(host, T_A, socket.inet_aton("192.168.1.57")))
+    pkt = struct.pack(">HHHHHH", 0, 0x8400, 0, 1, 0, 3) + body
+    beacons, hosts = {}, {}
+    parse(pkt, beacons, hosts)
+    parse(pkt[:40], beacons, hosts)  # truncated: ignored
+    out = line(inst, beacons.get(inst, {}), hosts)
+    print(out)
+    ok = all(s in out for s in ["192.168.1.57", "1.4.0", "01S00C123456789", "RUNNING", "42%", "warn"])
+    print("selftest", "OK" if ok else "FAIL")
+    return 0 if ok else 1
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--timeout", type=float, default=3.0)
+    ap.add_argument("--watch", action="store_true")
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+    if args.selftest:
+        return selftest()
+    return browse(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,533 @@
+// Polls /status.cbor (src/StatusCbor.h) on a fleet of beacons concurrently
+// and reports per-beacon latency.
+//
+// Every round opens one non-blocking HTTP/1.0 connection per beacon at once
+// and drives them all from a single poll() loop, so one slow or dead beacon
+// never delays the others. A round ends when every request has finished or
+// hit --timeout-ms. For each beacon it reports:
+//   - ok/failed counts;
+//   - connect, first-byte and total latency (p50/p99/max);
+//   - response size;
+//   - the last decoded status (CBOR map, key names from StatusCbor.h).
+// --path /info.json polls the JSON endpoint instead (sizes and latency
+// only), for comparison.
+//
+// --selftest serves the firmware's encoding from local stand-in beacons,
+// each with its own delay, plus one that never answers. It checks that the
+// whole round takes about as long as the slowest live beacon, not the sum,
+// and that every field decodes. Exit code 1 on failure.
+//
+// Build and run (Linux/macOS):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/fleet_poller.cpp -o fleet_poller
+//   ./fleet_poller --user admin --pass secret --rounds 20 192.168.1.50 192.168.1.51:80
+//   ./fleet_poller --file beacons.txt --interval-ms 500
+//   ./fleet_poller --selftest
+
+#include "StatusCbor.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int64_t nowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string base64(const std::string& in) {
+  static const char* t = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < in.size(); i += 3) {
+    uint32_t v = (uint8_t)in[i] << 16;
+    if (i + 1 < in.size()) v |= (uint8_t)in[i + 1] << 8;
+    if (i + 2 < in.size()) v |= (uint8_t)in[i + 2];
+    out += t[(v >> 18) & 63];
+    out += t[(v >> 12) & 63];
+    out += i + 1 < in.size() ? t[(v >> 6) & 63] : '=';
+    out += i + 2 < in.size() ? t[v & 63] : '=';
+  }
+  return out;
+}
+
+// ---- CBOR decoding (the subset StatusCbor.h writes, plus floats) ----
+
+struct Reader {
+  const uint8_t* p;
+  const uint8_t* end;
+  bool ok = true;
+
+  bool head(uint8_t& major, uint64_t& v, uint8_t& info) {
+    if (p >= end) return ok = false;
+    const uint8_t b = *p++;
+    major = b >> 5;
+    info = b & 31;
+    if (info < 24) {
+      v = info;
+      return true;
+    }
+    const int n = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : -1;
+    if (n < 0 || end - p < n) return ok = false;
+    v = 0;
+    for (int i = 0; i < n; i++) v = (v << 8) | *p++;
+    return true;
+  }
+
+  // Any scalar as display text
+  std::string value() {
+    uint8_t major, info;
+    uint64_t v;
+    if (!head(major, v, info)) return "?";
+    char buf[32];
+    switch (major) {
+      case 0:
+        snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+        return buf;
+      case 1:
+        snprintf(buf, sizeof(buf), "%lld", -1 - (long long)v);
+        return buf;
+      case 3:
+        if ((uint64_t)(end - p) < v) {
+          ok = false;
+          return "?";
+        } else {
+          std::string s((const char*)p, (size_t)v);
+          p += v;
+          return "\"" + s + "\"";
+        }
+      case 7:
+        if (info == 20) return "false";
+        if (info == 21) return "true";
+        if (info == 22) return "null";
+        if (info == 26) {
+          float f;
+          const uint32_t u = (uint32_t)v;
+          memcpy(&f, &u, 4);
+          snprintf(buf, sizeof(buf), "%g", f);
+          return buf;
+        }
+        if (info == 27) {
+          double d;
+          memcpy(&d, &v, 8);
+          snprintf(buf, sizeof(buf), "%g", d);
+          return buf;
+        }
+        break;
+    }
+    ok = false;
+    return "?";
+  }
+};
+
+// "key=value ..." for the status map; empty string if it is not one
+std::string decodeStatus(const std::vector<uint8_t>& body, size_t* fields) {
+  Reader r{ body.data(), body.data() + body.size() };
+  uint8_t major, info;
+  uint64_t n;
+  if (!r.head(major, n, info) || major != 5) return "";
+  std::string out;
+  size_t count = 0;
+  for (uint64_t i = 0; i < n && r.ok; i++) {
+    uint64_t k;
+    if (!r.head(major, k, info) || major != 0) return "";
+    const std::string v = r.value();
+    if (!r.ok) return "";
+    if (!out.empty()) out += ' ';
+    out += k < statuscbor::kKeyCount ? statuscbor::kKeyNames[k] : std::to_string(k);
+    out += '=';
+    out += v;
+    count++;
+  }
+  if (fields) *fields = count;
+  return out;
+}
+
+// ---- Polling ----
+
+struct Beacon {
+  std::string host;
+  uint16_t port = 80;
+  sockaddr_in addr{};
+  bool resolved = false;
+
+  uint32_t ok = 0, failed = 0;
+  std::vector<double> connectMs, firstByteMs, totalMs;
+  size_t lastBytes = 0;
+  std::string lastError, lastStatus;
+};
+
+struct Request {
+  Beacon* b = nullptr;
+  int fd = -1;
+  enum { Connecting, Sending, Reading, Done } state = Connecting;
+  std::string out;
+  size_t sent = 0;
+  std::vector<uint8_t> in;
+  int64_t startUs = 0, connectedUs = 0, firstByteUs = 0;
+};
+
+bool resolve(Beacon& b) {
+  addrinfo hints{}, *res = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(b.host.c_str(), nullptr, &hints, &res) != 0 || !res) return false;
+  b.addr = *(sockaddr_in*)res->ai_addr;
+  b.addr.sin_port = htons(b.port);
+  freeaddrinfo(res);
+  return b.resolved = true;
+}
+
+void finish(Request& q, const char* err) {
+  if (q.fd >= 0) close(q.fd);
+  q.fd = -1;
+  q.state = Request::Done;
+  Beacon& b = *q.b;
+  if (err) {
+    b.failed++;
+    b.lastError = err;
+    return;
+  }
+  // Status line, headers, body
+  const std::string head(q.in.begin(), q.in.end());
+  const size_t hdrEnd = head.find("\r\n\r\n");
+  int code = 0;
+  if (hdrEnd == std::string::npos || sscanf(head.c_str(), "HTTP/%*s %d", &code) != 1) {
+    b.failed++;
+    b.lastError = "bad response";
+    return;
+  }
+  if (code != 200) {
+    b.failed++;
+    b.lastError = "HTTP " + std::to_string(code);
+    return;
+  }
+  const std::vector<uint8_t> body(q.in.begin() + hdrEnd + 4, q.in.end());
+  const int64_t end = nowUs();
+  b.ok++;
+  b.connectMs.push_back((q.connectedUs - q.startUs) / 1000.0);
+  b.firstByteMs.push_back((q.firstByteUs - q.startUs) / 1000.0);
+  b.totalMs.push_back((end - q.startUs) / 1000.0);
+  b.lastBytes = body.size();
+  const std::string st = decodeStatus(body, nullptr);
+  b.lastStatus = st.empty() ? "(" + std::to_string(body.size()) + " bytes, not a status map)" : st;
+}
+
+// One concurrent round over all beacons; returns its wall time in ms
+double pollRound(std::vector<Beacon>& fleet, const std::string& path, const std::string& auth, int timeoutMs) {
+  std::vector<Request> reqs(fleet.size());
+  const int64_t t0 = nowUs();
+  for (size_t i = 0; i < fleet.size(); i++) {
+    Request& q = reqs[i];
+    q.b = &fleet[i];
+    q.startUs = t0;
+    if (!q.b->resolved && !resolve(*q.b)) {
+      finish(q, "unresolved");
+      continue;
+    }
+    q.out = "GET " + path + " HTTP/1.0\r\nHost: " + q.b->host + "\r\n";
+    if (!auth.empty()) q.out += "Authorization: Basic " + auth + "\r\n";
+    q.out += "\r\n";
+    q.fd = socket(AF_INET, SOCK_STREAM, 0);
+    fcntl(q.fd, F_SETFL, fcntl(q.fd, F_GETFL) | O_NONBLOCK);
+    const int one = 1;
+    setsockopt(q.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(q.fd, (sockaddr*)&q.b->addr, sizeof(q.b->addr)) != 0 && errno != EINPROGRESS) {
+      finish(q, strerror(errno));
+    }
+  }
+
+  std::vector<pollfd> pfds;
+  std::vector<size_t> idx;
+  for (;;) {
+    pfds.clear();
+    idx.clear();
+    for (size_t i = 0; i < reqs.size(); i++) {
+      const Request& q = reqs[i];
+      if (q.state == Request::Done) continue;
+      pfds.push_back({ q.fd, (short)(q.state == Request::Reading ? POLLIN : POLLOUT), 0 });
+      idx.push_back(i);
+    }
+    if (pfds.empty()) break;
+    const int left = timeoutMs - (int)((nowUs() - t0) / 1000);
+    if (left <= 0) {
+      for (size_t i : idx) finish(reqs[i], "timeout");
+      break;
+    }
+    if (poll(pfds.data(), pfds.size(), left) < 0 && errno != EINTR) break;
+
+    for (size_t k = 0; k < pfds.size(); k++) {
+      if (!pfds[k].revents) continue;
+      Request& q = reqs[idx[k]];
+      if (q.state == Request::Connecting) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(q.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err) {
+          finish(q, strerror(err));
+          continue;
+        }
+        q.connectedUs = nowUs();
+        q.state = Request::Sending;
+      }
+      if (q.state == Request::Sending) {
+        const ssize_t n = send(q.fd, q.out.data() + q.sent, q.out.size() - q.sent, MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN) {
+          finish(q, strerror(errno));
+          continue;
+        }
+        if (n > 0) q.sent += (size_t)n;
+        if (q.sent == q.out.size()) q.state = Request::Reading;
+        continue;
+      }
+      uint8_t buf[4096];
+      const ssize_t n = recv(q.fd, buf, sizeof(buf), 0);
+      if (n > 0) {
+        if (!q.firstByteUs) q.firstByteUs = nowUs();
+        q.in.insert(q.in.end(), buf, buf + n);
+        if (q.in.size() > 256 * 1024) finish(q, "response too large");
+      } else if (n == 0) {
+        finish(q, nullptr);
+      } else if (errno != EAGAIN) {
+        finish(q, strerror(errno));
+      }
+    }
+  }
+  return (nowUs() - t0) / 1000.0;
+}
+
+double pct(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(v.size() * p / 100.0))];
+}
+
+void report(const std::vector<Beacon>& fleet, const std::vector<double>& rounds) {
+  printf("\n%-22s %5s %5s  %-22s %-22s %-22s %6s\n", "beacon", "ok", "fail", "connect p50/p99/max",
+         "first byte p50/p99/max", "total p50/p99/max", "bytes");
+  for (const Beacon& b : fleet) {
+    char name[64], c[32], f[32], t[32];
+    snprintf(name, sizeof(name), "%s:%u", b.host.c_str(), b.port);
+    snprintf(c, sizeof(c), "%.1f/%.1f/%.1f", pct(b.connectMs, 50), pct(b.connectMs, 99), pct(b.connectMs, 100));
+    snprintf(f, sizeof(f), "%.1f/%.1f/%.1f", pct(b.firstByteMs, 50), pct(b.firstByteMs, 99), pct(b.firstByteMs, 100));
+    snprintf(t, sizeof(t), "%.1f/%.1f/%.1f", pct(b.totalMs, 50), pct(b.totalMs, 99), pct(b.totalMs, 100));
+    printf("%-22s %5u %5u  %-22s %-22s %-22s %6zu\n", name, b.ok, b.failed, c, f, t, b.lastBytes);
+    if (!b.lastStatus.empty()) printf("    %s\n", b.lastStatus.c_str());
+    if (b.failed) printf("    last error: %s\n", b.lastError.c_str());
+  }
+  printf("round wall time p50 %.1f ms, max %.1f ms (%zu rounds, %zu beacons)\n", pct(rounds, 50),
+         pct(rounds, 100), rounds.size(), fleet.size());
+}
+
+// ---- Self test: stand-in beacons on loopback ----
+
+std::vector<uint8_t> sampleStatus(int i) {
+  using namespace statuscbor;
+  uint8_t buf[kMaxLen];
+  Writer w(buf, sizeof(buf));
+  w.map(kKeyCount);
+  w.key(kKeySchema);       w.uint(kSchema);
+  w.key(kKeyUptimeMs);     w.uint(86400000ULL * 3 + i);
+  w.key(kKeyFw);           w.text("1.4.0");
+  w.key(kKeyRssi);         w.sint(-60 - i);
+  w.key(kKeyHeapFree);     w.uint(143000);
+  w.key(kKeyHeapBlock);    w.uint(65524);
+  w.key(kKeyConnected);    w.boolean(true);
+  w.key(kKeyGcodeState);   w.text("RUNNING");
+  w.key(kKeyProgress);     w.uint(42);
+  w.key(kKeyDownload);     w.null();
+  w.key(kKeyRemainingMin); w.uint(317);
+  w.key(kKeyBed);          w.sint(600);
+  w.key(kKeyBedTarget);    w.sint(600);
+  w.key(kKeyNozzle);       w.sint(-5);
+  w.key(kKeyNozzleTarget); w.sint(2200);
+  w.key(kKeyHmsTop);       w.uint(2);
+  w.key(kKeyHmsCount);     w.uint(1);
+  w.key(kKeyReportAgeMs);  w.uint(1234);
+  return std::vector<uint8_t>(buf, buf + (w.ok() ? w.length() : 0));
+}
+
+int selftest(int rounds) {
+  const int live = 6;
+  const int delayStepMs = 20;  // beacon i answers after i * 20 ms
+  std::atomic<bool> stop{false};
+  std::vector<Beacon> fleet;
+  std::vector<std::thread> servers;
+  std::vector<int> listeners;
+
+  for (int i = 0; i <= live; i++) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (sockaddr*)&a, sizeof(a));
+    listen(fd, 16);
+    socklen_t len = sizeof(a);
+    getsockname(fd, (sockaddr*)&a, &len);
+    listeners.push_back(fd);
+    Beacon b;
+    b.host = "127.0.0.1";
+    b.port = ntohs(a.sin_port);
+    fleet.push_back(b);
+
+    const bool dead = i == live;  // accepts, never answers
+    servers.emplace_back([fd, i, dead, &stop] {
+      const std::vector<uint8_t> body = sampleStatus(i);
+      while (!stop) {
+        pollfd p{ fd, POLLIN, 0 };
+        if (poll(&p, 1, 50) <= 0) continue;
+        const int c = accept(fd, nullptr, nullptr);
+        if (c < 0) continue;
+        std::thread([c, i, dead, body, &stop] {
+          char req[1024];
+          size_t got = 0;
+          while (got < sizeof(req) - 1) {
+            const ssize_t n = recv(c, req + got, sizeof(req) - 1 - got, 0);
+            if (n <= 0) break;
+            got += (size_t)n;
+            req[got] = 0;
+            if (strstr(req, "\r\n\r\n")) break;
+          }
+          if (dead) {
+            while (!stop) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(i * delayStepMs));
+            const bool authed = strstr(req, "Authorization: Basic dXNlcjpwYXNz") != nullptr;  // user:pass
+            char hdr[160];
+            int h = snprintf(hdr, sizeof(hdr), "HTTP/1.1 401 Unauthorized\r\nContent-Length: 0\r\n\r\n");
+            if (authed) {
+              h = snprintf(hdr, sizeof(hdr), "HTTP/1.1 200 OK\r\nContent-Type: application/cbor\r\n"
+                           "Content-Length: %zu\r\nConnection: close\r\n\r\n", body.size());
+            }
+            send(c, hdr, (size_t)h, MSG_NOSIGNAL);
+            if (authed) send(c, body.data(), body.size(), MSG_NOSIGNAL);
+          }
+          close(c);
+        }).detach();
+      }
+    });
+  }
+
+  std::vector<double> wall;
+  for (int r = 0; r < rounds; r++) wall.push_back(pollRound(fleet, "/status.cbor", base64("user:pass"), 500));
+  report(fleet, wall);
+
+  // A wrong password must come back as a failure, not as data
+  std::vector<Beacon> one(fleet.begin(), fleet.begin() + 1);
+  pollRound(one, "/status.cbor", base64("user:wrong"), 500);
+
+  stop = true;
+  for (std::thread& t : servers) t.join();
+  for (int fd : listeners) close(fd);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  bool ok = true;
+  const double slowest = (live - 1) * delayStepMs;
+  for (int i = 0; i < live; i++) {
+    size_t fields = 0;
+    const Beacon& b = fleet[i];
+    const std::string st = b.ok ? b.lastStatus : "";
+    decodeStatus(sampleStatus(i), &fields);
+    if (b.ok != (uint32_t)rounds || fields != statuscbor::kKeyCount ||
+        st.find("gcodeState=\"RUNNING\"") == std::string::npos || st.find("nozzle=-5") == std::string::npos ||
+        st.find("download=null") == std::string::npos) {
+      printf("FAIL: beacon %d: %u ok, %zu fields, status '%s'\n", i, b.ok, fields, st.c_str());
+      ok = false;
+    }
+  }
+  if (fleet[live].failed != (uint32_t)rounds || fleet[live].lastError != "timeout") {
+    printf("FAIL: silent beacon: %u failed, last error '%s'\n", fleet[live].failed, fleet[live].lastError.c_str());
+    ok = false;
+  }
+  if (one[0].failed != 1 || one[0].lastError != "HTTP 401") {
+    printf("FAIL: wrong password: %u failed, last error '%s'\n", one[0].failed, one[0].lastError.c_str());
+    ok = false;
+  }
+  // Concurrency: the slowest live beacon must be done long before the sum of
+  // all delays; the round itself is bounded by the silent beacon's timeout
+  const double sum = live * (live - 1) / 2.0 * delayStepMs;
+  const double slowestTotal = pct(fleet[live - 1].totalMs, 50);
+  if (slowestTotal > slowest + 0.5 * (sum - slowest)) {
+    printf("FAIL: slowest beacon took %.1f ms, sequential would be %.0f ms\n", slowestTotal, sum);
+    ok = false;
+  }
+  printf("%s (slowest live beacon %.1f ms, its own delay %.0f ms, sequential %.0f ms)\n", ok ? "OK" : "FAIL",
+         slowestTotal, slowest, sum);
+  return ok ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string user, pass, path = "/status.cbor";
+  int rounds = 10, intervalMs = 1000, timeoutMs = 2000;
+  bool self = false;
+  std::vector<Beacon> fleet;
+  auto add = [&](const std::string& spec) {
+    if (spec.empty() || spec[0] == '#') return;
+    Beacon b;
+    const size_t colon = spec.find(':');
+    b.host = spec.substr(0, colon);
+    if (colon != std::string::npos) b.port = (uint16_t)atoi(spec.c_str() + colon + 1);
+    fleet.push_back(b);
+  };
+
+  for (int i = 1; i < argc; i++) {
+    const std::string k = argv[i];
+    const bool hasV = i + 1 < argc;
+    if (k == "--selftest") self = true;
+    else if (k == "--user" && hasV) user = argv[++i];
+    else if (k == "--pass" && hasV) pass = argv[++i];
+    else if (k == "--path" && hasV) path = argv[++i];
+    else if (k == "--rounds" && hasV) rounds = atoi(argv[++i]);
+    else if (k == "--interval-ms" && hasV) intervalMs = atoi(argv[++i]);
+    else if (k == "--timeout-ms" && hasV) timeoutMs = atoi(argv[++i]);
+    else if (k == "--file" && hasV) {
+      std::ifstream f(argv[++i]);
+      for (std::string line; std::getline(f, line);) add(line.substr(0, line.find_first_of(" \t\r")));
+    } else if (k.size() && k[0] != '-') add(k);
+    else {
+      fprintf(stderr, "usage: %s [--user U --pass P] [--path /status.cbor] [--rounds N] [--interval-ms MS]\n"
+                      "          [--timeout-ms MS] [--file hosts.txt] [host[:port] ...] | --selftest\n", argv[0]);
+      return 2;
+    }
+  }
+  if (self) return selftest(rounds);
+  if (fleet.empty()) {
+    fprintf(stderr, "no beacons given\n");
+    return 2;
+  }
+
+  const std::string auth = user.empty() ? "" : base64(user + ":" + pass);
+  std::vector<double> wall;
+  for (int r = 0; r < rounds; r++) {
+    const int64_t start = nowUs();
+    wall.push_back(pollRound(fleet, path, auth, timeoutMs));
+    uint32_t ok = 0;
+    for (const Beacon& b : fleet) ok += b.ok;
+    printf("round %d: %.1f ms, %u/%zu ok so far\n", r + 1, wall.back(), ok, fleet.size() * (r + 1));
+    const int64_t waitUs = (int64_t)intervalMs * 1000 - (nowUs() - start);
+    if (r + 1 < rounds && waitUs > 0) std::this_thread::sleep_for(std::chrono::microseconds(waitUs));
+  }
+  report(fleet, wall);
+  return 0;
+}
@@ -0,0 +1,352 @@
+#!/usr/bin/env python3
+"""Minimal MQTT 3.1.1 broker stand-in for the beacon's Home Assistant publisher.
+
+Accepts plain MQTT on --port (QoS 0, retained messages, last will), keeps
+the retained topics like a real broker would, and checks what the beacon
+(HaPublisher) sends:
+  - <prefix>/<component>/<id>/<key>/config: discovery configs must be retained
+    JSON with name, uniq_id, stat_t, val_tpl, avty_t and dev.ids; stat_t must
+    be the device's state topic and every value_json.<field> a template uses
+    must be present in the state document
+  - bambubeacon/<id>/state: retained JSON; prints each change and counts
+    publishes that did not change anything (should stay 0)
+  - bambubeacon/<id>/status: "online" retained, "offline" via the will
+Every --interval seconds it prints state publishes/s and bytes/s.
+
+Set the beacon's MQTT Broker (WiFi setup page, Home Assistant section) to
+this machine. --selftest connects to the stub itself, publishes the firmware's
+topics (one config deliberately broken) and checks that exactly that one is
+reported.
+
+Usage:
+  python tools/ha_broker_stub.py --port 1883 --interval 10
+  python tools/ha_broker_stub.py --selftest
+"""
+import argparse
+import json
+import re
+import socket
+import struct
+import sys
+import threading
+import time
+
+TEMPLATE_FIELD = re.compile(r"value_json\.(\w+)")
+REQUIRED_CONFIG = ("name", "uniq_id", "stat_t", "val_tpl", "avty_t", "dev")
+
+
+def read_exact(sock, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError("closed")
+        buf += chunk
+    return buf
+
+
+def read_packet(sock):
+    first = read_exact(sock, 1)[0]
+    mult, length = 1, 0
+    while True:
+        b = read_exact(sock, 1)[0]
+        length += (b & 0x7F) * mult
+        if not b & 0x80:
+            break
+        mult *= 128
+    return first, read_exact(sock, length) if length else b""
+
+
+def encode_len(n):
+    out = bytearray()
+    while True:
+        b = n % 128
+        n //= 128
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def mqtt_str(s):
+    b = s.encode() if isinstance(s, str) else s
+    return struct.pack(">H", len(b)) + b
+
+
+def take_str(body, pos):
+    n = struct.unpack_from(">H", body, pos)[0]
+    return body[pos + 2:pos + 2 + n], pos + 2 + n
+
+
+def publish_packet(topic, payload, retain=False):
+    body = mqtt_str(topic) + payload
+    return bytes([0x30 | (1 if retain else 0)]) + encode_len(len(body)) + body
+
+
+class Checker:
+    def __init__(self, prefix, quiet=False):
+        self.prefix = prefix
+        self.quiet = quiet
+        self.lock = threading.Lock()
+        self.retained = {}
+        self.configs = {}      # topic -> config dict
+        self.states = {}       # state topic -> last document
+        self.errors = []
+        self.state_publishes = 0
+        self.state_bytes = 0
+        self.unchanged = 0
+        self.discovery = 0
+
+    def error(self, msg):
+        self.errors.append(msg)
+        print(f"[check] ERROR {msg}")
+
+    def on_publish(self, topic, payload, retain):
+        with self.lock:
+            if retain:
+                if payload:
+                    self.retained[topic] = payload
+                else:
+                    self.retained.pop(topic, None)
+            if topic.startswith(self.prefix + "/") and topic.endswith("/config"):
+                self.check_config(topic, payload, retain)
+            elif topic.startswith("bambubeacon/") and topic.endswith("/state"):
+                self.check_state(topic, payload, retain)
+            elif topic.startswith("bambubeacon/") and topic.endswith("/status"):
+                if not self.quiet:
+                    print(f"[status] {topic} = {payload.decode(errors='replace')}")
+
+    def check_config(self, topic, payload, retain):
+        self.discovery += 1
+        if not retain:
+            self.error(f"{topic}: discovery config not retained")
+        try:
+            cfg = json.loads(payload)
+        except ValueError:
+            self.error(f"{topic}: not JSON")
+            return
+        missing = [k for k in REQUIRED_CONFIG if k not in cfg]
+        if missing:
+            self.error(f"{topic}: missing {', '.join(missing)}")
+            return
+        parts = topic.split("/")
+        if len(parts) != 5:
+            self.error(f"{topic}: expected <prefix>/<component>/<id>/<key>/config")
+            return
+        dev_id = parts[2]
+        if cfg["stat_t"] != f"bambubeacon/{dev_id}/state":
+            self.error(f"{topic}: stat_t {cfg['stat_t']} is not bambubeacon/{dev_id}/state")
+        if cfg["avty_t"] != f"bambubeacon/{dev_id}/status":
+            self.error(f"{topic}: avty_t {cfg['avty_t']} is not bambubeacon/{dev_id}/status")
+        if not cfg["dev"].get("ids"):
+            self.error(f"{topic}: dev.ids empty")
+        self.configs[topic] = cfg
+        state = self.states.get(cfg["stat_t"])
+        if state is not None:
+            self.check_fields(topic, cfg, state)
+
+    def check_fields(self, topic, cfg, state):
+        for field in TEMPLATE_FIELD.findall(cfg["val_tpl"]):
+            if field not in state:
+                self.error(f"{topic}: template field '{field}' not in state document")
+
+    def check_state(self, topic, payload, retain):
+        self.state_publishes += 1
+        self.state_bytes += len(payload)
+        if not retain:
+            self.error(f"{topic}: state not retained")
+        try:
+            doc = json.loads(payload)
+        except ValueError:
+            self.error(f"{topic}: state not JSON")
+            return
+        prev = self.states.get(topic)
+        if prev == doc:
+            self.unchanged += 1
+        elif not self.quiet:
+            if prev is None:
+                print(f"[state] {topic} ({len(payload)} B) {json.dumps(doc)}")
+            else:
+                diff = {k: doc.get(k) for k in set(doc) | set(prev) if doc.get(k) != prev.get(k)}
+                print(f"[state] {topic} ({len(payload)} B) changed {json.dumps(diff)}")
+        first = prev is None
+        self.states[topic] = doc
+        if first:
+            for ctopic, cfg in self.configs.items():
+                if cfg["stat_t"] == topic:
+                    self.check_fields(ctopic, cfg, doc)
+
+
+class Broker:
+    def __init__(self, checker, port, bind="0.0.0.0"):
+        self.checker = checker
+        self.lock = threading.Lock()
+        self.sessions = {}     # conn -> list of subscription filters
+        self.srv = socket.socket()
+        self.srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.srv.bind((bind, port))
+        self.srv.listen(4)
+        self.port = self.srv.getsockname()[1]
+
+    def serve(self):
+        while True:
+            conn, addr = self.srv.accept()
+            threading.Thread(target=self.session, args=(conn, addr), daemon=True).start()
+
+    @staticmethod
+    def matches(flt, topic):
+        f, t = flt.split("/"), topic.split("/")
+        for i, part in enumerate(f):
+            if part == "#":
+                return True
+            if i >= len(t) or (part != "+" and part != t[i]):
+                return False
+        return len(f) == len(t)
+
+    def route(self, topic, payload):
+        with self.lock:
+            targets = [c for c, subs in self.sessions.items() if any(self.matches(f, topic) for f in subs)]
+        for c in targets:
+            try:
+                c.sendall(publish_packet(topic, payload))
+            except OSError:
+                pass
+
+    def session(self, conn, addr):
+        will = None
+        client_id = "?"
+        clean = False
+        try:
+            while True:
+                kind, body = read_packet(conn)
+                ptype = kind >> 4
+                if ptype == 1:      # CONNECT
+                    _, pos = take_str(body, 0)
+                    flags = body[pos + 1]
+                    pos += 4
+                    cid, pos = take_str(body, pos)
+                    client_id = cid.decode(errors="replace")
+                    if flags & 0x04:
+                        wt, pos = take_str(body, pos)
+                        wm, pos = take_str(body, pos)
+                        will = (wt.decode(), wm, bool(flags & 0x20))
+                    print(f"[broker] {client_id} connected from {addr[0]}"
+                          f"{' with will on ' + will[0] if will else ''}{' (auth)' if flags & 0x80 else ''}")
+                    conn.sendall(b"\x20\x02\x00\x00")
+                    with self.lock:
+                        self.sessions[conn] = []
+                elif ptype == 3:    # PUBLISH
+                    qos = (kind >> 1) & 3
+                    topic, pos = take_str(body, 0)
+                    if qos:
+                        pid = body[pos:pos + 2]
+                        pos += 2
+                        conn.sendall(b"\x40\x02" + pid)
+                    self.checker.on_publish(topic.decode(), body[pos:], bool(kind & 1))
+                    self.route(topic.decode(), body[pos:])
+                elif ptype == 8:    # SUBSCRIBE
+                    pid, pos, granted = body[:2], 2, b""
+                    new = []
+                    while pos < len(body):
+                        flt, pos = take_str(body, pos)
+                        pos += 1
+                        new.append(flt.decode())
+                        granted += b"\x00"
+                    conn.sendall(b"\x90" + encode_len(2 + len(granted)) + pid + granted)
+                    with self.lock:
+                        self.sessions.setdefault(conn, []).extend(new)
+                        retained = list(self.checker.retained.items())
+                    for topic, payload in retained:
+                        if any(self.matches(f, topic) for f in new):
+                            conn.sendall(publish_packet(topic, payload, retain=True))
+                elif ptype == 12:   # PINGREQ
+                    conn.sendall(b"\xd0\x00")
+                elif ptype == 14:   # DISCONNECT
+                    clean = True
+                    break
+        except (ConnectionError, OSError, struct.error, IndexError):
+            pass
+        with self.lock:
+            self.sessions.pop(conn, None)
+        conn.close()
+        if will and not clean:
+            print(f"[broker] {client_id} lost, publishing will {will[0]}")
+            self.checker.on_publish(will[0], will[1], will[2])
+            self.route(will[0], will[1])
+        else:
+            print(f"[broker] {client_id} disconnected")
+
+
+def report(checker, interval, stop):
+    last, snap = time.time(), (0, 0)
+    while not stop.wait(interval):
+        now = time.time()
+        dt = now - last
+        with checker.lock:
+            pubs, nbytes = checker.state_publishes, checker.state_bytes
+            print(f"[rate] {(pubs - snap[0]) / dt:.2f} state publishes/s {(nbytes - snap[1]) / dt:.0f} B/s, "
+                  f"total {pubs} ({checker.unchanged} unchanged), discovery {checker.discovery}, "
+                  f"retained topics {len(checker.retained)}, errors {len(checker.errors)}")
+        last, snap = now, (pubs, nbytes)
+
+
+def selftest(args):
+    """Plays the firmware against the stub: 2 sensors, one with a template field the state lacks."""
+    checker = Checker(args.prefix, quiet=True)
+    broker = Broker(checker, 0, "127.0.0.1")
+    threading.Thread(target=broker.serve, daemon=True).start()
+
+    dev_id = "bambubeacon_selftest"
+    base = f"bambubeacon/{dev_id}"
+    s = socket.create_connection(("127.0.0.1", broker.port))
+    var = mqtt_str("MQTT") + bytes([4, 0x02 | 0x04 | 0x20]) + struct.pack(">H", 15)
+    payload = mqtt_str(dev_id) + mqtt_str(base + "/status") + mqtt_str("offline")
+    s.sendall(b"\x10" + encode_len(len(var) + len(payload)) + var + payload)
+    read_packet(s)
+    s.sendall(publish_packet(base + "/status", b"online", retain=True))
+
+    def config(key, field):
+        return json.dumps({"name": key, "uniq_id": f"{dev_id}_{key}", "stat_t": base + "/state",
+                           "avty_t": base + "/status", "val_tpl": "{{ value_json.%s }}" % field,
+                           "dev": {"ids": [dev_id], "name": "selftest"}}).encode()
+    s.sendall(publish_packet(f"{args.prefix}/sensor/{dev_id}/progress/config", config("progress", "progress"), True))
+    s.sendall(publish_packet(f"{args.prefix}/sensor/{dev_id}/eta/config", config("eta", "eta"), True))
+    for p in (10, 11, 11, 12):
+        s.sendall(publish_packet(base + "/state", json.dumps({"state": "RUNNING", "progress": p}).encode(), True))
+    s.close()  # no DISCONNECT: the will must fire
+    time.sleep(0.5)
+
+    ok = (len(checker.errors) == 1 and "'eta'" in checker.errors[0] and checker.unchanged == 1
+          and checker.state_publishes == 4 and checker.retained.get(base + "/status") == b"offline")
+    print(f"selftest: {checker.state_publishes} state publishes ({checker.unchanged} unchanged, expected 1), "
+          f"{len(checker.errors)} error(s) (expected 1), status {checker.retained.get(base + '/status')} "
+          f"-> {'OK' if ok else 'FAIL'}")
+    return 0 if ok else 1
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--prefix", default="homeassistant", help="discovery prefix (haPrefix)")
+    ap.add_argument("--interval", type=float, default=10.0)
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+
+    if args.selftest:
+        return selftest(args)
+
+    checker = Checker(args.prefix)
+    broker = Broker(checker, args.port, args.bind)
+    print(f"[broker] listening on :{broker.port}")
+    stop = threading.Event()
+    threading.Thread(target=report, args=(checker, args.interval, stop), daemon=True).start()
+    try:
+        broker.serve()
+    except KeyboardInterrupt:
+        pass
+    stop.set()
+    return 1 if checker.errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""Sample the WebSerial log sink counters from /metrics.json.
+
+Prints WS frames/s, payload bytes/s, write() calls/s, drops and the CPU share
+spent in the sink (producer + drain), computed from deltas between polls.
+Keep the WebSerial page open so frames are actually sent. Build with
+-D BAMBU_MQTT_VERBOSE (see the _DBG env) for a verbose MQTT session.
+
+Usage:
+  python tools/log_bench.py 192.168.1.50 --user admin --password secret --interval 5 --samples 12
+"""
+import argparse
+import base64
+import json
+import sys
+import time
+import urllib.request
+
+
+def fetch(host, auth):
+    req = urllib.request.Request(f"http://{host}/metrics.json")
+    if auth:
+        req.add_header("Authorization", "Basic " + base64.b64encode(auth.encode()).decode())
+    with urllib.request.urlopen(req, timeout=5) as r:
+        return json.load(r)["log"]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host")
+    ap.add_argument("--user", default="")
+    ap.add_argument("--password", default="")
+    ap.add_argument("--interval", type=float, default=5.0)
+    ap.add_argument("--samples", type=int, default=12)
+    args = ap.parse_args()
+    auth = f"{args.user}:{args.password}" if args.user else ""
+
+    prev = fetch(args.host, auth)
+    totals = {"frames": 0, "bytes": 0, "writes": 0, "dropped": 0, "cpu": 0, "ms": 0}
+    print(f"{'frames/s':>9} {'bytes/s':>9} {'writes/s':>9} {'dropped':>8} {'cpu %':>6}")
+    for _ in range(args.samples):
+        time.sleep(args.interval)
+        cur = fetch(args.host, auth)
+        ms = (cur["uptimeMs"] - prev["uptimeMs"]) & 0xFFFFFFFF
+        if ms <= 0:
+            prev = cur
+            continue
+        d = {k: (cur[k] - prev[k]) & 0xFFFFFFFF for k in ("frames", "bytes", "writes", "dropped", "producerUs", "drainUs")}
+        cpu_us = d["producerUs"] + d["drainUs"]
+        print(f"{d['frames'] * 1000 / ms:9.1f} {d['bytes'] * 1000 / ms:9.0f} {d['writes'] * 1000 / ms:9.1f} "
+              f"{d['dropped']:8d} {cpu_us / (ms * 10):6.2f}")
+        for k in ("frames", "bytes", "writes", "dropped"):
+            totals[k] += d[k]
+        totals["cpu"] += cpu_us
+        totals["ms"] += ms
+        prev = cur
+
+    if totals["ms"]:
+        ms = totals["ms"]
+        print(f"avg: {totals['frames'] * 1000 / ms:.1f} frames/s, {totals['bytes'] * 1000 / ms:.0f} B/s, "
+              f"{totals['writes'] / max(totals['frames'], 1):.1f} writes per frame, "
+              f"{totals['dropped']} bytes dropped, {totals['cpu'] / (ms * 10):.2f}% CPU")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""Create (and verify) delta OTA patches between two firmware images.
+
+The patch is applied on the device by OtaUpdater against the running partition,
+so OLD must be the exact .bin.ota that is currently installed.
+
+Format (little endian, gzip-compressed as a whole):
+  header  b"BBDELTA1", u32 oldSize, u32 newSize, sha256(old), sha256(new)
+  records u32 diffLen, u32 extraLen, i32 seek, diff bytes, extra bytes
+
+Each record produces diffLen bytes as (old[pos + i] + diff[i]) & 0xFF, then
+extraLen literal bytes, then moves the old position by seek. Code that only
+moved in flash yields diff bytes that are mostly zero, which gzip squeezes well.
+
+Usage:
+  python tools/make_delta.py OLD.bin.ota NEW.bin.ota -o patch.delta.gz
+  python tools/make_delta.py OLD.bin.ota NEW.bin.ota --verify patch.delta.gz
+"""
+import argparse
+import gzip
+import hashlib
+import struct
+import sys
+
+MAGIC = b"BBDELTA1"
+HEADER = struct.Struct("<8sII32s32s")
+CONTROL = struct.Struct("<IIi")
+
+SEED_LEN = 16        # exact bytes needed to start a match
+INDEX_STEP = 4       # index every n-th old position (keeps the table small)
+MAX_CANDIDATES = 8   # old positions kept per seed
+MIN_MATCH = 32       # shorter exact matches are cheaper as extra bytes
+FUZZ_GIVEUP = 64     # stop extending after this many bytes without gain
+
+
+def build_index(old):
+    index = {}
+    for pos in range(0, len(old) - SEED_LEN + 1, INDEX_STEP):
+        slots = index.setdefault(old[pos:pos + SEED_LEN], [])
+        if len(slots) < MAX_CANDIDATES:
+            slots.append(pos)
+    return index
+
+
+def exact_len(old, o, new, n):
+    length = 0
+    limit = min(len(old) - o, len(new) - n)
+    while length + 64 <= limit and old[o + length:o + length + 64] == new[n + length:n + length + 64]:
+        length += 64
+    while length < limit and old[o + length] == new[n + length]:
+        length += 1
+    return length
+
+
+def extend_forward(old, o, new, n):
+    """bsdiff-style: longest prefix where matches outweigh mismatches."""
+    limit = min(len(old) - o, len(new) - n)
+    score = best = length = 0
+    for i in range(limit):
+        score += 1 if old[o + i] == new[n + i] else -1
+        if score > best:
+            best, length = score, i + 1
+        elif i + 1 - length > FUZZ_GIVEUP:
+            break
+    return length
+
+
+def extend_backward(old, o, new, n, floor_new, floor_old):
+    limit = min(n - floor_new, o - floor_old)
+    score = best = length = 0
+    for i in range(1, limit + 1):
+        score += 1 if old[o - i] == new[n - i] else -1
+        if score > best:
+            best, length = score, i
+        elif i - length > FUZZ_GIVEUP:
+            break
+    return length
+
+
+def find_match(index, old, new, n, predicted):
+    candidates = index.get(new[n:n + SEED_LEN])
+    if not candidates:
+        return None, 0
+    best_pos, best_len = None, 0
+    for o in candidates:
+        length = exact_len(old, o, new, n)
+        if length > best_len or (length == best_len and best_pos is not None
+                                 and abs(o - predicted) < abs(best_pos - predicted)):
+            best_pos, best_len = o, length
+    return best_pos, best_len
+
+
+def make_records(old, new):
+    """Returns [(newStart, oldStart, diffLen, extraLen, seek)] covering new."""
+    index = build_index(old)
+    regions = []
+    region_new = region_old = region_len = 0
+    n = 0
+    while n + SEED_LEN <= len(new):
+        # keep riding the current alignment if it still (fuzzily) matches
+        predicted = n - region_new + region_old
+        o, length = find_match(index, old, new, n, predicted)
+        if o is None or length < MIN_MATCH:
+            n += 1
+            continue
+        floor_new = region_new + region_len
+        back = extend_backward(old, o, new, n, floor_new, 0)
+        fwd = extend_forward(old, o, new, n)
+        regions.append((region_new, region_old, region_len))
+        region_new, region_old, region_len = n - back, o - back, back + fwd
+        n = region_new + region_len
+    regions.append((region_new, region_old, region_len))
+
+    records = []
+    for i, (rn, ro, rl) in enumerate(regions):
+        next_new = regions[i + 1][0] if i + 1 < len(regions) else len(new)
+        next_old = regions[i + 1][1] if i + 1 < len(regions) else ro + rl
+        records.append((rn, ro, rl, next_new - (rn + rl), next_old - (ro + rl)))
+    return records
+
+
+def make_patch(old, new):
+    out = bytearray(HEADER.pack(MAGIC, len(old), len(new),
+                                hashlib.sha256(old).digest(), hashlib.sha256(new).digest()))
+    for rn, ro, rl, extra, seek in make_records(old, new):
+        if rl == 0 and extra == 0 and seek == 0:
+            continue
+        out += CONTROL.pack(rl, extra, seek)
+        out += bytes((new[rn + i] - old[ro + i]) & 0xFF for i in range(rl))
+        out += new[rn + rl:rn + rl + extra]
+    return bytes(out)
+
+
+def apply_patch(old, patch):
+    """Reference implementation of the device side (OtaUpdater)."""
+    magic, old_size, new_size, old_sha, new_sha = HEADER.unpack_from(patch, 0)
+    if magic != MAGIC:
+        raise ValueError("bad magic")
+    if old_size != len(old) or hashlib.sha256(old).digest() != old_sha:
+        raise ValueError("patch was made for a different base image")
+    out = bytearray()
+    pos, ofs = 0, HEADER.size
+    while len(out) < new_size:
+        diff_len, extra_len, seek = CONTROL.unpack_from(patch, ofs)
+        ofs += CONTROL.size
+        if pos + diff_len > old_size or len(out) + diff_len + extra_len > new_size:
+            raise ValueError("record out of range")
+        out += bytes((old[pos + i] + patch[ofs + i]) & 0xFF for i in range(diff_len))
+        ofs += diff_len
+        pos += diff_len
+        out += patch[ofs:ofs + extra_len]
+        ofs += extra_len
+        pos += seek
+        if pos < 0 or pos > old_size:
+            raise ValueError("seek out of range")
+    if ofs != len(patch):
+        raise ValueError("trailing data")
+    if hashlib.sha256(out).digest() != new_sha:
+        raise ValueError("result hash mismatch")
+    return bytes(out)
+
+
+def write_delta(old_path, new_path, out_path):
+    """Builds, verifies and writes a gzip-compressed patch. Returns its size."""
+    with open(old_path, "rb") as f:
+        old = f.read()
+    with open(new_path, "rb") as f:
+        new = f.read()
+    patch = make_patch(old, new)
+    if apply_patch(old, patch) != new:
+        raise RuntimeError("delta self-check failed")
+    data = gzip.compress(patch, compresslevel=9, mtime=0)
+    with open(out_path, "wb") as f:
+        f.write(data)
+    return len(data)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("old", help="image currently installed on the device (.bin.ota)")
+    ap.add_argument("new", help="image to update to (.bin.ota)")
+    ap.add_argument("-o", "--output", help="patch file to write (gzip)")
+    ap.add_argument("--verify", metavar="PATCH", help="apply an existing patch and compare with NEW")
+    args = ap.parse_args()
+
+    if args.verify:
+        with open(args.old, "rb") as f:
+            old = f.read()
+        with open(args.new, "rb") as f:
+            new = f.read()
+        with open(args.verify, "rb") as f:
+            data = f.read()
+        patch = gzip.decompress(data) if data[:2] == b"\x1f\x8b" else data
+        ok = apply_patch(old, patch) == new
+        print("OK" if ok else "MISMATCH")
+        return 0 if ok else 1
+
+    if not args.output:
+        ap.error("-o/--output is required unless --verify is given")
+    size = write_delta(args.old, args.new, args.output)
+    with open(args.new, "rb") as f:
+        new = f.read()
+    full = len(gzip.compress(new, compresslevel=9, mtime=0))
+    print(f"{args.output}: {size} bytes (full image {len(new)}, gzip {full})")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,11 +1,22 @@
 Import("env")
+import glob
+import gzip
+import hashlib
 import os
+import re
 import shutil
+import sys
 
 # === Konfiguration ===
 ENABLE_MERGE_BIN = True  # Steuert ob Merge ausgeführt wird (OTA .bin.ota wird immer erstellt!)
+ENABLE_DELTA = True      # Delta-Patch gegen die vorherige Version in .firmware/ erzeugen
+ENABLE_STACK_REPORT = True  # Stack-Vorschläge aus .firmware/tasks_<env>.json ausgeben
 # ======================
 
+sys.path.insert(0, os.path.join(env.subst("$PROJECT_DIR"), "tools"))
+import make_delta
+import stack_report
+
 BUILD_DIR = env.subst("$BUILD_DIR")
 PROGNAME = env.subst("${PROGNAME}")
 APP_BIN = os.path.normpath(os.path.join(BUILD_DIR, f"{PROGNAME}.bin"))
@@ -18,15 +29,60 @@ version = env.GetProjectOption("custom_source_version") or "0.0.0"
 env_suffix = ENV_NAME or "env"
 firmware_filename_merged = f"{project_name}_{env_suffix}_V{version}.bin"
 firmware_filename_ota = f"{project_name}_{env_suffix}_V{version}.bin.ota"
+firmware_filename_ota_gz = f"{firmware_filename_ota}.gz"
+firmware_filename_ota_sha = f"{firmware_filename_ota}.sha256"
 
 firmware_path_merged = os.path.normpath(os.path.join(env.subst("$PROJECT_DIR"), ".firmware", firmware_filename_merged))
 firmware_path_ota = os.path.normpath(os.path.join(env.subst("$PROJECT_DIR"), ".firmware", firmware_filename_ota))
+firmware_path_ota_gz = os.path.normpath(os.path.join(env.subst("$PROJECT_DIR"), ".firmware", firmware_filename_ota_gz))
+firmware_path_ota_sha = os.path.normpath(os.path.join(env.subst("$PROJECT_DIR"), ".firmware", firmware_filename_ota_sha))
 
 def copy_bin_as_ota(source, target, env):
     os.makedirs(os.path.dirname(firmware_path_ota), exist_ok=True)
     shutil.copyfile(APP_BIN, firmware_path_ota)
     print(f'Firmware (OTA, uncompressed) copied to: {firmware_path_ota}')
 
+    # Compressed OTA image (inflated on the device) and the digest of the
+    # uncompressed image, which the device checks before switching partitions.
+    with open(APP_BIN, "rb") as f:
+        image = f.read()
+    with open(firmware_path_ota_gz, "wb") as f:
+        f.write(gzip.compress(image, compresslevel=9, mtime=0))
+    digest = hashlib.sha256(image).hexdigest()
+    with open(firmware_path_ota_sha, "w") as f:
+        f.write(f"{digest}  {firmware_filename_ota}\n")
+    print(f'Firmware (OTA, gzip) written to: {firmware_path_ota_gz} ({os.path.getsize(firmware_path_ota_gz)} of {len(image)} bytes)')
+    print(f'Firmware SHA-256 {digest} written to: {firmware_path_ota_sha}')
+
+    if ENABLE_DELTA:
+        make_delta_from_previous()
+
+def version_key(v):
+    return [int(p) if p.isdigit() else p for p in re.split(r"[.\-]", v)]
+
+def make_delta_from_previous():
+    # Nur gegen die neueste ältere Version derselben Umgebung, ein Patch pro Build
+    prefix = f"{project_name}_{env_suffix}_V"
+    firmware_dir = os.path.dirname(firmware_path_ota)
+    older = []
+    for path in glob.glob(os.path.join(firmware_dir, f"{prefix}*.bin.ota")):
+        v = os.path.basename(path)[len(prefix):-len(".bin.ota")]
+        if v != version:
+            older.append((version_key(v), v, path))
+    if not older:
+        return
+    try:
+        older.sort()
+    except TypeError:
+        return
+    _, base_version, base_path = older[-1]
+    delta_path = os.path.join(firmware_dir, f"{prefix}{base_version}_to_V{version}.delta.gz")
+    try:
+        size = make_delta.write_delta(base_path, APP_BIN, delta_path)
+        print(f'Firmware (delta from V{base_version}) written to: {delta_path} ({size} bytes)')
+    except Exception as e:
+        print(f'Delta from V{base_version} skipped: {e}')
+
 def merge_bin(source, target, env):
     flash_images = env.Flatten(env.get("FLASH_EXTRA_IMAGES", []))
     app_offset = env.subst("$ESP32_APP_OFFSET") or "0x10000"
@@ -55,9 +111,16 @@ def merge_bin(source, target, env):
     print(f'Firmware (merged) copied to: {firmware_path_merged}')
     return result
 
-# Immer OTA-Datei erzeugen (unkomprimiert, mit Endung .bin.ota)
+# Immer OTA-Dateien erzeugen (.bin.ota, .bin.ota.gz, .bin.ota.sha256 und ggf. .delta.gz)
 env.AddPostAction(APP_BIN, copy_bin_as_ota)
 
+def report_stacks(source, target, env):
+    snapshot = os.path.join(env.subst("$PROJECT_DIR"), ".firmware", f"tasks_{env_suffix}.json")
+    stack_report.build_report(snapshot, stack_report.cpp_defines(env))
+
+if ENABLE_STACK_REPORT:
+    env.AddPostAction(APP_BIN, report_stacks)
+
 # Optional merged .bin erzeugen
 if ENABLE_MERGE_BIN:
     env.AddPostAction(APP_BIN, merge_bin)
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Measure OTA upload throughput with and without the quiesce mode.
+
+Uploads the same image to /update once with ?quiesce=1 and once with
+?quiesce=0, waiting for the reboot in between, and prints the device-side
+session time (from the /update response) next to the wall-clock time.
+
+Usage:
+  python tools/ota_bench.py 192.168.1.50 .firmware/BambuBeacon_esp32dev_V1.2.3.bin.ota.gz
+  python tools/ota_bench.py beacon.local image.bin.ota --user admin --password secret --runs 2
+"""
+import argparse
+import base64
+import http.client
+import json
+import os
+import sys
+import time
+import uuid
+
+
+def upload(host, path, image, filename, auth, sha):
+    boundary = uuid.uuid4().hex
+    head = (f"--{boundary}\r\n"
+            f'Content-Disposition: form-data; name="firmware"; filename="{filename}"\r\n'
+            "Content-Type: application/octet-stream\r\n\r\n").encode()
+    tail = f"\r\n--{boundary}--\r\n".encode()
+    headers = {
+        "Content-Type": f"multipart/form-data; boundary={boundary}",
+        "Content-Length": str(len(head) + len(image) + len(tail)),
+    }
+    if auth:
+        headers["Authorization"] = "Basic " + base64.b64encode(auth.encode()).decode()
+    if sha:
+        headers["X-Firmware-SHA256"] = sha
+
+    conn = http.client.HTTPConnection(host, 80, timeout=120)
+    start = time.monotonic()
+    conn.putrequest("POST", path)
+    for k, v in headers.items():
+        conn.putheader(k, v)
+    conn.endheaders()
+    conn.send(head)
+    for ofs in range(0, len(image), 4096):
+        conn.send(image[ofs:ofs + 4096])
+    conn.send(tail)
+    resp = conn.getresponse()
+    body = resp.read()
+    wall_ms = (time.monotonic() - start) * 1000.0
+    conn.close()
+    try:
+        info = json.loads(body)
+    except ValueError:
+        info = {"raw": body.decode(errors="replace")}
+    return resp.status, wall_ms, info
+
+
+def wait_for_device(host, timeout_s=90):
+    deadline = time.monotonic() + timeout_s
+    time.sleep(3)
+    while time.monotonic() < deadline:
+        try:
+            conn = http.client.HTTPConnection(host, 80, timeout=3)
+            conn.request("GET", "/")
+            conn.getresponse().read()
+            conn.close()
+            return True
+        except OSError:
+            time.sleep(1)
+    return False
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host")
+    ap.add_argument("image", help=".bin.ota, .bin.ota.gz or .delta.gz")
+    ap.add_argument("--user", default="")
+    ap.add_argument("--password", default="")
+    ap.add_argument("--sha256", default="",
+                    help="expected digest of the final image (required by the device; "
+                         "default: read from <image without .gz>.sha256)")
+    ap.add_argument("--runs", type=int, default=1, help="uploads per mode")
+    args = ap.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    sha = args.sha256
+    if not sha:
+        sidecar = (args.image[:-3] if args.image.endswith(".gz") else args.image) + ".sha256"
+        if not os.path.exists(sidecar):
+            print(f"no --sha256 given and {sidecar} not found", file=sys.stderr)
+            return 1
+        with open(sidecar) as f:
+            sha = f.read().split()[0]
+    auth = f"{args.user}:{args.password}" if args.user else ""
+    name = os.path.basename(args.image)
+
+    results = {"1": [], "0": []}
+    for run in range(args.runs):
+        for mode in ("1", "0"):
+            status, wall_ms, info = upload(args.host, f"/update?quiesce={mode}", image, name, auth, sha)
+            dev_ms = info.get("ms", 0)
+            kbps = len(image) / 1024.0 / (wall_ms / 1000.0)
+            print(f"run {run + 1} quiesce={mode}: HTTP {status}, wall {wall_ms:.0f} ms, "
+                  f"device {dev_ms} ms, {kbps:.1f} KB/s {'' if info.get('success') else info}")
+            if status == 200:
+                results[mode].append((wall_ms, dev_ms))
+                if not wait_for_device(args.host):
+                    print("device did not come back", file=sys.stderr)
+                    return 1
+
+    for mode, label in (("1", "quiesce on "), ("0", "quiesce off")):
+        rows = results[mode]
+        if rows:
+            wall = sum(r[0] for r in rows) / len(rows)
+            dev = sum(r[1] for r in rows) / len(rows)
+            print(f"{label}: avg wall {wall:.0f} ms, avg device {dev:.0f} ms, "
+                  f"{len(image) / 1024.0 / (wall / 1000.0):.1f} KB/s over {len(rows)} run(s)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Minimal LAN/CI firmware server for pull OTA (/ota/pull).
+
+Serves a directory (default .firmware/) with HTTP Range, ETag and If-Range
+support, which the beacon uses to resume interrupted downloads. For testing
+the resume path it can cut connections after a number of bytes.
+
+Usage:
+  python tools/ota_serve.py                       # serve .firmware/ on :8000
+  python tools/ota_serve.py --dir build --port 8080
+  python tools/ota_serve.py --drop-after 200000   # close every response after ~200 KB
+  python tools/ota_serve.py --rate 50             # throttle to 50 KB/s per connection
+
+Then on the beacon: Maintenance -> Pull from LAN server ->
+  http://<this-host>:8000/<name>.bin.ota.gz
+"""
+import argparse
+import hashlib
+import os
+import re
+import socket
+import sys
+import time
+from http.server import SimpleHTTPRequestHandler, ThreadingHTTPServer
+
+RANGE_RE = re.compile(r"bytes=(\d+)-(\d*)$")
+
+
+class Handler(SimpleHTTPRequestHandler):
+    drop_after = 0
+    rate = 0
+
+    def etag_for(self, path):
+        st = os.stat(path)
+        return '"' + hashlib.sha1(f"{st.st_size}-{st.st_mtime_ns}".encode()).hexdigest()[:16] + '"'
+
+    def do_GET(self):
+        path = self.translate_path(self.path)
+        if not os.path.isfile(path):
+            return super().do_GET()
+
+        size = os.path.getsize(path)
+        etag = self.etag_for(path)
+        start, end = 0, size - 1
+        partial = False
+
+        rng = self.headers.get("Range")
+        if_range = self.headers.get("If-Range")
+        if rng and (not if_range or if_range == etag):
+            m = RANGE_RE.match(rng.strip())
+            if not m or int(m.group(1)) >= size:
+                self.send_response(416)
+                self.send_header("Content-Range", f"bytes */{size}")
+                self.end_headers()
+                return
+            start = int(m.group(1))
+            if m.group(2):
+                end = min(int(m.group(2)), size - 1)
+            partial = True
+
+        length = end - start + 1
+        self.send_response(206 if partial else 200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(length))
+        self.send_header("Accept-Ranges", "bytes")
+        self.send_header("ETag", etag)
+        if partial:
+            self.send_header("Content-Range", f"bytes {start}-{end}/{size}")
+        self.end_headers()
+
+        sent = 0
+        t0 = time.monotonic()
+        with open(path, "rb") as f:
+            f.seek(start)
+            while sent < length:
+                chunk = f.read(min(4096, length - sent))
+                if not chunk:
+                    break
+                if self.drop_after and sent + len(chunk) > self.drop_after:
+                    self.log_message("dropping connection after %d bytes (offset %d)", sent, start + sent)
+                    self.connection.shutdown(socket.SHUT_RDWR)
+                    return
+                try:
+                    self.wfile.write(chunk)
+                except (BrokenPipeError, ConnectionResetError):
+                    return
+                sent += len(chunk)
+                if self.rate:
+                    ahead = sent / (self.rate * 1024.0) - (time.monotonic() - t0)
+                    if ahead > 0:
+                        time.sleep(ahead)
+        self.log_message("sent %d bytes from offset %d", sent, start)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--dir", default=".firmware")
+    ap.add_argument("--port", type=int, default=8000)
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--drop-after", type=int, default=0, help="close each response after N bytes")
+    ap.add_argument("--rate", type=int, default=0, help="KB/s per connection (0 = unlimited)")
+    args = ap.parse_args()
+
+    if not os.path.isdir(args.dir):
+        print(f"{args.dir} does not exist", file=sys.stderr)
+        return 1
+    os.chdir(args.dir)
+    Handler.drop_after = args.drop_after
+    Handler.rate = args.rate
+    server = ThreadingHTTPServer((args.bind, args.port), Handler)
+    print(f"Serving {os.getcwd()} on http://{args.bind}:{args.port}/")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
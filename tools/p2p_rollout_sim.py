@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Simulate a fleet rollout: every beacon pulls from the server vs. peer-to-peer.
+
+Fluid model of one 2.4 GHz AP. All transfers share the channel's airtime
+fairly (water-filling). Each transfer is also capped by the receiving
+beacon's download limit (otaRateKBps) and flash write speed.
+
+- server: the origin sits behind the AP (wired) and serves at most
+  --server-slots beacons at once, each capped at --server-kbps.
+  One airtime hop per transfer (AP -> beacon).
+- p2p: beacon 0 pulls from the server. Each updated beacon then serves one
+  peer at a time (as /firmware.bin does). A waiting beacon picks the free
+  updated peer with the best RSSI, or the server if that is free and better.
+  A peer transfer crosses the air twice (beacon -> AP -> beacon).
+
+Prints the time until the whole fleet is updated and the total airtime used,
+so both sides of the trade-off are visible. P2P only wins when the origin is
+the bottleneck (slow or rate-limited server, few server slots). On a single AP
+it costs roughly twice the airtime per peer transfer.
+
+Usage:
+  python tools/p2p_rollout_sim.py --beacons 40 --image-kb 700 --server-slots 2 --server-kbps 300
+  python tools/p2p_rollout_sim.py --beacons 40 --server-wifi   # origin is itself a WiFi client
+"""
+import argparse
+import random
+
+# RSSI (dBm) -> realistic TCP goodput in Mbit/s for an ESP32 on 2.4 GHz
+RATE_TABLE = [(-50, 20.0), (-60, 14.0), (-67, 9.0), (-72, 5.0), (-78, 2.5), (-85, 1.0)]
+
+
+def goodput_mbps(rssi):
+    for limit, rate in RATE_TABLE:
+        if rssi >= limit:
+            return rate
+    return 0.5
+
+
+class Transfer:
+    def __init__(self, src, dst, size, airtime_per_byte, cap_bps):
+        self.src = src
+        self.dst = dst
+        self.left = size
+        self.apb = airtime_per_byte  # seconds of airtime per byte
+        self.cap = cap_bps           # bytes/s
+        self.rate = 0.0
+
+
+def allocate(transfers):
+    """Fair airtime water-filling: capped transfers release their unused share."""
+    active = list(transfers)
+    budget = 1.0  # seconds of airtime per second
+    while active:
+        share = budget / len(active)
+        capped = [t for t in active if t.cap * t.apb <= share]
+        if not capped:
+            for t in active:
+                t.rate = share / t.apb
+            return
+        for t in capped:
+            t.rate = t.cap
+            budget -= t.cap * t.apb
+            active.remove(t)
+
+
+def simulate(args, mode, rssi):
+    n = len(rssi)
+    size = args.image_kb * 1024
+    beacon_cap = min(args.beacon_kbps, args.flash_kbps) * 1024.0
+    server_cap = args.server_kbps * 1024.0
+    air = [8.0 / (goodput_mbps(r) * 1e6) for r in rssi]
+    server_air = 8.0 / (goodput_mbps(args.server_rssi) * 1e6) if args.server_wifi else 0.0
+
+    updated = [False] * n
+    busy_src = set()        # peer indices currently serving
+    waiting = list(range(n))
+    transfers = []
+    t = 0.0
+    airtime = 0.0
+    done_at = [None] * n
+
+    while not all(updated):
+        # start new transfers
+        for dst in list(waiting):
+            server_free = sum(1 for x in transfers if x.src == "server") < args.server_slots
+            src = None
+            if mode == "p2p":
+                peers = [i for i in range(n) if updated[i] and i not in busy_src]
+                if peers:
+                    src = max(peers, key=lambda i: rssi[i])
+                    if server_free and goodput_mbps(args.server_rssi if args.server_wifi else -40) >= goodput_mbps(rssi[src]):
+                        src = "server"
+            if src is None and server_free:
+                src = "server"
+            if src is None:
+                continue
+            if src == "server":
+                apb = air[dst] + server_air
+                cap = min(beacon_cap, server_cap)
+            else:
+                apb = air[dst] + air[src]
+                cap = beacon_cap
+                busy_src.add(src)
+            transfers.append(Transfer(src, dst, size, apb, cap))
+            waiting.remove(dst)
+
+        allocate(transfers)
+        dt = args.dt
+        for x in list(transfers):
+            moved = min(x.left, x.rate * dt)
+            x.left -= moved
+            airtime += moved * x.apb
+            if x.left <= 0:
+                transfers.remove(x)
+                updated[x.dst] = True
+                done_at[x.dst] = t + dt
+                if x.src != "server":
+                    busy_src.discard(x.src)
+        t += dt
+        if t > 24 * 3600:
+            break
+
+    return t, airtime, done_at
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--beacons", type=int, default=40)
+    ap.add_argument("--image-kb", type=int, default=700, help="transfer size (gzip image)")
+    ap.add_argument("--beacon-kbps", type=int, default=64, help="otaRateKBps on the beacons (0 = unlimited)")
+    ap.add_argument("--flash-kbps", type=int, default=150, help="flash write bound per beacon")
+    ap.add_argument("--server-slots", type=int, default=4, help="concurrent downloads the origin allows")
+    ap.add_argument("--server-kbps", type=int, default=1000, help="per-download origin limit")
+    ap.add_argument("--server-wifi", action="store_true", help="origin is a WiFi client too")
+    ap.add_argument("--server-rssi", type=int, default=-55)
+    ap.add_argument("--rssi-min", type=int, default=-82)
+    ap.add_argument("--rssi-max", type=int, default=-45)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--dt", type=float, default=0.05)
+    args = ap.parse_args()
+    if args.beacon_kbps == 0:
+        args.beacon_kbps = 10 ** 6
+
+    rnd = random.Random(args.seed)
+    rssi = [rnd.randint(args.rssi_min, args.rssi_max) for _ in range(args.beacons)]
+
+    print(f"{args.beacons} beacons, {args.image_kb} KB image, RSSI {min(rssi)}..{max(rssi)} dBm")
+    for mode in ("server", "p2p"):
+        total, airtime, done = simulate(args, mode, rssi)
+        done = sorted(d for d in done if d is not None)
+        median = done[len(done) // 2] if done else 0
+        print(f"{mode:>6}: fleet updated in {total:7.1f} s (median {median:6.1f} s), "
+              f"airtime {airtime:7.1f} s ({airtime / max(total, 1e-9) * 100:5.1f}% of the channel)")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
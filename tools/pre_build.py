@@ -2,9 +2,11 @@
 #        Compress files in src/www directory into a single header file.        #
 # ---------------------------------------------------------------------------- #
 
+import base64
 import gzip
 import os
 import glob
+import re
 
 WWW_DIR = os.path.join("src", "webUI")
 OUTPUT_HEADER_NAME = "www.h"
@@ -25,15 +27,55 @@ MIME_TYPES = {
     ".svg":  "image/svg+xml",
 }
 
+# Shared assets that get inlined into every HTML page at build time, so a page
+# is a single request (matters a lot for phones on the captive portal).
+# route -> file in WWW_DIR. The assets are still emitted on their own for the
+# standalone routes in WebServerHandler.
+BUNDLE_ASSETS = {
+    "/style.css": "Style.css",
+    "/backgroundCanvas.js": "backgroundCanvas.js",
+    "/logo.svg": "logo.svg",
+}
+
 def guess_mime_type(filename):
     _, ext = os.path.splitext(filename.lower())
     return MIME_TYPES.get(ext, "application/octet-stream")
 
+def read_asset(route):
+    with open(os.path.join(WWW_DIR, BUNDLE_ASSETS[route]), "r", encoding="utf-8") as f:
+        return f.read()
+
+def data_uri(route):
+    path = os.path.join(WWW_DIR, BUNDLE_ASSETS[route])
+    with open(path, "rb") as f:
+        encoded = base64.b64encode(f.read()).decode("ascii")
+    return f"data:{guess_mime_type(path)};base64,{encoded}"
+
+def bundle_html(html):
+    css = read_asset("/style.css")
+    js = read_asset("/backgroundCanvas.js")
+    if "</style" in css.lower() or "</script" in js.lower():
+        print("❌ Error: shared asset contains a closing tag and cannot be inlined")
+        exit(1)
+
+    logo = data_uri("/logo.svg")
+
+    html = re.sub(r'<link\s+rel="stylesheet"\s+href="/style\.css"\s*/?>',
+                  lambda m: f"<style>\n{css}\n</style>\n<link rel=\"icon\" href=\"{logo}\" />", html)
+    html = re.sub(r'<script\s+src="/backgroundCanvas\.js"\s*>\s*</script>',
+                  lambda m: f"<script>\n{js}\n</script>", html)
+    html = html.replace('src="/logo.svg"', f'src="{logo}"')
+    return html
+
 def compress_and_generate_entry(input_file):
     # Compress in-memory, no temp file
     with open(input_file, "rb") as infile:
         data = infile.read()
-        compressed_data = gzip.compress(data, compresslevel=9)
+    bundled = ""
+    if input_file.lower().endswith(".html"):
+        data = bundle_html(data.decode("utf-8")).encode("utf-8")
+        bundled = " (bundled)"
+    compressed_data = gzip.compress(data, compresslevel=9)
 
     # ------------ Generate a C array name based on the file name ------------ #
     # array_name = os.path.basename(input_file).replace(".", "_")
@@ -49,7 +91,7 @@ def compress_and_generate_entry(input_file):
     entry.append(f"const unsigned int {array_name}_gz_len = {len(compressed_data)};\n")
     entry.append(f"const char * {array_name}_gz_mime = \"{guess_mime_type(input_file)}\";\n\n")
     file = os.path.relpath(input_file, WWW_DIR)
-    print(f"Added: {file} as {array_name}_gz with MIME {guess_mime_type(input_file)}")
+    print(f"Added: {file}{bundled} as {array_name}_gz with MIME {guess_mime_type(input_file)}")
     return ''.join(entry)
 
 def compress_files():
@@ -0,0 +1,407 @@
+#!/usr/bin/env python3
+"""Stand-in Bambu printer for the host simulator (and for real beacons).
+
+Runs a minimal MQTT 3.1.1 broker on --port that plays the printer: it checks
+the beacon's CONNECT (user bblp, password = --ac), answers SUBSCRIBE and
+PINGREQ, and publishes reports on device/<usn>/report while a print job
+cycles IDLE -> PREPARE -> RUNNING (0..100 %, temperatures ramping) -> FINISH
+every --job-seconds. A pushall request gets the full state back at once,
+everything else is a delta like the real printer sends. --hms-every N raises
+an HMS warning for 20 s every N seconds (--hms-count N raises a storm of N
+distinct codes instead); --drop-every N closes the beacon's
+connection every N seconds to exercise reconnects. --ssdp also answers the
+beacon's M-SEARCH and sends NOTIFY on 239.255.255.250:2021.
+
+The simulator's WiFiClientSecure is plain TCP, so the default is plain MQTT;
+--tls wraps it in a throwaway certificate (openssl CLI) for a real beacon.
+
+Usage:
+  python tools/printer_sim.py --usn SIM00000000001 --ac 12345678 --job-seconds 120
+  .pio/build/sim/program --printer 127.0.0.1 --usn SIM00000000001 --ac 12345678
+  python tools/printer_sim.py --tls --ssdp --hms-every 300
+  python tools/printer_sim.py --selftest
+"""
+import argparse
+import json
+import os
+import socket
+import ssl
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+SSDP_GROUP = "239.255.255.250"
+SSDP_PORT = 2021
+HMS_WARNING = {"attr": 0x03000100, "code": 0x00030001}   # severity = high word of code: 3 = warning
+
+
+def read_exact(sock, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError("closed")
+        buf += chunk
+    return buf
+
+
+def read_packet(sock):
+    first = read_exact(sock, 1)[0]
+    mult, length = 1, 0
+    while True:
+        b = read_exact(sock, 1)[0]
+        length += (b & 0x7F) * mult
+        if not b & 0x80:
+            break
+        mult *= 128
+    return first, read_exact(sock, length) if length else b""
+
+
+def encode_len(n):
+    out = bytearray()
+    while True:
+        b = n % 128
+        n //= 128
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def mqtt_str(s):
+    b = s.encode() if isinstance(s, str) else s
+    return struct.pack(">H", len(b)) + b
+
+
+def take_str(body, pos):
+    n = struct.unpack_from(">H", body, pos)[0]
+    return body[pos + 2:pos + 2 + n], pos + 2 + n
+
+
+def publish_packet(topic, payload):
+    body = mqtt_str(topic) + payload
+    return bytes([0x30]) + encode_len(len(body)) + body
+
+
+class Job:
+    """The printer's state as a function of time since start."""
+
+    def __init__(self, job_seconds, hms_every, hms_count=1):
+        self.job_seconds = job_seconds
+        self.hms_every = hms_every
+        self.hms_count = hms_count
+        self.t0 = time.time()
+
+    def state(self, now=None):
+        t = (now if now is not None else time.time()) - self.t0
+        cycle = self.job_seconds + 40
+        phase = t % cycle
+        if phase < 10:
+            gstate, pct = "IDLE", 0
+        elif phase < 20:
+            gstate, pct = "PREPARE", 0
+        elif phase < 20 + self.job_seconds:
+            gstate, pct = "RUNNING", int(100 * (phase - 20) / self.job_seconds)
+        else:
+            gstate, pct = "FINISH", 100
+        heating = gstate in ("PREPARE", "RUNNING")
+        bed_target = 60 if heating else 0
+        nozzle_target = 220 if heating else 0
+        warm = min(1.0, (phase - 10) / 10) if heating else 0.0
+        remaining = max(0, int((self.job_seconds - (phase - 20)) / 60)) if gstate == "RUNNING" else 0
+        hms = []
+        if self.hms_every and t % self.hms_every < 20 and t >= self.hms_every:
+            for i in range(self.hms_count):
+                hms.append({"attr": HMS_WARNING["attr"] + (i << 8), "code": HMS_WARNING["code"] + i})
+        return {
+            "gcode_state": gstate,
+            "mc_percent": pct,
+            "mc_remaining_time": remaining,
+            "bed_temper": round(25 + (bed_target - 25) * warm, 1) if heating else 25.0,
+            "bed_target_temper": bed_target,
+            "nozzle_temper": round(25 + (nozzle_target - 25) * warm, 1) if heating else 25.0,
+            "nozzle_target_temper": nozzle_target,
+            "hms": hms,
+        }
+
+
+class Printer:
+    def __init__(self, args, job):
+        self.args = args
+        self.job = job
+        self.lock = threading.Lock()
+        self.conn = None
+        self.sent = {}
+        self.stats = {"connects": 0, "rejected": 0, "reports": 0, "pushall": 0, "drops": 0}
+        self.srv = socket.socket()
+        self.srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.srv.bind(("0.0.0.0", args.port))
+        self.srv.listen(2)
+        self.port = self.srv.getsockname()[1]
+        self.ctx = None
+        if args.tls:
+            tmp = tempfile.mkdtemp()
+            cert, key = os.path.join(tmp, "c.pem"), os.path.join(tmp, "k.pem")
+            subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-subj", "/CN=printer",
+                            "-days", "1", "-keyout", key, "-out", cert], check=True, capture_output=True)
+            self.ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+            self.ctx.load_cert_chain(cert, key)
+
+    def log(self, msg):
+        if not self.args.quiet:
+            print(msg, flush=True)
+
+    def serve(self):
+        while True:
+            raw, addr = self.srv.accept()
+            try:
+                conn = self.ctx.wrap_socket(raw, server_side=True) if self.ctx else raw
+            except (ssl.SSLError, OSError) as e:
+                self.log(f"[printer] TLS handshake from {addr[0]} failed: {e}")
+                continue
+            threading.Thread(target=self.session, args=(conn, addr), daemon=True).start()
+
+    def session(self, conn, addr):
+        report = f"device/{self.args.usn}/report"
+        try:
+            while True:
+                kind, body = read_packet(conn)
+                ptype = kind >> 4
+                if ptype == 1:      # CONNECT
+                    flags = body[7]
+                    pos = 10
+                    client_id, pos = take_str(body, pos)
+                    if flags & 0x04:
+                        _, pos = take_str(body, pos)
+                        _, pos = take_str(body, pos)
+                    user = password = b""
+                    if flags & 0x80:
+                        user, pos = take_str(body, pos)
+                    if flags & 0x40:
+                        password, pos = take_str(body, pos)
+                    if user != b"bblp" or password != self.args.ac.encode():
+                        conn.sendall(b"\x20\x02\x00\x05")   # not authorized
+                        with self.lock:
+                            self.stats["rejected"] += 1
+                        self.log(f"[printer] rejected {client_id.decode(errors='replace')} from {addr[0]}")
+                        break
+                    conn.sendall(b"\x20\x02\x00\x00")
+                    with self.lock:
+                        self.stats["connects"] += 1
+                    self.log(f"[printer] {client_id.decode(errors='replace')} connected from {addr[0]}")
+                elif ptype == 8:    # SUBSCRIBE
+                    topic, _ = take_str(body, 2)
+                    ok = topic.decode(errors="replace") == report
+                    conn.sendall(b"\x90\x03" + body[:2] + (b"\x00" if ok else b"\x80"))
+                    if ok:
+                        with self.lock:
+                            self.conn = conn
+                            self.sent = {}
+                elif ptype == 3:    # PUBLISH on device/<usn>/request
+                    topic, pos = take_str(body, 0)
+                    if kind & 0x06:
+                        pos += 2
+                    if b"pushall" in body[pos:]:
+                        with self.lock:
+                            self.stats["pushall"] += 1
+                            self.sent = {}
+                        self.push(full=True)
+                elif ptype == 10:   # UNSUBSCRIBE
+                    conn.sendall(b"\xb0\x02" + body[:2])
+                elif ptype == 12:   # PINGREQ
+                    conn.sendall(b"\xd0\x00")
+                elif ptype == 14:   # DISCONNECT
+                    break
+        except (ConnectionError, OSError, ssl.SSLError, IndexError, struct.error):
+            pass
+        with self.lock:
+            if self.conn is conn:
+                self.conn = None
+        try:
+            conn.close()
+        except OSError:
+            pass
+        self.log(f"[printer] {addr[0]} disconnected")
+
+    def push(self, full=False):
+        with self.lock:
+            conn = self.conn
+            state = self.job.state()
+            delta = {k: v for k, v in state.items() if full or self.sent.get(k) != v}
+            if not delta or not conn:
+                return False
+            self.sent.update(delta)
+            doc = {"print": dict(delta, command="push_status", msg=0 if full else 1,
+                                 sequence_id=str(self.stats["reports"]))}
+            self.stats["reports"] += 1
+        try:
+            conn.sendall(publish_packet(f"device/{self.args.usn}/report", json.dumps(doc).encode()))
+        except OSError:
+            return False
+        if "gcode_state" in delta:
+            self.log(f"[printer] {delta['gcode_state']}")
+        return True
+
+    def drop(self):
+        with self.lock:
+            conn, self.conn = self.conn, None
+            if conn:
+                self.stats["drops"] += 1
+        if conn:
+            self.log("[printer] dropping the beacon's connection")
+            try:
+                conn.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+
+    def run(self, stop):
+        next_drop = time.time() + self.args.drop_every if self.args.drop_every else None
+        while not stop.is_set():
+            self.push()
+            if next_drop and time.time() >= next_drop:
+                self.drop()
+                next_drop += self.args.drop_every
+            stop.wait(self.args.interval)
+
+
+def ssdp(args, port_hint, stop):
+    notify = ("NOTIFY * HTTP/1.1\r\n"
+              f"HOST: {SSDP_GROUP}:{SSDP_PORT}\r\n"
+              "Server: UPnP/1.0\r\n"
+              f"Location: {args.bind_ip}\r\n"
+              "NT: urn:bambulab-com:device:3dprinter:1\r\n"
+              "NTS: ssdp:alive\r\n"
+              f"USN: {args.usn}\r\n"
+              "Cache-Control: max-age=1800\r\n"
+              "DevModel.bambu.com: C11\r\n"
+              "DevName.bambu.com: printer-sim\r\n"
+              "DevSignal.bambu.com: -40\r\n"
+              "DevConnect.bambu.com: lan\r\n"
+              "DevBind.bambu.com: free\r\n\r\n").encode()
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, "SO_REUSEPORT"):
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    s.bind(("", SSDP_PORT))
+    mreq = struct.pack("4s4s", socket.inet_aton(SSDP_GROUP), socket.inet_aton("0.0.0.0"))
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    s.settimeout(0.5)
+    next_notify = 0
+    while not stop.is_set():
+        if time.time() >= next_notify:
+            try:
+                s.sendto(notify, (SSDP_GROUP, SSDP_PORT))
+            except OSError:
+                pass
+            next_notify = time.time() + 5
+        try:
+            data, addr = s.recvfrom(1500)
+        except socket.timeout:
+            continue
+        if data.startswith(b"M-SEARCH"):
+            s.sendto(notify.replace(b"NOTIFY * HTTP/1.1", b"HTTP/1.1 200 OK", 1), addr)
+
+
+def selftest():
+    args = argparse.Namespace(port=0, usn="SELFTEST01", ac="12345678", tls=False, quiet=True,
+                              interval=0.05, drop_every=0, job_seconds=2, hms_every=0)
+    job = Job(args.job_seconds, args.hms_every)
+    job.t0 -= 19     # one second before RUNNING
+    printer = Printer(args, job)
+    threading.Thread(target=printer.serve, daemon=True).start()
+    stop = threading.Event()
+    threading.Thread(target=printer.run, args=(stop,), daemon=True).start()
+
+    def connect(password):
+        c = socket.create_connection(("127.0.0.1", printer.port), timeout=5)
+        body = mqtt_str("MQTT") + bytes([4, 0xC2]) + struct.pack(">H", 60) + mqtt_str("beacon") + \
+            mqtt_str("bblp") + mqtt_str(password)
+        c.sendall(bytes([0x10]) + encode_len(len(body)) + body)
+        return c, read_packet(c)
+
+    failures = []
+    c, (kind, body) = connect("wrong")
+    if body[1] != 5:
+        failures.append("wrong access code accepted")
+    c.close()
+
+    c, (kind, body) = connect(args.ac)
+    if kind != 0x20 or body[1] != 0:
+        failures.append("CONNECT not accepted")
+    sub = struct.pack(">H", 1) + mqtt_str(f"device/{args.usn}/report") + b"\x00"
+    c.sendall(bytes([0x82]) + encode_len(len(sub)) + sub)
+    if read_packet(c)[0] != 0x90:
+        failures.append("no SUBACK")
+    req = publish_packet(f"device/{args.usn}/request", json.dumps({"pushing": {"command": "pushall"}}).encode())
+    c.sendall(req)
+
+    states, full = [], None
+    deadline = time.time() + 6
+    while time.time() < deadline and "FINISH" not in states:
+        kind, body = read_packet(c)
+        if kind >> 4 != 3:
+            continue
+        _, pos = take_str(body, 0)
+        doc = json.loads(body[pos:])["print"]
+        if full is None and doc.get("msg") == 0:
+            full = doc
+        if "gcode_state" in doc:
+            states.append(doc["gcode_state"])
+    c.close()
+    stop.set()
+
+    if not full or not all(k in full for k in ("gcode_state", "mc_percent", "bed_temper", "hms")):
+        failures.append("pushall did not return the full state")
+    for want in ("PREPARE", "RUNNING", "FINISH"):
+        if want not in states:
+            failures.append(f"never reported {want} (saw {states})")
+    for f in failures:
+        print(f"FAIL {f}")
+    print("selftest", "FAILED" if failures else "ok")
+    return 1 if failures else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", type=int, default=8883)
+    ap.add_argument("--usn", default="SIM00000000001", help="printer serial (the beacon's Printer serial)")
+    ap.add_argument("--ac", default="12345678", help="LAN access code the beacon must send")
+    ap.add_argument("--tls", action="store_true", help="MQTT over TLS like a real printer (needs openssl)")
+    ap.add_argument("--job-seconds", type=float, default=120, help="length of the RUNNING phase")
+    ap.add_argument("--interval", type=float, default=1.0, help="seconds between report deltas")
+    ap.add_argument("--hms-every", type=float, default=0, help="raise an HMS warning every N s (0 = never)")
+    ap.add_argument("--hms-count", type=int, default=1, help="HMS codes raised at once (a storm when > 1)")
+    ap.add_argument("--drop-every", type=float, default=0, help="drop the connection every N s (0 = never)")
+    ap.add_argument("--ssdp", action="store_true", help="announce on SSDP and answer M-SEARCH")
+    ap.add_argument("--bind-ip", default="127.0.0.1", help="address put into the SSDP Location")
+    ap.add_argument("--quiet", action="store_true")
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+
+    if args.selftest:
+        sys.exit(selftest())
+
+    job = Job(args.job_seconds, args.hms_every, args.hms_count)
+    printer = Printer(args, job)
+    stop = threading.Event()
+    threading.Thread(target=printer.serve, daemon=True).start()
+    threading.Thread(target=printer.run, args=(stop,), daemon=True).start()
+    if args.ssdp:
+        threading.Thread(target=ssdp, args=(args, printer.port, stop), daemon=True).start()
+    print(f"[printer] {args.usn} on :{printer.port} ({'TLS' if args.tls else 'plain'} MQTT)", flush=True)
+    try:
+        while True:
+            time.sleep(60)
+            with printer.lock:
+                s = dict(printer.stats)
+            print(f"[printer] connects={s['connects']} rejected={s['rejected']} reports={s['reports']} "
+                  f"pushall={s['pushall']} drops={s['drops']}", flush=True)
+    except KeyboardInterrupt:
+        stop.set()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,369 @@
+// Runs several beacon relay nodes (src/RelayProto.h, the firmware's own
+// election and codec) as threads of one process on loopback multicast and
+// checks the relay behaviour end to end.
+//
+// A simulated printer changes state continuously (temperatures every 200 ms,
+// progress every second, an HMS event now and then). Whoever is leader feeds
+// it into its node; followers only see what arrives over multicast. The run:
+//   - all nodes boot together; exactly one leader must emerge
+//   - the leader is killed at --kill s; another must take over and the
+//     followers must converge on the printer state again
+//   - the killed node reboots at --restart s and must NOT take over
+//   - the leader's printer session dies at --session-loss s (the node keeps
+//     running); it must step down and another node must take over
+//   - an intruder with a wrong access code multicasts as a high-ranked leader
+//     the whole time; nobody may follow it
+// Reports election/failover times, split-brain and no-leader time,
+// propagation lag (p50/p99/max) and packet counts; exit code 1 on failure.
+//
+// Build and run (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/relay_loopback.cpp -o relay_loopback
+//   ./relay_loopback --nodes 4 --seconds 50 --kill 10 --restart 18 --session-loss 22 --loss 0.05
+
+#include "RelayProto.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const auto t0 = std::chrono::steady_clock::now();
+uint32_t nowMs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+std::mutex g_mu;  // guards every Instance and the printer
+
+struct Printer {
+  relay::Wire state;
+  uint32_t step = 0;
+
+  Printer() {
+    state.flags = relay::kStConnected | relay::kStBedValid | relay::kStNozzleValid;
+    strcpy(state.state, "RUNNING");
+    state.progress = 0;
+    state.download = 100;
+    state.remaining = 120;
+    state.bedTarget = 600;
+    state.nozzleTarget = 2200;
+  }
+
+  // Every 200 ms
+  void advance(std::mt19937& rng) {
+    step++;
+    state.bed = (int16_t)(595 + rng() % 10);
+    state.nozzle = (int16_t)(2195 + rng() % 10);
+    if (step % 5 == 0 && state.progress < 100) {
+      state.progress++;
+      if (state.remaining) state.remaining--;
+    }
+    if (step % 37 == 0) {
+      state.hmsN = state.hmsN ? 0 : 1;
+      state.hmsCount = state.hmsN;
+      state.hmsFull[0] = 0x0300120000020001ULL;
+      state.hmsSev[0] = 3;
+      state.hmsTop = state.hmsN ? 3 : 0;
+    }
+  }
+};
+
+Printer g_printer;
+
+bool sameState(const relay::Wire& a, const relay::Wire& b) { return relay::diff(a, b) == 0; }
+
+int openSocket() {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(relay::kPort);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    perror("bind");
+    exit(2);
+  }
+  ip_mreq mreq{};
+  memcpy(&mreq.imr_multiaddr, relay::kGroupAddr, 4);
+  mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+  if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+    perror("IP_ADD_MEMBERSHIP (is loopback multicast available?)");
+    exit(2);
+  }
+  in_addr ifaddr{};
+  ifaddr.s_addr = htonl(INADDR_LOOPBACK);
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &ifaddr, sizeof(ifaddr));
+  unsigned char loop = 1;
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  timeval tv{0, 5000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  return fd;
+}
+
+struct Instance {
+  uint32_t id = 0;
+  std::string accessCode;
+  bool intruder = false;
+  bool alive = true;
+  bool sessionDead = false;  // node runs, its printer session does not
+  relay::Node node;
+  int fd = -1;
+  uint32_t mismatchSince = 0;  // 0 = in sync
+  std::vector<uint32_t> lags;
+};
+
+struct Options {
+  int nodes = 4;
+  double seconds = 50;
+  double kill = 10;
+  double restart = 18;
+  double sessionLoss = 22;
+  double loss = 0.0;
+};
+
+void runInstance(Instance* in, const Options& opt, std::atomic<bool>* stop) {
+  std::mt19937 rng(in->id * 7919u);
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  sockaddr_in group{};
+  group.sin_family = AF_INET;
+  group.sin_port = htons(relay::kPort);
+  memcpy(&group.sin_addr, relay::kGroupAddr, 4);
+
+  bool wasAlive = false;
+  while (!*stop) {
+    {
+      std::lock_guard<std::mutex> lk(g_mu);
+      if (in->alive && !wasAlive) {
+        in->fd = openSocket();
+        const int fd = in->fd;
+        in->node.setSender([fd, group](const uint8_t* data, size_t len) {
+          sendto(fd, data, len, 0, (const sockaddr*)&group, sizeof(group));
+        });
+        in->node.configure(in->id, "SIM01P000000001", in->accessCode.c_str(), nowMs());
+      } else if (!in->alive && wasAlive) {
+        close(in->fd);
+        in->fd = -1;
+      }
+      wasAlive = in->alive;
+    }
+    if (!wasAlive) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+
+    uint8_t buf[512];
+    const ssize_t n = recv(in->fd, buf, sizeof(buf), 0);
+    std::lock_guard<std::mutex> lk(g_mu);
+    if (!in->alive) continue;
+    const uint32_t now = nowMs();
+    if (n > 0 && !(opt.loss > 0 && u(rng) < opt.loss)) in->node.onPacket(buf, (size_t)n, now);
+
+    const bool leader = in->node.role() == relay::Role::Leader;
+    // Like BeaconLink: a leader feeds its printer session, a follower's
+    // snapshot is whatever it last received
+    const relay::Wire local = (leader || in->intruder) ? g_printer.state : in->node.state();
+    in->node.tick(now, (leader && !in->sessionDead) || in->intruder, local);
+  }
+  if (in->fd >= 0) close(in->fd);
+}
+
+uint32_t pct(std::vector<uint32_t> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(v.size() * p / 100.0))];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string k = argv[i];
+    const double v = atof(argv[i + 1]);
+    if (k == "--nodes") opt.nodes = (int)v;
+    else if (k == "--seconds") opt.seconds = v;
+    else if (k == "--kill") opt.kill = v;
+    else if (k == "--restart") opt.restart = v;
+    else if (k == "--session-loss") opt.sessionLoss = v;
+    else if (k == "--loss") opt.loss = v;
+    else {
+      fprintf(stderr, "usage: %s [--nodes N] [--seconds S] [--kill S] [--restart S] [--session-loss S] [--loss P]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<Instance*> nodes;
+  for (int i = 0; i < opt.nodes; i++) {
+    Instance* in = new Instance();
+    in->id = 0x1000 + (uint32_t)i * 0x111;
+    in->accessCode = "12345678";
+    nodes.push_back(in);
+  }
+  Instance* intruder = new Instance();
+  intruder->id = 0xFFFFFFF0;  // would win every election if its tag were accepted
+  intruder->accessCode = "wrongkey";
+  intruder->intruder = true;
+
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  for (Instance* in : nodes) threads.emplace_back(runInstance, in, std::cref(opt), &stop);
+  threads.emplace_back(runInstance, intruder, std::cref(opt), &stop);
+
+  std::mt19937 rng(42);
+  uint32_t firstLeaderMs = 0, splitMs = 0, noLeaderMs = 0, failoverMs = 0, convergedMs = 0;
+  uint32_t killedId = 0, leaderBeforeRestart = 0, leaderAfterRestart = 0, killAt = 0;
+  uint32_t deadSessionId = 0, sessionLossAt = 0, handoverMs = 0;
+  bool killed = false, restarted = false, sessionLost = false, followedIntruder = false;
+  uint32_t lastPrinterMs = 0, lastSampleMs = 0;
+  const uint32_t endMs = (uint32_t)(opt.seconds * 1000);
+
+  while (nowMs() < endMs) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::lock_guard<std::mutex> lk(g_mu);
+    const uint32_t now = nowMs();
+    if (now - lastPrinterMs >= 200) {
+      lastPrinterMs = now;
+      g_printer.advance(rng);
+    }
+
+    int leaders = 0;
+    uint32_t leaderId = 0;
+    for (Instance* in : nodes) {
+      if (!in->alive) continue;
+      if (in->node.role() == relay::Role::Leader) {
+        leaders++;
+        leaderId = in->id;
+      }
+      if (in->node.leader() == intruder->id) followedIntruder = true;
+    }
+    const uint32_t dt = now - lastSampleMs;
+    lastSampleMs = now;
+    if (leaders > 1) splitMs += dt;
+    if (leaders == 0 && firstLeaderMs) noLeaderMs += dt;
+    if (leaders == 1 && !firstLeaderMs) {
+      firstLeaderMs = now;
+      printf("[%6.2f s] node %08x elected\n", now / 1000.0, leaderId);
+    }
+
+    // Propagation lag: time from a follower falling out of sync to catching up
+    for (Instance* in : nodes) {
+      if (!in->alive || in->node.role() != relay::Role::Follower) {
+        in->mismatchSince = 0;
+        continue;
+      }
+      const bool same = sameState(in->node.state(), g_printer.state);
+      if (!same && !in->mismatchSince) in->mismatchSince = now;
+      if (same && in->mismatchSince) {
+        if (!killed || convergedMs) in->lags.push_back(now - in->mismatchSince);
+        in->mismatchSince = 0;
+      }
+    }
+
+    if (!killed && now >= opt.kill * 1000 && leaderId) {
+      for (Instance* in : nodes) {
+        if (in->id == leaderId) in->alive = false;
+      }
+      killed = true;
+      killedId = leaderId;
+      killAt = now;
+      printf("[%6.2f s] killed leader %08x\n", now / 1000.0, leaderId);
+    }
+    if (killed && !failoverMs && leaders == 1 && leaderId != killedId) {
+      failoverMs = now - killAt;
+      printf("[%6.2f s] node %08x took over after %u ms\n", now / 1000.0, leaderId, failoverMs);
+    }
+    if (failoverMs && !convergedMs) {
+      bool all = true;
+      for (Instance* in : nodes) {
+        if (in->alive && in->id != leaderId && !sameState(in->node.state(), g_printer.state)) all = false;
+      }
+      if (all) {
+        convergedMs = now - killAt;
+        printf("[%6.2f s] followers in sync again %u ms after the kill\n", now / 1000.0, convergedMs);
+      }
+    }
+    if (killed && !restarted && now >= opt.restart * 1000) {
+      for (Instance* in : nodes) {
+        if (in->id == killedId) in->alive = true;
+      }
+      restarted = true;
+      leaderBeforeRestart = leaderId;
+      printf("[%6.2f s] rebooted %08x\n", now / 1000.0, killedId);
+    }
+    if (restarted && !sessionLost) leaderAfterRestart = leaderId;
+    if (!sessionLost && now >= opt.sessionLoss * 1000 && leaderId) {
+      for (Instance* in : nodes) {
+        if (in->id == leaderId) in->sessionDead = true;
+      }
+      sessionLost = true;
+      deadSessionId = leaderId;
+      sessionLossAt = now;
+      printf("[%6.2f s] printer session of leader %08x lost\n", now / 1000.0, leaderId);
+    }
+    if (sessionLost && !handoverMs && leaders == 1 && leaderId != deadSessionId) {
+      handoverMs = now - sessionLossAt;
+      printf("[%6.2f s] node %08x took over after %u ms\n", now / 1000.0, leaderId, handoverMs);
+    }
+  }
+  stop = true;
+  for (auto& t : threads) t.join();
+
+  std::vector<uint32_t> lags;
+  relay::Node::Stats sum;
+  for (Instance* in : nodes) {
+    lags.insert(lags.end(), in->lags.begin(), in->lags.end());
+    const relay::Node::Stats& s = in->node.stats();
+    sum.sentKeys += s.sentKeys;
+    sum.sentDeltas += s.sentDeltas;
+    sum.sentClaims += s.sentClaims;
+    sum.sentBytes += s.sentBytes;
+    sum.rxPackets += s.rxPackets;
+    sum.rxRejected += s.rxRejected;
+    sum.rxGaps += s.rxGaps;
+    sum.elections += s.elections;
+    sum.stepDowns += s.stepDowns;
+  }
+
+  printf("\nnodes %d, %.0f s, receive loss %.0f%%\n", opt.nodes, opt.seconds, opt.loss * 100);
+  printf("first election %u ms, failover %u ms, converged %u ms after kill\n", firstLeaderMs, failoverMs, convergedMs);
+  printf("split-brain %u ms, no leader %u ms, elections %u, step-downs %u\n", splitMs, noLeaderMs, sum.elections,
+         sum.stepDowns);
+  printf("propagation lag p50 %u ms, p99 %u ms, max %u ms (%zu samples)\n",
+         pct(lags, 50), pct(lags, 99), lags.empty() ? 0 : *std::max_element(lags.begin(), lags.end()), lags.size());
+  printf("sent %u key, %u delta, %u claim (%u B, %.0f B/s); rx %u, rejected %u, delta gaps %u\n",
+         sum.sentKeys, sum.sentDeltas, sum.sentClaims, sum.sentBytes, sum.sentBytes / opt.seconds,
+         sum.rxPackets, sum.rxRejected, sum.rxGaps);
+
+  bool ok = true;
+  auto check = [&](bool cond, const char* what) {
+    printf("  %-52s %s\n", what, cond ? "ok" : "FAIL");
+    ok = ok && cond;
+  };
+  check(firstLeaderMs > 0 && firstLeaderMs < relay::kLeaderTimeoutMs + relay::kClaimMs + 1000, "one leader elected after boot");
+  check(failoverMs > 0 && failoverMs < relay::kLeaderTimeoutMs + relay::kClaimMs + 1500, "failover after leader loss");
+  check(convergedMs > 0, "followers converge after failover");
+  check(leaderAfterRestart == leaderBeforeRestart, "rebooted node does not take over");
+  if (opt.sessionLoss < opt.seconds) {
+    check(handoverMs > 0 && handoverMs < relay::kLeaderDownMs + relay::kLeaderTimeoutMs + relay::kClaimMs + 1500,
+          "leader without printer session hands over");
+  }
+  check(splitMs < 500, "no lasting split-brain");
+  check(!followedIntruder && sum.rxRejected > 0, "wrong access code rejected");
+  return ok ? 0 : 1;
+}
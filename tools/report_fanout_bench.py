@@ -0,0 +1,308 @@
+#!/usr/bin/env python3
+"""Benchmark the printer report fan-out (/ws/report) with a stand-in printer.
+
+Runs a minimal MQTT 3.1.1 broker over TLS on :8883 that plays the printer:
+it accepts the beacon's connection, answers SUBSCRIBE/PINGREQ and publishes
+synthetic reports of --size bytes at --rate per second on device/<usn>/report.
+Each report carries a sequence number and a send timestamp. Meanwhile
+--subscribers WebSocket clients connect to ws://<beacon>/ws/report and
+measure received reports/s, lost reports (sequence gaps = the beacon's
+drop-oldest) and end-to-end latency. --slow N makes N of the subscribers
+read slowly, to show that they lose reports without slowing the others.
+
+Point the beacon's printer settings at this machine first (Printer setup:
+IP = this host, serial = --usn, any access code). Needs the openssl CLI to
+make a throwaway certificate (the beacon does not verify it).
+
+Usage:
+  python tools/report_fanout_bench.py 192.168.1.50 --usn BENCH01 --rate 5 --size 12000 \\
+      --subscribers 4 --slow 1 --seconds 60 --user admin --password secret
+"""
+import argparse
+import base64
+import json
+import os
+import socket
+import ssl
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+
+# ---------------------------------------------------------------- broker
+
+def read_exact(sock, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError("closed")
+        buf += chunk
+    return buf
+
+
+def read_packet(sock):
+    first = read_exact(sock, 1)[0]
+    mult, length = 1, 0
+    while True:
+        b = read_exact(sock, 1)[0]
+        length += (b & 0x7F) * mult
+        if not b & 0x80:
+            break
+        mult *= 128
+    return first, read_exact(sock, length) if length else b""
+
+
+def encode_len(n):
+    out = bytearray()
+    while True:
+        b = n % 128
+        n //= 128
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def publish_packet(topic, payload):
+    t = topic.encode()
+    body = struct.pack(">H", len(t)) + t + payload
+    return bytes([0x30]) + encode_len(len(body)) + body
+
+
+class Broker:
+    def __init__(self, args):
+        self.args = args
+        self.conn = None
+        self.lock = threading.Lock()
+        self.connected = threading.Event()
+        self.pushall = 0
+        self.published = 0
+
+    def serve(self):
+        tmp = tempfile.mkdtemp()
+        cert, key = os.path.join(tmp, "c.pem"), os.path.join(tmp, "k.pem")
+        subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-subj", "/CN=bench",
+                        "-days", "1", "-keyout", key, "-out", cert], check=True, capture_output=True)
+        ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        ctx.load_cert_chain(cert, key)
+        srv = socket.socket()
+        srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        srv.bind(("0.0.0.0", self.args.mqtt_port))
+        srv.listen(2)
+        print(f"[broker] listening on :{self.args.mqtt_port}")
+        while True:
+            raw, addr = srv.accept()
+            try:
+                conn = ctx.wrap_socket(raw, server_side=True)
+            except (ssl.SSLError, OSError) as e:
+                print(f"[broker] TLS handshake from {addr[0]} failed: {e}")
+                continue
+            threading.Thread(target=self.session, args=(conn, addr), daemon=True).start()
+
+    def session(self, conn, addr):
+        print(f"[broker] beacon connected from {addr[0]}")
+        try:
+            while True:
+                kind, body = read_packet(conn)
+                ptype = kind >> 4
+                if ptype == 1:      # CONNECT
+                    conn.sendall(b"\x20\x02\x00\x00")
+                elif ptype == 8:    # SUBSCRIBE
+                    conn.sendall(b"\x90\x03" + body[:2] + b"\x00")
+                    with self.lock:
+                        self.conn = conn
+                    self.connected.set()
+                elif ptype == 3:    # PUBLISH from the beacon (request topic)
+                    if b"pushall" in body:
+                        self.pushall += 1
+                elif ptype == 10:   # UNSUBSCRIBE
+                    conn.sendall(b"\xb0\x02" + body[:2])
+                elif ptype == 12:   # PINGREQ
+                    conn.sendall(b"\xd0\x00")
+                elif ptype == 14:   # DISCONNECT
+                    break
+        except (ConnectionError, OSError, ssl.SSLError):
+            pass
+        with self.lock:
+            if self.conn is conn:
+                self.conn = None
+        self.connected.clear()
+        print("[broker] beacon disconnected")
+
+    def run_publisher(self, stop):
+        topic = f"device/{self.args.usn}/report"
+        seq = 0
+        period = 1.0 / self.args.rate
+        nxt = time.time()
+        while not stop.is_set():
+            nxt += period
+            delay = nxt - time.time()
+            if delay > 0:
+                time.sleep(delay)
+            with self.lock:
+                conn = self.conn
+            if not conn:
+                nxt = time.time()
+                continue
+            doc = {"print": {"command": "push_status", "sequence_id": str(seq), "bench_seq": seq,
+                             "bench_ts": time.time(), "gcode_state": "RUNNING", "mc_percent": seq % 100}}
+            base = json.dumps(doc)
+            pad = max(0, self.args.size - len(base) - 20)
+            doc["print"]["bench_pad"] = "x" * pad
+            try:
+                conn.sendall(publish_packet(topic, json.dumps(doc).encode()))
+                self.published += 1
+                seq += 1
+            except OSError:
+                pass
+
+
+# ---------------------------------------------------------------- ws client
+
+class Subscriber:
+    def __init__(self, args, idx, slow):
+        self.args = args
+        self.idx = idx
+        self.slow = slow
+        self.received = 0
+        self.lost = 0
+        self.latency = []
+        self.last_seq = None
+        self.error = None
+
+    def connect(self):
+        s = socket.create_connection((self.args.host, 80), timeout=10)
+        key = base64.b64encode(os.urandom(16)).decode()
+        req = (f"GET /ws/report HTTP/1.1\r\nHost: {self.args.host}\r\nUpgrade: websocket\r\n"
+               f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n")
+        if self.args.user:
+            cred = base64.b64encode(f"{self.args.user}:{self.args.password}".encode()).decode()
+            req += f"Authorization: Basic {cred}\r\n"
+        s.sendall((req + "\r\n").encode())
+        head = b""
+        while b"\r\n\r\n" not in head:
+            chunk = s.recv(1)
+            if not chunk:
+                raise ConnectionError("closed during handshake")
+            head += chunk
+        status = head.split(b"\r\n", 1)[0]
+        if b" 101 " not in status:
+            raise ConnectionError(status.decode(errors="replace"))
+        return s
+
+    def send_frame(self, s, opcode, payload=b""):
+        mask = os.urandom(4)
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        s.sendall(bytes([0x80 | opcode, 0x80 | len(payload)]) + mask + masked)
+
+    def run(self, stop):
+        try:
+            s = self.connect()
+            s.settimeout(1.0)
+            message = b""
+            while not stop.is_set():
+                try:
+                    b0, b1 = read_exact(s, 2)
+                except socket.timeout:
+                    continue
+                opcode = b0 & 0x0F
+                n = b1 & 0x7F
+                if n == 126:
+                    n = struct.unpack(">H", read_exact(s, 2))[0]
+                elif n == 127:
+                    n = struct.unpack(">Q", read_exact(s, 8))[0]
+                payload = read_exact(s, n) if n else b""
+                if opcode == 9:
+                    self.send_frame(s, 10, payload)
+                    continue
+                if opcode == 8:
+                    break
+                if opcode in (1, 2, 0):
+                    message += payload
+                    if b0 & 0x80:
+                        self.on_message(message)
+                        message = b""
+                        if self.slow:
+                            time.sleep(self.args.slow_delay)
+            s.close()
+        except Exception as e:  # noqa: BLE001 - report any failure per subscriber
+            self.error = str(e)
+
+    def on_message(self, data):
+        try:
+            p = json.loads(data)["print"]
+            seq, ts = p["bench_seq"], p["bench_ts"]
+        except (ValueError, KeyError, TypeError):
+            return
+        self.received += 1
+        self.latency.append(time.time() - ts)
+        if self.last_seq is not None and seq > self.last_seq + 1:
+            self.lost += seq - self.last_seq - 1
+        self.last_seq = seq
+
+
+def pct(values, p):
+    if not values:
+        return float("nan")
+    v = sorted(values)
+    return v[min(len(v) - 1, int(len(v) * p / 100))]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host", help="beacon IP")
+    ap.add_argument("--usn", default="BENCH01", help="printer serial configured on the beacon")
+    ap.add_argument("--mqtt-port", type=int, default=8883)
+    ap.add_argument("--rate", type=float, default=5.0, help="reports per second")
+    ap.add_argument("--size", type=int, default=12000, help="report size in bytes")
+    ap.add_argument("--subscribers", type=int, default=4)
+    ap.add_argument("--slow", type=int, default=0, help="how many subscribers read slowly")
+    ap.add_argument("--slow-delay", type=float, default=1.0, help="seconds a slow subscriber sleeps per report")
+    ap.add_argument("--seconds", type=float, default=60)
+    ap.add_argument("--user", default="")
+    ap.add_argument("--password", default="")
+    args = ap.parse_args()
+
+    broker = Broker(args)
+    threading.Thread(target=broker.serve, daemon=True).start()
+    print("[bench] waiting for the beacon to connect and subscribe ...")
+    if not broker.connected.wait(120):
+        print("beacon did not connect; check its printer IP/serial settings")
+        return 1
+
+    stop = threading.Event()
+    subs = [Subscriber(args, i, i < args.slow) for i in range(args.subscribers)]
+    threads = [threading.Thread(target=s.run, args=(stop,), daemon=True) for s in subs]
+    for t in threads:
+        t.start()
+    time.sleep(1.0)
+    pub = threading.Thread(target=broker.run_publisher, args=(stop,), daemon=True)
+    t0 = time.time()
+    pub.start()
+    time.sleep(args.seconds)
+    stop.set()
+    for t in threads + [pub]:
+        t.join(timeout=3)
+    elapsed = time.time() - t0
+
+    print(f"\npublished {broker.published} reports of ~{args.size} B in {elapsed:.1f} s "
+          f"({broker.published / elapsed:.1f}/s, {broker.published * args.size / elapsed / 1024:.1f} KB/s), "
+          f"pushall requests from the beacon: {broker.pushall}")
+    total = 0
+    for s in subs:
+        kind = "slow" if s.slow else "fast"
+        total += s.received
+        if s.error:
+            print(f"  sub {s.idx} ({kind}): error {s.error}")
+            continue
+        print(f"  sub {s.idx} ({kind}): {s.received} received ({s.received / elapsed:.1f}/s), {s.lost} lost, "
+              f"latency p50 {pct(s.latency, 50) * 1000:.0f} ms p99 {pct(s.latency, 99) * 1000:.0f} ms")
+    print(f"aggregate fan-out: {total / elapsed:.1f} reports/s, {total * args.size / elapsed / 1024:.1f} KB/s")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,313 @@
+#!/usr/bin/env python3
+"""Accelerated soak of a real beacon: heap fragmentation and loop latency drift.
+
+The on-device counterpart of the simulator's --soak. This host plays the
+printer (printer_sim.Printer, TLS by default like a real one) on compressed
+time: short print jobs, an HMS storm of --hms-count codes every --hms-every
+seconds and a dropped MQTT session every --drop-every seconds. Meanwhile it
+cycles GETs over the JSON endpoints and saves settings (LED brightness, and
+the printer config with unchanged values so nothing restarts).
+
+Every --window minutes a row records the window's minimum free heap and
+largest free block (sampled from /metrics.json every --interval s), live
+blocks, and loop() p50/p99/max from the difference of the cumulative loop
+histograms. After the first quarter (warm-up) a metric fails when it moves the
+wrong way in at least 80% of its non-flat steps, at least three times, and by
+more than a floor in total. A reboot (uptime going backwards) fails the run.
+
+--printer-ip points the beacon at this host first (it overwrites the stored
+printer address, serial and access code); without it the beacon must already
+use this host as its printer.
+
+Usage:
+  python tools/soak_device.py 192.168.1.50 --user admin --password secret \\
+      --printer-ip 192.168.1.20 --hours 24 --csv soak.csv
+  python tools/soak_device.py --selftest
+"""
+import argparse
+import base64
+import csv
+import json
+import sys
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+
+from printer_sim import Job, Printer
+
+ENDPOINTS = ["/api/state", "/metrics.json", "/status.cbor", "/info.json", "/logs", "/ledconf.json"]
+COLUMNS = ["window", "hours", "free_min", "largest_min", "blocks", "p50_us", "p99_us", "max_us"]
+# name, sign (+1: growth is bad, -1: shrinking is bad), floor, floor relative to the first window
+CHECKS = [("free_min", -1, 256, False), ("largest_min", -1, 256, False), ("blocks", +1, 4, False),
+          ("p99_us", +1, 0.25, True)]
+
+
+def bucket_limit(b):
+    """LoopStats::bucketLimitUs: upper bound of histogram bucket b."""
+    n = b + 1
+    if n < 4:
+        return n
+    return (4 + (n & 3)) << (n // 4 - 1)
+
+
+def percentile(hist, q):
+    total = sum(hist)
+    if not total:
+        return 0
+    rank = int(q * total + 0.5)
+    seen = 0
+    for i, n in enumerate(hist):
+        seen += n
+        if seen and seen >= rank:
+            return bucket_limit(i)
+    return bucket_limit(len(hist) - 1)
+
+
+def hist_delta(cur, prev):
+    prev = prev + [0] * (len(cur) - len(prev))
+    return [(c - p) & 0xFFFFFFFF for c, p in zip(cur, prev)]
+
+
+def degrading(rows, key, sign, floor):
+    bad = good = 0
+    for a, b in zip(rows, rows[1:]):
+        d = (b[key] - a[key]) * sign
+        if d > 0:
+            bad += 1
+        elif d < 0:
+            good += 1
+    net = (rows[-1][key] - rows[0][key]) * sign
+    return bad >= 3 and bad * 5 >= (bad + good) * 4 and net > floor, net
+
+
+def verdict(rows):
+    """Names of the metrics that degrade after warm-up; None if too few windows."""
+    rows = rows[len(rows) // 4:]
+    if len(rows) < 5:
+        return None
+    failed = []
+    for key, sign, floor, relative in CHECKS:
+        limit = floor * max(1.0, rows[0][key]) if relative else floor
+        bad, net = degrading(rows, key, sign, limit)
+        if bad:
+            failed.append(f"{key} ({net * sign:+.0f})")
+    return failed
+
+
+class Beacon:
+    def __init__(self, host, user, password):
+        self.host = host
+        self.auth = "Basic " + base64.b64encode(f"{user}:{password}".encode()).decode() if user else ""
+
+    def request(self, path, form=None):
+        data = urllib.parse.urlencode(form).encode() if form is not None else None
+        req = urllib.request.Request(f"http://{self.host}{path}", data=data)
+        if self.auth:
+            req.add_header("Authorization", self.auth)
+        try:
+            with urllib.request.urlopen(req, timeout=10) as r:
+                return r.status, r.read()
+        except urllib.error.HTTPError as e:
+            return e.code, b""
+        except OSError:
+            return 0, b""
+
+    def metrics(self):
+        status, body = self.request("/metrics.json")
+        return json.loads(body) if status == 200 else None
+
+
+def traffic(beacon, args, stop, counters):
+    """GETs across the endpoints and periodic settings saves until stop."""
+    i = saves = 0
+    next_save = time.time() + args.save_every
+    while not stop.wait(args.web_every):
+        status, _ = beacon.request(ENDPOINTS[i % len(ENDPOINTS)])
+        i += 1
+        counters["requests"] += 1
+        # 503 is the admission gate shedding load, not an error
+        if status not in (200, 503):
+            counters["errors"] += 1
+        if time.time() < next_save:
+            continue
+        next_save = time.time() + args.save_every
+        # The printer config is only known (and so only re-saved) with --printer-ip
+        if saves % 2 == 1 and args.printer_ip:
+            status, _ = beacon.request("/submitPrinterConfig", {"printerip": args.printer_ip,
+                                                                "printerusn": args.usn, "printerac": args.ac})
+        else:
+            status, _ = beacon.request("/setLedBrightness", {"brightness": 200 + saves // 2 % 2})
+        saves += 1
+        counters["saves"] += 1
+        if status not in (200, 503):
+            counters["errors"] += 1
+
+
+def soak(args):
+    beacon = Beacon(args.host, args.user, args.password)
+    first = beacon.metrics()
+    if not first:
+        print(f"[soak] cannot read http://{args.host}/metrics.json", file=sys.stderr)
+        return 2
+    if "loop" not in first or "blocks" not in first["heap"]:
+        print("[soak] the firmware does not report loop/heap block stats yet", file=sys.stderr)
+        return 2
+
+    printer_args = argparse.Namespace(port=8883, usn=args.usn, ac=args.ac, tls=not args.plain, quiet=True,
+                                      interval=1.0, drop_every=args.drop_every)
+    printer = Printer(printer_args, Job(args.job_seconds, args.hms_every, args.hms_count))
+    stop = threading.Event()
+    threading.Thread(target=printer.serve, daemon=True).start()
+    threading.Thread(target=printer.run, args=(stop,), daemon=True).start()
+
+    if args.printer_ip:
+        status, _ = beacon.request("/submitPrinterConfig", {"printerip": args.printer_ip, "printerusn": args.usn,
+                                                            "printerac": args.ac})
+        if status != 200:
+            print(f"[soak] configuring the printer failed: HTTP {status}", file=sys.stderr)
+            return 2
+
+    counters = {"requests": 0, "errors": 0, "saves": 0}
+    threading.Thread(target=traffic, args=(beacon, args, stop, counters), daemon=True).start()
+
+    out = open(args.csv, "w", newline="") if args.csv else None
+    writer = csv.DictWriter(out, fieldnames=COLUMNS) if out else None
+    if writer:
+        writer.writeheader()
+
+    rows, rebooted = [], False
+    start = time.time()
+    end = start + args.hours * 3600
+    prev = first
+    win_start, win_loop = time.time(), first["loop"]["hist"]
+    free_min = largest_min = None
+    print(f"[soak] {args.hours} h, {args.window} min windows, printer on :{printer.port}")
+    try:
+        while time.time() < end:
+            time.sleep(args.interval)
+            m = beacon.metrics()
+            if not m:
+                continue
+            # millis() wraps after 49.7 days; only a drop from well below that is a reboot
+            if m["log"]["uptimeMs"] < prev["log"]["uptimeMs"] < 0xF0000000:
+                print("[soak] FAIL the beacon rebooted")
+                rebooted = True
+                break
+            prev = m
+            heap = m["heap"]
+            free_min = heap["free"] if free_min is None else min(free_min, heap["free"])
+            largest_min = heap["largestBlock"] if largest_min is None else min(largest_min, heap["largestBlock"])
+            if time.time() - win_start < args.window * 60:
+                continue
+
+            hist = hist_delta(m["loop"]["hist"], win_loop)
+            top = max((i for i, n in enumerate(hist) if n), default=None)
+            row = {"window": len(rows), "hours": round((time.time() - start) / 3600, 2), "free_min": free_min,
+                   "largest_min": largest_min, "blocks": heap["blocks"], "p50_us": percentile(hist, 0.5),
+                   "p99_us": percentile(hist, 0.99), "max_us": bucket_limit(top) if top is not None else 0}
+            rows.append(row)
+            print(f"[soak] {row['hours']:6.1f} h free_min={free_min} largest_min={largest_min} "
+                  f"blocks={row['blocks']} loop p50={row['p50_us']} p99={row['p99_us']} max<{row['max_us']} us",
+                  flush=True)
+            if writer:
+                writer.writerow(row)
+                out.flush()
+            win_start, win_loop = time.time(), m["loop"]["hist"]
+            free_min = largest_min = None
+    except KeyboardInterrupt:
+        print("[soak] interrupted")
+    stop.set()
+    if out:
+        out.close()
+
+    with printer.lock:
+        s = dict(printer.stats)
+    print(f"[soak] {len(rows)} windows, {s['connects']} connects, {s['drops']} drops, {s['reports']} reports, "
+          f"{counters['requests']} requests, {counters['saves']} saves, {counters['errors']} web errors")
+    failed = verdict(rows)
+    if failed is None:
+        print(f"[soak] too few windows after warm-up for a trend (need 5, have {len(rows) - len(rows) // 4})")
+        failed = []
+    for f in failed:
+        print(f"[soak] FAIL {f} degrades monotonically after warm-up")
+    bad = rebooted or bool(failed)
+    print("[soak]", "FAILED" if bad else "ok")
+    return 1 if bad else 0
+
+
+def selftest():
+    failures = []
+    # Bucket bounds must match LoopStats::bucketOf/bucketLimitUs
+    def bucket_of(us):
+        if us < 4:
+            return us
+        msb = us.bit_length() - 1
+        return min((msb - 1) * 4 + ((us >> (msb - 2)) & 3), 79)
+    for us in list(range(1, 5000)) + [65535, 65536, 1000000]:
+        b = bucket_of(us)
+        if not (b == 0 or bucket_limit(b - 1) <= us < bucket_limit(b)) and b != 79:
+            failures.append(f"{us} us lands in bucket {b} [{bucket_limit(b - 1)}, {bucket_limit(b)})")
+            break
+    hist = [0] * 80
+    hist[bucket_of(100)] = 99
+    hist[bucket_of(5000)] = 1
+    if percentile(hist, 0.5) != bucket_limit(bucket_of(100)) or percentile(hist, 1.0) != bucket_limit(bucket_of(5000)):
+        failures.append("percentile bounds")
+
+    def rows(free, blocks=None, p99=None):
+        return [{"free_min": f, "largest_min": f, "blocks": (blocks or [100] * len(free))[i],
+                 "p99_us": (p99 or [3] * len(free))[i]} for i, f in enumerate(free)]
+    flat = [50000] * 12
+    cases = [
+        ("flat", rows(flat), []),
+        ("noise", rows([50000, 49900, 50010, 49950, 50000, 49920, 50030, 49980, 50000, 49900, 50000, 49950]), []),
+        ("one step down", rows(flat[:6] + [48000] * 6), []),
+        ("leak", rows([50000 - 300 * i for i in range(12)]), ["free_min", "largest_min"]),
+        ("block growth", rows(flat, blocks=[100 + 2 * i for i in range(12)]), ["blocks"]),
+        ("latency creep", rows(flat, p99=[3, 3, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16]), ["p99_us"]),
+    ]
+    for name, series, want in cases:
+        got = [f.split(" ")[0] for f in verdict(series)]
+        if got != want:
+            failures.append(f"{name}: flagged {got}, want {want}")
+    if verdict(rows(flat[:4])) is not None:
+        failures.append("a verdict from four windows")
+    for f in failures:
+        print(f"FAIL {f}")
+    print("selftest", "FAILED" if failures else "ok")
+    return 1 if failures else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host", nargs="?")
+    ap.add_argument("--user", default="")
+    ap.add_argument("--password", default="")
+    ap.add_argument("--printer-ip", default="", help="this host's address; configures the beacon to use it")
+    ap.add_argument("--usn", default="SIM00000000001")
+    ap.add_argument("--ac", default="12345678")
+    ap.add_argument("--plain", action="store_true", help="plain MQTT (simulator builds) instead of TLS")
+    ap.add_argument("--hours", type=float, default=24)
+    ap.add_argument("--window", type=float, default=30, help="minutes per stats window")
+    ap.add_argument("--interval", type=float, default=10, help="seconds between /metrics.json samples")
+    ap.add_argument("--job-seconds", type=float, default=300)
+    ap.add_argument("--hms-every", type=float, default=900)
+    ap.add_argument("--hms-count", type=int, default=24)
+    ap.add_argument("--drop-every", type=float, default=600)
+    ap.add_argument("--web-every", type=float, default=2)
+    ap.add_argument("--save-every", type=float, default=300)
+    ap.add_argument("--csv", default="")
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+
+    if args.selftest:
+        return selftest()
+    if not args.host:
+        ap.error("host is required")
+    return soak(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,275 @@
+#!/usr/bin/env python3
+"""Suggest right-sized task stacks from a beacon's /tasks.json.
+
+The firmware samples every task's stack high-water mark (the least free stack
+it ever had) and CPU share (TaskStats). This tool turns a capture into stack
+sizes with headroom:
+
+  suggested = used + max(used * --margin, --min-headroom), rounded up to 256
+
+where used = size - high-water mark. For the stacks the firmware sizes
+(loopTask, async_tcp, logfs, ota_pull) it names the knob and the bytes to
+reclaim or add; the framework's stacks are fixed by its precompiled sdkconfig
+and only listed. A mark is only as good
+as the workload that produced it: capture after the device has run its heavy
+paths (printer connected, web UI, log viewer, an OTA pull).
+
+--save merges the capture into a snapshot file, keeping each task's worst
+mark and peak CPU across captures (several devices or workloads). The build
+(tools/merge_firmware.py) prints the report against .firmware/tasks_<env>.json
+after every firmware build, with stack sizes taken from the new build flags.
+
+Usage:
+  python tools/stack_report.py 192.168.1.50 --user admin --password secret \\
+      --save .firmware/tasks_wemos_d1_mini32.json
+  python tools/stack_report.py --snapshot .firmware/tasks_wemos_d1_mini32.json
+  python tools/stack_report.py --selftest
+"""
+import argparse
+import base64
+import json
+import os
+import sys
+import urllib.request
+
+ROUND = 256
+
+# task name (trailing * = prefix) -> (build define of its size, where to change it, set by the firmware)
+KNOBS = [
+    ("loopTask", None, "SET_LOOP_TASK_STACK_SIZE() in main.cpp", True),
+    ("async_tcp", "CONFIG_ASYNC_TCP_STACK_SIZE", "-DCONFIG_ASYNC_TCP_STACK_SIZE in platformio.ini", True),
+    ("logfs", None, "PersistLog::kStackSize", True),
+    ("ota_pull", None, "OtaPuller::kStackSize", True),
+    ("esp_timer", "CONFIG_ESP_TIMER_TASK_STACK_SIZE", "sdkconfig", False),
+    ("tiT", "CONFIG_LWIP_TCPIP_TASK_STACK_SIZE", "sdkconfig", False),
+    ("sys_evt", "CONFIG_ESP_SYSTEM_EVENT_TASK_STACK_SIZE", "sdkconfig", False),
+    ("Tmr Svc", "CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH", "sdkconfig", False),
+    ("IDLE*", "CONFIG_FREERTOS_IDLE_TASK_STACKSIZE", "sdkconfig", False),
+    ("ipc*", "CONFIG_ESP_IPC_TASK_STACK_SIZE", "sdkconfig", False),
+    ("mdns", "CONFIG_MDNS_TASK_STACK_SIZE", "sdkconfig", False),
+]
+
+
+def knob_for(name):
+    for pattern, define, where, fw in KNOBS:
+        if pattern.endswith("*") and name.startswith(pattern[:-1]) or pattern == name:
+            return define, where, fw
+    return None, "", False
+
+
+def suggest(size, free, margin, min_headroom):
+    """Suggested stack bytes, or None when the size is unknown."""
+    if not size:
+        return None
+    used = max(0, size - free)
+    want = used + max(int(used * margin), min_headroom)
+    return (want + ROUND - 1) // ROUND * ROUND
+
+
+def merge(snapshot, capture):
+    """Folds a /tasks.json capture into a snapshot (worst mark, peak CPU)."""
+    out = dict(snapshot) if snapshot else {"captures": 0, "uptimeMs": 0, "tasks": []}
+    out["captures"] = out.get("captures", 0) + 1
+    out["uptimeMs"] = max(out.get("uptimeMs", 0), capture.get("uptimeMs", 0))
+    out["cores"] = capture.get("cores", out.get("cores", 1))
+    out["runTimeStats"] = capture.get("runTimeStats", out.get("runTimeStats", False))
+    tasks = {t["name"]: dict(t) for t in out.get("tasks", [])}
+    for t in capture.get("tasks", []):
+        old = tasks.get(t["name"])
+        if old is None:
+            tasks[t["name"]] = dict(t)
+            continue
+        # A size change means a new build: its marks start over
+        if t.get("stackSize") and t["stackSize"] != old.get("stackSize"):
+            tasks[t["name"]] = dict(t)
+            continue
+        old["stackFree"] = min(old.get("stackFree", t["stackFree"]), t["stackFree"])
+        old["cpuPeak"] = max(old.get("cpuPeak", 0), t.get("cpuPeak", 0))
+        old["cpu"] = t.get("cpu", 0)
+        old["state"] = t.get("state", old.get("state"))
+    out["tasks"] = sorted(tasks.values(), key=lambda t: t["name"])
+    return out
+
+
+def apply_defines(snapshot, defines):
+    """Sizes from the build flags replace the ones the capture was built with."""
+    for t in snapshot.get("tasks", []):
+        define, _, _ = knob_for(t["name"])
+        if define and define in defines:
+            t["configured"] = int(defines[define])
+
+
+def report(snapshot, margin=0.25, min_headroom=1024, out=sys.stdout):
+    """Prints the table; returns (reclaimable bytes, names of tight tasks)."""
+    tasks = snapshot.get("tasks", [])
+    hours = snapshot.get("uptimeMs", 0) / 3600000.0
+    print(f"Stack report: {len(tasks)} task(s), {snapshot.get('captures', 1)} capture(s), "
+          f"longest uptime {hours:.1f} h", file=out)
+    if hours < 1:
+        print("  note: short capture, the marks may miss the heavy paths", file=out)
+    print(f"  {'task':<16} {'cpu%':>5} {'peak%':>5} {'size':>6} {'used':>6} {'free':>6} {'suggest':>7}  change",
+          file=out)
+    reclaim = 0
+    tight = []
+    cpu_known = snapshot.get("runTimeStats", False)
+    for t in sorted(tasks, key=lambda t: -t.get("cpuPeak", 0)):
+        name = t["name"]
+        size = t.get("stackSize", 0)
+        free = t.get("stackFree", 0)
+        configured = t.get("configured", size)
+        want = suggest(size, free, margin, min_headroom)
+        _, where, fw = knob_for(name)
+        cpu = f"{t.get('cpu', 0):5.1f} {t.get('cpuPeak', 0):5.1f}" if cpu_known else f"{'-':>5} {'-':>5}"
+        used = f"{size - free:6d}" if size else f"{'?':>6}"
+        line = f"  {name:<16} {cpu} {size or '?':>6} {used} {free:6d} {want or '-':>7}"
+        if want is not None and fw:
+            if want > configured:
+                tight.append(name)
+                line += f"  grow to {want} ({where})"
+            elif configured - want >= ROUND:
+                reclaim += configured - want
+                line += f"  -{configured - want} B ({where})"
+            else:
+                line += "  ok"
+        elif want is not None:
+            line += "  framework"
+        if configured != size:
+            line += f" [build: {configured}]"
+        if t.get("state") == "gone":
+            line += " (exited)"
+        print(line, file=out)
+    print(f"  reclaimable by the firmware: {reclaim} B", file=out)
+    if tight:
+        print(f"  tight: {', '.join(tight)}", file=out)
+    return reclaim, tight
+
+
+def fetch(host, user, password):
+    req = urllib.request.Request(f"http://{host}/tasks.json")
+    if user:
+        req.add_header("Authorization", "Basic " + base64.b64encode(f"{user}:{password}".encode()).decode())
+    with urllib.request.urlopen(req, timeout=10) as r:
+        return json.load(r)
+
+
+def load(path):
+    with open(path) as f:
+        return json.load(f)
+
+
+def cpp_defines(env):
+    """NAME -> value of the numeric defines of a PlatformIO environment."""
+    out = {}
+    for d in env.get("CPPDEFINES", []):
+        if isinstance(d, (list, tuple)) and len(d) == 2:
+            name, value = d
+        else:
+            name, _, value = str(d).partition("=")
+        try:
+            out[str(name)] = int(str(value), 0)
+        except ValueError:
+            pass
+    return out
+
+
+def build_report(snapshot_path, defines):
+    """Post-build hook (merge_firmware.py): report against the new build's sizes."""
+    if not os.path.exists(snapshot_path):
+        print(f"Stack report: no capture at {snapshot_path} (tools/stack_report.py HOST --save ...)")
+        return
+    snapshot = load(snapshot_path)
+    apply_defines(snapshot, defines)
+    report(snapshot)
+
+
+def selftest():
+    failures = []
+
+    def check(name, ok):
+        if not ok:
+            failures.append(name)
+            print("FAIL", name)
+
+    check("suggest headroom floor", suggest(4096, 3000, 0.25, 1024) == 2304)      # 1096 + 1024
+    check("suggest margin", suggest(16384, 4000, 0.25, 1024) == 15616)            # 12384 + 3096
+    check("suggest unknown size", suggest(0, 500, 0.25, 1024) is None)
+    check("knob prefix", knob_for("IDLE1")[0] == "CONFIG_FREERTOS_IDLE_TASK_STACKSIZE")
+    check("knob exact", knob_for("async_tcp")[2] and not knob_for("async_tcp2")[2])
+
+    a = {"uptimeMs": 1000, "cores": 2, "runTimeStats": True, "tasks": [
+        {"name": "loopTask", "stackSize": 8192, "stackFree": 5000, "cpu": 10, "cpuPeak": 30},
+        {"name": "async_tcp", "stackSize": 4096, "stackFree": 900, "cpu": 1, "cpuPeak": 5}]}
+    b = {"uptimeMs": 7200000, "cores": 2, "runTimeStats": True, "tasks": [
+        {"name": "loopTask", "stackSize": 8192, "stackFree": 5500, "cpu": 12, "cpuPeak": 20},
+        {"name": "ota_pull", "stackSize": 8192, "stackFree": 5200, "cpu": 0, "cpuPeak": 40, "state": "gone"}]}
+    s = merge(merge(None, a), b)
+    by = {t["name"]: t for t in s["tasks"]}
+    check("merge captures", s["captures"] == 2 and s["uptimeMs"] == 7200000)
+    check("merge worst mark", by["loopTask"]["stackFree"] == 5000 and by["loopTask"]["cpuPeak"] == 30)
+    check("merge keeps tasks", set(by) == {"loopTask", "async_tcp", "ota_pull"})
+    c = {"uptimeMs": 10, "tasks": [{"name": "loopTask", "stackSize": 6144, "stackFree": 3000}]}
+    check("merge new size restarts", {t["name"]: t for t in merge(s, c)["tasks"]}["loopTask"]["stackFree"] == 3000)
+
+    apply_defines(s, cpp_defines({"CPPDEFINES": [("CONFIG_ASYNC_TCP_STACK_SIZE", "6144"), "VERSION=1.0.0"]}))
+    check("defines", {t["name"]: t for t in s["tasks"]}["async_tcp"].get("configured") == 6144)
+
+    class Sink:
+        text = ""
+
+        def write(self, x):
+            self.text += x
+
+    sink = Sink()
+    reclaim, tight = report(s, out=sink)
+    # used + 1024 rounded up: ota_pull 2992 -> 4096, loopTask 3192 -> 4352, async_tcp 3196 -> 4352 of 6144
+    check("reclaim", reclaim == 4096 + 3840 + 1792 and tight == [])
+    check("notes", "(exited)" in sink.text and "[build: 6144]" in sink.text)
+    by = {t["name"]: t for t in s["tasks"]}
+    by["async_tcp"]["stackFree"] = 100  # 3996 used -> 5120
+    reclaim, tight = report(s, out=Sink())
+    check("reclaim after a deeper mark", reclaim == 4096 + 3840 + 1024 and tight == [])
+    by["async_tcp"]["configured"] = 4096
+    _, tight = report(s, out=Sink())
+    check("grow", tight == ["async_tcp"])
+
+    print("selftest", "FAILED" if failures else "ok")
+    return 1 if failures else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host", nargs="?", help="beacon to capture /tasks.json from")
+    ap.add_argument("--user", default="")
+    ap.add_argument("--password", default="")
+    ap.add_argument("--snapshot", default="", help="report on a saved snapshot instead of a capture")
+    ap.add_argument("--save", default="", help="merge the capture into this snapshot file")
+    ap.add_argument("--margin", type=float, default=0.25, help="headroom as a fraction of the used stack")
+    ap.add_argument("--min-headroom", type=int, default=1024, help="least headroom in bytes")
+    ap.add_argument("-D", dest="defines", action="append", default=[], metavar="NAME=VALUE",
+                    help="build define overriding a captured size, e.g. CONFIG_ASYNC_TCP_STACK_SIZE=6144")
+    ap.add_argument("--selftest", action="store_true")
+    args = ap.parse_args()
+
+    if args.selftest:
+        return selftest()
+    if bool(args.host) == bool(args.snapshot):
+        ap.error("give a host or --snapshot")
+
+    if args.host:
+        capture = fetch(args.host, args.user, args.password)
+        snapshot = merge(load(args.save) if args.save and os.path.exists(args.save) else None, capture)
+        if args.save:
+            os.makedirs(os.path.dirname(args.save) or ".", exist_ok=True)
+            with open(args.save, "w") as f:
+                json.dump(snapshot, f, indent=1)
+            print(f"Saved {args.save}")
+    else:
+        snapshot = load(args.snapshot)
+
+    apply_defines(snapshot, cpp_defines({"CPPDEFINES": args.defines}))
+    _, tight = report(snapshot, args.margin, args.min_headroom)
+    return 1 if tight else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
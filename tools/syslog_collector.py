@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Minimal RFC 5424 UDP syslog collector for beacon log forwarding.
+
+Listens for datagrams as sent by the firmware (SyslogSink): one message per
+datagram, MSG holds one or more log lines, [meta sequenceId] is the sequence
+number of the first line and [bb@32473 lines] the line count. Per host it
+checks that sequence numbers continue without gaps or reordering and prints
+datagrams/s, lines/s, bytes/s, lost and reordered lines every interval.
+
+Set the beacon's Syslog Server to this machine (WiFi setup page) and the port
+to --port. --selftest sends synthetic traffic in the firmware format to the
+collector itself (with a deliberate gap and swap) to check the checker.
+
+Usage:
+  python tools/syslog_collector.py --port 5514 --interval 5 [--print]
+  python tools/syslog_collector.py --selftest --count 20000 --rate 2000
+"""
+import argparse
+import re
+import socket
+import sys
+import threading
+import time
+
+SEQ_MAX = 2147483647
+HEADER = re.compile(
+    rb"^<(\d{1,3})>1 (\S+) (\S+) (\S+) (\S+) (\S+) ((?:\[(?:[^\]\\]|\\.)*\])+|-) ?(.*)$", re.DOTALL)
+SD_PARAM = re.compile(rb'(\w+)="((?:[^"\\]|\\.)*)"')
+
+
+def parse(data):
+    m = HEADER.match(data)
+    if not m:
+        return None
+    sd = {k.decode(): v.decode() for k, v in SD_PARAM.findall(m.group(7))}
+    return {
+        "host": m.group(3).decode(errors="replace"),
+        "seq": int(sd.get("sequenceId", "0")),
+        "lines": int(sd.get("lines", "1")),
+        "msg": m.group(8).decode(errors="replace"),
+    }
+
+
+def seq_add(a, n):
+    return (a - 1 + n) % SEQ_MAX + 1
+
+
+def seq_diff(a, b):
+    """Signed distance a - b on the 1..SEQ_MAX circle."""
+    d = (a - b) % SEQ_MAX
+    return d - SEQ_MAX if d > SEQ_MAX // 2 else d
+
+
+class HostState:
+    def __init__(self):
+        self.expected = None
+        self.datagrams = 0
+        self.lines = 0
+        self.bytes = 0
+        self.lost = 0
+        self.reordered = 0
+
+
+def collect(sock, args, stop):
+    hosts = {}
+    last = time.time()
+    snap = {}
+    bad = 0
+    while not stop.is_set():
+        try:
+            data, _ = sock.recvfrom(2048)
+        except socket.timeout:
+            data = None
+        if data:
+            msg = parse(data)
+            if not msg:
+                bad += 1
+            else:
+                st = hosts.setdefault(msg["host"], HostState())
+                st.datagrams += 1
+                st.lines += msg["lines"]
+                st.bytes += len(data)
+                if st.expected is not None:
+                    d = seq_diff(msg["seq"], st.expected)
+                    if d > 0:
+                        st.lost += d
+                    elif d < 0:
+                        st.reordered += msg["lines"]
+                        st.lost = max(0, st.lost - msg["lines"])
+                if st.expected is None or seq_diff(msg["seq"], st.expected) >= 0:
+                    st.expected = seq_add(msg["seq"], msg["lines"])
+                if args.print:
+                    for line in msg["msg"].splitlines():
+                        print(f"{msg['host']}: {line}")
+
+        now = time.time()
+        if now - last >= args.interval:
+            dt = now - last
+            for host, st in sorted(hosts.items()):
+                p = snap.get(host, (0, 0, 0))
+                print(f"{host:>20}: {(st.datagrams - p[0]) / dt:7.1f} dgram/s {(st.lines - p[1]) / dt:8.1f} lines/s "
+                      f"{(st.bytes - p[2]) / dt:9.0f} B/s  lost {st.lost}  reordered {st.reordered}")
+                snap[host] = (st.datagrams, st.lines, st.bytes)
+            if bad:
+                print(f"{'':>20}  {bad} unparsable datagram(s)")
+            last = now
+    return hosts
+
+
+def selftest(args):
+    """Sends firmware-format datagrams to ourselves; one gap and one swap are injected."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 * 1024 * 1024)
+    sock.bind(("127.0.0.1", 0))
+    sock.settimeout(0.2)
+    port = sock.getsockname()[1]
+    stop = threading.Event()
+    result = {}
+    t = threading.Thread(target=lambda: result.update(collect(sock, args, stop)))
+    t.start()
+
+    out = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    seq = SEQ_MAX - 50  # cross the wrap on purpose
+    per = 4
+    pending = None
+    sent_lines = 0
+    t0 = time.time()
+    for i in range(args.count // per):
+        body = "\n".join(f"[TEST] line {i * per + k}" for k in range(per))
+        dgram = (f'<134>1 - selftest BambuBeacon - log [meta sequenceId="{seq}" sysUpTime="{int((time.time() - t0) * 100)}"]'
+                 f'[bb@32473 lines="{per}"] {body}').encode()
+        seq = seq_add(seq, per)
+        if i == 100:
+            continue  # gap: 4 lines lost
+        if i == 200:
+            pending = dgram  # swap with the next one
+            continue
+        out.sendto(dgram, ("127.0.0.1", port))
+        sent_lines += per
+        if pending:
+            out.sendto(pending, ("127.0.0.1", port))
+            sent_lines += per
+            pending = None
+        if args.rate:
+            target = t0 + sent_lines / args.rate
+            delay = target - time.time()
+            if delay > 0:
+                time.sleep(delay)
+    elapsed = time.time() - t0
+    time.sleep(0.5)
+    stop.set()
+    t.join()
+
+    st = result.get("selftest")
+    ok = st is not None and st.lines == sent_lines and st.lost == per and st.reordered == per
+    print(f"selftest: sent {sent_lines} lines in {elapsed:.2f} s ({sent_lines / elapsed:.0f} lines/s), "
+          f"received {st.lines if st else 0}, lost {st.lost if st else '?'} (expected {per}), "
+          f"reordered {st.reordered if st else '?'} (expected {per}) -> {'OK' if ok else 'FAIL'}")
+    return 0 if ok else 1
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=5514)
+    ap.add_argument("--interval", type=float, default=5.0)
+    ap.add_argument("--print", action="store_true", help="print every received line")
+    ap.add_argument("--selftest", action="store_true")
+    ap.add_argument("--count", type=int, default=20000, help="selftest: lines to send")
+    ap.add_argument("--rate", type=int, default=0, help="selftest: lines/s (0 = as fast as possible)")
+    args = ap.parse_args()
+
+    if args.selftest:
+        return selftest(args)
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    sock.settimeout(0.5)
+    print(f"listening on udp/{args.port}")
+    stop = threading.Event()
+    try:
+        collect(sock, args, stop)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())